@@ -0,0 +1,530 @@
+//! Benchmarks of the overhead of the wrapper around OpenEXR, as opposed to
+//! the codecs.
+//!
+//! Run with `cargo bench --bench ffi_overhead`.  All images are uncompressed,
+//! so that the time is spent moving data across the FFI boundary rather
+//! than compressing it.
+//!
+//! The groups are:
+//!
+//! * `ffi/stream/{read,seek}`: reading every chunk of a file with
+//!   `InputFile::raw_pixel_data()`, in order and in a scattered order, from
+//!   memory and through a `Cursor` with a range of read-ahead buffer sizes
+//!   (`read_stream()` and `seek_stream()` in `src/stream_io.rs`).
+//! * `ffi/stream/write`: writing an image to memory and through a `Cursor`
+//!   (`write_stream()` and `seek_stream()`).
+//! * `ffi/frame_buffer/{copy_and_offset,rebase}`: a single call of
+//!   `CEXR_FrameBuffer_copy_and_offset_scanlines()`, which builds a new
+//!   offset framebuffer, and of `CEXR_FrameBuffer_rebase_scanlines()`, which
+//!   moves the slices of an earlier copy, for a range of channel counts.
+//! * `ffi/frame_buffer/{read,write}_partial`: reading and writing an image in
+//!   bands of different numbers of scanlines, each of which offsets the
+//!   framebuffer once.
+//! * `ffi/open/<compression>`: opening a file from memory and through a
+//!   `Cursor`, both completely and reading only the header.
+//!
+//! # Baseline
+//!
+//! After a benchmark run, Criterion's estimates for all of these are
+//! gathered into one JSON file, along with the number of reader and writer
+//! calls each stream benchmark makes per iteration.  It's written to
+//! `ffi_overhead.json` in Criterion's output directory (`target/criterion`
+//! unless `CRITERION_HOME` or `CARGO_TARGET_DIR` say otherwise), or to the
+//! path in `OPENEXR_BENCH_BASELINE`.  Benchmarks left out by a filter keep
+//! their estimates from earlier runs.  To check for regressions, save a
+//! baseline with `cargo bench --bench ffi_overhead -- --save-baseline main`
+//! and compare against it later with `-- --baseline main`.
+
+#[macro_use]
+extern crate criterion;
+extern crate half;
+extern crate openexr;
+extern crate openexr_sys;
+
+use std::env;
+use std::fs;
+use std::io::Cursor;
+use std::path::{Path, PathBuf};
+
+use criterion::{black_box, BenchmarkId, Criterion, Throughput};
+use half::f16;
+
+use openexr::header::Compression;
+use openexr::input::InputOptions;
+use openexr::{
+    FrameBuffer, FrameBufferMut, Header, InputFile, IoStats, PixelType, ScanlineOutputFile,
+};
+use openexr_sys::*;
+
+const RESOLUTION: (u32, u32) = (1920, 1080);
+
+const CHANNELS: [&str; 4] = ["R", "G", "B", "A"];
+
+// Read-ahead buffer sizes for reads through a `Cursor`, where 0 means every
+// read OpenEXR does goes to the reader.
+const BUFFER_SIZES: [usize; 4] = [0, 4 * 1024, 64 * 1024, 1024 * 1024];
+
+// Scanlines per band for the partial reads and writes.
+const BAND_ROWS: [u32; 5] = [1, 16, 64, 256, 1080];
+
+// Channel counts for the framebuffer offsetting.
+const CHANNEL_COUNTS: [usize; 3] = [1, 4, 16];
+
+// A prime number of chunks to step over per read in the scattered order, so
+// that every chunk is visited once.
+const SEEK_STRIDE: usize = 37;
+
+// The name of the baseline file in Criterion's output directory.
+const BASELINE_NAME: &str = "ffi_overhead.json";
+
+type Pixel = (f16, f16, f16, f16);
+
+fn header(compression: Compression) -> Header {
+    let mut header = Header::new();
+    header
+        .set_resolution(RESOLUTION.0, RESOLUTION.1)
+        .set_compression(compression);
+    for name in &CHANNELS {
+        header.add_channel(name, PixelType::HALF);
+    }
+    header
+}
+
+fn pixels() -> Vec<Pixel> {
+    (0..RESOLUTION.0 * RESOLUTION.1)
+        .map(|i| {
+            let v = f16::from_f32((i % 1024) as f32 / 1024.0);
+            (v, v, v, f16::from_f32(1.0))
+        })
+        .collect()
+}
+
+fn image_bytes() -> u64 {
+    RESOLUTION.0 as u64 * RESOLUTION.1 as u64 * CHANNELS.len() as u64 * 2
+}
+
+fn encode_image(header: &Header, pixels: &[Pixel]) -> Vec<u8> {
+    let mut data = Vec::new();
+    {
+        let mut exr_file = ScanlineOutputFile::to_memory(&mut data, header).unwrap();
+        let mut fb = FrameBuffer::new(RESOLUTION.0, RESOLUTION.1);
+        fb.insert_channels(&CHANNELS, pixels);
+        exr_file.write_pixels(&fb).unwrap();
+    }
+    data
+}
+
+// The first scanline of each chunk, in the order they're read.
+fn chunk_scanlines(exr_file: &InputFile, scattered: bool) -> Vec<i32> {
+    let header = exr_file.header();
+    let rows = header.scanlines_per_chunk();
+    let chunks = ((header.data_dimensions().1 + rows - 1) / rows) as usize;
+    (0..chunks)
+        .map(|i| {
+            if scattered {
+                i * SEEK_STRIDE % chunks
+            } else {
+                i
+            }
+        })
+        .map(|chunk| header.data_origin().1 + (chunk as u32 * rows) as i32)
+        .collect()
+}
+
+fn read_chunks(exr_file: &mut InputFile, scanlines: &[i32]) {
+    for &y in scanlines {
+        black_box(exr_file.raw_pixel_data(y).unwrap());
+    }
+}
+
+// The reader and writer calls made by one iteration of a stream benchmark.
+struct IoCount {
+    id: String,
+    stats: IoStats,
+}
+
+fn io_difference(after: &IoStats, before: &IoStats) -> IoStats {
+    let mut stats = *after;
+    stats.bytes -= before.bytes;
+    stats.io_calls -= before.io_calls;
+    stats.seek_calls -= before.seek_calls;
+    stats
+}
+
+fn stream_read(c: &mut Criterion, io_counts: &mut Vec<IoCount>) {
+    let data = encode_image(&header(Compression::NO_COMPRESSION), &pixels());
+    for &(group_name, scattered) in &[("read", false), ("seek", true)] {
+        let mut group = c.benchmark_group(format!("ffi/stream/{}", group_name));
+        group
+            .sample_size(20)
+            .throughput(Throughput::Bytes(data.len() as u64));
+
+        {
+            let mut exr_file = InputFile::from_slice(&data).unwrap();
+            let scanlines = chunk_scanlines(&exr_file, scattered);
+            group.bench_function("memory", |b| {
+                b.iter(|| read_chunks(&mut exr_file, &scanlines))
+            });
+        }
+
+        for &buffer_size in &BUFFER_SIZES {
+            let mut cursor = Cursor::new(&data[..]);
+            let mut exr_file = InputFile::new_with_options(
+                &mut cursor,
+                InputOptions::new().set_buffer_size(buffer_size),
+            )
+            .unwrap();
+            let scanlines = chunk_scanlines(&exr_file, scattered);
+
+            let before = exr_file.stats();
+            read_chunks(&mut exr_file, &scanlines);
+            io_counts.push(IoCount {
+                id: format!("ffi/stream/{}/cursor/{}", group_name, buffer_size),
+                stats: io_difference(&exr_file.stats(), &before),
+            });
+
+            group.bench_function(BenchmarkId::new("cursor", buffer_size), |b| {
+                b.iter(|| read_chunks(&mut exr_file, &scanlines))
+            });
+        }
+        group.finish();
+    }
+}
+
+fn stream_write(c: &mut Criterion, io_counts: &mut Vec<IoCount>) {
+    let header = header(Compression::NO_COMPRESSION);
+    let pixels = pixels();
+    let mut fb = FrameBuffer::new(RESOLUTION.0, RESOLUTION.1);
+    fb.insert_channels(&CHANNELS, &pixels);
+
+    let mut group = c.benchmark_group("ffi/stream/write");
+    group
+        .sample_size(20)
+        .throughput(Throughput::Bytes(image_bytes()));
+    {
+        let mut buffer = Vec::new();
+        group.bench_function("memory", |b| {
+            b.iter(|| {
+                let mut exr_file = ScanlineOutputFile::to_memory(&mut buffer, &header).unwrap();
+                exr_file.write_pixels(&fb).unwrap();
+            })
+        });
+    }
+    {
+        let mut cursor = Cursor::new(Vec::new());
+        {
+            let mut exr_file = ScanlineOutputFile::new(&mut cursor, &header).unwrap();
+            exr_file.write_pixels(&fb).unwrap();
+            io_counts.push(IoCount {
+                id: "ffi/stream/write/cursor".to_string(),
+                stats: exr_file.stats(),
+            });
+        }
+        group.bench_function("cursor", |b| {
+            b.iter(|| {
+                cursor.get_mut().clear();
+                cursor.set_position(0);
+                let mut exr_file = ScanlineOutputFile::new(&mut cursor, &header).unwrap();
+                exr_file.write_pixels(&fb).unwrap();
+            })
+        });
+    }
+    group.finish();
+}
+
+fn stream(c: &mut Criterion) {
+    let mut io_counts = Vec::new();
+    stream_read(c, &mut io_counts);
+    stream_write(c, &mut io_counts);
+    if benchmarking() {
+        save_io_counts(&io_counts);
+    }
+}
+
+// A framebuffer of one scanline of `channels` interleaved HALF channels in
+// `pixels`.
+fn raw_frame_buffer(channels: usize, pixels: &mut [f16]) -> *mut CEXR_FrameBuffer {
+    let width = RESOLUTION.0 as usize;
+    let pixel_size = channels * 2;
+    let framebuffer = unsafe { CEXR_FrameBuffer_new() };
+    for channel in 0..channels {
+        let name = format!("C{}\0", channel);
+        unsafe {
+            CEXR_FrameBuffer_insert(
+                framebuffer,
+                name.as_ptr() as *const _,
+                PixelType::HALF,
+                (pixels.as_mut_ptr() as *mut std::os::raw::c_char).offset(channel as isize * 2),
+                pixel_size,
+                pixel_size * width,
+                1,
+                1,
+                0.0,
+                0,
+                0,
+            )
+        };
+    }
+    framebuffer
+}
+
+fn frame_buffer_offset(c: &mut Criterion) {
+    let mut group = c.benchmark_group("ffi/frame_buffer/copy_and_offset");
+    for &channels in &CHANNEL_COUNTS {
+        let mut pixels = vec![f16::from_f32(0.0); RESOLUTION.0 as usize * channels];
+        let framebuffer = raw_frame_buffer(channels, &mut pixels);
+        group.bench_function(BenchmarkId::from_parameter(channels), |b| {
+            b.iter(|| unsafe {
+                let copy = CEXR_FrameBuffer_copy_and_offset_scanlines(framebuffer, black_box(16));
+                CEXR_FrameBuffer_delete(copy);
+            })
+        });
+        unsafe { CEXR_FrameBuffer_delete(framebuffer) };
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("ffi/frame_buffer/rebase");
+    for &channels in &CHANNEL_COUNTS {
+        let mut pixels = vec![f16::from_f32(0.0); RESOLUTION.0 as usize * channels];
+        let framebuffer = raw_frame_buffer(channels, &mut pixels);
+        let rebased = unsafe { CEXR_FrameBuffer_copy_and_offset_scanlines(framebuffer, 0) };
+        // Alternate between two offsets, so that every call moves the
+        // slices, as with successive partial reads.
+        let mut offset = 0;
+        group.bench_function(BenchmarkId::from_parameter(channels), |b| {
+            b.iter(|| {
+                offset ^= 16;
+                black_box(unsafe {
+                    CEXR_FrameBuffer_rebase_scanlines(rebased, framebuffer, offset)
+                })
+            })
+        });
+        unsafe {
+            CEXR_FrameBuffer_delete(rebased);
+            CEXR_FrameBuffer_delete(framebuffer);
+        }
+    }
+    group.finish();
+}
+
+fn frame_buffer_partial(c: &mut Criterion) {
+    let header = header(Compression::NO_COMPRESSION);
+    let mut pixels = pixels();
+    let data = encode_image(&header, &pixels);
+    let width = RESOLUTION.0 as usize;
+
+    let mut group = c.benchmark_group("ffi/frame_buffer/read_partial");
+    group
+        .sample_size(20)
+        .throughput(Throughput::Bytes(image_bytes()));
+    for &rows in &BAND_ROWS {
+        let mut exr_file = InputFile::from_slice(&data).unwrap();
+        group.bench_function(BenchmarkId::from_parameter(rows), |b| {
+            b.iter(|| {
+                for (band, band_pixels) in pixels.chunks_mut(width * rows as usize).enumerate() {
+                    let band_rows = (band_pixels.len() / width) as u32;
+                    let mut fb = FrameBufferMut::new(RESOLUTION.0, band_rows);
+                    fb.insert_channels(
+                        &[("R", 0.0), ("G", 0.0), ("B", 0.0), ("A", 1.0)],
+                        band_pixels,
+                    );
+                    exr_file
+                        .read_pixels_partial(band as u32 * rows, &mut fb)
+                        .unwrap();
+                }
+            })
+        });
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("ffi/frame_buffer/write_partial");
+    group
+        .sample_size(20)
+        .throughput(Throughput::Bytes(image_bytes()));
+    for &rows in &BAND_ROWS {
+        let mut buffer = Vec::new();
+        group.bench_function(BenchmarkId::from_parameter(rows), |b| {
+            b.iter(|| {
+                let mut exr_file = ScanlineOutputFile::to_memory(&mut buffer, &header).unwrap();
+                for band_pixels in pixels.chunks(width * rows as usize) {
+                    let mut fb = FrameBuffer::new(RESOLUTION.0, (band_pixels.len() / width) as u32);
+                    fb.insert_channels(&CHANNELS, band_pixels);
+                    exr_file.write_pixels_incremental(&fb).unwrap();
+                }
+            })
+        });
+    }
+    group.finish();
+}
+
+fn open(c: &mut Criterion) {
+    let pixels = pixels();
+    for &compression in &[Compression::NO_COMPRESSION, Compression::ZIP_COMPRESSION] {
+        let data = encode_image(&header(compression), &pixels);
+        let mut group = c.benchmark_group(format!("ffi/open/{:?}", compression));
+        group.bench_function(BenchmarkId::new("full", "memory"), |b| {
+            b.iter(|| black_box(InputFile::from_slice(&data).unwrap()))
+        });
+        group.bench_function(BenchmarkId::new("header_only", "memory"), |b| {
+            b.iter(|| black_box(Header::read_from_slice(&data).unwrap()))
+        });
+        let mut cursor = Cursor::new(&data[..]);
+        group.bench_function(BenchmarkId::new("full", "cursor"), |b| {
+            b.iter(|| {
+                cursor.set_position(0);
+                black_box(InputFile::new(&mut cursor).unwrap());
+            })
+        });
+        group.bench_function(BenchmarkId::new("header_only", "cursor"), |b| {
+            b.iter(|| black_box(Header::read_from(&mut cursor).unwrap()))
+        });
+        group.finish();
+    }
+}
+
+criterion_group!(
+    benches,
+    stream,
+    frame_buffer_offset,
+    frame_buffer_partial,
+    open
+);
+
+fn main() {
+    benches();
+    Criterion::default().configure_from_args().final_summary();
+    if benchmarking() {
+        save_baseline();
+    }
+}
+
+// Whether Criterion is benchmarking, and so saving estimates, rather than
+// e.g. testing with `cargo test --benches`.
+fn benchmarking() -> bool {
+    env::args().any(|arg| arg == "--bench")
+}
+
+// Criterion's output directory, following Criterion's own defaults apart
+// from asking Cargo for the target directory.
+fn criterion_dir() -> PathBuf {
+    if let Some(dir) = env::var_os("CRITERION_HOME") {
+        PathBuf::from(dir)
+    } else if let Some(dir) = env::var_os("CARGO_TARGET_DIR") {
+        PathBuf::from(dir).join("criterion")
+    } else {
+        PathBuf::from("target/criterion")
+    }
+}
+
+fn baseline_path() -> PathBuf {
+    env::var_os("OPENEXR_BENCH_BASELINE")
+        .map(PathBuf::from)
+        .unwrap_or_else(|| criterion_dir().join(BASELINE_NAME))
+}
+
+fn io_counts_path() -> PathBuf {
+    criterion_dir().join("ffi_overhead_io.json")
+}
+
+fn json_string(s: &str) -> String {
+    let mut json = String::from("\"");
+    for c in s.chars() {
+        match c {
+            '"' => json.push_str("\\\""),
+            '\\' => json.push_str("\\\\"),
+            c if (c as u32) < 0x20 => json.push_str(&format!("\\u{:04x}", c as u32)),
+            c => json.push(c),
+        }
+    }
+    json.push('"');
+    json
+}
+
+// Saves the stream benchmarks' call counts for `save_baseline()`, since
+// they're measured before Criterion has run.
+fn save_io_counts(io_counts: &[IoCount]) {
+    let entries: Vec<String> = io_counts
+        .iter()
+        .map(|count| {
+            format!(
+                "    {}: {{\"bytes\": {}, \"io_calls\": {}, \"seek_calls\": {}}}",
+                json_string(&count.id),
+                count.stats.bytes,
+                count.stats.io_calls,
+                count.stats.seek_calls
+            )
+        })
+        .collect();
+    let json = format!("{{\n{}\n  }}", entries.join(",\n"));
+    let _ = fs::create_dir_all(criterion_dir());
+    if let Err(e) = fs::write(io_counts_path(), json) {
+        eprintln!("couldn't write {}: {}", io_counts_path().display(), e);
+    }
+}
+
+// Finds the directories of Criterion's latest estimates under `dir`, with
+// their paths relative to the output directory.
+fn find_estimates(dir: &Path, id: &str, found: &mut Vec<(String, PathBuf)>) {
+    let new_dir = dir.join("new");
+    if new_dir.join("estimates.json").is_file() {
+        found.push((id.to_string(), new_dir));
+    }
+    if let Ok(entries) = fs::read_dir(dir) {
+        for entry in entries.filter_map(|entry| entry.ok()) {
+            let name = entry.file_name().to_string_lossy().into_owned();
+            if name != "new" && name != "base" && name != "report" && entry.path().is_dir() {
+                find_estimates(&entry.path(), &format!("{}/{}", id, name), found);
+            }
+        }
+    }
+}
+
+// Gathers Criterion's estimates for this file's benchmarks into one file,
+// as `{"benchmarks": {<id>: {"benchmark": ..., "estimates": ...}}, "io":
+// {<id>: <call counts>}}`, where the ids are Criterion's directory names and
+// the objects are Criterion's own `benchmark.json` and `estimates.json`.
+fn save_baseline() {
+    let dir = criterion_dir();
+    let mut found = Vec::new();
+    if let Ok(entries) = fs::read_dir(&dir) {
+        for entry in entries.filter_map(|entry| entry.ok()) {
+            let name = entry.file_name().to_string_lossy().into_owned();
+            // Criterion replaces the slashes in group names with underscores.
+            if name.starts_with("ffi_") {
+                find_estimates(&entry.path(), &name, &mut found);
+            }
+        }
+    }
+    found.sort();
+
+    let benchmarks: Vec<String> = found
+        .iter()
+        .filter_map(|&(ref id, ref new_dir)| {
+            let estimates = fs::read_to_string(new_dir.join("estimates.json")).ok()?;
+            let benchmark = fs::read_to_string(new_dir.join("benchmark.json"))
+                .unwrap_or_else(|_| "null".to_string());
+            Some(format!(
+                "    {}: {{\"benchmark\": {}, \"estimates\": {}}}",
+                json_string(id),
+                benchmark.trim(),
+                estimates.trim()
+            ))
+        })
+        .collect();
+    let io_counts = fs::read_to_string(io_counts_path()).unwrap_or_else(|_| "{}".to_string());
+    let json = format!(
+        "{{\n  \"benchmarks\": {{\n{}\n  }},\n  \"io\": {}\n}}\n",
+        benchmarks.join(",\n"),
+        io_counts.trim()
+    );
+
+    let path = baseline_path();
+    match fs::write(&path, json) {
+        Ok(()) => println!(
+            "Wrote baseline of {} benchmarks to {}",
+            found.len(),
+            path.display()
+        ),
+        Err(e) => eprintln!("couldn't write {}: {}", path.display(), e),
+    }
+}
@@ -0,0 +1,406 @@
+//! Read and write throughput benchmarks.
+//!
+//! Run with `cargo bench`, or a subset of them with e.g.
+//! `cargo bench -- compression/read/PIZ`.
+//!
+//! Every iteration reads or writes one whole RGBA image, so the reported
+//! time is the time per image (images/s is its inverse), and the reported
+//! throughput is of uncompressed pixel data in MB/s.
+//!
+//! The groups are:
+//!
+//! * `compression/{read,write}/<compression>`: every compression mode, for
+//!   every pixel type and resolution, single-threaded and in memory.
+//! * `threads/{read,write}`: a range of per-file thread counts.
+//! * `backend/{read,write}`: reading from a slice, a file and a `Cursor`,
+//!   and writing to a `Vec`, a file and a `Cursor`.
+//! * `effort/write/{ZIP,DWA}`: each `CompressionEffort` preset, starting
+//!   from `ZIP_COMPRESSION` and `DWAA_COMPRESSION`.  The size of each
+//!   preset's files is printed before its benchmark, since the speed is
+//!   only half of the trade-off.
+
+#[macro_use]
+extern crate criterion;
+extern crate half;
+extern crate openexr;
+
+use std::fs::{self, File};
+use std::io::{Cursor, Seek, Write};
+use std::path::PathBuf;
+
+use criterion::{BenchmarkId, Criterion, Throughput};
+use half::f16;
+
+use openexr::header::{Compression, CompressionEffort};
+use openexr::input::InputOptions;
+use openexr::output::OutputOptions;
+use openexr::{FrameBuffer, FrameBufferMut, Header, InputFile, PixelType, ScanlineOutputFile};
+
+const COMPRESSIONS: [Compression; 10] = [
+    Compression::NO_COMPRESSION,
+    Compression::RLE_COMPRESSION,
+    Compression::ZIPS_COMPRESSION,
+    Compression::ZIP_COMPRESSION,
+    Compression::PIZ_COMPRESSION,
+    Compression::PXR24_COMPRESSION,
+    Compression::B44_COMPRESSION,
+    Compression::B44A_COMPRESSION,
+    Compression::DWAA_COMPRESSION,
+    Compression::DWAB_COMPRESSION,
+];
+
+const PIXEL_TYPES: [PixelType; 3] = [PixelType::HALF, PixelType::FLOAT, PixelType::UINT];
+
+const RESOLUTIONS: [(u32, u32); 3] = [(256, 256), (1024, 1024), (1920, 1080)];
+
+// Per-file thread counts, where 0 means decoding and encoding on the
+// calling thread.
+const THREADS: [usize; 5] = [0, 1, 2, 4, 8];
+
+const CHANNELS: [&str; 4] = ["R", "G", "B", "A"];
+
+// The configuration used by the groups that vary something other than
+// compression, pixel type or resolution.
+const DEFAULT_COMPRESSION: Compression = Compression::PIZ_COMPRESSION;
+const DEFAULT_PIXEL_TYPE: PixelType = PixelType::HALF;
+const DEFAULT_RESOLUTION: (u32, u32) = (1920, 1080);
+
+// An RGBA image in one of the pixel types.
+enum Pixels {
+    Half(Vec<(f16, f16, f16, f16)>),
+    Float(Vec<(f32, f32, f32, f32)>),
+    Uint(Vec<(u32, u32, u32, u32)>),
+}
+
+impl Pixels {
+    // Creates an image of smooth gradients with a little noise, so that it
+    // compresses roughly like a real one.
+    fn new(pixel_type: PixelType, (width, height): (u32, u32)) -> Pixels {
+        let mut seed = 0x2545_f491u32;
+        let values: Vec<[f32; 4]> = (0..height)
+            .flat_map(|y| (0..width).map(move |x| (x, y)))
+            .map(|(x, y)| {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                let noise = (seed >> 16) as f32 / 65536.0 * 0.02;
+                let u = x as f32 / width as f32;
+                let v = y as f32 / height as f32;
+                [u + noise, v + noise, (u * v) + noise, 1.0]
+            })
+            .collect();
+
+        match pixel_type {
+            PixelType::HALF => Pixels::Half(
+                values
+                    .iter()
+                    .map(|p| {
+                        (
+                            f16::from_f32(p[0]),
+                            f16::from_f32(p[1]),
+                            f16::from_f32(p[2]),
+                            f16::from_f32(p[3]),
+                        )
+                    })
+                    .collect(),
+            ),
+            PixelType::FLOAT => {
+                Pixels::Float(values.iter().map(|p| (p[0], p[1], p[2], p[3])).collect())
+            }
+            PixelType::UINT => Pixels::Uint(
+                values
+                    .iter()
+                    .map(|p| {
+                        let id = |c: f32| (c * 4096.0) as u32;
+                        (id(p[0]), id(p[1]), id(p[2]), id(p[3]))
+                    })
+                    .collect(),
+            ),
+        }
+    }
+
+    fn frame_buffer(&self, (width, height): (u32, u32)) -> FrameBuffer<'_> {
+        let mut fb = FrameBuffer::new(width, height);
+        match *self {
+            Pixels::Half(ref data) => fb.insert_channels(&CHANNELS, data),
+            Pixels::Float(ref data) => fb.insert_channels(&CHANNELS, data),
+            Pixels::Uint(ref data) => fb.insert_channels(&CHANNELS, data),
+        };
+        fb
+    }
+
+    fn frame_buffer_mut(&mut self, (width, height): (u32, u32)) -> FrameBufferMut<'_> {
+        let names_and_fills = [("R", 0.0), ("G", 0.0), ("B", 0.0), ("A", 1.0)];
+        let mut fb = FrameBufferMut::new(width, height);
+        match *self {
+            Pixels::Half(ref mut data) => fb.insert_channels(&names_and_fills, data),
+            Pixels::Float(ref mut data) => fb.insert_channels(&names_and_fills, data),
+            Pixels::Uint(ref mut data) => fb.insert_channels(&names_and_fills, data),
+        };
+        fb
+    }
+}
+
+// The size of an image's uncompressed pixel data in bytes.
+fn image_bytes(pixel_type: PixelType, (width, height): (u32, u32)) -> u64 {
+    let channel_size = match pixel_type {
+        PixelType::HALF => 2,
+        PixelType::FLOAT | PixelType::UINT => 4,
+    };
+    width as u64 * height as u64 * CHANNELS.len() as u64 * channel_size
+}
+
+fn header(compression: Compression, pixel_type: PixelType, (width, height): (u32, u32)) -> Header {
+    let mut header = Header::new();
+    header
+        .set_resolution(width, height)
+        .set_compression(compression);
+    for name in &CHANNELS {
+        header.add_channel(name, pixel_type);
+    }
+    header
+}
+
+fn write_image<W: Write + Seek>(writer: &mut W, header: &Header, pixels: &Pixels, threads: usize) {
+    let mut exr_file = ScanlineOutputFile::new_with_options(
+        writer,
+        header,
+        OutputOptions::new().set_threads(threads),
+    )
+    .unwrap();
+    exr_file
+        .write_pixels(&pixels.frame_buffer(header.data_dimensions()))
+        .unwrap();
+}
+
+fn encode_image(header: &Header, pixels: &Pixels) -> Vec<u8> {
+    let mut cursor = Cursor::new(Vec::new());
+    write_image(&mut cursor, header, pixels, 0);
+    cursor.into_inner()
+}
+
+fn read_image(exr_file: &mut InputFile, pixels: &mut Pixels) {
+    let dimensions = exr_file.header().data_dimensions();
+    exr_file
+        .read_pixels(&mut pixels.frame_buffer_mut(dimensions))
+        .unwrap();
+}
+
+fn bench_id(pixel_type: PixelType, (width, height): (u32, u32)) -> BenchmarkId {
+    BenchmarkId::new(format!("{:?}", pixel_type), format!("{}x{}", width, height))
+}
+
+// A file in the temporary directory, deleted when dropped.
+struct TempFile(PathBuf);
+
+impl TempFile {
+    fn new(name: &str) -> TempFile {
+        TempFile(std::env::temp_dir().join(format!(
+            "openexr-bench-{}-{}.exr",
+            std::process::id(),
+            name
+        )))
+    }
+}
+
+impl Drop for TempFile {
+    fn drop(&mut self) {
+        let _ = fs::remove_file(&self.0);
+    }
+}
+
+fn compression_write(c: &mut Criterion) {
+    for &compression in &COMPRESSIONS {
+        let mut group = c.benchmark_group(format!("compression/write/{:?}", compression));
+        group.sample_size(10);
+        for &pixel_type in &PIXEL_TYPES {
+            for &resolution in &RESOLUTIONS {
+                let header = header(compression, pixel_type, resolution);
+                let pixels = Pixels::new(pixel_type, resolution);
+                let mut cursor = Cursor::new(Vec::new());
+                group.throughput(Throughput::Bytes(image_bytes(pixel_type, resolution)));
+                group.bench_function(bench_id(pixel_type, resolution), |b| {
+                    b.iter(|| {
+                        cursor.get_mut().clear();
+                        write_image(&mut cursor, &header, &pixels, 0);
+                    })
+                });
+            }
+        }
+        group.finish();
+    }
+}
+
+fn compression_read(c: &mut Criterion) {
+    for &compression in &COMPRESSIONS {
+        let mut group = c.benchmark_group(format!("compression/read/{:?}", compression));
+        group.sample_size(10);
+        for &pixel_type in &PIXEL_TYPES {
+            for &resolution in &RESOLUTIONS {
+                let mut pixels = Pixels::new(pixel_type, resolution);
+                let data = encode_image(&header(compression, pixel_type, resolution), &pixels);
+                group.throughput(Throughput::Bytes(image_bytes(pixel_type, resolution)));
+                group.bench_function(bench_id(pixel_type, resolution), |b| {
+                    b.iter(|| {
+                        let mut exr_file = InputFile::from_slice(&data).unwrap();
+                        read_image(&mut exr_file, &mut pixels);
+                    })
+                });
+            }
+        }
+        group.finish();
+    }
+}
+
+fn threads(c: &mut Criterion) {
+    let header = header(DEFAULT_COMPRESSION, DEFAULT_PIXEL_TYPE, DEFAULT_RESOLUTION);
+    let mut pixels = Pixels::new(DEFAULT_PIXEL_TYPE, DEFAULT_RESOLUTION);
+    let data = encode_image(&header, &pixels);
+    let bytes = image_bytes(DEFAULT_PIXEL_TYPE, DEFAULT_RESOLUTION);
+
+    let mut group = c.benchmark_group("threads/write");
+    group.sample_size(10).throughput(Throughput::Bytes(bytes));
+    for &threads in &THREADS {
+        let mut cursor = Cursor::new(Vec::new());
+        group.bench_function(BenchmarkId::from_parameter(threads), |b| {
+            b.iter(|| {
+                cursor.get_mut().clear();
+                write_image(&mut cursor, &header, &pixels, threads);
+            })
+        });
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("threads/read");
+    group.sample_size(10).throughput(Throughput::Bytes(bytes));
+    for &threads in &THREADS {
+        group.bench_function(BenchmarkId::from_parameter(threads), |b| {
+            b.iter(|| {
+                let mut exr_file = InputFile::from_slice_with_options(
+                    &data,
+                    InputOptions::new().set_threads(threads),
+                )
+                .unwrap();
+                read_image(&mut exr_file, &mut pixels);
+            })
+        });
+    }
+    group.finish();
+}
+
+fn backend(c: &mut Criterion) {
+    let header = header(DEFAULT_COMPRESSION, DEFAULT_PIXEL_TYPE, DEFAULT_RESOLUTION);
+    let mut pixels = Pixels::new(DEFAULT_PIXEL_TYPE, DEFAULT_RESOLUTION);
+    let data = encode_image(&header, &pixels);
+    let bytes = image_bytes(DEFAULT_PIXEL_TYPE, DEFAULT_RESOLUTION);
+
+    let mut group = c.benchmark_group("backend/write");
+    group.sample_size(10).throughput(Throughput::Bytes(bytes));
+    {
+        let mut buffer = Vec::new();
+        group.bench_function("memory", |b| {
+            b.iter(|| {
+                let mut exr_file = ScanlineOutputFile::to_memory(&mut buffer, &header).unwrap();
+                exr_file
+                    .write_pixels(&pixels.frame_buffer(DEFAULT_RESOLUTION))
+                    .unwrap();
+            })
+        });
+    }
+    {
+        let temp_file = TempFile::new("write");
+        group.bench_function("file", |b| {
+            b.iter(|| {
+                let mut file = File::create(&temp_file.0).unwrap();
+                write_image(&mut file, &header, &pixels, 0);
+            })
+        });
+    }
+    {
+        let mut cursor = Cursor::new(Vec::new());
+        group.bench_function("cursor", |b| {
+            b.iter(|| {
+                cursor.get_mut().clear();
+                write_image(&mut cursor, &header, &pixels, 0);
+            })
+        });
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("backend/read");
+    group.sample_size(10).throughput(Throughput::Bytes(bytes));
+    group.bench_function("memory", |b| {
+        b.iter(|| {
+            let mut exr_file = InputFile::from_slice(&data).unwrap();
+            read_image(&mut exr_file, &mut pixels);
+        })
+    });
+    {
+        let temp_file = TempFile::new("read");
+        fs::write(&temp_file.0, &data).unwrap();
+        group.bench_function("file", |b| {
+            b.iter(|| {
+                let mut file = File::open(&temp_file.0).unwrap();
+                let mut exr_file = InputFile::new(&mut file).unwrap();
+                read_image(&mut exr_file, &mut pixels);
+            })
+        });
+    }
+    {
+        let mut cursor = Cursor::new(&data[..]);
+        group.bench_function("cursor", |b| {
+            b.iter(|| {
+                let mut exr_file = InputFile::new(&mut cursor).unwrap();
+                read_image(&mut exr_file, &mut pixels);
+            })
+        });
+    }
+    group.finish();
+}
+
+fn effort(c: &mut Criterion) {
+    let bytes = image_bytes(DEFAULT_PIXEL_TYPE, DEFAULT_RESOLUTION);
+    let pixels = Pixels::new(DEFAULT_PIXEL_TYPE, DEFAULT_RESOLUTION);
+    for &(family, compression) in &[
+        ("ZIP", Compression::ZIP_COMPRESSION),
+        ("DWA", Compression::DWAA_COMPRESSION),
+    ] {
+        let mut group = c.benchmark_group(format!("effort/write/{}", family));
+        group.sample_size(10).throughput(Throughput::Bytes(bytes));
+        for &effort in &[
+            CompressionEffort::Fastest,
+            CompressionEffort::Default,
+            CompressionEffort::Smallest,
+        ] {
+            let mut header = header(compression, DEFAULT_PIXEL_TYPE, DEFAULT_RESOLUTION);
+            header.set_compression_effort(effort);
+            println!(
+                "effort/write/{}/{:?} ({:?}): {} bytes",
+                family,
+                effort,
+                header.compression(),
+                encode_image(&header, &pixels).len()
+            );
+            let mut buffer = Vec::new();
+            group.bench_function(BenchmarkId::from_parameter(format!("{:?}", effort)), |b| {
+                b.iter(|| {
+                    let mut exr_file = ScanlineOutputFile::to_memory(&mut buffer, &header).unwrap();
+                    exr_file
+                        .write_pixels(&pixels.frame_buffer(DEFAULT_RESOLUTION))
+                        .unwrap();
+                })
+            });
+        }
+        group.finish();
+    }
+}
+
+criterion_group!(
+    benches,
+    compression_write,
+    compression_read,
+    threads,
+    backend,
+    effort
+);
+criterion_main!(benches);
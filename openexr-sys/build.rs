@@ -30,7 +30,7 @@ fn main() {
                 // There's no enviroment variable, so use pkgconfig to find
                 // the libs.
                 let paths = pkg_config::Config::new()
-                    .atleast_version("2.0.0")
+                    .atleast_version("2.3.0")
                     .probe("OpenEXR")
                     .map(|openexr_cfg| openexr_cfg.include_paths.clone())
                     .map_err(|err| {
@@ -57,7 +57,7 @@ fn main() {
                 // There's no enviroment variable, so use pkgconfig to find
                 // the libs.
                 let paths = pkg_config::Config::new()
-                    .atleast_version("2.0.0")
+                    .atleast_version("2.3.0")
                     .cargo_metadata(false) // OpenEXR already pulls in all the flags we need
                     .probe("IlmBase")
                     .map(|ilmbase_cfg| ilmbase_cfg.include_paths.clone())
@@ -101,7 +101,14 @@ fn main() {
         cc.file("c_wrapper/cexr.cpp")
             .file("c_wrapper/rust_istream.cpp")
             .file("c_wrapper/memory_istream.cpp")
+            .file("c_wrapper/memory_ostream.cpp")
+            .file("c_wrapper/mapped_istream.cpp")
             .file("c_wrapper/rust_ostream.cpp")
+            .file("c_wrapper/half_convert.cpp")
+            .file("c_wrapper/callback_thread_provider.cpp")
+            .file("c_wrapper/preview.cpp")
+            .file("c_wrapper/chunk_table.cpp")
+            .file("c_wrapper/prefixed_istream.cpp")
             .compile("libcexr.a");
     }
 }
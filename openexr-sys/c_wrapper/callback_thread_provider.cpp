@@ -0,0 +1,49 @@
+#include "callback_thread_provider.hpp"
+
+void CEXR_Task::run() {
+    CallbackThreadProvider *provider = this->provider;
+    try {
+        task->execute();
+    } catch (...) {
+        // OpenEXR's tasks keep their own errors for the file to report
+        // after the task group is done, so this shouldn't happen.  Either
+        // way, the task must still be completed below.
+    }
+    delete task;
+    delete this;
+    provider->task_done();
+}
+
+CallbackThreadProvider::~CallbackThreadProvider() {
+    finish();
+    delete_executor_ptr(executor);
+}
+
+int CallbackThreadProvider::numThreads() const {
+    return thread_count;
+}
+
+void CallbackThreadProvider::setNumThreads(int count) {
+    thread_count = count;
+}
+
+void CallbackThreadProvider::addTask(IlmThread::Task *task) {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        pending += 1;
+    }
+    add_task_ptr(executor, new CEXR_Task{task, this});
+}
+
+void CallbackThreadProvider::finish() {
+    std::unique_lock<std::mutex> lock{mutex};
+    idle.wait(lock, [this] { return pending == 0; });
+}
+
+void CallbackThreadProvider::task_done() {
+    std::lock_guard<std::mutex> lock{mutex};
+    pending -= 1;
+    if (pending == 0) {
+        idle.notify_all();
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef CEXR_CALLBACK_THREAD_PROVIDER_H_
+#define CEXR_CALLBACK_THREAD_PROVIDER_H_
+
+#include "cexr.h"
+
+#include "IlmThreadPool.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+class CallbackThreadProvider;
+
+// A task handed to the Rust side, which must run it exactly once with
+// CEXR_Task_run().
+struct CEXR_Task {
+    IlmThread::Task *task;
+    CallbackThreadProvider *provider;
+
+    // Executes and deletes the task, which is how IlmThread signals its
+    // completion to the task group waiting on it.
+    void run();
+};
+
+// A ThreadPoolProvider that hands every task to a Rust executor via a
+// callback, instead of running it on IlmThread's own worker threads.
+//
+// `numThreads()` just reports `thread_count`, since the executor decides
+// how many tasks actually run at once.  `finish()` waits for every task
+// handed out so far to be run.  The executor is released with
+// `delete_executor` when the provider is destroyed, which IlmThread does
+// when the provider is replaced.
+class CallbackThreadProvider: public IlmThread::ThreadPoolProvider {
+public:
+    CallbackThreadProvider(
+        int thread_count,
+        void *executor,
+        void (*add_task_ptr)(void *, CEXR_Task *),
+        void (*delete_executor_ptr)(void *)
+    )
+        : thread_count{thread_count},
+        executor{executor},
+        add_task_ptr{add_task_ptr},
+        delete_executor_ptr{delete_executor_ptr},
+        pending{0} {}
+
+    ~CallbackThreadProvider();
+
+    CallbackThreadProvider(const CallbackThreadProvider &) = delete;
+    CallbackThreadProvider &operator=(const CallbackThreadProvider &) = delete;
+
+    int numThreads() const;
+    void setNumThreads(int count);
+    void addTask(IlmThread::Task *task);
+    void finish();
+
+private:
+    friend struct CEXR_Task;
+    void task_done();
+
+    int thread_count;
+    void *executor;
+    void (*add_task_ptr)(void *, CEXR_Task *);
+    void (*delete_executor_ptr)(void *);
+
+    std::mutex mutex;
+    std::condition_variable idle;
+    std::size_t pending; // Tasks handed out but not run yet.
+};
+
+#endif
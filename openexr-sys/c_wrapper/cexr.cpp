@@ -1,7 +1,11 @@
 #include "cexr.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated"
@@ -11,14 +15,33 @@
 #include "ImfChannelList.h"
 #include "ImfHeader.h"
 #include "ImfFrameBuffer.h"
+#include "ImfDeepFrameBuffer.h"
 #include "ImfOutputFile.h"
 #include "ImfInputFile.h"
+#include "ImfTiledOutputFile.h"
+#include "ImfTiledInputFile.h"
+#include "ImfDeepScanLineInputFile.h"
+#include "ImfDeepScanLineOutputFile.h"
+#include "ImfMultiPartInputFile.h"
+#include "ImfMultiPartOutputFile.h"
+#include "ImfInputPart.h"
+#include "ImfOutputPart.h"
+#include "ImfPartType.h"
 #include "Iex.h"
 #include "ImfStandardAttributes.h"
 #include "ImfThreading.h"
+#include "ImfVersion.h"
 #pragma GCC diagnostic pop
 
+#include "callback_thread_provider.hpp"
+#include "chunk_table.hpp"
+#include "half_convert.hpp"
+#include "io_stats.hpp"
 #include "memory_istream.hpp"
+#include "memory_ostream.hpp"
+#include "mapped_istream.hpp"
+#include "prefixed_istream.hpp"
+#include "preview.hpp"
 #include "rust_istream.hpp"
 #include "rust_ostream.hpp"
 
@@ -27,6 +50,7 @@ using namespace Imf;
 
 static_assert(sizeof(CEXR_V2i) == sizeof(V2i), "V2i size is correct");
 static_assert(sizeof(CEXR_Box2i) == sizeof(Box2i), "Box2i size is correct");
+static_assert(sizeof(CEXR_PreviewRgba) == sizeof(PreviewRgba), "PreviewRgba size is correct");
 
 static char *copy_err(const char *err) {
     size_t len = strlen(err)+1;
@@ -35,15 +59,29 @@ static char *copy_err(const char *err) {
     return result;
 }
 
+// Copies the counters of a stream to `out`, or zeroes it for streams that
+// don't keep any.
+static void copy_io_stats(const IoCounted *stream, CEXR_IoStats *out) {
+    IoStats stats;
+    if (stream) {
+        stats = stream->io_stats();
+    }
+    out->bytes = stats.bytes;
+    out->calls = stats.calls;
+    out->seeks = stats.seeks;
+    out->nanos = stats.nanos;
+}
+
 int CEXR_IStream_from_reader(
     void *reader,
-    int (*read_ptr)(void *, char *, int, int *err_out),
+    int (*read_ptr)(void *, char *, int, int *read_out, int *err_out),
     int (*seekp_ptr)(void *, uint64_t, int *err_out),
+    size_t buffer_size,
     CEXR_IStream **out,
     const char **err_out
 ) {
     try {
-        *out = reinterpret_cast<CEXR_IStream *>(new RustIStream(reader, read_ptr, seekp_ptr));
+        *out = reinterpret_cast<CEXR_IStream *>(new RustIStream(reader, read_ptr, seekp_ptr, buffer_size));
     } catch(const std::exception &e) {
         *err_out = copy_err(e.what());
         return 1;
@@ -56,19 +94,102 @@ CEXR_IStream *CEXR_IStream_from_memory(const char *filename, char *data, size_t
     return reinterpret_cast<CEXR_IStream *>(new MemoryIStream(filename, data, size));
 }
 
+void CEXR_IStream_reset_memory(CEXR_IStream *stream, char *data, size_t size) {
+    reinterpret_cast<MemoryIStream *>(stream)->reset(data, size);
+}
+
+int CEXR_IStream_from_file_mmap(const char *path, CEXR_IStream **out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<CEXR_IStream *>(new MappedIStream(path));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+CEXR_IStream *CEXR_IStream_with_prefix(CEXR_IStream *stream, const char *prefix, size_t size) {
+    return reinterpret_cast<CEXR_IStream *>(new PrefixedIStream(reinterpret_cast<IStream *>(stream), prefix, size));
+}
+
+// Reads `size` bytes at `position`, leaving the stream where it was.
+int CEXR_IStream_read_at(CEXR_IStream *stream, uint64_t position, char *out, size_t size, const char **err_out) {
+    auto &is = *reinterpret_cast<IStream *>(stream);
+    Int64 old_position = 0;
+    try {
+        old_position = is.tellg();
+        is.seekg(position);
+        is.read(out, static_cast<int>(size));
+        is.seekg(old_position);
+    } catch(const std::exception &e) {
+        // Restoring the position can fail too, which mustn't throw out of
+        // here.
+        try {
+            is.clear();
+            is.seekg(old_position);
+        } catch(...) {}
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// Finds the chunks of the scanline file on `stream`, with an offset and size
+// of 0 for chunks that are missing.  See read_chunk_table().
+//
+// `count` must be the number of chunks in the file.
+int CEXR_IStream_read_chunk_table(CEXR_IStream *stream, uint64_t *offsets, uint64_t *sizes, size_t count, uint64_t *table_end_out, const char **err_out) {
+    try {
+        ChunkTable table;
+        read_chunk_table(*reinterpret_cast<IStream *>(stream), table);
+        if(table.offsets.size() != count) {
+            throw std::runtime_error("wrong number of chunks for the file");
+        }
+        std::copy(table.offsets.begin(), table.offsets.end(), offsets);
+        std::copy(table.sizes.begin(), table.sizes.end(), sizes);
+        *table_end_out = table.table_end;
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
 void CEXR_IStream_delete(CEXR_IStream *stream) {
     delete reinterpret_cast<IStream *>(stream);
 }
 
+void CEXR_IStream_stats(const CEXR_IStream *stream, CEXR_IoStats *out) {
+    copy_io_stats(dynamic_cast<const IoCounted *>(reinterpret_cast<const IStream *>(stream)), out);
+}
+
 int CEXR_OStream_from_writer(
     void *writer,
     int (*write_ptr)(void *, const char *, int, int *err_out),
     int (*seekp_ptr)(void *, uint64_t, int *err_out),
+    size_t buffer_size,
+    CEXR_OStream **out,
+    const char **err_out
+) {
+    try {
+        *out = reinterpret_cast<CEXR_OStream *>(new RustOStream(writer, write_ptr, seekp_ptr, buffer_size));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_OStream_from_memory(
+    void *vec,
+    int (*sync_ptr)(void *, size_t len, size_t min_capacity, char **data_out, size_t *capacity_out),
     CEXR_OStream **out,
     const char **err_out
 ) {
     try {
-        *out = reinterpret_cast<CEXR_OStream *>(new RustOStream(writer, write_ptr, seekp_ptr));
+        *out = reinterpret_cast<CEXR_OStream *>(new MemoryOStream(vec, sync_ptr));
     } catch(const std::exception &e) {
         *err_out = copy_err(e.what());
         return 1;
@@ -81,6 +202,10 @@ void CEXR_OStream_delete(CEXR_OStream *stream) {
     delete reinterpret_cast<OStream *>(stream);
 }
 
+void CEXR_OStream_stats(const CEXR_OStream *stream, CEXR_IoStats *out) {
+    copy_io_stats(dynamic_cast<const IoCounted *>(reinterpret_cast<const OStream *>(stream)), out);
+}
+
 
 //----------------------------------------------------
 // ChannelListIter
@@ -149,10 +274,51 @@ CEXR_ChannelListIter *CEXR_Header_channel_list_iter(const CEXR_Header *header) {
     return channel_iter;
 }
 
+CEXR_Header *CEXR_Header_copy(const CEXR_Header *header) {
+    return reinterpret_cast<CEXR_Header *>(new Header(*reinterpret_cast<const Header *>(header)));
+}
+
 void CEXR_Header_delete(CEXR_Header *header) {
     delete reinterpret_cast<Header *>(header);
 }
 
+int CEXR_Header_read_from_stream(CEXR_IStream *stream, CEXR_Header **out, const char **err_out) {
+    try {
+        auto &is = *reinterpret_cast<IStream *>(stream);
+
+        // Magic number and version field, as in ImfInputFile.cpp.
+        char magic_and_version[8];
+        is.read(magic_and_version, 8);
+        if(!isImfMagic(magic_and_version)) {
+            throw std::runtime_error("not an OpenEXR file");
+        }
+        int version = 0;
+        for(int i = 7; i >= 4; i--) {
+            version = (version << 8) | static_cast<unsigned char>(magic_and_version[i]);
+        }
+        if(getVersion(version) != EXR_VERSION) {
+            throw std::runtime_error("unsupported OpenEXR file format version");
+        }
+        if(!supportsFlags(getFlags(version))) {
+            throw std::runtime_error("OpenEXR file uses unsupported features");
+        }
+
+        auto header = new Header;
+        try {
+            header->readFrom(is, version);
+        } catch(...) {
+            delete header;
+            throw;
+        }
+        *out = reinterpret_cast<CEXR_Header *>(header);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
 const CEXR_Box2i *CEXR_Header_display_window(const CEXR_Header *header) {
     return reinterpret_cast<const CEXR_Box2i *>(&reinterpret_cast<const Header *>(header)->displayWindow());
 }
@@ -180,14 +346,44 @@ void CEXR_Header_set_screen_window_width(CEXR_Header *header, float width) {
     reinterpret_cast<Header *>(header)->screenWindowWidth() = width;
 }
 
+CEXR_LineOrder CEXR_Header_line_order(const CEXR_Header *header) {
+    return static_cast<CEXR_LineOrder>(reinterpret_cast<const Header *>(header)->lineOrder());
+}
+
 void CEXR_Header_set_line_order(CEXR_Header *header, CEXR_LineOrder line_order) {
     *reinterpret_cast<CEXR_LineOrder *>(&reinterpret_cast<Header *>(header)->lineOrder()) = line_order;
 }
 
+CEXR_Compression CEXR_Header_compression(const CEXR_Header *header) {
+    return static_cast<CEXR_Compression>(reinterpret_cast<const Header *>(header)->compression());
+}
+
 void CEXR_Header_set_compression(CEXR_Header *header, CEXR_Compression compression) {
     *reinterpret_cast<CEXR_Compression *>(&reinterpret_cast<Header *>(header)->compression()) = compression;
 }
 
+int CEXR_Header_scanlines_per_chunk(const CEXR_Header *header) {
+    return scanlines_per_chunk(reinterpret_cast<const Header *>(header)->compression());
+}
+
+bool CEXR_Header_has_dwa_compression_level(const CEXR_Header *header) {
+    return hasDwaCompressionLevel(*reinterpret_cast<const Header *>(header));
+}
+
+float CEXR_Header_dwa_compression_level(const CEXR_Header *header) {
+    return dwaCompressionLevel(*reinterpret_cast<const Header *>(header));
+}
+
+// The level is stored as an attribute, so that it's also in the files
+// written.
+void CEXR_Header_set_dwa_compression_level(CEXR_Header *header, float level) {
+    addDwaCompressionLevel(*reinterpret_cast<Header *>(header), level);
+}
+
+void CEXR_Header_erase_dwa_compression_level(CEXR_Header *header) {
+    reinterpret_cast<Header *>(header)->erase("dwaCompressionLevel");
+}
+
 bool CEXR_Header_has_envmap(const CEXR_Header *header) {
     return hasEnvmap(*reinterpret_cast<const Header *>(header));
 }
@@ -208,7 +404,7 @@ size_t CEXR_Header_multiview(const CEXR_Header *header, CEXR_Slice *out) {
     auto &v = multiView(*reinterpret_cast<const Header *>(header));
     if (out != nullptr) {
         for (size_t i = 0; i < v.size(); ++i) {
-            out[i] = CEXR_Slice{const_cast<void*>(static_cast<const void*>(v[0].data())), v[0].size()};
+            out[i] = CEXR_Slice{const_cast<void*>(static_cast<const void*>(v[i].data())), v[i].size()};
         }
     }
     return v.size();
@@ -223,10 +419,82 @@ void CEXR_Header_set_multiview(CEXR_Header *header, const CEXR_Slice* views, siz
     addMultiView(*reinterpret_cast<Header *>(header), v);
 }
 
+bool CEXR_Header_has_name(const CEXR_Header *header) {
+    return reinterpret_cast<const Header *>(header)->hasName();
+}
+
+CEXR_Slice CEXR_Header_name(const CEXR_Header *header) {
+    auto &name = reinterpret_cast<const Header *>(header)->name();
+    return CEXR_Slice {
+        const_cast<char *>(name.data()),
+        name.size(),
+    };
+}
+
+void CEXR_Header_set_name(CEXR_Header *header, const char *name) {
+    reinterpret_cast<Header *>(header)->setName(name);
+}
+
+bool CEXR_Header_has_view(const CEXR_Header *header) {
+    return reinterpret_cast<const Header *>(header)->hasView();
+}
+
+CEXR_Slice CEXR_Header_view(const CEXR_Header *header) {
+    auto &view = reinterpret_cast<const Header *>(header)->view();
+    return CEXR_Slice {
+        const_cast<char *>(view.data()),
+        view.size(),
+    };
+}
+
+void CEXR_Header_set_view(CEXR_Header *header, const char *view) {
+    reinterpret_cast<Header *>(header)->setView(view);
+}
+
 void CEXR_Header_erase_attribute(CEXR_Header *header, const char *attribute) {
     reinterpret_cast<Header *>(header)->erase(attribute);
 }
 
+bool CEXR_Header_has_tile_description(const CEXR_Header *header) {
+    return reinterpret_cast<const Header *>(header)->hasTileDescription();
+}
+
+CEXR_TileDescription CEXR_Header_tile_description(const CEXR_Header *header) {
+    auto &td = reinterpret_cast<const Header *>(header)->tileDescription();
+    return CEXR_TileDescription {
+        td.xSize,
+        td.ySize,
+        static_cast<CEXR_LevelMode>(td.mode),
+        static_cast<CEXR_LevelRoundingMode>(td.roundingMode),
+    };
+}
+
+void CEXR_Header_set_tile_description(CEXR_Header *header, CEXR_TileDescription tile_description) {
+    reinterpret_cast<Header *>(header)->setTileDescription(TileDescription(
+        tile_description.x_size,
+        tile_description.y_size,
+        static_cast<LevelMode>(tile_description.mode),
+        static_cast<LevelRoundingMode>(tile_description.rounding_mode)
+    ));
+}
+
+bool CEXR_Header_has_preview_image(const CEXR_Header *header) {
+    return reinterpret_cast<const Header *>(header)->hasPreviewImage();
+}
+
+const CEXR_PreviewRgba *CEXR_Header_preview_image(const CEXR_Header *header, unsigned int *width_out, unsigned int *height_out) {
+    auto &preview = reinterpret_cast<const Header *>(header)->previewImage();
+    *width_out = preview.width();
+    *height_out = preview.height();
+    return reinterpret_cast<const CEXR_PreviewRgba *>(preview.pixels());
+}
+
+void CEXR_Header_set_preview_image(CEXR_Header *header, unsigned int width, unsigned int height, const CEXR_PreviewRgba *pixels) {
+    reinterpret_cast<Header *>(header)->setPreviewImage(
+        PreviewImage(width, height, reinterpret_cast<const PreviewRgba *>(pixels))
+    );
+}
+
 
 //----------------------------------------------------
 // FrameBuffer
@@ -271,6 +539,26 @@ int CEXR_FrameBuffer_get_channel(const CEXR_FrameBuffer *frame_buffer, const cha
     }
 }
 
+// Returns `slice` with its base pointer offset by `offset` scanlines.
+static Slice offset_slice(Slice slice, unsigned int offset) {
+    auto tmp = (size_t)slice.base;
+    tmp -= slice.yStride * (offset / slice.ySampling);
+    slice.base = (char *)tmp;
+    return slice;
+}
+
+// Whether two slices are the same apart from their base pointers.
+static bool same_slice_layout(const Slice &a, const Slice &b) {
+    return a.type == b.type
+        && a.xStride == b.xStride
+        && a.yStride == b.yStride
+        && a.xSampling == b.xSampling
+        && a.ySampling == b.ySampling
+        && a.fillValue == b.fillValue
+        && a.xTileCoords == b.xTileCoords
+        && a.yTileCoords == b.yTileCoords;
+}
+
 // Creates a copy of the framebuffer, but with all base pointers offset by
 // `offset` scanlines.
 //
@@ -285,16 +573,102 @@ CEXR_FrameBuffer *CEXR_FrameBuffer_copy_and_offset_scanlines(const CEXR_FrameBuf
     // Copy all of the slices to the new frame buffer while offsetting their
     // base pointers appropriately.
     for (auto itr = fb->begin(); itr != fb->end(); itr++) {
-        Slice slice = itr.slice();
+        new_fb->insert(itr.name(), offset_slice(itr.slice(), offset));
+    }
+
+    return reinterpret_cast<CEXR_FrameBuffer *>(new_fb);
+}
 
-        auto tmp = (size_t)slice.base;
-        tmp -= slice.yStride * (offset / slice.ySampling);
-        slice.base = (char *)tmp;
+// Makes `dst` the same as what CEXR_FrameBuffer_copy_and_offset_scanlines()
+// would return for `src` and `offset`, reusing `dst` in place when possible.
+//
+// Returns 0 if `dst` was already identical, 1 if only base pointers were
+// updated, and 2 if the slices differed in any other way and `dst` was
+// rebuilt.
+int CEXR_FrameBuffer_rebase_scanlines(CEXR_FrameBuffer *dst, const CEXR_FrameBuffer *src, unsigned int offset) {
+    auto dst_fb = reinterpret_cast<FrameBuffer *>(dst);
+    auto src_fb = reinterpret_cast<const FrameBuffer *>(src);
+
+    // Check if the slices match apart from their base pointers.
+    bool same_layout = true;
+    {
+        auto dst_itr = dst_fb->begin();
+        auto src_itr = src_fb->begin();
+        for (; dst_itr != dst_fb->end() && src_itr != src_fb->end(); dst_itr++, src_itr++) {
+            if (strcmp(dst_itr.name(), src_itr.name()) != 0
+                || !same_slice_layout(dst_itr.slice(), src_itr.slice()))
+            {
+                same_layout = false;
+                break;
+            }
+        }
+        if (dst_itr != dst_fb->end() || src_itr != src_fb->end()) {
+            same_layout = false;
+        }
+    }
 
-        new_fb->insert(itr.name(), slice);
+    if (same_layout) {
+        bool changed = false;
+        auto dst_itr = dst_fb->begin();
+        for (auto src_itr = src_fb->begin(); src_itr != src_fb->end(); dst_itr++, src_itr++) {
+            char *base = offset_slice(src_itr.slice(), offset).base;
+            if (dst_itr.slice().base != base) {
+                dst_itr.slice().base = base;
+                changed = true;
+            }
+        }
+        return changed ? 1 : 0;
+    } else {
+        *dst_fb = FrameBuffer();
+        for (auto itr = src_fb->begin(); itr != src_fb->end(); itr++) {
+            dst_fb->insert(itr.name(), offset_slice(itr.slice(), offset));
+        }
+        return 2;
     }
+}
 
-    return reinterpret_cast<CEXR_FrameBuffer *>(new_fb);
+// Fills the rows of a preview image sampled from scanlines `scanline_1` to
+// `scanline_2`.  See sample_preview().
+void CEXR_FrameBuffer_sample_preview(const CEXR_FrameBuffer *frame_buffer, CEXR_Box2i data_window, int scanline_1, int scanline_2, unsigned int width, unsigned int height, CEXR_PreviewRgba *pixels) {
+    sample_preview(
+        *reinterpret_cast<const FrameBuffer *>(frame_buffer),
+        *reinterpret_cast<const Box2i *>(&data_window),
+        scanline_1,
+        scanline_2,
+        width,
+        height,
+        reinterpret_cast<PreviewRgba *>(pixels)
+    );
+}
+
+
+//----------------------------------------------------
+// DeepFrameBuffer
+
+CEXR_DeepFrameBuffer *CEXR_DeepFrameBuffer_new() {
+    return reinterpret_cast<CEXR_DeepFrameBuffer *>(new DeepFrameBuffer);
+}
+
+void CEXR_DeepFrameBuffer_delete(CEXR_DeepFrameBuffer *fb) {
+    delete reinterpret_cast<DeepFrameBuffer *>(fb);
+}
+
+void CEXR_DeepFrameBuffer_insert(CEXR_DeepFrameBuffer *fb,
+                                 const char *name,
+                                 CEXR_PixelType type,
+                                 char *base,
+                                 size_t xStride,
+                                 size_t yStride,
+                                 size_t sampleStride,
+                                 double fillValue) {
+    reinterpret_cast<DeepFrameBuffer *>(fb)->insert(name, DeepSlice(static_cast<Imf::PixelType>(type), base, xStride, yStride, sampleStride, 1, 1, fillValue));
+}
+
+void CEXR_DeepFrameBuffer_insert_sample_count_slice(CEXR_DeepFrameBuffer *fb,
+                                                    char *base,
+                                                    size_t xStride,
+                                                    size_t yStride) {
+    reinterpret_cast<DeepFrameBuffer *>(fb)->insertSampleCountSlice(Slice(Imf::UINT, base, xStride, yStride));
 }
 
 
@@ -352,6 +726,139 @@ int CEXR_InputFile_read_pixels(CEXR_InputFile *file, int scanline_1, int scanlin
     return 0;
 }
 
+// Size in bytes of one value of type `type`.
+static size_t pixel_type_size(Imf::PixelType type) {
+    return type == Imf::HALF ? 2 : 4;
+}
+
+// Reads the pixels of `region` into `fb`, which only needs to cover
+// `region`.
+//
+// InputFile always writes whole scanlines of the data window, so `region` is
+// read in batches of `batch_rows` scanlines into full-width scratch slices,
+// and only the requested columns are copied to `fb`.  Batches are aligned
+// to multiples of `batch_rows` from the top of the data window, so if
+// that's a multiple of the file's scanlines per chunk no chunk is
+// decompressed twice.  Only slices that are in `fb` are read.
+//
+// The scratch slices have the type of the file's channels, so FLOAT slices
+// in `fb` can be read from HALF channels, converting whole rows at a time
+// with `half_to_float()` rather than a pixel at a time in OpenEXR.
+//
+// This leaves the scratch framebuffer set on the file.
+int CEXR_InputFile_read_region(CEXR_InputFile *file, const CEXR_FrameBuffer *fb, CEXR_Box2i region, int batch_rows, const char **err_out) {
+    try {
+        auto in_file = reinterpret_cast<InputFile *>(file);
+        auto dst_fb = reinterpret_cast<const FrameBuffer *>(fb);
+        const Box2i &dw = in_file->header().dataWindow();
+        const ChannelList &channels = in_file->header().channels();
+        const int min_x = dw.min.x;
+        const size_t width = dw.max.x - dw.min.x + 1;
+        const size_t region_width = region.max.x - region.min.x + 1;
+
+        // One full-width scratch buffer per slice, of the type of the
+        // file's channel.
+        std::vector<Imf::PixelType> scratch_types;
+        std::vector<std::vector<char>> scratch;
+        for (auto itr = dst_fb->begin(); itr != dst_fb->end(); itr++) {
+            const Slice &slice = itr.slice();
+            if (slice.xSampling != 1 || slice.ySampling != 1) {
+                throw Iex::ArgExc("region reads don't support subsampled channels");
+            }
+            const Channel *channel = channels.findChannel(itr.name());
+            Imf::PixelType type = channel ? channel->type : slice.type;
+            if (type != slice.type && !(type == Imf::HALF && slice.type == Imf::FLOAT)) {
+                throw Iex::ArgExc("unsupported pixel type conversion");
+            }
+            scratch_types.push_back(type);
+            scratch.emplace_back(pixel_type_size(type) * width * batch_rows);
+        }
+        std::vector<float> row(region_width);
+
+        int y1 = region.min.y;
+        while (y1 <= region.max.y) {
+            int y2 = std::min(dw.min.y + ((y1 - dw.min.y) / batch_rows + 1) * batch_rows - 1, region.max.y);
+
+            // Point the scratch slices at the batch and read it.
+            FrameBuffer batch_fb;
+            size_t i = 0;
+            for (auto itr = dst_fb->begin(); itr != dst_fb->end(); itr++, i++) {
+                const size_t size = pixel_type_size(scratch_types[i]);
+                char *base = scratch[i].data() - (min_x + (ptrdiff_t)y1 * width) * size;
+                batch_fb.insert(itr.name(), Slice(scratch_types[i], base, size, size * width, 1, 1, itr.slice().fillValue));
+            }
+            in_file->setFrameBuffer(batch_fb);
+            in_file->readPixels(y1, y2);
+
+            // Copy the requested columns, converting them if needed.
+            i = 0;
+            for (auto itr = dst_fb->begin(); itr != dst_fb->end(); itr++, i++) {
+                const Slice &slice = itr.slice();
+                const size_t src_size = pixel_type_size(scratch_types[i]);
+                const size_t dst_size = pixel_type_size(slice.type);
+                for (int y = y1; y <= y2; y++) {
+                    const char *src = scratch[i].data() + ((region.min.x - min_x) + (size_t)(y - y1) * width) * src_size;
+                    char *dst = slice.base + (ptrdiff_t)y * slice.yStride + (ptrdiff_t)region.min.x * slice.xStride;
+                    if (scratch_types[i] != slice.type) {
+                        // Convert straight into `fb` if it's contiguous,
+                        // and through `row` otherwise.
+                        const uint16_t *half_src = reinterpret_cast<const uint16_t *>(src);
+                        if (slice.xStride == dst_size) {
+                            half_to_float(half_src, reinterpret_cast<float *>(dst), region_width);
+                            continue;
+                        }
+                        half_to_float(half_src, row.data(), region_width);
+                        src = reinterpret_cast<const char *>(row.data());
+                    }
+                    if (slice.xStride == dst_size) {
+                        memcpy(dst, src, dst_size * region_width);
+                    } else {
+                        for (size_t x = 0; x < region_width; x++) {
+                            memcpy(dst, src, dst_size);
+                            src += dst_size;
+                            dst += slice.xStride;
+                        }
+                    }
+                }
+            }
+
+            y1 = y2 + 1;
+        }
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int CEXR_InputFile_raw_pixel_data(CEXR_InputFile *file, int first_scanline, const char **data_out, int *size_out, const char **err_out) {
+    try {
+        reinterpret_cast<InputFile *>(file)->rawPixelData(first_scanline, *data_out, *size_out);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+bool CEXR_InputFile_is_complete(const CEXR_InputFile *file) {
+    return reinterpret_cast<const InputFile *>(file)->isComplete();
+}
+
+// Makes a preview image from a strided read of the file.  See
+// read_preview().
+//
+// This changes the framebuffer set on the file.
+int CEXR_InputFile_read_preview(CEXR_InputFile *file, unsigned int width, unsigned int height, CEXR_PreviewRgba *pixels, const char **err_out) {
+    try {
+        read_preview(*reinterpret_cast<InputFile *>(file), width, height, reinterpret_cast<PreviewRgba *>(pixels));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
 
 //----------------------------------------------------
 // OutputFile
@@ -396,16 +903,545 @@ int CEXR_OutputFile_write_pixels(CEXR_OutputFile *file, int num_scanlines, const
     return 0;
 }
 
+int CEXR_OutputFile_copy_pixels(CEXR_OutputFile *file, CEXR_InputFile *in_file, const char **err_out) {
+    try {
+        reinterpret_cast<OutputFile *>(file)->copyPixels(*reinterpret_cast<InputFile *>(in_file));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int CEXR_OutputFile_update_preview_image(CEXR_OutputFile *file, const CEXR_PreviewRgba *pixels, const char **err_out) {
+    try {
+        reinterpret_cast<OutputFile *>(file)->updatePreviewImage(reinterpret_cast<const PreviewRgba *>(pixels));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
 
 //----------------------------------------------------
-// ThreadCount
+// TiledInputFile
 
-int CEXR_set_global_thread_count(int thread_count, const char **err_out) {
+int CEXR_TiledInputFile_from_stream(CEXR_IStream *stream, int threads, CEXR_TiledInputFile **out, const char **err_out) {
     try {
-    	setGlobalThreadCount(thread_count);
+        *out = reinterpret_cast<CEXR_TiledInputFile *>(new TiledInputFile(*reinterpret_cast<IStream *>(stream), threads));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+void CEXR_TiledInputFile_delete(CEXR_TiledInputFile *file) {
+    delete reinterpret_cast<TiledInputFile *>(file);
+}
+
+const CEXR_Header *CEXR_TiledInputFile_header(CEXR_TiledInputFile *file) {
+    return reinterpret_cast<const CEXR_Header *>(&reinterpret_cast<TiledInputFile *>(file)->header());
+}
+
+int CEXR_TiledInputFile_set_framebuffer(CEXR_TiledInputFile *file, CEXR_FrameBuffer *fb, const char **err_out) {
+    try {
+        reinterpret_cast<TiledInputFile *>(file)->setFrameBuffer(*reinterpret_cast<FrameBuffer *>(fb));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledInputFile_num_x_levels(CEXR_TiledInputFile *file, int *out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<TiledInputFile *>(file)->numXLevels();
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledInputFile_num_y_levels(CEXR_TiledInputFile *file, int *out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<TiledInputFile *>(file)->numYLevels();
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledInputFile_data_window_for_level(CEXR_TiledInputFile *file, int lx, int ly, CEXR_Box2i *out, const char **err_out) {
+    try {
+        auto window = reinterpret_cast<TiledInputFile *>(file)->dataWindowForLevel(lx, ly);
+        *out = *reinterpret_cast<const CEXR_Box2i *>(&window);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledInputFile_num_x_tiles(CEXR_TiledInputFile *file, int lx, int *out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<TiledInputFile *>(file)->numXTiles(lx);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledInputFile_num_y_tiles(CEXR_TiledInputFile *file, int ly, int *out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<TiledInputFile *>(file)->numYTiles(ly);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledInputFile_data_window_for_tile(CEXR_TiledInputFile *file, int dx, int dy, int lx, int ly, CEXR_Box2i *out, const char **err_out) {
+    try {
+        auto window = reinterpret_cast<TiledInputFile *>(file)->dataWindowForTile(dx, dy, lx, ly);
+        *out = *reinterpret_cast<const CEXR_Box2i *>(&window);
     } catch(const std::exception &e) {
         *err_out = copy_err(e.what());
         return 1;
     }
+
     return 0;
 }
+
+int CEXR_TiledInputFile_read_tile(CEXR_TiledInputFile *file, int dx, int dy, int lx, int ly, const char **err_out) {
+    try {
+        reinterpret_cast<TiledInputFile *>(file)->readTile(dx, dy, lx, ly);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int CEXR_TiledInputFile_read_tiles(CEXR_TiledInputFile *file, int dx1, int dx2, int dy1, int dy2, int lx, int ly, const char **err_out) {
+    try {
+        reinterpret_cast<TiledInputFile *>(file)->readTiles(dx1, dx2, dy1, dy2, lx, ly);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------
+// TiledOutputFile
+
+int CEXR_TiledOutputFile_from_stream(CEXR_OStream *stream, const CEXR_Header *header, int threads, CEXR_TiledOutputFile **out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<CEXR_TiledOutputFile *>(new TiledOutputFile(*reinterpret_cast<OStream *>(stream), *reinterpret_cast<const Header *>(header), threads));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+void CEXR_TiledOutputFile_delete(CEXR_TiledOutputFile *file) {
+    delete reinterpret_cast<TiledOutputFile *>(file);
+}
+
+const CEXR_Header *CEXR_TiledOutputFile_header(CEXR_TiledOutputFile *file) {
+    return reinterpret_cast<const CEXR_Header *>(&reinterpret_cast<TiledOutputFile *>(file)->header());
+}
+
+int CEXR_TiledOutputFile_set_framebuffer(CEXR_TiledOutputFile *file, const CEXR_FrameBuffer *fb, const char **err_out) {
+    try {
+        reinterpret_cast<TiledOutputFile *>(file)->setFrameBuffer(*reinterpret_cast<const FrameBuffer *>(fb));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledOutputFile_num_x_levels(CEXR_TiledOutputFile *file, int *out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<TiledOutputFile *>(file)->numXLevels();
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledOutputFile_num_y_levels(CEXR_TiledOutputFile *file, int *out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<TiledOutputFile *>(file)->numYLevels();
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledOutputFile_data_window_for_level(CEXR_TiledOutputFile *file, int lx, int ly, CEXR_Box2i *out, const char **err_out) {
+    try {
+        auto window = reinterpret_cast<TiledOutputFile *>(file)->dataWindowForLevel(lx, ly);
+        *out = *reinterpret_cast<const CEXR_Box2i *>(&window);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledOutputFile_num_x_tiles(CEXR_TiledOutputFile *file, int lx, int *out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<TiledOutputFile *>(file)->numXTiles(lx);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledOutputFile_num_y_tiles(CEXR_TiledOutputFile *file, int ly, int *out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<TiledOutputFile *>(file)->numYTiles(ly);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledOutputFile_data_window_for_tile(CEXR_TiledOutputFile *file, int dx, int dy, int lx, int ly, CEXR_Box2i *out, const char **err_out) {
+    try {
+        auto window = reinterpret_cast<TiledOutputFile *>(file)->dataWindowForTile(dx, dy, lx, ly);
+        *out = *reinterpret_cast<const CEXR_Box2i *>(&window);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_TiledOutputFile_write_tile(CEXR_TiledOutputFile *file, int dx, int dy, int lx, int ly, const char **err_out) {
+    try {
+        reinterpret_cast<TiledOutputFile *>(file)->writeTile(dx, dy, lx, ly);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int CEXR_TiledOutputFile_write_tiles(CEXR_TiledOutputFile *file, int dx1, int dx2, int dy1, int dy2, int lx, int ly, const char **err_out) {
+    try {
+        reinterpret_cast<TiledOutputFile *>(file)->writeTiles(dx1, dx2, dy1, dy2, lx, ly);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int CEXR_TiledOutputFile_copy_pixels(CEXR_TiledOutputFile *file, CEXR_TiledInputFile *in_file, const char **err_out) {
+    try {
+        reinterpret_cast<TiledOutputFile *>(file)->copyPixels(*reinterpret_cast<TiledInputFile *>(in_file));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------
+// MultiPartInputFile
+
+int CEXR_MultiPartInputFile_from_stream(CEXR_IStream *stream, int threads, CEXR_MultiPartInputFile **out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<CEXR_MultiPartInputFile *>(new MultiPartInputFile(*reinterpret_cast<IStream *>(stream), threads));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+void CEXR_MultiPartInputFile_delete(CEXR_MultiPartInputFile *file) {
+    delete reinterpret_cast<MultiPartInputFile *>(file);
+}
+
+int CEXR_MultiPartInputFile_parts(CEXR_MultiPartInputFile *file) {
+    return reinterpret_cast<MultiPartInputFile *>(file)->parts();
+}
+
+const CEXR_Header *CEXR_MultiPartInputFile_header(CEXR_MultiPartInputFile *file, int part) {
+    return reinterpret_cast<const CEXR_Header *>(&reinterpret_cast<MultiPartInputFile *>(file)->header(part));
+}
+
+// NOTE: InputPart is a lightweight handle to state owned by the
+// MultiPartInputFile (including the framebuffer), so it's fine to create
+// one per call.  Different parts may be read from different threads at the
+// same time, but the reads are serialized by the file's stream lock, so
+// reading them concurrently takes a file per thread.
+int CEXR_MultiPartInputFile_set_framebuffer(CEXR_MultiPartInputFile *file, int part, CEXR_FrameBuffer *fb, const char **err_out) {
+    try {
+        InputPart input_part(*reinterpret_cast<MultiPartInputFile *>(file), part);
+        input_part.setFrameBuffer(*reinterpret_cast<FrameBuffer *>(fb));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_MultiPartInputFile_read_pixels(CEXR_MultiPartInputFile *file, int part, int scanline_1, int scanline_2, const char **err_out) {
+    try {
+        InputPart input_part(*reinterpret_cast<MultiPartInputFile *>(file), part);
+        input_part.readPixels(scanline_1, scanline_2);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------
+// MultiPartOutputFile
+
+int CEXR_MultiPartOutputFile_from_stream(CEXR_OStream *stream, const CEXR_Header *const *headers, int parts, int threads, CEXR_MultiPartOutputFile **out, const char **err_out) {
+    try {
+        // MultiPartOutputFile wants a contiguous array of headers, and
+        // every part of a multipart file needs a type.
+        std::vector<Header> part_headers;
+        part_headers.reserve(parts);
+        for (int i = 0; i < parts; i++) {
+            part_headers.push_back(*reinterpret_cast<const Header *>(headers[i]));
+            Header &header = part_headers.back();
+            if (!header.hasType()) {
+                header.setType(header.hasTileDescription() ? TILEDIMAGE : SCANLINEIMAGE);
+            }
+        }
+
+        *out = reinterpret_cast<CEXR_MultiPartOutputFile *>(new MultiPartOutputFile(*reinterpret_cast<OStream *>(stream), part_headers.data(), parts, false, threads));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+void CEXR_MultiPartOutputFile_delete(CEXR_MultiPartOutputFile *file) {
+    delete reinterpret_cast<MultiPartOutputFile *>(file);
+}
+
+int CEXR_MultiPartOutputFile_parts(CEXR_MultiPartOutputFile *file) {
+    return reinterpret_cast<MultiPartOutputFile *>(file)->parts();
+}
+
+const CEXR_Header *CEXR_MultiPartOutputFile_header(CEXR_MultiPartOutputFile *file, int part) {
+    return reinterpret_cast<const CEXR_Header *>(&reinterpret_cast<MultiPartOutputFile *>(file)->header(part));
+}
+
+int CEXR_MultiPartOutputFile_set_framebuffer(CEXR_MultiPartOutputFile *file, int part, const CEXR_FrameBuffer *fb, const char **err_out) {
+    try {
+        OutputPart output_part(*reinterpret_cast<MultiPartOutputFile *>(file), part);
+        output_part.setFrameBuffer(*reinterpret_cast<const FrameBuffer *>(fb));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_MultiPartOutputFile_write_pixels(CEXR_MultiPartOutputFile *file, int part, int num_scanlines, const char **err_out) {
+    try {
+        OutputPart output_part(*reinterpret_cast<MultiPartOutputFile *>(file), part);
+        output_part.writePixels(num_scanlines);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+//----------------------------------------------------
+// DeepScanLineInputFile
+
+int CEXR_DeepScanLineInputFile_from_stream(CEXR_IStream *stream, int threads, CEXR_DeepScanLineInputFile **out, const char **err_out) {
+    try {
+        *out = reinterpret_cast<CEXR_DeepScanLineInputFile *>(new DeepScanLineInputFile(*reinterpret_cast<IStream *>(stream), threads));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+void CEXR_DeepScanLineInputFile_delete(CEXR_DeepScanLineInputFile *file) {
+    delete reinterpret_cast<DeepScanLineInputFile *>(file);
+}
+
+const CEXR_Header *CEXR_DeepScanLineInputFile_header(CEXR_DeepScanLineInputFile *file) {
+    return reinterpret_cast<const CEXR_Header *>(&reinterpret_cast<DeepScanLineInputFile *>(file)->header());
+}
+
+int CEXR_DeepScanLineInputFile_set_framebuffer(CEXR_DeepScanLineInputFile *file, const CEXR_DeepFrameBuffer *fb, const char **err_out) {
+    try {
+        reinterpret_cast<DeepScanLineInputFile *>(file)->setFrameBuffer(*reinterpret_cast<const DeepFrameBuffer *>(fb));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_DeepScanLineInputFile_read_pixel_sample_counts(CEXR_DeepScanLineInputFile *file, int scanline_1, int scanline_2, const char **err_out) {
+    try {
+        reinterpret_cast<DeepScanLineInputFile *>(file)->readPixelSampleCounts(scanline_1, scanline_2);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int CEXR_DeepScanLineInputFile_read_pixels(CEXR_DeepScanLineInputFile *file, int scanline_1, int scanline_2, const char **err_out) {
+    try {
+        reinterpret_cast<DeepScanLineInputFile *>(file)->readPixels(scanline_1, scanline_2);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------
+// DeepScanLineOutputFile
+
+int CEXR_DeepScanLineOutputFile_from_stream(CEXR_OStream *stream, const CEXR_Header *header, int threads, CEXR_DeepScanLineOutputFile **out, const char **err_out) {
+    try {
+        // Deep files must say so in their header.
+        Header deep_header = *reinterpret_cast<const Header *>(header);
+        deep_header.setType(DEEPSCANLINE);
+
+        *out = reinterpret_cast<CEXR_DeepScanLineOutputFile *>(new DeepScanLineOutputFile(*reinterpret_cast<OStream *>(stream), deep_header, threads));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+void CEXR_DeepScanLineOutputFile_delete(CEXR_DeepScanLineOutputFile *file) {
+    delete reinterpret_cast<DeepScanLineOutputFile *>(file);
+}
+
+const CEXR_Header *CEXR_DeepScanLineOutputFile_header(CEXR_DeepScanLineOutputFile *file) {
+    return reinterpret_cast<const CEXR_Header *>(&reinterpret_cast<DeepScanLineOutputFile *>(file)->header());
+}
+
+int CEXR_DeepScanLineOutputFile_set_framebuffer(CEXR_DeepScanLineOutputFile *file, const CEXR_DeepFrameBuffer *fb, const char **err_out) {
+    try {
+        reinterpret_cast<DeepScanLineOutputFile *>(file)->setFrameBuffer(*reinterpret_cast<const DeepFrameBuffer *>(fb));
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int CEXR_DeepScanLineOutputFile_write_pixels(CEXR_DeepScanLineOutputFile *file, int num_scanlines, const char **err_out) {
+    try {
+        reinterpret_cast<DeepScanLineOutputFile *>(file)->writePixels(num_scanlines);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------
+// ThreadCount
+
+int CEXR_set_global_thread_count(int thread_count, const char **err_out) {
+    try {
+    	setGlobalThreadCount(thread_count);
+    } catch(const std::exception &e) {
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int CEXR_set_global_thread_provider(
+    int thread_count,
+    void *executor,
+    void (*add_task_ptr)(void *, CEXR_Task *),
+    void (*delete_executor_ptr)(void *),
+    const char **err_out
+) {
+    CallbackThreadProvider *provider;
+    try {
+        provider = new CallbackThreadProvider(
+            thread_count,
+            executor,
+            add_task_ptr,
+            delete_executor_ptr
+        );
+    } catch(const std::exception &e) {
+        delete_executor_ptr(executor);
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+
+    try {
+        // Takes ownership of the provider, and deletes the old one once
+        // its tasks are done.
+        IlmThread::ThreadPool::globalThreadPool().setThreadProvider(provider);
+    } catch(const std::exception &e) {
+        delete provider;
+        *err_out = copy_err(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+void CEXR_Task_run(CEXR_Task *task) {
+    task->run();
+}
@@ -145,15 +145,72 @@ typedef struct CEXR_Channel {
     bool p_linear;
 } CEXR_Channel;
 
+// IlmImf/ImfTileDescription.h
+/**
+ * Resolution levels stored in a tiled image.
+ *
+ * * `ONE_LEVEL`: only the full resolution image is stored.
+ * * `MIPMAP_LEVELS`: the image is stored at full resolution and at
+ *   successively halved resolutions, down to a single pixel.
+ * * `RIPMAP_LEVELS`: like `MIPMAP_LEVELS`, but the width and height are
+ *   halved independently of each other.
+ */
+typedef enum CEXR_LevelMode {
+    ONE_LEVEL = 0,
+    MIPMAP_LEVELS = 1,
+    RIPMAP_LEVELS = 2,
+} CEXR_LevelMode;
+
+// IlmImf/ImfTileDescription.h
+/**
+ * How the size of each level is rounded when halving an odd dimension.
+ */
+typedef enum CEXR_LevelRoundingMode {
+    ROUND_DOWN = 0,
+    ROUND_UP = 1,
+} CEXR_LevelRoundingMode;
+
+// IlmImf/ImfTileDescription.h
+// Changed element names slightly to adhere to Rust naming conventions.
+/**
+ * Describes the tiling of a tiled image.
+ *
+ * `x_size` and `y_size` are the width and height of each tile in pixels.
+ * `mode` is which resolution levels are stored, and `rounding_mode` is how
+ * level sizes are rounded.
+ */
+typedef struct CEXR_TileDescription {
+    unsigned int x_size;
+    unsigned int y_size;
+    CEXR_LevelMode mode;
+    CEXR_LevelRoundingMode rounding_mode;
+} CEXR_TileDescription;
+
+
+// IlmImf/ImfPreviewImage.h
+typedef struct CEXR_PreviewRgba {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+    unsigned char a;
+} CEXR_PreviewRgba;
 
 // Opaque types
 typedef struct CEXR_InputFile CEXR_InputFile;
 typedef struct CEXR_OutputFile CEXR_OutputFile;
+typedef struct CEXR_TiledInputFile CEXR_TiledInputFile;
+typedef struct CEXR_TiledOutputFile CEXR_TiledOutputFile;
+typedef struct CEXR_MultiPartInputFile CEXR_MultiPartInputFile;
+typedef struct CEXR_MultiPartOutputFile CEXR_MultiPartOutputFile;
+typedef struct CEXR_DeepScanLineInputFile CEXR_DeepScanLineInputFile;
+typedef struct CEXR_DeepScanLineOutputFile CEXR_DeepScanLineOutputFile;
 typedef struct CEXR_Header CEXR_Header;
 typedef struct CEXR_FrameBuffer CEXR_FrameBuffer;
+typedef struct CEXR_DeepFrameBuffer CEXR_DeepFrameBuffer;
 typedef struct CEXR_IStream CEXR_IStream;
 typedef struct CEXR_OStream CEXR_OStream;
 typedef struct CEXR_ChannelListIter CEXR_ChannelListIter;
+typedef struct CEXR_Task CEXR_Task;
 
 // Helper type
 typedef struct CEXR_Slice {
@@ -161,24 +218,49 @@ typedef struct CEXR_Slice {
     size_t len;
 } CEXR_Slice;
 
+// I/O counters of a stream.  `bytes` counts the bytes read or written
+// through the stream, and the rest only count calls to a Rust reader or
+// writer.
+typedef struct CEXR_IoStats {
+    uint64_t bytes;
+    uint64_t calls;
+    uint64_t seeks;
+    uint64_t nanos;
+} CEXR_IoStats;
+
 int CEXR_IStream_from_reader(
     void *reader,
-    int (*read_ptr)(void *, char *, int, int *err_out),
+    int (*read_ptr)(void *, char *, int, int *read_out, int *err_out),
     int (*seekp_ptr)(void *, uint64_t, int *err_out),
+    size_t buffer_size,
     CEXR_IStream **out,
     const char **err_out
 );
 CEXR_IStream *CEXR_IStream_from_memory(const char *filename, char *data, size_t size);
+void CEXR_IStream_reset_memory(CEXR_IStream *stream, char *data, size_t size);
+int CEXR_IStream_from_file_mmap(const char *path, CEXR_IStream **out, const char **err_out);
+CEXR_IStream *CEXR_IStream_with_prefix(CEXR_IStream *stream, const char *prefix, size_t size);
+int CEXR_IStream_read_at(CEXR_IStream *stream, uint64_t position, char *out, size_t size, const char **err_out);
+int CEXR_IStream_read_chunk_table(CEXR_IStream *stream, uint64_t *offsets, uint64_t *sizes, size_t count, uint64_t *table_end_out, const char **err_out);
 void CEXR_IStream_delete(CEXR_IStream *stream);
+void CEXR_IStream_stats(const CEXR_IStream *stream, CEXR_IoStats *out);
 
 int CEXR_OStream_from_writer(
     void *writer,
     int (*write_ptr)(void *, const char *, int, int *err_out),
     int (*seekp_ptr)(void *, uint64_t, int *err_out),
+    size_t buffer_size,
+    CEXR_OStream **out,
+    const char **err_out
+);
+int CEXR_OStream_from_memory(
+    void *vec,
+    int (*sync_ptr)(void *, size_t len, size_t min_capacity, char **data_out, size_t *capacity_out),
     CEXR_OStream **out,
     const char **err_out
 );
 void CEXR_OStream_delete(CEXR_OStream *stream);
+void CEXR_OStream_stats(const CEXR_OStream *stream, CEXR_IoStats *out);
 
 bool CEXR_ChannelListIter_next(CEXR_ChannelListIter *iter, const char **name, CEXR_Channel *channel);
 void CEXR_ChannelListIter_delete(CEXR_ChannelListIter *iter);
@@ -190,7 +272,9 @@ CEXR_Header *CEXR_Header_new(const CEXR_Box2i *displayWindow,
                              float screenWindowWidth,
                              CEXR_LineOrder lineOrder,
                              CEXR_Compression compression);
+CEXR_Header *CEXR_Header_copy(const CEXR_Header *header);
 void CEXR_Header_delete(CEXR_Header *header);
+int CEXR_Header_read_from_stream(CEXR_IStream *stream, CEXR_Header **out, const char **err_out);
 void CEXR_Header_insert_channel(CEXR_Header *header, const char name[], const CEXR_Channel channel);
 const CEXR_Channel *CEXR_Header_get_channel(const CEXR_Header *header, const char name[]);
 CEXR_ChannelListIter *CEXR_Header_channel_list_iter(const CEXR_Header *header);
@@ -201,15 +285,34 @@ void CEXR_Header_set_data_window(CEXR_Header *header, CEXR_Box2i window);
 void CEXR_Header_set_pixel_aspect_ratio(CEXR_Header *header, float aspect_ratio);
 void CEXR_Header_set_screen_window_center(CEXR_Header *header, CEXR_V2f center);
 void CEXR_Header_set_screen_window_width(CEXR_Header *header, float width);
+CEXR_LineOrder CEXR_Header_line_order(const CEXR_Header *header);
 void CEXR_Header_set_line_order(CEXR_Header *header, CEXR_LineOrder line_order);
+CEXR_Compression CEXR_Header_compression(const CEXR_Header *header);
 void CEXR_Header_set_compression(CEXR_Header *header, CEXR_Compression compression);
+int CEXR_Header_scanlines_per_chunk(const CEXR_Header *header);
+bool CEXR_Header_has_dwa_compression_level(const CEXR_Header *header);
+float CEXR_Header_dwa_compression_level(const CEXR_Header *header);
+void CEXR_Header_set_dwa_compression_level(CEXR_Header *header, float level);
+void CEXR_Header_erase_dwa_compression_level(CEXR_Header *header);
 bool CEXR_Header_has_envmap(const CEXR_Header *header);
 int CEXR_Header_envmap(const CEXR_Header *header);
 void CEXR_Header_set_envmap(CEXR_Header *header, int envmap);
 bool CEXR_Header_has_multiview(const CEXR_Header *header);
 size_t CEXR_Header_multiview(const CEXR_Header *header, CEXR_Slice *out);
 void CEXR_Header_set_multiview(CEXR_Header *header, const CEXR_Slice* views, size_t view_count);
+bool CEXR_Header_has_name(const CEXR_Header *header);
+CEXR_Slice CEXR_Header_name(const CEXR_Header *header);
+void CEXR_Header_set_name(CEXR_Header *header, const char *name);
+bool CEXR_Header_has_view(const CEXR_Header *header);
+CEXR_Slice CEXR_Header_view(const CEXR_Header *header);
+void CEXR_Header_set_view(CEXR_Header *header, const char *view);
 void CEXR_Header_erase_attribute(CEXR_Header *header, const char *attribute);
+bool CEXR_Header_has_tile_description(const CEXR_Header *header);
+CEXR_TileDescription CEXR_Header_tile_description(const CEXR_Header *header);
+void CEXR_Header_set_tile_description(CEXR_Header *header, CEXR_TileDescription tile_description);
+bool CEXR_Header_has_preview_image(const CEXR_Header *header);
+const CEXR_PreviewRgba *CEXR_Header_preview_image(const CEXR_Header *header, unsigned int *width_out, unsigned int *height_out);
+void CEXR_Header_set_preview_image(CEXR_Header *header, unsigned int width, unsigned int height, const CEXR_PreviewRgba *pixels);
 
 
 CEXR_FrameBuffer *CEXR_FrameBuffer_new();
@@ -227,6 +330,23 @@ void CEXR_FrameBuffer_insert(CEXR_FrameBuffer *framebuffer,
                              int yTileCoords);
 int CEXR_FrameBuffer_get_channel(const CEXR_FrameBuffer *frame_buffer, const char name[], CEXR_Channel *out);
 CEXR_FrameBuffer *CEXR_FrameBuffer_copy_and_offset_scanlines(const CEXR_FrameBuffer *frame_buffer, unsigned int offset);
+int CEXR_FrameBuffer_rebase_scanlines(CEXR_FrameBuffer *dst, const CEXR_FrameBuffer *src, unsigned int offset);
+void CEXR_FrameBuffer_sample_preview(const CEXR_FrameBuffer *frame_buffer, CEXR_Box2i data_window, int scanline_1, int scanline_2, unsigned int width, unsigned int height, CEXR_PreviewRgba *pixels);
+
+CEXR_DeepFrameBuffer *CEXR_DeepFrameBuffer_new();
+void CEXR_DeepFrameBuffer_delete(CEXR_DeepFrameBuffer *framebuffer);
+void CEXR_DeepFrameBuffer_insert(CEXR_DeepFrameBuffer *framebuffer,
+                                 const char *name,
+                                 CEXR_PixelType type,
+                                 char *base,
+                                 size_t xStride,
+                                 size_t yStride,
+                                 size_t sampleStride,
+                                 double fillValue);
+void CEXR_DeepFrameBuffer_insert_sample_count_slice(CEXR_DeepFrameBuffer *framebuffer,
+                                                    char *base,
+                                                    size_t xStride,
+                                                    size_t yStride);
 
 int CEXR_InputFile_from_file_path(const char *path, int threads, CEXR_InputFile **out, const char **err_out);
 int CEXR_InputFile_from_stream(CEXR_IStream *stream, int threads, CEXR_InputFile **out, const char **err_out);
@@ -234,14 +354,82 @@ void CEXR_InputFile_delete(CEXR_InputFile *file);
 const CEXR_Header *CEXR_InputFile_header(CEXR_InputFile *file);
 int CEXR_InputFile_set_framebuffer(CEXR_InputFile *file, CEXR_FrameBuffer *framebuffer, const char **err_out);
 int CEXR_InputFile_read_pixels(CEXR_InputFile *file, int scanline_1, int scanline_2, const char **err_out);
+int CEXR_InputFile_read_region(CEXR_InputFile *file, const CEXR_FrameBuffer *framebuffer, CEXR_Box2i region, int batch_rows, const char **err_out);
+int CEXR_InputFile_raw_pixel_data(CEXR_InputFile *file, int first_scanline, const char **data_out, int *size_out, const char **err_out);
+int CEXR_InputFile_read_preview(CEXR_InputFile *file, unsigned int width, unsigned int height, CEXR_PreviewRgba *pixels, const char **err_out);
+bool CEXR_InputFile_is_complete(const CEXR_InputFile *file);
 
 int CEXR_OutputFile_from_stream(CEXR_OStream *stream, const CEXR_Header *header, int threads, CEXR_OutputFile **out, const char **err_out);
 void CEXR_OutputFile_delete(CEXR_OutputFile *file);
 const CEXR_Header *CEXR_OutputFile_header(CEXR_OutputFile *file);
 int CEXR_OutputFile_set_framebuffer(CEXR_OutputFile *file, const CEXR_FrameBuffer *framebuffer, const char **err_out);
 int CEXR_OutputFile_write_pixels(CEXR_OutputFile *file, int num_scanlines, const char **err_out);
+int CEXR_OutputFile_copy_pixels(CEXR_OutputFile *file, CEXR_InputFile *in_file, const char **err_out);
+int CEXR_OutputFile_update_preview_image(CEXR_OutputFile *file, const CEXR_PreviewRgba *pixels, const char **err_out);
+
+int CEXR_TiledInputFile_from_stream(CEXR_IStream *stream, int threads, CEXR_TiledInputFile **out, const char **err_out);
+void CEXR_TiledInputFile_delete(CEXR_TiledInputFile *file);
+const CEXR_Header *CEXR_TiledInputFile_header(CEXR_TiledInputFile *file);
+int CEXR_TiledInputFile_set_framebuffer(CEXR_TiledInputFile *file, CEXR_FrameBuffer *framebuffer, const char **err_out);
+int CEXR_TiledInputFile_num_x_levels(CEXR_TiledInputFile *file, int *out, const char **err_out);
+int CEXR_TiledInputFile_num_y_levels(CEXR_TiledInputFile *file, int *out, const char **err_out);
+int CEXR_TiledInputFile_data_window_for_level(CEXR_TiledInputFile *file, int lx, int ly, CEXR_Box2i *out, const char **err_out);
+int CEXR_TiledInputFile_num_x_tiles(CEXR_TiledInputFile *file, int lx, int *out, const char **err_out);
+int CEXR_TiledInputFile_num_y_tiles(CEXR_TiledInputFile *file, int ly, int *out, const char **err_out);
+int CEXR_TiledInputFile_data_window_for_tile(CEXR_TiledInputFile *file, int dx, int dy, int lx, int ly, CEXR_Box2i *out, const char **err_out);
+int CEXR_TiledInputFile_read_tile(CEXR_TiledInputFile *file, int dx, int dy, int lx, int ly, const char **err_out);
+int CEXR_TiledInputFile_read_tiles(CEXR_TiledInputFile *file, int dx1, int dx2, int dy1, int dy2, int lx, int ly, const char **err_out);
+
+int CEXR_TiledOutputFile_from_stream(CEXR_OStream *stream, const CEXR_Header *header, int threads, CEXR_TiledOutputFile **out, const char **err_out);
+void CEXR_TiledOutputFile_delete(CEXR_TiledOutputFile *file);
+const CEXR_Header *CEXR_TiledOutputFile_header(CEXR_TiledOutputFile *file);
+int CEXR_TiledOutputFile_set_framebuffer(CEXR_TiledOutputFile *file, const CEXR_FrameBuffer *framebuffer, const char **err_out);
+int CEXR_TiledOutputFile_num_x_levels(CEXR_TiledOutputFile *file, int *out, const char **err_out);
+int CEXR_TiledOutputFile_num_y_levels(CEXR_TiledOutputFile *file, int *out, const char **err_out);
+int CEXR_TiledOutputFile_data_window_for_level(CEXR_TiledOutputFile *file, int lx, int ly, CEXR_Box2i *out, const char **err_out);
+int CEXR_TiledOutputFile_num_x_tiles(CEXR_TiledOutputFile *file, int lx, int *out, const char **err_out);
+int CEXR_TiledOutputFile_num_y_tiles(CEXR_TiledOutputFile *file, int ly, int *out, const char **err_out);
+int CEXR_TiledOutputFile_data_window_for_tile(CEXR_TiledOutputFile *file, int dx, int dy, int lx, int ly, CEXR_Box2i *out, const char **err_out);
+int CEXR_TiledOutputFile_write_tile(CEXR_TiledOutputFile *file, int dx, int dy, int lx, int ly, const char **err_out);
+int CEXR_TiledOutputFile_write_tiles(CEXR_TiledOutputFile *file, int dx1, int dx2, int dy1, int dy2, int lx, int ly, const char **err_out);
+int CEXR_TiledOutputFile_copy_pixels(CEXR_TiledOutputFile *file, CEXR_TiledInputFile *in_file, const char **err_out);
+
+int CEXR_MultiPartInputFile_from_stream(CEXR_IStream *stream, int threads, CEXR_MultiPartInputFile **out, const char **err_out);
+void CEXR_MultiPartInputFile_delete(CEXR_MultiPartInputFile *file);
+int CEXR_MultiPartInputFile_parts(CEXR_MultiPartInputFile *file);
+const CEXR_Header *CEXR_MultiPartInputFile_header(CEXR_MultiPartInputFile *file, int part);
+int CEXR_MultiPartInputFile_set_framebuffer(CEXR_MultiPartInputFile *file, int part, CEXR_FrameBuffer *framebuffer, const char **err_out);
+int CEXR_MultiPartInputFile_read_pixels(CEXR_MultiPartInputFile *file, int part, int scanline_1, int scanline_2, const char **err_out);
+
+int CEXR_MultiPartOutputFile_from_stream(CEXR_OStream *stream, const CEXR_Header *const *headers, int parts, int threads, CEXR_MultiPartOutputFile **out, const char **err_out);
+void CEXR_MultiPartOutputFile_delete(CEXR_MultiPartOutputFile *file);
+int CEXR_MultiPartOutputFile_parts(CEXR_MultiPartOutputFile *file);
+const CEXR_Header *CEXR_MultiPartOutputFile_header(CEXR_MultiPartOutputFile *file, int part);
+int CEXR_MultiPartOutputFile_set_framebuffer(CEXR_MultiPartOutputFile *file, int part, const CEXR_FrameBuffer *framebuffer, const char **err_out);
+int CEXR_MultiPartOutputFile_write_pixels(CEXR_MultiPartOutputFile *file, int part, int num_scanlines, const char **err_out);
+
+int CEXR_DeepScanLineInputFile_from_stream(CEXR_IStream *stream, int threads, CEXR_DeepScanLineInputFile **out, const char **err_out);
+void CEXR_DeepScanLineInputFile_delete(CEXR_DeepScanLineInputFile *file);
+const CEXR_Header *CEXR_DeepScanLineInputFile_header(CEXR_DeepScanLineInputFile *file);
+int CEXR_DeepScanLineInputFile_set_framebuffer(CEXR_DeepScanLineInputFile *file, const CEXR_DeepFrameBuffer *framebuffer, const char **err_out);
+int CEXR_DeepScanLineInputFile_read_pixel_sample_counts(CEXR_DeepScanLineInputFile *file, int scanline_1, int scanline_2, const char **err_out);
+int CEXR_DeepScanLineInputFile_read_pixels(CEXR_DeepScanLineInputFile *file, int scanline_1, int scanline_2, const char **err_out);
+
+int CEXR_DeepScanLineOutputFile_from_stream(CEXR_OStream *stream, const CEXR_Header *header, int threads, CEXR_DeepScanLineOutputFile **out, const char **err_out);
+void CEXR_DeepScanLineOutputFile_delete(CEXR_DeepScanLineOutputFile *file);
+const CEXR_Header *CEXR_DeepScanLineOutputFile_header(CEXR_DeepScanLineOutputFile *file);
+int CEXR_DeepScanLineOutputFile_set_framebuffer(CEXR_DeepScanLineOutputFile *file, const CEXR_DeepFrameBuffer *framebuffer, const char **err_out);
+int CEXR_DeepScanLineOutputFile_write_pixels(CEXR_DeepScanLineOutputFile *file, int num_scanlines, const char **err_out);
 
 int CEXR_set_global_thread_count(int thread_count, const char **err_out);
+int CEXR_set_global_thread_provider(
+    int thread_count,
+    void *executor,
+    void (*add_task_ptr)(void *, CEXR_Task *),
+    void (*delete_executor_ptr)(void *),
+    const char **err_out
+);
+void CEXR_Task_run(CEXR_Task *task);
 
 #ifdef __cplusplus
 }
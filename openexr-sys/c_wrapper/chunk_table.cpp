@@ -0,0 +1,157 @@
+#include "chunk_table.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include "ImfVersion.h"
+
+using namespace IMATH_NAMESPACE;
+using namespace Imf;
+
+namespace {
+
+// Restores a stream's position when going out of scope, as far as it can,
+// since a destructor mustn't throw.
+class PositionGuard {
+public:
+    explicit PositionGuard(IStream &is)
+        : is_(is), position_(is.tellg()) {}
+    ~PositionGuard() {
+        try {
+            is_.clear();
+            is_.seekg(position_);
+        } catch(...) {}
+    }
+
+private:
+    IStream &is_;
+    Int64 position_;
+};
+
+// Reads a little-endian integer of `n` bytes, as stored in OpenEXR files.
+uint64_t read_le(IStream &is, int n) {
+    char bytes[8];
+    is.read(bytes, n);
+    uint64_t value = 0;
+    for(int i = n - 1; i >= 0; i--) {
+        value = (value << 8) | static_cast<unsigned char>(bytes[i]);
+    }
+    return value;
+}
+
+// Returns whether the `size` bytes at `position` are all in the stream.
+bool is_in_stream(IStream &is, Int64 position, Int64 size) {
+    try {
+        char last;
+        is.seekg(position + size - 1);
+        is.read(&last, 1);
+        return true;
+    } catch(const std::exception &) {
+        is.clear();
+        return false;
+    }
+}
+
+} // namespace
+
+int scanlines_per_chunk(Compression compression) {
+    switch(compression) {
+        case NO_COMPRESSION:
+        case RLE_COMPRESSION:
+        case ZIPS_COMPRESSION:
+            return 1;
+        case ZIP_COMPRESSION:
+        case PXR24_COMPRESSION:
+            return 16;
+        case DWAB_COMPRESSION:
+            return 256;
+        default:
+            return 32;
+    }
+}
+
+void read_chunk_table(IStream &is, ChunkTable &table) {
+    PositionGuard guard(is);
+
+    // Magic number, version field and header, as in ImfInputFile.cpp.
+    is.seekg(0);
+    char magic_and_version[8];
+    is.read(magic_and_version, 8);
+    if(!isImfMagic(magic_and_version)) {
+        throw std::runtime_error("not an OpenEXR file");
+    }
+    int version = 0;
+    for(int i = 7; i >= 4; i--) {
+        version = (version << 8) | static_cast<unsigned char>(magic_and_version[i]);
+    }
+    if(isTiled(version) || isMultiPart(version) || isNonImage(version)) {
+        throw std::runtime_error("chunk tables are only available for single-part scanline files");
+    }
+    Header header;
+    header.readFrom(is, version);
+
+    const Box2i &data_window = header.dataWindow();
+    const int chunk_rows = scanlines_per_chunk(header.compression());
+    const Int64 height = Int64(data_window.max.y) - data_window.min.y + 1;
+    const size_t count = static_cast<size_t>((height + chunk_rows - 1) / chunk_rows);
+    table.offsets.assign(count, 0);
+    table.sizes.assign(count, 0);
+
+    // Reads the chunk at `position`, returning its index, or -1 if it
+    // doesn't make sense or isn't completely in the stream.
+    auto read_chunk = [&](Int64 position, Int64 &size) -> Int64 {
+        if(!is_in_stream(is, position, 8)) {
+            return -1;
+        }
+        is.seekg(position);
+        const int y = static_cast<int32_t>(read_le(is, 4));
+        size = 8 + Int64(static_cast<int32_t>(read_le(is, 4)));
+
+        const Int64 row = Int64(y) - data_window.min.y;
+        if(row < 0 || row >= height || row % chunk_rows != 0 || size <= 8
+           || !is_in_stream(is, position, size))
+        {
+            return -1;
+        }
+        return row / chunk_rows;
+    };
+
+    // The offset table, which is complete if every entry has been written.
+    bool complete = true;
+    for(auto &offset: table.offsets) {
+        offset = static_cast<Int64>(read_le(is, 8));
+        if(offset <= 0) {
+            complete = false;
+        }
+    }
+    table.table_end = is.tellg();
+
+    if(complete) {
+        for(size_t i = 0; i < count; i++) {
+            Int64 size = 0;
+            if(read_chunk(table.offsets[i], size) == Int64(i)) {
+                table.sizes[i] = size;
+            } else {
+                table.offsets[i] = 0;
+            }
+        }
+        return;
+    }
+
+    // Otherwise scan the chunks after the table, each of which starts with
+    // its first scanline and the size of its data, until one is missing or
+    // doesn't make sense.
+    std::fill(table.offsets.begin(), table.offsets.end(), 0);
+    Int64 position = table.table_end;
+    for(size_t i = 0; i < count; i++) {
+        Int64 size = 0;
+        const Int64 index = read_chunk(position, size);
+        if(index < 0) {
+            break;
+        }
+        table.offsets[index] = position;
+        table.sizes[index] = size;
+        position += size;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef CEXR_CHUNK_TABLE_H_
+#define CEXR_CHUNK_TABLE_H_
+
+#include <vector>
+
+#include "ImfHeader.h"
+#include "ImfIO.h"
+
+// Where the chunks of a single-part scanline file are, in order from the top
+// of the data window.  Chunks that are missing have an offset and size of 0.
+struct ChunkTable {
+    // The end of the header and offset table, where the chunks start.
+    IMATH_NAMESPACE::Int64 table_end = 0;
+    std::vector<IMATH_NAMESPACE::Int64> offsets;
+    // Sizes of the whole chunks, including their scanline and data size
+    // fields.
+    std::vector<IMATH_NAMESPACE::Int64> sizes;
+};
+
+// Returns the number of scanlines in each chunk of a scanline file
+// compressed with `compression`.
+int scanlines_per_chunk(Imf::Compression compression);
+
+// Finds the chunks of the single-part scanline file on `is`.
+//
+// Each entry of the offset table is checked against the scanline and size
+// at the start of its chunk, and chunks that don't make sense or aren't
+// completely in the stream are treated as missing.  The offset table is only
+// filled in once the file has been completely written, so if any of its
+// entries are missing, the chunks are instead found by scanning the ones
+// that follow the table, in the same way that OpenEXR does when opening such
+// a file.
+//
+// The stream is left at the position it was in beforehand, since OpenEXR
+// keeps track of it between reads.
+void read_chunk_table(Imf::IStream &is, ChunkTable &table);
+
+#endif
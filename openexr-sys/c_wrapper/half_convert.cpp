@@ -0,0 +1,60 @@
+#include "half_convert.hpp"
+
+#include "half.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CEXR_HALF_CONVERT_F16C
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define CEXR_HALF_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+static void half_to_float_scalar(const uint16_t *src, float *dst, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) {
+        half h;
+        h.setBits(src[i]);
+        dst[i] = h;
+    }
+}
+
+#if defined(CEXR_HALF_CONVERT_F16C)
+
+__attribute__((target("avx,f16c")))
+static void half_to_float_f16c(const uint16_t *src, float *dst, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+    }
+    half_to_float_scalar(src + i, dst + i, n - i);
+}
+
+void half_to_float(const uint16_t *src, float *dst, std::size_t n) {
+    static const bool has_f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    if (has_f16c) {
+        half_to_float_f16c(src, dst, n);
+    } else {
+        half_to_float_scalar(src, dst, n);
+    }
+}
+
+#elif defined(CEXR_HALF_CONVERT_NEON)
+
+void half_to_float(const uint16_t *src, float *dst, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(src + i));
+        vst1q_f32(dst + i, vcvt_f32_f16(vget_low_f16(h)));
+        vst1q_f32(dst + i + 4, vcvt_high_f32_f16(h));
+    }
+    half_to_float_scalar(src + i, dst + i, n - i);
+}
+
+#else
+
+void half_to_float(const uint16_t *src, float *dst, std::size_t n) {
+    half_to_float_scalar(src, dst, n);
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef CEXR_HALF_CONVERT_H_
+#define CEXR_HALF_CONVERT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Converts `n` half floats, given by their bits, to floats.
+//
+// Uses F16C on x86 CPUs that support it and NEON on AArch64, and converts
+// one value at a time otherwise.
+void half_to_float(const uint16_t *src, float *dst, std::size_t n);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef CEXR_IO_STATS_H_
+#define CEXR_IO_STATS_H_
+
+#include <chrono>
+#include <cstdint>
+
+// I/O counters kept by the stream classes.
+//
+// `bytes` counts the bytes OpenEXR reads or writes through the stream,
+// while `calls`, `seeks` and `nanos` only count the calls made to a Rust
+// reader or writer, and the time spent in them.
+struct IoStats {
+    std::uint64_t bytes = 0;
+    std::uint64_t calls = 0;
+    std::uint64_t seeks = 0;
+    std::uint64_t nanos = 0;
+};
+
+// Base class of the streams that keep `IoStats`, so they can be found with
+// a dynamic_cast from Imf::IStream or Imf::OStream.
+class IoCounted {
+public:
+    virtual ~IoCounted() {}
+
+    const IoStats &io_stats() const {
+        return stats;
+    }
+
+protected:
+    IoStats stats;
+};
+
+// Adds the time from its construction to its destruction to `nanos`.
+class IoTimer {
+public:
+    explicit IoTimer(std::uint64_t &nanos)
+        : nanos{nanos}, start{std::chrono::steady_clock::now()} {}
+
+    ~IoTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+
+    IoTimer(const IoTimer &) = delete;
+    IoTimer &operator=(const IoTimer &) = delete;
+
+private:
+    std::uint64_t &nanos;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
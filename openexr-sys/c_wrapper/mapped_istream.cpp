@@ -0,0 +1,116 @@
+#include "mapped_istream.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+static std::runtime_error last_error(const char *what, const char *path) {
+    return std::runtime_error(std::string(what) + " " + path + ": error code " + std::to_string(GetLastError()));
+}
+
+MappedIStream::MappedIStream(const char *path)
+    : MemoryIStream{path, nullptr, 0}, mapping_{nullptr}
+{
+    int wide_len = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+    if(wide_len == 0) {
+        throw last_error("invalid path", path);
+    }
+    std::wstring wide_path(wide_len, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, path, -1, &wide_path[0], wide_len);
+
+    HANDLE file = CreateFileW(wide_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        throw last_error("couldn't open", path);
+    }
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw last_error("couldn't get the size of", path);
+    }
+
+    // Empty files can't be mapped, but they're valid (if useless) input.
+    if(size.QuadPart > 0) {
+        mapping_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if(mapping_ == nullptr) {
+            throw last_error("couldn't map", path);
+        }
+
+        data_ = static_cast<char *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if(data_ == nullptr) {
+            CloseHandle(mapping_);
+            throw last_error("couldn't map", path);
+        }
+        size_ = static_cast<std::size_t>(size.QuadPart);
+    } else {
+        CloseHandle(file);
+    }
+}
+
+MappedIStream::~MappedIStream() {
+    if(data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if(mapping_ != nullptr) {
+        CloseHandle(mapping_);
+    }
+}
+
+#else
+
+static std::runtime_error errno_error(const char *what, const char *path) {
+    return std::runtime_error(std::string(what) + " " + path + ": " + strerror(errno));
+}
+
+MappedIStream::MappedIStream(const char *path)
+    : MemoryIStream{path, nullptr, 0}
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        throw errno_error("couldn't open", path);
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0) {
+        auto err = errno_error("couldn't get the size of", path);
+        close(fd);
+        throw err;
+    }
+
+    // Empty files can't be mapped, but they're valid (if useless) input.
+    if(info.st_size > 0) {
+        void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED) {
+            auto err = errno_error("couldn't map", path);
+            close(fd);
+            throw err;
+        }
+        data_ = static_cast<char *>(data);
+        size_ = static_cast<std::size_t>(info.st_size);
+    }
+
+    // The mapping stays valid after the file is closed.
+    close(fd);
+}
+
+MappedIStream::~MappedIStream() {
+    if(data_ != nullptr) {
+        munmap(data_, size_);
+    }
+}
+
+#endif
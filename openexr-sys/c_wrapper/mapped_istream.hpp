@@ -0,0 +1,25 @@
+#ifndef CEXR_MAPPED_ISTREAM_H_
+#define CEXR_MAPPED_ISTREAM_H_
+
+#include "memory_istream.hpp"
+
+// A MemoryIStream over a read-only memory mapping of a file.
+//
+// The mapping is owned by the stream and released when it's destroyed, so
+// OpenEXR can read chunks directly out of the page cache via
+// readMemoryMapped() without an intermediate copy.
+class MappedIStream: public MemoryIStream {
+public:
+    explicit MappedIStream(const char *path);
+    ~MappedIStream();
+
+    MappedIStream(const MappedIStream &) = delete;
+    MappedIStream &operator=(const MappedIStream &) = delete;
+
+private:
+#ifdef _WIN32
+    void *mapping_;
+#endif
+};
+
+#endif
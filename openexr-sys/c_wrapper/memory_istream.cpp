@@ -9,6 +9,7 @@ bool MemoryIStream::read(char *c, int n) {
     if(position_ + n <= size_) {
         memcpy(c, static_cast<void *>(data_ + position_), n);
         position_ += n;
+        stats.bytes += n;
     } else {
         throw std::runtime_error("unexpected EOF");
     }
@@ -35,5 +36,12 @@ char *MemoryIStream::readMemoryMapped(int n) {
 
     std::size_t start = position_;
     position_ += n;
+    stats.bytes += n;
     return data_ + start;
 }
+
+void MemoryIStream::reset(char *data, std::size_t size) {
+    data_ = data;
+    size_ = size;
+    position_ = 0;
+}
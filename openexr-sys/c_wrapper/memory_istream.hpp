@@ -3,9 +3,11 @@
 
 #include "ImfIO.h"
 
+#include "io_stats.hpp"
+
 #include <cstddef>
 
-class MemoryIStream: public Imf::IStream {
+class MemoryIStream: public Imf::IStream, public IoCounted {
 public:
     MemoryIStream(const char *filename, char *data, std::size_t size)
         : IStream{filename}, data_{data}, position_{0}, size_{size} {}
@@ -16,7 +18,11 @@ public:
     bool isMemoryMapped() const;
     char *readMemoryMapped(int n);
 
-private:
+    // Points the stream at new data, starting from its beginning, so that
+    // one stream can be reused for many files.
+    void reset(char *data, std::size_t size);
+
+protected:
     char *data_;
     std::size_t position_;
     std::size_t size_;
@@ -0,0 +1,60 @@
+#include "memory_ostream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace IMATH_NAMESPACE;
+
+MemoryOStream::MemoryOStream(
+    void *vec,
+    int (*sync_ptr)(void *, std::size_t, std::size_t, char **, std::size_t *)
+)
+    : OStream{"in-memory data"},
+    vec{vec},
+    sync_ptr{sync_ptr},
+    data{nullptr},
+    capacity{0},
+    position{0},
+    len{0}
+{
+    if (sync_ptr(vec, 0, 0, &data, &capacity) != 0) {
+        throw std::runtime_error("error preparing output buffer");
+    }
+}
+
+MemoryOStream::~MemoryOStream() {
+    sync_ptr(vec, len, 0, &data, &capacity);
+}
+
+void MemoryOStream::write(const char c[], int n) {
+    std::size_t end = position + std::size_t(n);
+    if (end > capacity) {
+        // Grow geometrically, so that a vector that starts out small is
+        // only reallocated a logarithmic number of times.
+        reserve(std::max(end, capacity * 2));
+    }
+
+    // Seeks past the end leave a gap, which is zeroed.
+    if (position > len) {
+        memset(data + len, 0, position - len);
+    }
+    memcpy(data + position, c, n);
+    position = end;
+    len = std::max(len, end);
+    stats.bytes += n;
+}
+
+Int64 MemoryOStream::tellp() {
+    return position;
+}
+
+void MemoryOStream::seekp(Int64 pos) {
+    position = std::size_t(pos);
+}
+
+void MemoryOStream::reserve(std::size_t new_capacity) {
+    if (sync_ptr(vec, len, new_capacity, &data, &capacity) != 0 || capacity < new_capacity) {
+        throw std::runtime_error("error growing output buffer");
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef CEXR_MEMORY_OSTREAM_H_
+#define CEXR_MEMORY_OSTREAM_H_
+
+#include "ImfIO.h"
+
+#include "io_stats.hpp"
+
+#include <cstddef>
+
+// An OStream that writes straight into the storage of a Rust `Vec<u8>`.
+//
+// Writes are copied into the vector's spare capacity, and the vector is
+// only called back into (via `sync_ptr`) when it has to grow, and when the
+// stream is destroyed.  `sync_ptr` is given the number of bytes written so
+// far, which the vector takes as its length, and the capacity needed, and
+// returns the vector's storage.  A vector with enough capacity reserved up
+// front is never reallocated.
+class MemoryOStream: public Imf::OStream, public IoCounted {
+public:
+    MemoryOStream(
+        void *vec,
+        int (*sync_ptr)(void *, std::size_t, std::size_t, char **, std::size_t *)
+    );
+
+    // Tells the vector its final length.  Errors at this point can't be
+    // reported, so they're ignored.
+    virtual ~MemoryOStream();
+
+    MemoryOStream(const MemoryOStream &) = delete;
+    MemoryOStream &operator=(const MemoryOStream &) = delete;
+
+    virtual void write (const char c[/*n*/], int n);
+    virtual Imath::Int64 tellp ();
+    virtual void seekp (Imath::Int64 pos);
+
+private:
+    // Makes sure the storage holds at least `capacity` bytes.
+    void reserve(std::size_t capacity);
+
+    void *vec;
+    int (*sync_ptr)(void *, std::size_t, std::size_t, char **, std::size_t *);
+    char *data;
+    std::size_t capacity;
+    std::size_t position;
+    std::size_t len; // Bytes written so far, up to the furthest write.
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "prefixed_istream.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace IMATH_NAMESPACE;
+
+PrefixedIStream::PrefixedIStream(Imf::IStream *inner, const char *prefix, std::size_t size)
+    : IStream{inner->fileName()},
+    inner_{inner},
+    inner_counted_{dynamic_cast<const IoCounted *>(inner)},
+    prefix_(prefix, prefix + size),
+    position_{0},
+    inner_position_{-1},
+    prefix_bytes_{0}
+{
+    update_stats();
+}
+
+PrefixedIStream::~PrefixedIStream() {
+    delete inner_;
+}
+
+bool PrefixedIStream::read(char c[], int n) {
+    const Int64 prefix_size = prefix_.size();
+    if(position_ < prefix_size) {
+        const int count = static_cast<int>(std::min<Int64>(n, prefix_size - position_));
+        std::memcpy(c, prefix_.data() + position_, count);
+        position_ += count;
+        prefix_bytes_ += count;
+        c += count;
+        n -= count;
+        if(n == 0) {
+            update_stats();
+            return true;
+        }
+    }
+
+    seek_inner();
+    inner_position_ = -1; // In case the read fails partway.
+    const bool more = inner_->read(c, n);
+    position_ += n;
+    inner_position_ = position_;
+    update_stats();
+    return more;
+}
+
+Int64 PrefixedIStream::tellg() {
+    return position_;
+}
+
+void PrefixedIStream::seekg(Int64 pos) {
+    position_ = pos;
+}
+
+void PrefixedIStream::clear() {
+    inner_->clear();
+}
+
+bool PrefixedIStream::isMemoryMapped() const {
+    return inner_->isMemoryMapped();
+}
+
+char *PrefixedIStream::readMemoryMapped(int n) {
+    const Int64 prefix_size = prefix_.size();
+    if(position_ >= prefix_size) {
+        seek_inner();
+        inner_position_ = -1;
+        char *data = inner_->readMemoryMapped(n);
+        position_ += n;
+        inner_position_ = position_;
+        update_stats();
+        return data;
+    }
+    if(position_ + n <= prefix_size) {
+        char *data = prefix_.data() + position_;
+        position_ += n;
+        prefix_bytes_ += n;
+        update_stats();
+        return data;
+    }
+
+    // Across the end of the copy.
+    scratch_.resize(n);
+    read(scratch_.data(), n);
+    return scratch_.data();
+}
+
+void PrefixedIStream::seek_inner() {
+    if(inner_position_ != position_) {
+        inner_->seekg(position_);
+        inner_position_ = position_;
+    }
+}
+
+void PrefixedIStream::update_stats() {
+    if(inner_counted_) {
+        stats = inner_counted_->io_stats();
+    }
+    stats.bytes += prefix_bytes_;
+}
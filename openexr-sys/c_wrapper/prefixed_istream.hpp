@@ -0,0 +1,48 @@
+#ifndef CEXR_PREFIXED_ISTREAM_H_
+#define CEXR_PREFIXED_ISTREAM_H_
+
+#include "ImfIO.h"
+
+#include "io_stats.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// An IStream that serves the first bytes of a file from a copy kept in
+// memory, such as a cached header and offset table, and the rest from
+// another stream, which it owns.
+//
+// Reads of the cached bytes never touch the other stream, so opening a file
+// through it only reads from the other stream once it gets to the chunks.
+// The stats are those of the other stream, plus the bytes served from the
+// copy.
+class PrefixedIStream: public Imf::IStream, public IoCounted {
+public:
+    PrefixedIStream(Imf::IStream *inner, const char *prefix, std::size_t size);
+    ~PrefixedIStream();
+
+    PrefixedIStream(const PrefixedIStream &) = delete;
+    PrefixedIStream &operator=(const PrefixedIStream &) = delete;
+
+    bool read(char c[/*n*/], int n);
+    IMATH_NAMESPACE::Int64 tellg();
+    void seekg(IMATH_NAMESPACE::Int64 pos);
+    void clear();
+    bool isMemoryMapped() const;
+    char *readMemoryMapped(int n);
+
+private:
+    // Moves the other stream to `position_`, if it isn't there already.
+    void seek_inner();
+    void update_stats();
+
+    Imf::IStream *inner_;
+    const IoCounted *inner_counted_;
+    std::vector<char> prefix_;
+    IMATH_NAMESPACE::Int64 position_;       // Position as seen by OpenEXR.
+    IMATH_NAMESPACE::Int64 inner_position_; // Position of `inner_`, or -1 if unknown.
+    std::uint64_t prefix_bytes_;
+    std::vector<char> scratch_; // For memory-mapped reads across the end of the copy.
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "preview.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "half.h"
+
+using namespace IMATH_NAMESPACE;
+using namespace Imf;
+
+namespace {
+
+// The exposure exrmakepreview uses by default, as a scale factor.
+const float EXPOSURE_SCALE = std::pow(2.0f, 2.47393f);
+
+// Compresses values above 1, as exrmakepreview does.
+float knee(float x, float f) {
+    return std::log(x * f + 1.0f) / f;
+}
+
+unsigned char tone_map(float value) {
+    float x = std::max(0.0f, value * EXPOSURE_SCALE);
+    if (x > 1.0f) {
+        x = 1.0f + knee(x - 1.0f, 0.184874f);
+    }
+    return static_cast<unsigned char>(std::min(std::max(std::pow(x, 0.4545f) * 84.66f, 0.0f), 255.0f));
+}
+
+unsigned char alpha(float value) {
+    return static_cast<unsigned char>(std::min(std::max(value * 255.0f + 0.5f, 0.0f), 255.0f));
+}
+
+// Division rounding toward negative infinity, as OpenEXR uses to address
+// subsampled slices.
+std::ptrdiff_t floor_div(int x, int y) {
+    return x / y - ((x % y != 0) && ((x < 0) != (y < 0)));
+}
+
+// Reads the value of `slice` at pixel (x, y) as a float.
+float sample(const Slice &slice, int x, int y) {
+    const char *p = slice.base
+        + floor_div(x, slice.xSampling) * std::ptrdiff_t(slice.xStride)
+        + floor_div(y, slice.ySampling) * std::ptrdiff_t(slice.yStride);
+    switch (slice.type) {
+    case HALF:
+        return *reinterpret_cast<const half *>(p);
+    case FLOAT:
+        return *reinterpret_cast<const float *>(p);
+    default:
+        return float(*reinterpret_cast<const std::uint32_t *>(p));
+    }
+}
+
+// The data window coordinate sampled for preview pixel `i` of `n` along an
+// axis from `min` to `max`.
+int sample_position(unsigned i, unsigned n, int min, int max) {
+    std::int64_t size = std::int64_t(max) - min + 1;
+    return min + int((std::int64_t(2 * i + 1) * size) / (2 * std::int64_t(n)));
+}
+
+} // namespace
+
+void sample_preview(
+    const FrameBuffer &framebuffer,
+    const Box2i &data_window,
+    int scanline_1,
+    int scanline_2,
+    unsigned width,
+    unsigned height,
+    PreviewRgba *pixels
+) {
+    const Slice *r = framebuffer.findSlice("R");
+    const Slice *g = framebuffer.findSlice("G");
+    const Slice *b = framebuffer.findSlice("B");
+    const Slice *a = framebuffer.findSlice("A");
+    if (!r) {
+        r = g = b = framebuffer.findSlice("Y");
+    }
+
+    for (unsigned py = 0; py < height; ++py) {
+        int y = sample_position(py, height, data_window.min.y, data_window.max.y);
+        if (y < scanline_1 || y > scanline_2) {
+            continue;
+        }
+        for (unsigned px = 0; px < width; ++px) {
+            int x = sample_position(px, width, data_window.min.x, data_window.max.x);
+            PreviewRgba &pixel = pixels[std::size_t(py) * width + px];
+            pixel.r = r ? tone_map(sample(*r, x, y)) : 0;
+            pixel.g = g ? tone_map(sample(*g, x, y)) : 0;
+            pixel.b = b ? tone_map(sample(*b, x, y)) : 0;
+            pixel.a = a ? alpha(sample(*a, x, y)) : 255;
+        }
+    }
+}
+
+void read_preview(
+    InputFile &file,
+    unsigned width,
+    unsigned height,
+    PreviewRgba *pixels
+) {
+    const Box2i &dw = file.header().dataWindow();
+    const ChannelList &channels = file.header().channels();
+
+    // One row of floats per channel used, with a y stride of zero so that
+    // every scanline is read into it.
+    static const char *const names[] = {"R", "G", "B", "A", "Y"};
+    const std::size_t row_width = std::size_t(dw.max.x) - dw.min.x + 1;
+    std::vector<std::vector<float>> rows;
+    std::vector<int> y_samplings;
+    FrameBuffer row_fb;
+    for (const char *name : names) {
+        const Channel *channel = channels.findChannel(name);
+        if (!channel) {
+            continue;
+        }
+        rows.emplace_back(row_width);
+        char *base = reinterpret_cast<char *>(rows.back().data())
+            - floor_div(dw.min.x, channel->xSampling) * std::ptrdiff_t(sizeof(float));
+        row_fb.insert(name, Slice(FLOAT, base, sizeof(float), 0, channel->xSampling, channel->ySampling));
+        y_samplings.push_back(channel->ySampling);
+    }
+    file.setFrameBuffer(row_fb);
+
+    std::vector<int> sampled_rows;
+    for (unsigned py = 0; py < height; ++py) {
+        int y = sample_position(py, height, dw.min.y, dw.max.y);
+
+        // A scanline only holds values of the channels sampled on it, so
+        // each channel's value for `y` is read from its last sampled row at
+        // or above `y`.  Reading those rows from the top down leaves every
+        // channel's row holding its own.
+        sampled_rows.clear();
+        for (int y_sampling : y_samplings) {
+            sampled_rows.push_back(int(floor_div(y, y_sampling) * y_sampling));
+        }
+        std::sort(sampled_rows.begin(), sampled_rows.end());
+        sampled_rows.erase(std::unique(sampled_rows.begin(), sampled_rows.end()), sampled_rows.end());
+        for (int row : sampled_rows) {
+            file.readPixels(row);
+        }
+        sample_preview(row_fb, dw, y, y, width, height, pixels);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef CEXR_PREVIEW_H_
+#define CEXR_PREVIEW_H_
+
+#include "ImathBox.h"
+#include "ImfFrameBuffer.h"
+#include "ImfInputFile.h"
+#include "ImfPreviewImage.h"
+
+// Fills the rows of a `width` x `height` preview image whose scanlines
+// (sampled from the middle of each preview pixel's area of the data
+// window) are in `scanline_1` to `scanline_2`, from the channels of
+// `framebuffer`.
+//
+// "R", "G" and "B" are used for color, or "Y" for all three if there's no
+// "R", and "A" for alpha if present.  Colors are tone mapped the same way
+// as by OpenEXR's exrmakepreview tool.
+void sample_preview(
+    const Imf::FrameBuffer &framebuffer,
+    const IMATH_NAMESPACE::Box2i &data_window,
+    int scanline_1,
+    int scanline_2,
+    unsigned width,
+    unsigned height,
+    Imf::PreviewRgba *pixels
+);
+
+// Makes a `width` x `height` preview image of `file` by reading only the
+// scanlines that are sampled, one at a time, into a single row.
+//
+// This changes the framebuffer set on `file`.
+void read_preview(
+    Imf::InputFile &file,
+    unsigned width,
+    unsigned height,
+    Imf::PreviewRgba *pixels
+);
+
+#endif
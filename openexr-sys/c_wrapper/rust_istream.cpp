@@ -1,22 +1,43 @@
 #include "rust_istream.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <system_error>
 
 using namespace IMATH_NAMESPACE;
 
 bool RustIStream::read(char c[/*n*/], int n) {
-    int err = 0;
-    int res = read_ptr(reader, c, n, &err);
-    if (res == 0) {
-        // Success
-        cursor_pos += n;
-    } else if (res == 1) {
-        // System error
-        throw std::system_error(err, std::system_category());
-    } else {
-        // Some other kind of error
-        throw std::runtime_error("error reading from input");
+    stats.bytes += n;
+    while (n > 0) {
+        // Copy whatever is available from the buffer.
+        if (cursor_pos >= buffer_pos && cursor_pos < buffer_pos + Int64(buffer_len)) {
+            std::size_t offset = std::size_t(cursor_pos - buffer_pos);
+            int count = int(std::min(std::size_t(n), buffer_len - offset));
+            memcpy(c, buffer.data() + offset, count);
+            c += count;
+            n -= count;
+            cursor_pos += count;
+            continue;
+        }
+
+        if (std::size_t(n) >= buffer.size()) {
+            // Large reads go straight into the destination.
+            int count = read_reader(c, n);
+            if (count < n) {
+                throw std::runtime_error("unexpected EOF");
+            }
+            cursor_pos += count;
+            n = 0;
+        } else {
+            // Refill the buffer.
+            buffer_pos = cursor_pos;
+            buffer_len = 0;
+            buffer_len = read_reader(buffer.data(), int(buffer.size()));
+            if (buffer_len == 0) {
+                throw std::runtime_error("unexpected EOF");
+            }
+        }
     }
 
     // Note: this return value appears to never actually be used by
@@ -29,11 +50,47 @@ Imath::Int64 RustIStream::tellg() {
 }
 
 void RustIStream::seekg(Imath::Int64 pos) {
+    // The reader is only seeked when we actually need to read from it.
+    cursor_pos = pos;
+}
+
+int RustIStream::read_reader(char *c, int n) {
+    if (reader_pos != cursor_pos) {
+        seek_reader(cursor_pos);
+    }
+
     int err = 0;
-    int res = seekg_ptr(reader, pos, &err);
+    int count = 0;
+    int res;
+    {
+        IoTimer timer{stats.nanos};
+        stats.calls += 1;
+        res = read_ptr(reader, c, n, &count, &err);
+    }
+    if (res == 0) {
+        // Success
+        reader_pos += count;
+        return count;
+    } else if (res == 1) {
+        // System error
+        throw std::system_error(err, std::system_category());
+    } else {
+        // Some other kind of error
+        throw std::runtime_error("error reading from input");
+    }
+}
+
+void RustIStream::seek_reader(Imath::Int64 pos) {
+    int err = 0;
+    int res;
+    {
+        IoTimer timer{stats.nanos};
+        stats.seeks += 1;
+        res = seekg_ptr(reader, pos, &err);
+    }
     if (res == 0) {
         // Success
-        cursor_pos = pos;
+        reader_pos = pos;
     } else if (res == 1) {
         // System error
         throw std::system_error(err, std::system_category());
@@ -3,23 +3,42 @@
 
 #include "ImfIO.h"
 
+#include "io_stats.hpp"
+
+#include <algorithm>
+#include <climits>
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
-class RustIStream: public Imf::IStream {
+// An IStream that reads from a Rust reader via callbacks.
+//
+// Reads are served from an internal read-ahead buffer of `buffer_size`
+// bytes, so that the many small reads OpenEXR does (e.g. when parsing the
+// header and offset tables) turn into a few large reads on the Rust side.
+// Reads at least as large as the buffer bypass it entirely.  Seeks within
+// the buffered data don't touch the reader at all, and other seeks are
+// deferred until the next read.  A `buffer_size` of zero disables
+// buffering.
+class RustIStream: public Imf::IStream, public IoCounted {
 public:
     RustIStream(
         void *reader,
-        int (*read_ptr)(void *, char *, int, int *err_out),
-        int (*seekg_ptr)(void *, std::uint64_t, int *err_out)
+        int (*read_ptr)(void *, char *, int, int *read_out, int *err_out),
+        int (*seekg_ptr)(void *, std::uint64_t, int *err_out),
+        std::size_t buffer_size
     )
         : IStream{"Rust reader"},
         reader{reader},
         read_ptr{read_ptr},
         seekg_ptr{seekg_ptr},
-        cursor_pos{0}
+        cursor_pos{0},
+        reader_pos{0},
+        buffer(std::min<std::size_t>(buffer_size, INT_MAX)),
+        buffer_pos{0},
+        buffer_len{0}
     {
-        seekg(0);
+        seek_reader(0);
     }
 
     bool read(char c[/*n*/], int n);
@@ -27,11 +46,21 @@ public:
     void seekg(Imath::Int64 pos);
 
 private:
+    // Reads up to `n` bytes from the reader at `cursor_pos`, returning the
+    // number of bytes read.  Only returns less than `n` at the end of the
+    // input.
+    int read_reader(char *c, int n);
+    void seek_reader(Imath::Int64 pos);
+
     void *reader;
-    int (*read_ptr)(void *, char *, int, int *err_out);
-    Imath::Int64 (*tellp_ptr)(void *);
+    int (*read_ptr)(void *, char *, int, int *read_out, int *err_out);
     int (*seekg_ptr)(void *, std::uint64_t, int *err_out);
-    Imath::Int64 cursor_pos;
+    Imath::Int64 cursor_pos; // Position as seen by OpenEXR.
+    Imath::Int64 reader_pos; // Position of the underlying reader.
+
+    std::vector<char> buffer;
+    Imath::Int64 buffer_pos; // Position in the input of buffer[0].
+    std::size_t buffer_len;  // Number of valid bytes in the buffer.
 };
 
 #endif
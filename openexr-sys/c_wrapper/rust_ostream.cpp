@@ -5,12 +5,66 @@
 
 using namespace IMATH_NAMESPACE;
 
+RustOStream::~RustOStream() {
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
 void RustOStream::write(const char c[], int n) {
+    stats.bytes += n;
+    if (buffer.size() + std::size_t(n) > buffer_capacity) {
+        flush();
+    }
+
+    if (std::size_t(n) >= buffer_capacity) {
+        // Large writes go straight to the writer.
+        write_writer(c, n);
+    } else {
+        buffer.insert(buffer.end(), c, c + n);
+    }
+    cursor_pos += n;
+}
+
+Imath::Int64 RustOStream::tellp() {
+    return cursor_pos;
+}
+
+void RustOStream::seekp(Imath::Int64 pos) {
+    if (pos == cursor_pos) {
+        return;
+    }
+
+    // The writer is only seeked when we actually need to write to it.
+    flush();
+    cursor_pos = pos;
+}
+
+void RustOStream::flush() {
+    if (!buffer.empty()) {
+        write_writer(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+void RustOStream::write_writer(const char *c, std::size_t n) {
+    // Where the data goes, accounting for data still in the buffer.
+    Imath::Int64 pos = cursor_pos - Int64(buffer.size());
+    if (writer_pos != pos) {
+        seek_writer(pos);
+    }
+
     int err = 0;
-    int res = write_ptr(writer, c, n, &err);
+    int res;
+    {
+        IoTimer timer{stats.nanos};
+        stats.calls += 1;
+        res = write_ptr(writer, c, int(n), &err);
+    }
     if (res == 0) {
         // Success
-        cursor_pos += n;
+        writer_pos += n;
     } else if (res == 1) {
         // System error
         throw std::system_error(err, std::system_category());
@@ -20,16 +74,17 @@ void RustOStream::write(const char c[], int n) {
     }
 }
 
-Imath::Int64 RustOStream::tellp() {
-    return cursor_pos;
-}
-
-void RustOStream::seekp(Imath::Int64 pos) {
+void RustOStream::seek_writer(Imath::Int64 pos) {
     int err = 0;
-    int res = seekp_ptr(writer, pos, &err);
+    int res;
+    {
+        IoTimer timer{stats.nanos};
+        stats.seeks += 1;
+        res = seekp_ptr(writer, pos, &err);
+    }
     if (res == 0) {
         // Success
-        cursor_pos = pos;
+        writer_pos = pos;
     } else if (res == 1) {
         // System error
         throw std::system_error(err, std::system_category());
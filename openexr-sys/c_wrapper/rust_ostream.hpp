@@ -3,34 +3,64 @@
 
 #include "ImfIO.h"
 
+#include "io_stats.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
-class RustOStream: public Imf::OStream {
+// An OStream that writes to a Rust writer via callbacks.
+//
+// Writes are collected in an internal write-behind buffer of `buffer_size`
+// bytes, and passed on to the Rust side when it fills up, before seeks, and
+// when the stream is destroyed.  Writes at least as large as the buffer
+// bypass it entirely.  A `buffer_size` of zero disables buffering.
+class RustOStream: public Imf::OStream, public IoCounted {
 public:
     RustOStream(
         void *writer,
         int (*write_ptr)(void *, const char *, int, int *err_out),
-        int (*seekp_ptr)(void *, std::uint64_t, int *err_out)
+        int (*seekp_ptr)(void *, std::uint64_t, int *err_out),
+        std::size_t buffer_size
     )
         : OStream{"Rust StreamWriter"},
         writer{writer},
         write_ptr{write_ptr},
         seekp_ptr{seekp_ptr},
-        cursor_pos{0}
+        cursor_pos{0},
+        writer_pos{0},
+        buffer_capacity{std::min<std::size_t>(buffer_size, INT_MAX)}
     {
-        seekp(0);
+        buffer.reserve(buffer_capacity);
+        seek_writer(0);
     }
 
+    // Flushes any buffered data.  Errors at this point can't be reported,
+    // so they're ignored.
+    virtual ~RustOStream();
+
     virtual void write (const char c[/*n*/], int n);
     virtual Imath::Int64 tellp ();
     virtual void seekp (Imath::Int64 pos);
 
+    // Passes all buffered data on to the writer.
+    void flush();
+
 private:
+    void write_writer(const char *c, std::size_t n);
+    void seek_writer(Imath::Int64 pos);
+
     void *writer;
     int (*write_ptr)(void *, const char *, int, int *err_out);
-    Imath::Int64 (*tellp_ptr)(void *);
     int (*seekp_ptr)(void *, std::uint64_t, int *err_out);
-    Imath::Int64 cursor_pos;
+    Imath::Int64 cursor_pos; // Position as seen by OpenEXR.
+    Imath::Int64 writer_pos; // Position of the underlying writer.
+
+    // Buffered data, which starts at `cursor_pos - buffer.size()`.
+    std::vector<char> buffer;
+    std::size_t buffer_capacity;
 };
 
 #endif
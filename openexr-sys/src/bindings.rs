@@ -279,6 +279,156 @@ fn bindgen_test_layout_CEXR_Channel() {
         )
     );
 }
+#[repr(u32)]
+/// Resolution levels stored in a tiled image.
+///
+/// * `ONE_LEVEL`: only the full resolution image is stored.
+/// * `MIPMAP_LEVELS`: the image is stored at full resolution and at
+///   successively halved resolutions, down to a single pixel.
+/// * `RIPMAP_LEVELS`: like `MIPMAP_LEVELS`, but the width and height are
+///   halved independently of each other.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash)]
+pub enum CEXR_LevelMode {
+    ONE_LEVEL = 0,
+    MIPMAP_LEVELS = 1,
+    RIPMAP_LEVELS = 2,
+}
+#[repr(u32)]
+/// How the size of each level is rounded when halving an odd dimension.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash)]
+pub enum CEXR_LevelRoundingMode {
+    ROUND_DOWN = 0,
+    ROUND_UP = 1,
+}
+/// Describes the tiling of a tiled image.
+///
+/// `x_size` and `y_size` are the width and height of each tile in pixels.
+/// `mode` is which resolution levels are stored, and `rounding_mode` is how
+/// level sizes are rounded.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct CEXR_TileDescription {
+    pub x_size: ::std::os::raw::c_uint,
+    pub y_size: ::std::os::raw::c_uint,
+    pub mode: CEXR_LevelMode,
+    pub rounding_mode: CEXR_LevelRoundingMode,
+}
+#[test]
+fn bindgen_test_layout_CEXR_TileDescription() {
+    assert_eq!(
+        ::std::mem::size_of::<CEXR_TileDescription>(),
+        16usize,
+        concat!("Size of: ", stringify!(CEXR_TileDescription))
+    );
+    assert_eq!(
+        ::std::mem::align_of::<CEXR_TileDescription>(),
+        4usize,
+        concat!("Alignment of ", stringify!(CEXR_TileDescription))
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<CEXR_TileDescription>())).x_size as *const _ as usize },
+        0usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_TileDescription),
+            "::",
+            stringify!(x_size)
+        )
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<CEXR_TileDescription>())).y_size as *const _ as usize },
+        4usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_TileDescription),
+            "::",
+            stringify!(y_size)
+        )
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<CEXR_TileDescription>())).mode as *const _ as usize },
+        8usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_TileDescription),
+            "::",
+            stringify!(mode)
+        )
+    );
+    assert_eq!(
+        unsafe {
+            &(*(::std::ptr::null::<CEXR_TileDescription>())).rounding_mode as *const _ as usize
+        },
+        12usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_TileDescription),
+            "::",
+            stringify!(rounding_mode)
+        )
+    );
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct CEXR_PreviewRgba {
+    pub r: ::std::os::raw::c_uchar,
+    pub g: ::std::os::raw::c_uchar,
+    pub b: ::std::os::raw::c_uchar,
+    pub a: ::std::os::raw::c_uchar,
+}
+#[test]
+fn bindgen_test_layout_CEXR_PreviewRgba() {
+    assert_eq!(
+        ::std::mem::size_of::<CEXR_PreviewRgba>(),
+        4usize,
+        concat!("Size of: ", stringify!(CEXR_PreviewRgba))
+    );
+    assert_eq!(
+        ::std::mem::align_of::<CEXR_PreviewRgba>(),
+        1usize,
+        concat!("Alignment of ", stringify!(CEXR_PreviewRgba))
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<CEXR_PreviewRgba>())).r as *const _ as usize },
+        0usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_PreviewRgba),
+            "::",
+            stringify!(r)
+        )
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<CEXR_PreviewRgba>())).g as *const _ as usize },
+        1usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_PreviewRgba),
+            "::",
+            stringify!(g)
+        )
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<CEXR_PreviewRgba>())).b as *const _ as usize },
+        2usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_PreviewRgba),
+            "::",
+            stringify!(b)
+        )
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<CEXR_PreviewRgba>())).a as *const _ as usize },
+        3usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_PreviewRgba),
+            "::",
+            stringify!(a)
+        )
+    );
+}
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
 pub struct CEXR_InputFile {
@@ -291,6 +441,36 @@ pub struct CEXR_OutputFile {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct CEXR_TiledInputFile {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct CEXR_TiledOutputFile {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct CEXR_MultiPartInputFile {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct CEXR_MultiPartOutputFile {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct CEXR_DeepScanLineInputFile {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct CEXR_DeepScanLineOutputFile {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct CEXR_Header {
     _unused: [u8; 0],
 }
@@ -301,6 +481,11 @@ pub struct CEXR_FrameBuffer {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct CEXR_DeepFrameBuffer {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct CEXR_IStream {
     _unused: [u8; 0],
 }
@@ -316,6 +501,11 @@ pub struct CEXR_ChannelListIter {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct CEXR_Task {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct CEXR_Slice {
     pub ptr: *mut ::std::os::raw::c_void,
     pub len: usize,
@@ -353,6 +543,67 @@ fn bindgen_test_layout_CEXR_Slice() {
         )
     );
 }
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct CEXR_IoStats {
+    pub bytes: u64,
+    pub calls: u64,
+    pub seeks: u64,
+    pub nanos: u64,
+}
+#[test]
+fn bindgen_test_layout_CEXR_IoStats() {
+    assert_eq!(
+        ::std::mem::size_of::<CEXR_IoStats>(),
+        32usize,
+        concat!("Size of: ", stringify!(CEXR_IoStats))
+    );
+    assert_eq!(
+        ::std::mem::align_of::<CEXR_IoStats>(),
+        8usize,
+        concat!("Alignment of ", stringify!(CEXR_IoStats))
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<CEXR_IoStats>())).bytes as *const _ as usize },
+        0usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_IoStats),
+            "::",
+            stringify!(bytes)
+        )
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<CEXR_IoStats>())).calls as *const _ as usize },
+        8usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_IoStats),
+            "::",
+            stringify!(calls)
+        )
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<CEXR_IoStats>())).seeks as *const _ as usize },
+        16usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_IoStats),
+            "::",
+            stringify!(seeks)
+        )
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<CEXR_IoStats>())).nanos as *const _ as usize },
+        24usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(CEXR_IoStats),
+            "::",
+            stringify!(nanos)
+        )
+    );
+}
 extern "C" {
     pub fn CEXR_IStream_from_reader(
         reader: *mut ::std::os::raw::c_void,
@@ -361,6 +612,7 @@ extern "C" {
                 arg1: *mut ::std::os::raw::c_void,
                 arg2: *mut ::std::os::raw::c_char,
                 arg3: ::std::os::raw::c_int,
+                read_out: *mut ::std::os::raw::c_int,
                 err_out: *mut ::std::os::raw::c_int,
             ) -> ::std::os::raw::c_int,
         >,
@@ -371,6 +623,7 @@ extern "C" {
                 err_out: *mut ::std::os::raw::c_int,
             ) -> ::std::os::raw::c_int,
         >,
+        buffer_size: usize,
         out: *mut *mut CEXR_IStream,
         err_out: *mut *const ::std::os::raw::c_char,
     ) -> ::std::os::raw::c_int;
@@ -382,9 +635,52 @@ extern "C" {
         size: usize,
     ) -> *mut CEXR_IStream;
 }
+extern "C" {
+    pub fn CEXR_IStream_reset_memory(
+        stream: *mut CEXR_IStream,
+        data: *mut ::std::os::raw::c_char,
+        size: usize,
+    );
+}
+extern "C" {
+    pub fn CEXR_IStream_from_file_mmap(
+        path: *const ::std::os::raw::c_char,
+        out: *mut *mut CEXR_IStream,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_IStream_with_prefix(
+        stream: *mut CEXR_IStream,
+        prefix: *const ::std::os::raw::c_char,
+        size: usize,
+    ) -> *mut CEXR_IStream;
+}
+extern "C" {
+    pub fn CEXR_IStream_read_at(
+        stream: *mut CEXR_IStream,
+        position: u64,
+        out: *mut ::std::os::raw::c_char,
+        size: usize,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_IStream_read_chunk_table(
+        stream: *mut CEXR_IStream,
+        offsets: *mut u64,
+        sizes: *mut u64,
+        count: usize,
+        table_end_out: *mut u64,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
 extern "C" {
     pub fn CEXR_IStream_delete(stream: *mut CEXR_IStream);
 }
+extern "C" {
+    pub fn CEXR_IStream_stats(stream: *const CEXR_IStream, out: *mut CEXR_IoStats);
+}
 extern "C" {
     pub fn CEXR_OStream_from_writer(
         writer: *mut ::std::os::raw::c_void,
@@ -403,6 +699,23 @@ extern "C" {
                 err_out: *mut ::std::os::raw::c_int,
             ) -> ::std::os::raw::c_int,
         >,
+        buffer_size: usize,
+        out: *mut *mut CEXR_OStream,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_OStream_from_memory(
+        vec: *mut ::std::os::raw::c_void,
+        sync_ptr: ::std::option::Option<
+            unsafe extern "C" fn(
+                arg1: *mut ::std::os::raw::c_void,
+                len: usize,
+                min_capacity: usize,
+                data_out: *mut *mut ::std::os::raw::c_char,
+                capacity_out: *mut usize,
+            ) -> ::std::os::raw::c_int,
+        >,
         out: *mut *mut CEXR_OStream,
         err_out: *mut *const ::std::os::raw::c_char,
     ) -> ::std::os::raw::c_int;
@@ -410,6 +723,9 @@ extern "C" {
 extern "C" {
     pub fn CEXR_OStream_delete(stream: *mut CEXR_OStream);
 }
+extern "C" {
+    pub fn CEXR_OStream_stats(stream: *const CEXR_OStream, out: *mut CEXR_IoStats);
+}
 extern "C" {
     pub fn CEXR_ChannelListIter_next(
         iter: *mut CEXR_ChannelListIter,
@@ -431,9 +747,19 @@ extern "C" {
         compression: CEXR_Compression,
     ) -> *mut CEXR_Header;
 }
+extern "C" {
+    pub fn CEXR_Header_copy(header: *const CEXR_Header) -> *mut CEXR_Header;
+}
 extern "C" {
     pub fn CEXR_Header_delete(header: *mut CEXR_Header);
 }
+extern "C" {
+    pub fn CEXR_Header_read_from_stream(
+        stream: *mut CEXR_IStream,
+        out: *mut *mut CEXR_Header,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
 extern "C" {
     pub fn CEXR_Header_insert_channel(
         header: *mut CEXR_Header,
@@ -471,12 +797,33 @@ extern "C" {
 extern "C" {
     pub fn CEXR_Header_set_screen_window_width(header: *mut CEXR_Header, width: f32);
 }
+extern "C" {
+    pub fn CEXR_Header_line_order(header: *const CEXR_Header) -> CEXR_LineOrder;
+}
 extern "C" {
     pub fn CEXR_Header_set_line_order(header: *mut CEXR_Header, line_order: CEXR_LineOrder);
 }
+extern "C" {
+    pub fn CEXR_Header_compression(header: *const CEXR_Header) -> CEXR_Compression;
+}
 extern "C" {
     pub fn CEXR_Header_set_compression(header: *mut CEXR_Header, compression: CEXR_Compression);
 }
+extern "C" {
+    pub fn CEXR_Header_scanlines_per_chunk(header: *const CEXR_Header) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_Header_has_dwa_compression_level(header: *const CEXR_Header) -> bool;
+}
+extern "C" {
+    pub fn CEXR_Header_dwa_compression_level(header: *const CEXR_Header) -> f32;
+}
+extern "C" {
+    pub fn CEXR_Header_set_dwa_compression_level(header: *mut CEXR_Header, level: f32);
+}
+extern "C" {
+    pub fn CEXR_Header_erase_dwa_compression_level(header: *mut CEXR_Header);
+}
 extern "C" {
     pub fn CEXR_Header_has_envmap(header: *const CEXR_Header) -> bool;
 }
@@ -499,12 +846,60 @@ extern "C" {
         view_count: usize,
     );
 }
+extern "C" {
+    pub fn CEXR_Header_has_name(header: *const CEXR_Header) -> bool;
+}
+extern "C" {
+    pub fn CEXR_Header_name(header: *const CEXR_Header) -> CEXR_Slice;
+}
+extern "C" {
+    pub fn CEXR_Header_set_name(header: *mut CEXR_Header, name: *const ::std::os::raw::c_char);
+}
+extern "C" {
+    pub fn CEXR_Header_has_view(header: *const CEXR_Header) -> bool;
+}
+extern "C" {
+    pub fn CEXR_Header_view(header: *const CEXR_Header) -> CEXR_Slice;
+}
+extern "C" {
+    pub fn CEXR_Header_set_view(header: *mut CEXR_Header, view: *const ::std::os::raw::c_char);
+}
 extern "C" {
     pub fn CEXR_Header_erase_attribute(
         header: *mut CEXR_Header,
         attribute: *const ::std::os::raw::c_char,
     );
 }
+extern "C" {
+    pub fn CEXR_Header_has_tile_description(header: *const CEXR_Header) -> bool;
+}
+extern "C" {
+    pub fn CEXR_Header_tile_description(header: *const CEXR_Header) -> CEXR_TileDescription;
+}
+extern "C" {
+    pub fn CEXR_Header_set_tile_description(
+        header: *mut CEXR_Header,
+        tile_description: CEXR_TileDescription,
+    );
+}
+extern "C" {
+    pub fn CEXR_Header_has_preview_image(header: *const CEXR_Header) -> bool;
+}
+extern "C" {
+    pub fn CEXR_Header_preview_image(
+        header: *const CEXR_Header,
+        width_out: *mut ::std::os::raw::c_uint,
+        height_out: *mut ::std::os::raw::c_uint,
+    ) -> *const CEXR_PreviewRgba;
+}
+extern "C" {
+    pub fn CEXR_Header_set_preview_image(
+        header: *mut CEXR_Header,
+        width: ::std::os::raw::c_uint,
+        height: ::std::os::raw::c_uint,
+        pixels: *const CEXR_PreviewRgba,
+    );
+}
 extern "C" {
     pub fn CEXR_FrameBuffer_new() -> *mut CEXR_FrameBuffer;
 }
@@ -539,6 +934,50 @@ extern "C" {
         offset: ::std::os::raw::c_uint,
     ) -> *mut CEXR_FrameBuffer;
 }
+extern "C" {
+    pub fn CEXR_FrameBuffer_rebase_scanlines(
+        dst: *mut CEXR_FrameBuffer,
+        src: *const CEXR_FrameBuffer,
+        offset: ::std::os::raw::c_uint,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_FrameBuffer_sample_preview(
+        frame_buffer: *const CEXR_FrameBuffer,
+        data_window: CEXR_Box2i,
+        scanline_1: ::std::os::raw::c_int,
+        scanline_2: ::std::os::raw::c_int,
+        width: ::std::os::raw::c_uint,
+        height: ::std::os::raw::c_uint,
+        pixels: *mut CEXR_PreviewRgba,
+    );
+}
+extern "C" {
+    pub fn CEXR_DeepFrameBuffer_new() -> *mut CEXR_DeepFrameBuffer;
+}
+extern "C" {
+    pub fn CEXR_DeepFrameBuffer_delete(framebuffer: *mut CEXR_DeepFrameBuffer);
+}
+extern "C" {
+    pub fn CEXR_DeepFrameBuffer_insert(
+        framebuffer: *mut CEXR_DeepFrameBuffer,
+        name: *const ::std::os::raw::c_char,
+        type_: CEXR_PixelType,
+        base: *mut ::std::os::raw::c_char,
+        xStride: usize,
+        yStride: usize,
+        sampleStride: usize,
+        fillValue: f64,
+    );
+}
+extern "C" {
+    pub fn CEXR_DeepFrameBuffer_insert_sample_count_slice(
+        framebuffer: *mut CEXR_DeepFrameBuffer,
+        base: *mut ::std::os::raw::c_char,
+        xStride: usize,
+        yStride: usize,
+    );
+}
 extern "C" {
     pub fn CEXR_InputFile_from_file_path(
         path: *const ::std::os::raw::c_char,
@@ -576,6 +1015,36 @@ extern "C" {
         err_out: *mut *const ::std::os::raw::c_char,
     ) -> ::std::os::raw::c_int;
 }
+extern "C" {
+    pub fn CEXR_InputFile_read_region(
+        file: *mut CEXR_InputFile,
+        framebuffer: *const CEXR_FrameBuffer,
+        region: CEXR_Box2i,
+        batch_rows: ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_InputFile_raw_pixel_data(
+        file: *mut CEXR_InputFile,
+        first_scanline: ::std::os::raw::c_int,
+        data_out: *mut *const ::std::os::raw::c_char,
+        size_out: *mut ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_InputFile_read_preview(
+        file: *mut CEXR_InputFile,
+        width: ::std::os::raw::c_uint,
+        height: ::std::os::raw::c_uint,
+        pixels: *mut CEXR_PreviewRgba,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_InputFile_is_complete(file: *const CEXR_InputFile) -> bool;
+}
 extern "C" {
     pub fn CEXR_OutputFile_from_stream(
         stream: *mut CEXR_OStream,
@@ -605,9 +1074,382 @@ extern "C" {
         err_out: *mut *const ::std::os::raw::c_char,
     ) -> ::std::os::raw::c_int;
 }
+extern "C" {
+    pub fn CEXR_OutputFile_copy_pixels(
+        file: *mut CEXR_OutputFile,
+        in_file: *mut CEXR_InputFile,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_OutputFile_update_preview_image(
+        file: *mut CEXR_OutputFile,
+        pixels: *const CEXR_PreviewRgba,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_from_stream(
+        stream: *mut CEXR_IStream,
+        threads: ::std::os::raw::c_int,
+        out: *mut *mut CEXR_TiledInputFile,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_delete(file: *mut CEXR_TiledInputFile);
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_header(file: *mut CEXR_TiledInputFile) -> *const CEXR_Header;
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_set_framebuffer(
+        file: *mut CEXR_TiledInputFile,
+        framebuffer: *mut CEXR_FrameBuffer,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_num_x_levels(
+        file: *mut CEXR_TiledInputFile,
+        out: *mut ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_num_y_levels(
+        file: *mut CEXR_TiledInputFile,
+        out: *mut ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_data_window_for_level(
+        file: *mut CEXR_TiledInputFile,
+        lx: ::std::os::raw::c_int,
+        ly: ::std::os::raw::c_int,
+        out: *mut CEXR_Box2i,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_num_x_tiles(
+        file: *mut CEXR_TiledInputFile,
+        lx: ::std::os::raw::c_int,
+        out: *mut ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_num_y_tiles(
+        file: *mut CEXR_TiledInputFile,
+        ly: ::std::os::raw::c_int,
+        out: *mut ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_data_window_for_tile(
+        file: *mut CEXR_TiledInputFile,
+        dx: ::std::os::raw::c_int,
+        dy: ::std::os::raw::c_int,
+        lx: ::std::os::raw::c_int,
+        ly: ::std::os::raw::c_int,
+        out: *mut CEXR_Box2i,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_read_tile(
+        file: *mut CEXR_TiledInputFile,
+        dx: ::std::os::raw::c_int,
+        dy: ::std::os::raw::c_int,
+        lx: ::std::os::raw::c_int,
+        ly: ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledInputFile_read_tiles(
+        file: *mut CEXR_TiledInputFile,
+        dx1: ::std::os::raw::c_int,
+        dx2: ::std::os::raw::c_int,
+        dy1: ::std::os::raw::c_int,
+        dy2: ::std::os::raw::c_int,
+        lx: ::std::os::raw::c_int,
+        ly: ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_from_stream(
+        stream: *mut CEXR_OStream,
+        header: *const CEXR_Header,
+        threads: ::std::os::raw::c_int,
+        out: *mut *mut CEXR_TiledOutputFile,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_delete(file: *mut CEXR_TiledOutputFile);
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_header(file: *mut CEXR_TiledOutputFile) -> *const CEXR_Header;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_set_framebuffer(
+        file: *mut CEXR_TiledOutputFile,
+        framebuffer: *const CEXR_FrameBuffer,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_num_x_levels(
+        file: *mut CEXR_TiledOutputFile,
+        out: *mut ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_num_y_levels(
+        file: *mut CEXR_TiledOutputFile,
+        out: *mut ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_data_window_for_level(
+        file: *mut CEXR_TiledOutputFile,
+        lx: ::std::os::raw::c_int,
+        ly: ::std::os::raw::c_int,
+        out: *mut CEXR_Box2i,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_num_x_tiles(
+        file: *mut CEXR_TiledOutputFile,
+        lx: ::std::os::raw::c_int,
+        out: *mut ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_num_y_tiles(
+        file: *mut CEXR_TiledOutputFile,
+        ly: ::std::os::raw::c_int,
+        out: *mut ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_data_window_for_tile(
+        file: *mut CEXR_TiledOutputFile,
+        dx: ::std::os::raw::c_int,
+        dy: ::std::os::raw::c_int,
+        lx: ::std::os::raw::c_int,
+        ly: ::std::os::raw::c_int,
+        out: *mut CEXR_Box2i,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_write_tile(
+        file: *mut CEXR_TiledOutputFile,
+        dx: ::std::os::raw::c_int,
+        dy: ::std::os::raw::c_int,
+        lx: ::std::os::raw::c_int,
+        ly: ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_write_tiles(
+        file: *mut CEXR_TiledOutputFile,
+        dx1: ::std::os::raw::c_int,
+        dx2: ::std::os::raw::c_int,
+        dy1: ::std::os::raw::c_int,
+        dy2: ::std::os::raw::c_int,
+        lx: ::std::os::raw::c_int,
+        ly: ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_TiledOutputFile_copy_pixels(
+        file: *mut CEXR_TiledOutputFile,
+        in_file: *mut CEXR_TiledInputFile,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_MultiPartInputFile_from_stream(
+        stream: *mut CEXR_IStream,
+        threads: ::std::os::raw::c_int,
+        out: *mut *mut CEXR_MultiPartInputFile,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_MultiPartInputFile_delete(file: *mut CEXR_MultiPartInputFile);
+}
+extern "C" {
+    pub fn CEXR_MultiPartInputFile_parts(
+        file: *mut CEXR_MultiPartInputFile,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_MultiPartInputFile_header(
+        file: *mut CEXR_MultiPartInputFile,
+        part: ::std::os::raw::c_int,
+    ) -> *const CEXR_Header;
+}
+extern "C" {
+    pub fn CEXR_MultiPartInputFile_set_framebuffer(
+        file: *mut CEXR_MultiPartInputFile,
+        part: ::std::os::raw::c_int,
+        framebuffer: *mut CEXR_FrameBuffer,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_MultiPartInputFile_read_pixels(
+        file: *mut CEXR_MultiPartInputFile,
+        part: ::std::os::raw::c_int,
+        scanline_1: ::std::os::raw::c_int,
+        scanline_2: ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_MultiPartOutputFile_from_stream(
+        stream: *mut CEXR_OStream,
+        headers: *const *const CEXR_Header,
+        parts: ::std::os::raw::c_int,
+        threads: ::std::os::raw::c_int,
+        out: *mut *mut CEXR_MultiPartOutputFile,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_MultiPartOutputFile_delete(file: *mut CEXR_MultiPartOutputFile);
+}
+extern "C" {
+    pub fn CEXR_MultiPartOutputFile_parts(
+        file: *mut CEXR_MultiPartOutputFile,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_MultiPartOutputFile_header(
+        file: *mut CEXR_MultiPartOutputFile,
+        part: ::std::os::raw::c_int,
+    ) -> *const CEXR_Header;
+}
+extern "C" {
+    pub fn CEXR_MultiPartOutputFile_set_framebuffer(
+        file: *mut CEXR_MultiPartOutputFile,
+        part: ::std::os::raw::c_int,
+        framebuffer: *const CEXR_FrameBuffer,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_MultiPartOutputFile_write_pixels(
+        file: *mut CEXR_MultiPartOutputFile,
+        part: ::std::os::raw::c_int,
+        num_scanlines: ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_DeepScanLineInputFile_from_stream(
+        stream: *mut CEXR_IStream,
+        threads: ::std::os::raw::c_int,
+        out: *mut *mut CEXR_DeepScanLineInputFile,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_DeepScanLineInputFile_delete(file: *mut CEXR_DeepScanLineInputFile);
+}
+extern "C" {
+    pub fn CEXR_DeepScanLineInputFile_header(
+        file: *mut CEXR_DeepScanLineInputFile,
+    ) -> *const CEXR_Header;
+}
+extern "C" {
+    pub fn CEXR_DeepScanLineInputFile_set_framebuffer(
+        file: *mut CEXR_DeepScanLineInputFile,
+        framebuffer: *const CEXR_DeepFrameBuffer,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_DeepScanLineInputFile_read_pixel_sample_counts(
+        file: *mut CEXR_DeepScanLineInputFile,
+        scanline_1: ::std::os::raw::c_int,
+        scanline_2: ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_DeepScanLineInputFile_read_pixels(
+        file: *mut CEXR_DeepScanLineInputFile,
+        scanline_1: ::std::os::raw::c_int,
+        scanline_2: ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_DeepScanLineOutputFile_from_stream(
+        stream: *mut CEXR_OStream,
+        header: *const CEXR_Header,
+        threads: ::std::os::raw::c_int,
+        out: *mut *mut CEXR_DeepScanLineOutputFile,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_DeepScanLineOutputFile_delete(file: *mut CEXR_DeepScanLineOutputFile);
+}
+extern "C" {
+    pub fn CEXR_DeepScanLineOutputFile_header(
+        file: *mut CEXR_DeepScanLineOutputFile,
+    ) -> *const CEXR_Header;
+}
+extern "C" {
+    pub fn CEXR_DeepScanLineOutputFile_set_framebuffer(
+        file: *mut CEXR_DeepScanLineOutputFile,
+        framebuffer: *const CEXR_DeepFrameBuffer,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_DeepScanLineOutputFile_write_pixels(
+        file: *mut CEXR_DeepScanLineOutputFile,
+        num_scanlines: ::std::os::raw::c_int,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
 extern "C" {
     pub fn CEXR_set_global_thread_count(
         thread_count: ::std::os::raw::c_int,
         err_out: *mut *const ::std::os::raw::c_char,
     ) -> ::std::os::raw::c_int;
 }
+extern "C" {
+    pub fn CEXR_set_global_thread_provider(
+        thread_count: ::std::os::raw::c_int,
+        executor: *mut ::std::os::raw::c_void,
+        add_task_ptr: ::std::option::Option<
+            unsafe extern "C" fn(arg1: *mut ::std::os::raw::c_void, arg2: *mut CEXR_Task),
+        >,
+        delete_executor_ptr: ::std::option::Option<
+            unsafe extern "C" fn(arg1: *mut ::std::os::raw::c_void),
+        >,
+        err_out: *mut *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn CEXR_Task_run(task: *mut CEXR_Task);
+}
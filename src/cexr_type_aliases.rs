@@ -1,5 +1,8 @@
 pub use openexr_sys::CEXR_Box2i as Box2i;
 pub use openexr_sys::CEXR_Channel as Channel;
 pub use openexr_sys::CEXR_Compression as Compression;
+pub use openexr_sys::CEXR_LevelMode as LevelMode;
+pub use openexr_sys::CEXR_LevelRoundingMode as LevelRoundingMode;
 pub use openexr_sys::CEXR_LineOrder as LineOrder;
 pub use openexr_sys::CEXR_PixelType as PixelType;
+pub use openexr_sys::CEXR_TileDescription as TileDescription;
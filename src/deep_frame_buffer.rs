@@ -0,0 +1,379 @@
+//! A `DeepFrameBuffer` points to and describes deep image data in memory to
+//! be used for input and output.
+//!
+//! Deep images store a varying number of samples per pixel, given by a table
+//! of sample counts with one entry per pixel.  A deep frame buffer is built
+//! from such a table, and each channel inserted into it is backed by a
+//! single contiguous slice of samples (an "arena") holding the samples of
+//! every pixel one after the other, in scanline order.  This avoids an
+//! allocation per pixel: the usual workflow for reading is to read the
+//! sample counts first, allocate one buffer per channel (or one buffer of
+//! structs for several channels) with room for `total_samples()` samples,
+//! and then read the samples into it.
+//!
+//! `DeepFrameBuffer` is used for read-only sample data, and
+//! `DeepFrameBufferMut` is used for read/write sample data.
+//! `DeepFrameBufferMut` dereferences to `&DeepFrameBuffer` so it can be
+//! passed anywhere a `&DeepFrameBuffer` can.
+//!
+//! ## Examples
+//!
+//! Building a deep frame buffer for a 2x2 image whose pixels have 0, 1, 2
+//! and 3 depth samples:
+//!
+//! ```
+//! # use openexr::DeepFrameBuffer;
+//! let sample_counts = [0, 1, 2, 3];
+//! let depths = [1.0f32, 2.0, 2.5, 3.0, 3.5, 4.0];
+//!
+//! let mut fb = DeepFrameBuffer::new(2, 2, &sample_counts);
+//! assert_eq!(fb.total_samples(), 6);
+//! fb.insert_channel("Z", &depths);
+//! ```
+
+use std::ffi::CString;
+use std::marker::PhantomData;
+use std::mem;
+use std::ops::Deref;
+
+use libc::c_char;
+
+use openexr_sys::*;
+
+use cexr_type_aliases::*;
+use frame_buffer::{PixelData, PixelStruct};
+
+/// Points to and describes in-memory deep image data for reading.
+pub struct DeepFrameBuffer<'a> {
+    dimensions: (u32, u32),
+    sample_counts: *const u32,
+    total_samples: usize,
+    // Index of the first sample of each pixel within the sample arenas.
+    sample_offsets: Vec<usize>,
+    slices: Vec<DeepSlice>,
+    _phantom: PhantomData<&'a mut [u8]>,
+}
+
+// A channel of a `DeepFrameBuffer`.
+struct DeepSlice {
+    name: String,
+    pixel_type: PixelType,
+    fill_value: f64,
+    sample_stride: usize,
+    // Pointer to the first sample of each pixel, which is what OpenEXR
+    // expects a deep slice's base to point at.
+    pointers: Vec<*mut c_char>,
+}
+
+impl<'a> DeepFrameBuffer<'a> {
+    /// Creates a deep frame buffer with the given dimensions in pixels, and
+    /// `sample_counts` as the number of samples of each pixel.
+    ///
+    /// # Panics
+    ///
+    /// Panics if either dimension is zero, or if `sample_counts` doesn't
+    /// contain precisely width * height elements.
+    pub fn new(width: u32, height: u32, sample_counts: &'a [u32]) -> Self {
+        assert!(
+            width > 0 && height > 0,
+            "DeepFrameBuffers must be non-zero size in \
+             both dimensions."
+        );
+        if sample_counts.len() != width as usize * height as usize {
+            panic!(
+                "{} sample counts cannot describe a {}x{} deep framebuffer",
+                sample_counts.len(),
+                width,
+                height
+            );
+        }
+
+        let mut sample_offsets = Vec::with_capacity(sample_counts.len());
+        let mut total_samples = 0;
+        for &count in sample_counts {
+            sample_offsets.push(total_samples);
+            total_samples += count as usize;
+        }
+
+        DeepFrameBuffer {
+            dimensions: (width, height),
+            sample_counts: sample_counts.as_ptr(),
+            total_samples: total_samples,
+            sample_offsets: sample_offsets,
+            slices: Vec::new(),
+            _phantom: PhantomData,
+        }
+    }
+
+    /// Return the dimensions of the frame buffer.
+    pub fn dimensions(&self) -> (u32, u32) {
+        self.dimensions
+    }
+
+    /// Return the total number of samples of all pixels, which is the number
+    /// of elements each inserted channel's data must have.
+    pub fn total_samples(&self) -> usize {
+        self.total_samples
+    }
+
+    /// Returns the index of the first sample of the pixel at `(x, y)`
+    /// (relative to the frame buffer) within the channel data.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `(x, y)` is outside of the frame buffer.
+    pub fn sample_offset(&self, x: u32, y: u32) -> usize {
+        assert!(x < self.dimensions.0 && y < self.dimensions.1);
+        self.sample_offsets[y as usize * self.dimensions.0 as usize + x as usize]
+    }
+
+    /// Insert a single channel into the DeepFrameBuffer.
+    ///
+    /// The channel will be given the name `name`.
+    ///
+    /// `samples` is the memory for the channel and should contain precisely
+    /// `total_samples()` elements: the samples of each pixel, one pixel
+    /// after another.
+    pub fn insert_channel<T: PixelData>(&mut self, name: &str, samples: &'a [T]) -> &mut Self {
+        self.check_samples_len(samples.len());
+        self.insert_slice(
+            name,
+            T::pixel_type(),
+            0.0,
+            samples.as_ptr() as *mut c_char,
+            mem::size_of::<T>(),
+        );
+        self
+    }
+
+    /// Insert multiple channels from a slice of structs or tuples.
+    ///
+    /// The number of channels to be inserted is determined by the
+    /// implementation of the `PixelStruct` trait on `T`.  `names` should
+    /// contain the names of each of those channels.
+    ///
+    /// `samples` is the memory for the channels and should contain precisely
+    /// `total_samples()` elements.
+    pub fn insert_channels<T: PixelStruct>(
+        &mut self,
+        names: &[&str],
+        samples: &'a [T],
+    ) -> &mut Self {
+        self.check_samples_len(samples.len());
+        for (name, (ty, offset)) in names.iter().zip(T::channels()) {
+            let base = unsafe { (samples.as_ptr() as *mut c_char).add(offset) };
+            self.insert_slice(name, ty, 0.0, base, mem::size_of::<T>());
+        }
+        self
+    }
+
+    fn check_samples_len(&self, len: usize) {
+        if len != self.total_samples {
+            panic!(
+                "data size of {} samples cannot back deep framebuffer \
+                 with {} samples",
+                len, self.total_samples
+            );
+        }
+    }
+
+    // Adds a channel whose samples start at `base`, `sample_stride` bytes
+    // apart.
+    fn insert_slice(
+        &mut self,
+        name: &str,
+        pixel_type: PixelType,
+        fill_value: f64,
+        base: *mut c_char,
+        sample_stride: usize,
+    ) {
+        let pointers = self
+            .sample_offsets
+            .iter()
+            .map(|&offset| base.wrapping_add(offset * sample_stride))
+            .collect();
+        self.slices.retain(|slice| slice.name != name);
+        self.slices.push(DeepSlice {
+            name: name.to_string(),
+            pixel_type: pixel_type,
+            fill_value: fill_value,
+            sample_stride: sample_stride,
+            pointers: pointers,
+        });
+    }
+
+    // This function abuses the Channel type to return information
+    // about a DeepFrameBuffer slice.  For internal use only.
+    pub(crate) fn _get_channel(&self, name: &str) -> Option<Channel> {
+        self.slices
+            .iter()
+            .find(|slice| slice.name == name)
+            .map(|slice| Channel {
+                pixel_type: slice.pixel_type,
+                x_sampling: 1,
+                y_sampling: 1,
+                p_linear: false,
+            })
+    }
+
+    // Builds the C++ deep framebuffer for this, placing its first pixel at
+    // `first_pixel` in the coordinates of the file's data window.
+    pub(crate) fn build(&self, first_pixel: (i32, i32)) -> DeepFrameBufferHandle {
+        let handle = DeepFrameBufferHandle::with_sample_counts(
+            self.sample_counts as *mut u32,
+            self.dimensions.0,
+            first_pixel,
+        );
+
+        let width = self.dimensions.0 as isize;
+        let origin_offset = -(first_pixel.0 as isize + first_pixel.1 as isize * width);
+        let pointer_size = mem::size_of::<*mut c_char>();
+        for slice in &self.slices {
+            let c_name = CString::new(slice.name.as_bytes()).unwrap();
+            unsafe {
+                CEXR_DeepFrameBuffer_insert(
+                    handle.handle,
+                    c_name.as_ptr(),
+                    slice.pixel_type,
+                    (slice.pointers.as_ptr() as *mut c_char)
+                        .wrapping_offset(origin_offset * pointer_size as isize),
+                    pointer_size,
+                    width as usize * pointer_size,
+                    slice.sample_stride,
+                    slice.fill_value,
+                )
+            };
+        }
+
+        handle
+    }
+}
+
+// ----------------------------------------------------------------
+
+/// Points to and describes in-memory deep image data for both reading and
+/// writing.
+pub struct DeepFrameBufferMut<'a> {
+    frame_buffer: DeepFrameBuffer<'a>,
+}
+
+impl<'a> DeepFrameBufferMut<'a> {
+    /// Creates a deep frame buffer with the given dimensions in pixels, and
+    /// `sample_counts` as the number of samples of each pixel.
+    ///
+    /// When reading, `sample_counts` must be the sample counts of the
+    /// scanlines being read, as returned by e.g.
+    /// `DeepScanlineInputFile::read_sample_counts()`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if either dimension is zero, or if `sample_counts` doesn't
+    /// contain precisely width * height elements.
+    pub fn new(width: u32, height: u32, sample_counts: &'a [u32]) -> Self {
+        DeepFrameBufferMut {
+            frame_buffer: DeepFrameBuffer::new(width, height, sample_counts),
+        }
+    }
+
+    /// Insert a single channel.
+    ///
+    /// The channel will be given the name `name`, and will use the value
+    /// `fill` for all samples if a file is read that doesn't have a channel
+    /// with that name.
+    ///
+    /// `samples` is the memory for the channel and should contain precisely
+    /// `total_samples()` elements.
+    pub fn insert_channel<T: PixelData>(
+        &mut self,
+        name: &str,
+        fill: f64,
+        samples: &'a mut [T],
+    ) -> &mut Self {
+        self.frame_buffer.check_samples_len(samples.len());
+        self.frame_buffer.insert_slice(
+            name,
+            T::pixel_type(),
+            fill,
+            samples.as_mut_ptr() as *mut c_char,
+            mem::size_of::<T>(),
+        );
+        self
+    }
+
+    /// Insert multiple channels from a slice of structs or tuples.
+    ///
+    /// The number of channels to be inserted is determined by the
+    /// implementation of the `PixelStruct` trait on `T`.  `names_and_fills`
+    /// should contain the names and default fill values of each of those
+    /// channels.
+    ///
+    /// `samples` is the memory for the channels and should contain precisely
+    /// `total_samples()` elements.
+    pub fn insert_channels<T: PixelStruct>(
+        &mut self,
+        names_and_fills: &[(&str, f64)],
+        samples: &'a mut [T],
+    ) -> &mut Self {
+        self.frame_buffer.check_samples_len(samples.len());
+        for (&(name, fill), (ty, offset)) in names_and_fills.iter().zip(T::channels()) {
+            let base = unsafe { (samples.as_mut_ptr() as *mut c_char).add(offset) };
+            self.frame_buffer
+                .insert_slice(name, ty, fill, base, mem::size_of::<T>());
+        }
+        self
+    }
+}
+
+impl<'a> Deref for DeepFrameBufferMut<'a> {
+    type Target = DeepFrameBuffer<'a>;
+    fn deref(&self) -> &Self::Target {
+        &self.frame_buffer
+    }
+}
+
+// ----------------------------------------------------------------
+
+/// An owned C++ deep framebuffer, built by `DeepFrameBuffer::build()`.
+///
+/// It points into the `DeepFrameBuffer` it was built from, so it must not
+/// outlive it.
+pub(crate) struct DeepFrameBufferHandle {
+    handle: *mut CEXR_DeepFrameBuffer,
+}
+
+impl DeepFrameBufferHandle {
+    // Creates a deep framebuffer with only a sample count slice, backed by
+    // `sample_counts` for `width`-pixel-wide scanlines starting at
+    // `first_pixel` in the coordinates of the file's data window.
+    //
+    // This is all that's needed for reading sample counts, which OpenEXR
+    // writes through `sample_counts`.
+    pub(crate) fn with_sample_counts(
+        sample_counts: *mut u32,
+        width: u32,
+        first_pixel: (i32, i32),
+    ) -> DeepFrameBufferHandle {
+        let origin_offset = -(first_pixel.0 as isize + first_pixel.1 as isize * width as isize);
+        let count_size = mem::size_of::<u32>();
+        let handle = unsafe { CEXR_DeepFrameBuffer_new() };
+        unsafe {
+            CEXR_DeepFrameBuffer_insert_sample_count_slice(
+                handle,
+                (sample_counts as *mut c_char).wrapping_offset(origin_offset * count_size as isize),
+                count_size,
+                width as usize * count_size,
+            )
+        };
+        DeepFrameBufferHandle { handle: handle }
+    }
+
+    pub(crate) fn handle(&self) -> *const CEXR_DeepFrameBuffer {
+        self.handle
+    }
+}
+
+impl Drop for DeepFrameBufferHandle {
+    fn drop(&mut self) {
+        unsafe { CEXR_DeepFrameBuffer_delete(self.handle) };
+    }
+}
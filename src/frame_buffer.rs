@@ -37,12 +37,17 @@ use libc::{c_char, c_int};
 use openexr_sys::*;
 
 use cexr_type_aliases::*;
+use error::{Error, Result};
+use header::View;
 
 /// Points to and describes in-memory image data for reading.
 pub struct FrameBuffer<'a> {
     handle: *mut CEXR_FrameBuffer,
     origin: (i32, i32),
     dimensions: (u32, u32),
+    // The slices whose types allow converting from other file types, with
+    // their `PixelStruct::channel_converts_from()` and channel index.
+    conversions: Vec<(String, fn(usize, PixelType) -> bool, usize)>,
     _phantom_1: PhantomData<CEXR_FrameBuffer>,
     _phantom_2: PhantomData<&'a mut [u8]>,
 }
@@ -71,6 +76,7 @@ impl<'a> FrameBuffer<'a> {
             handle: unsafe { CEXR_FrameBuffer_new() },
             origin: (origin_x, origin_y),
             dimensions: (width, height),
+            conversions: Vec::new(),
             _phantom_1: PhantomData,
             _phantom_2: PhantomData,
         }
@@ -154,6 +160,22 @@ impl<'a> FrameBuffer<'a> {
         self
     }
 
+    /// Insert multiple channels of one view of a multi-view image from a
+    /// slice of structs or tuples.
+    ///
+    /// This is the same as `insert_channels()`, except that `names` are the
+    /// channel names without the view, which `view` adds (see `View`).
+    pub fn insert_view_channels<T: PixelStruct>(
+        &mut self,
+        view: &View,
+        names: &[&str],
+        data: &'a [T],
+    ) -> &mut Self {
+        let view_names: Vec<String> = names.iter().map(|name| view.channel_name(name)).collect();
+        let view_names: Vec<&str> = view_names.iter().map(|name| &name[..]).collect();
+        self.insert_channels(&view_names, data)
+    }
+
     /// The raw method for inserting a new channel.
     ///
     /// This is very unsafe: the other methods should be preferred unless you
@@ -173,6 +195,7 @@ impl<'a> FrameBuffer<'a> {
         tile_coords: (bool, bool),
     ) -> &mut Self {
         let c_name = CString::new(name).unwrap();
+        self.record_conversion(name, None);
         CEXR_FrameBuffer_insert(
             self.handle,
             c_name.as_ptr(),
@@ -203,6 +226,51 @@ impl<'a> FrameBuffer<'a> {
         self.origin_offset() * mem::size_of::<T>() as isize
     }
 
+    // Checks that the frame buffer covers all pixels in `window`, which is
+    // given in the same coordinate system as the data window.
+    pub(crate) fn validate_covers(&self, window: &Box2i) -> Result<()> {
+        let (x, y) = self.origin;
+        let (w, h) = (self.dimensions.0 as i64, self.dimensions.1 as i64);
+        if window.min.x < x
+            || window.min.y < y
+            || window.max.x as i64 >= x as i64 + w
+            || window.max.y as i64 >= y as i64 + h
+        {
+            return Err(Error::Generic(format!(
+                "framebuffer with origin {},{} and size {}x{} does not cover \
+                 the region {},{} to {},{}",
+                x, y, w, h, window.min.x, window.min.y, window.max.x, window.max.y
+            )));
+        }
+        Ok(())
+    }
+
+    // Records whether the slice named `name` may be converted from other
+    // file types, replacing any earlier record for a slice of that name.
+    fn record_conversion(
+        &mut self,
+        name: &str,
+        converts_from: Option<(fn(usize, PixelType) -> bool, usize)>,
+    ) {
+        self.conversions.retain(|conversion| conversion.0 != name);
+        if let Some((converts_from, index)) = converts_from {
+            self.conversions
+                .push((name.to_string(), converts_from, index));
+        }
+    }
+
+    // Whether the slice named `name` can be read from file channels of type
+    // `file_type` by converting them, as recorded when it was inserted.
+    // See `PixelData::converts_from()`.
+    pub(crate) fn channel_converts_from(&self, name: &str, file_type: PixelType) -> bool {
+        self.conversions
+            .iter()
+            .find(|conversion| conversion.0 == name)
+            .map_or(false, |&(_, converts_from, index)| {
+                converts_from(index, file_type)
+            })
+    }
+
     #[doc(hidden)]
     pub(crate) fn handle(&self) -> *const CEXR_FrameBuffer {
         self.handle
@@ -298,6 +366,8 @@ impl<'a> FrameBufferMut<'a> {
                 (false, false),
             )
         };
+        self.frame_buffer
+            .record_conversion(name, Some((<T as PixelStruct>::channel_converts_from, 0)));
         self
     }
 
@@ -327,7 +397,9 @@ impl<'a> FrameBufferMut<'a> {
         }
         let width = self.dimensions.0;
         let origin_offset = self.origin_offset_byte::<T>();
-        for (&(name, fill), (ty, offset)) in names_and_fills.iter().zip(T::channels()) {
+        for (i, (&(name, fill), (ty, offset))) in
+            names_and_fills.iter().zip(T::channels()).enumerate()
+        {
             unsafe {
                 self.insert_raw(
                     name,
@@ -339,10 +411,36 @@ impl<'a> FrameBufferMut<'a> {
                     (false, false),
                 )
             };
+            self.frame_buffer
+                .record_conversion(name, Some((T::channel_converts_from, i)));
         }
         self
     }
 
+    /// Insert multiple channels of one view of a multi-view image from a
+    /// slice of structs or tuples.
+    ///
+    /// This is the same as `insert_channels()`, except that the names in
+    /// `names_and_fills` are the channel names without the view, which `view`
+    /// adds (see `View`).
+    pub fn insert_view_channels<T: PixelStruct>(
+        &mut self,
+        view: &View,
+        names_and_fills: &[(&str, f64)],
+        data: &'a mut [T],
+    ) -> &mut Self {
+        let view_names: Vec<String> = names_and_fills
+            .iter()
+            .map(|&(name, _)| view.channel_name(name))
+            .collect();
+        let view_names_and_fills: Vec<(&str, f64)> = view_names
+            .iter()
+            .zip(names_and_fills)
+            .map(|(name, &(_, fill))| (&name[..], fill))
+            .collect();
+        self.insert_channels(&view_names_and_fills, data)
+    }
+
     /// The raw method for inserting a new channel.
     ///
     /// This is very unsafe: the other methods should be preferred unless you
@@ -362,6 +460,7 @@ impl<'a> FrameBufferMut<'a> {
         tile_coords: (bool, bool),
     ) -> &mut Self {
         let c_name = CString::new(name).unwrap();
+        self.frame_buffer.record_conversion(name, None);
         CEXR_FrameBuffer_insert(
             self.handle,
             c_name.as_ptr(),
@@ -392,6 +491,87 @@ impl<'a> Deref for FrameBufferMut<'a> {
 
 // ----------------------------------------------------------------
 
+/// How a `FrameBufferCache` changed in an update.
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub(crate) enum FrameBufferUpdate {
+    /// Nothing changed, so it doesn't need to be set on the file again.
+    Unchanged,
+    /// Only the locations of the slices changed, so it needs to be set on the
+    /// file again, but doesn't need to be validated again.
+    Moved,
+    /// The channels or their layout changed, so it needs to be validated and
+    /// set on the file again.
+    Changed,
+}
+
+/// A file's copy of the last framebuffer set on it, with its scanlines
+/// offset for incremental reads and writes.
+///
+/// Updating it in place avoids building a new C++ framebuffer for every
+/// chunk of scanlines, and tells the file when it can skip validating and
+/// setting the framebuffer because the layout hasn't changed.
+pub(crate) struct FrameBufferCache {
+    handle: *mut CEXR_FrameBuffer,
+    // Whether `handle` has been validated and successfully set on the file.
+    current: bool,
+}
+
+impl FrameBufferCache {
+    pub(crate) fn new() -> FrameBufferCache {
+        FrameBufferCache {
+            handle: unsafe { CEXR_FrameBuffer_new() },
+            current: false,
+        }
+    }
+
+    /// Updates the cache to be `framebuffer` with its base pointers offset by
+    /// `offset` scanlines (see `CEXR_FrameBuffer_copy_and_offset_scanlines`).
+    ///
+    /// The cache is no longer current after this; call `set_current()` once
+    /// it has been set on the file.
+    pub(crate) fn update(&mut self, framebuffer: &FrameBuffer, offset: u32) -> FrameBufferUpdate {
+        let result =
+            unsafe { CEXR_FrameBuffer_rebase_scanlines(self.handle, framebuffer.handle(), offset) };
+        let update = match (self.current, result) {
+            (false, _) => FrameBufferUpdate::Changed,
+            (true, 0) => FrameBufferUpdate::Unchanged,
+            (true, 1) => FrameBufferUpdate::Moved,
+            _ => FrameBufferUpdate::Changed,
+        };
+        if update != FrameBufferUpdate::Unchanged {
+            self.current = false;
+        }
+        update
+    }
+
+    /// Marks the cache as validated and set on the file.
+    pub(crate) fn set_current(&mut self) {
+        self.current = true;
+    }
+
+    /// Marks the cache as no longer set on the file, e.g. because another
+    /// framebuffer was set on it directly.
+    pub(crate) fn invalidate(&mut self) {
+        self.current = false;
+    }
+
+    pub(crate) fn handle(&self) -> *const CEXR_FrameBuffer {
+        self.handle
+    }
+
+    pub(crate) fn handle_mut(&mut self) -> *mut CEXR_FrameBuffer {
+        self.handle
+    }
+}
+
+impl Drop for FrameBufferCache {
+    fn drop(&mut self) {
+        unsafe { CEXR_FrameBuffer_delete(self.handle) };
+    }
+}
+
+// ----------------------------------------------------------------
+
 /// Types that can be inserted into a `FrameBuffer` as a channel.
 ///
 /// Implementing this trait on a type allows the type to be used directly by the
@@ -404,6 +584,47 @@ impl<'a> Deref for FrameBufferMut<'a> {
 pub unsafe trait PixelData {
     /// Returns which `PixelType` the implementing type corresponds to.
     fn pixel_type() -> PixelType;
+
+    /// Returns whether file channels of type `file_type` can be read into
+    /// this type, converting them on the way.
+    ///
+    /// Conversions are done by the wrapper a row at a time with vectorized
+    /// kernels where available, rather than by OpenEXR a pixel at a time.
+    /// By default no conversions are allowed, and only channels of type
+    /// `pixel_type()` can be read, which is also the case for the built-in
+    /// types.  Whether a slice converts is decided by the type it's inserted
+    /// with by `FrameBufferMut::insert_channel()` or `insert_channels()`.
+    /// Slices inserted with `insert_raw()` never convert.
+    ///
+    /// Converting reads through `InputFile` don't support subsampled
+    /// channels.  Other input file types leave conversions to OpenEXR.
+    ///
+    /// # Examples
+    ///
+    /// A type for reading HALF channels as well as FLOAT ones into `f32`s:
+    ///
+    /// ```
+    /// use openexr::frame_buffer::PixelData;
+    /// use openexr::PixelType;
+    ///
+    /// #[repr(transparent)]
+    /// #[derive(Copy, Clone, Default)]
+    /// struct Float(f32);
+    ///
+    /// unsafe impl PixelData for Float {
+    ///     fn pixel_type() -> PixelType {
+    ///         PixelType::FLOAT
+    ///     }
+    ///
+    ///     fn converts_from(file_type: PixelType) -> bool {
+    ///         file_type == PixelType::HALF
+    ///     }
+    /// }
+    /// ```
+    fn converts_from(file_type: PixelType) -> bool {
+        let _ = file_type;
+        false
+    }
 }
 
 unsafe impl PixelData for u32 {
@@ -469,6 +690,17 @@ pub unsafe trait PixelStruct {
     fn channels() -> PixelStructChannelIter {
         (0..Self::channel_count()).map(Self::channel)
     }
+
+    /// Returns whether file channels of type `file_type` can be read into
+    /// channel `i`, converting them on the way.
+    ///
+    /// See `PixelData::converts_from()`.  The implementations for tuples
+    /// and arrays ask their elements, and by default no conversions are
+    /// allowed.
+    fn channel_converts_from(i: usize, file_type: PixelType) -> bool {
+        let _ = (i, file_type);
+        false
+    }
 }
 
 /// An iterator over the types and offsets of the channels in a `PixelStruct`.
@@ -482,6 +714,9 @@ unsafe impl<T: PixelData> PixelStruct for T {
     fn channel(_: usize) -> (PixelType, usize) {
         (T::pixel_type(), 0)
     }
+    fn channel_converts_from(_: usize, file_type: PixelType) -> bool {
+        T::converts_from(file_type)
+    }
 }
 
 macro_rules! offset_of {
@@ -497,6 +732,9 @@ unsafe impl<A: PixelData> PixelStruct for (A,) {
     fn channel(_: usize) -> (PixelType, usize) {
         (A::pixel_type(), offset_of!(Self, 0))
     }
+    fn channel_converts_from(_: usize, file_type: PixelType) -> bool {
+        A::converts_from(file_type)
+    }
 }
 
 unsafe impl<A, B> PixelStruct for (A, B)
@@ -513,6 +751,9 @@ where
             (B::pixel_type(), offset_of!(Self, 1)),
         ][i]
     }
+    fn channel_converts_from(i: usize, file_type: PixelType) -> bool {
+        [A::converts_from as fn(PixelType) -> bool, B::converts_from][i](file_type)
+    }
 }
 
 unsafe impl<A, B, C> PixelStruct for (A, B, C)
@@ -531,6 +772,13 @@ where
             (C::pixel_type(), offset_of!(Self, 2)),
         ][i]
     }
+    fn channel_converts_from(i: usize, file_type: PixelType) -> bool {
+        [
+            A::converts_from as fn(PixelType) -> bool,
+            B::converts_from,
+            C::converts_from,
+        ][i](file_type)
+    }
 }
 
 unsafe impl<A, B, C, D> PixelStruct for (A, B, C, D)
@@ -551,6 +799,14 @@ where
             (D::pixel_type(), offset_of!(Self, 3)),
         ][i]
     }
+    fn channel_converts_from(i: usize, file_type: PixelType) -> bool {
+        [
+            A::converts_from as fn(PixelType) -> bool,
+            B::converts_from,
+            C::converts_from,
+            D::converts_from,
+        ][i](file_type)
+    }
 }
 
 unsafe impl<T: PixelData> PixelStruct for [T; 1] {
@@ -560,6 +816,9 @@ unsafe impl<T: PixelData> PixelStruct for [T; 1] {
     fn channel(_: usize) -> (PixelType, usize) {
         (T::pixel_type(), 0)
     }
+    fn channel_converts_from(_: usize, file_type: PixelType) -> bool {
+        T::converts_from(file_type)
+    }
 }
 
 unsafe impl<T: PixelData> PixelStruct for [T; 2] {
@@ -569,6 +828,9 @@ unsafe impl<T: PixelData> PixelStruct for [T; 2] {
     fn channel(i: usize) -> (PixelType, usize) {
         (T::pixel_type(), i * mem::size_of::<T>())
     }
+    fn channel_converts_from(_: usize, file_type: PixelType) -> bool {
+        T::converts_from(file_type)
+    }
 }
 
 unsafe impl<T: PixelData> PixelStruct for [T; 3] {
@@ -578,6 +840,9 @@ unsafe impl<T: PixelData> PixelStruct for [T; 3] {
     fn channel(i: usize) -> (PixelType, usize) {
         (T::pixel_type(), i * mem::size_of::<T>())
     }
+    fn channel_converts_from(_: usize, file_type: PixelType) -> bool {
+        T::converts_from(file_type)
+    }
 }
 
 unsafe impl<T: PixelData> PixelStruct for [T; 4] {
@@ -587,4 +852,7 @@ unsafe impl<T: PixelData> PixelStruct for [T; 4] {
     fn channel(i: usize) -> (PixelType, usize) {
         (T::pixel_type(), i * mem::size_of::<T>())
     }
+    fn channel_converts_from(_: usize, file_type: PixelType) -> bool {
+        T::converts_from(file_type)
+    }
 }
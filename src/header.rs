@@ -1,17 +1,23 @@
 //! Header and related types.
 
+use std::cell::OnceCell;
 use std::ffi::{CStr, CString};
+use std::io::{Read, Seek};
 use std::marker::PhantomData;
 use std::{self, ptr, slice};
 
 use openexr_sys::*;
 
 use cexr_type_aliases::*;
+use deep_frame_buffer::DeepFrameBuffer;
 use error::{Error, Result};
 use frame_buffer::{FrameBuffer, FrameBufferMut};
-use libc::c_int;
+use libc::{c_char, c_int};
+use stream_io::{read_stream, seek_stream};
 
-pub use cexr_type_aliases::{Channel, Compression, LineOrder};
+pub use cexr_type_aliases::{
+    Channel, Compression, LevelMode, LevelRoundingMode, LineOrder, TileDescription,
+};
 
 /// Represents an OpenEXR file header.
 ///
@@ -36,9 +42,18 @@ pub use cexr_type_aliases::{Channel, Compression, LineOrder};
 pub struct Header {
     pub(crate) handle: *mut CEXR_Header,
     pub(crate) owned: bool,
+    // Snapshot of the channel list, taken the first time it's needed so
+    // that looking up channels (e.g. when validating framebuffers for each
+    // chunk read or written) doesn't call into C++.  Reset by the methods
+    // that change the channel list.
+    channel_cache: OnceCell<Vec<(CString, Channel)>>,
     pub(crate) _phantom: PhantomData<CEXR_Header>,
 }
 
+// Size of the read-ahead buffer used by `Header::read_from()`.  Large enough
+// for typical headers in a single read, without reading much further.
+const HEADER_READ_BUFFER_SIZE: usize = 4096;
+
 impl Header {
     /// Creates a new header.
     pub fn new() -> Self {
@@ -67,13 +82,112 @@ impl Header {
             }
         };
 
-        Self {
-            handle: header,
+        Header::owned(header)
+    }
+
+    // Takes ownership of `handle`, deleting it when dropped.
+    pub(crate) fn owned(handle: *mut CEXR_Header) -> Header {
+        Header {
+            handle: handle,
             owned: true,
+            channel_cache: OnceCell::new(),
+            _phantom: PhantomData,
+        }
+    }
+
+    // Refers to the header of a file, which the file keeps ownership of.
+    pub(crate) fn borrowed(handle: *const CEXR_Header) -> Header {
+        Header {
+            // NOTE: We're casting to *mut here to satisfy the field's type,
+            // but importantly files only return a const & of the Header so
+            // it retains const semantics.
+            handle: handle as *mut CEXR_Header,
+            owned: false,
+            channel_cache: OnceCell::new(),
             _phantom: PhantomData,
         }
     }
 
+    /// Reads just the header of a file from any `Read + Seek` type
+    /// (typically a `std::fs::File`).
+    ///
+    /// This stops reading right after the header, without reading the
+    /// offset tables or setting up any of the machinery for reading pixel
+    /// data, which makes it much cheaper than opening an `InputFile` when
+    /// only the file's metadata is needed.  For multi-part files, this reads
+    /// the header of the first part.
+    ///
+    /// Note: this seeks to byte 0 before reading.
+    ///
+    /// # Examples
+    ///
+    /// ```no_run
+    /// # use openexr::Header;
+    /// #
+    /// let mut file = std::fs::File::open("input_file.exr").unwrap();
+    /// let header = Header::read_from(&mut file).unwrap();
+    /// println!("{:?} {:?}", header.data_dimensions(), header.compression());
+    /// ```
+    pub fn read_from<T: Read + Seek>(reader: &mut T) -> Result<Header> {
+        let istream_ptr = {
+            let read_ptr = read_stream::<T>;
+            let seekp_ptr = seek_stream::<T>;
+
+            let mut error_out = ptr::null();
+            let mut out = ptr::null_mut();
+            let error = unsafe {
+                CEXR_IStream_from_reader(
+                    reader as *mut T as *mut _,
+                    Some(read_ptr),
+                    Some(seekp_ptr),
+                    HEADER_READ_BUFFER_SIZE,
+                    &mut out,
+                    &mut error_out,
+                )
+            };
+
+            if error != 0 {
+                return Err(Error::take(error_out));
+            } else {
+                out
+            }
+        };
+
+        let header = Header::read_from_istream(istream_ptr);
+        unsafe { CEXR_IStream_delete(istream_ptr) };
+        header
+    }
+
+    /// Reads just the header of a file from a slice of bytes.
+    ///
+    /// See `read_from()` for details.
+    pub fn read_from_slice(slice: &[u8]) -> Result<Header> {
+        let istream_ptr = unsafe {
+            CEXR_IStream_from_memory(
+                b"in-memory data\0".as_ptr() as *const c_char,
+                slice.as_ptr() as *mut u8 as *mut c_char,
+                slice.len(),
+            )
+        };
+
+        let header = Header::read_from_istream(istream_ptr);
+        unsafe { CEXR_IStream_delete(istream_ptr) };
+        header
+    }
+
+    // Shared code for the functions above.  Doesn't take ownership of
+    // `istream_ptr`.
+    fn read_from_istream(istream_ptr: *mut CEXR_IStream) -> Result<Header> {
+        let mut error_out = ptr::null();
+        let mut out = ptr::null_mut();
+        let error = unsafe { CEXR_Header_read_from_stream(istream_ptr, &mut out, &mut error_out) };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(Header::owned(out))
+        }
+    }
+
     /// Sets the resolution.
     ///
     /// This is really just a shortcut for setting both the display window
@@ -157,6 +271,30 @@ impl Header {
         self
     }
 
+    /// Returns the line order.
+    pub fn line_order(&self) -> LineOrder {
+        unsafe { CEXR_Header_line_order(self.handle) }
+    }
+
+    /// Returns the compression mode.
+    pub fn compression(&self) -> Compression {
+        unsafe { CEXR_Header_compression(self.handle) }
+    }
+
+    /// Returns the number of scanlines stored together in each chunk of a
+    /// scanline file.
+    ///
+    /// This is determined by the compression mode, and is the granularity at
+    /// which scanline files are compressed and read.  OpenEXR doesn't allow
+    /// changing it otherwise, but some codecs come in two variants that
+    /// differ only in their chunk size: `ZIPS_COMPRESSION` and
+    /// `ZIP_COMPRESSION`, and `DWAA_COMPRESSION` and `DWAB_COMPRESSION`.
+    /// Larger chunks generally compress better, while smaller ones make
+    /// reading small regions cheaper.
+    pub fn scanlines_per_chunk(&self) -> u32 {
+        unsafe { CEXR_Header_scanlines_per_chunk(self.handle) as u32 }
+    }
+
     /// Sets the compression mode.
     pub fn set_compression(&mut self, compression: Compression) -> &mut Self {
         unsafe {
@@ -165,6 +303,78 @@ impl Header {
         self
     }
 
+    /// Returns the compression level used by `DWAA_COMPRESSION` and
+    /// `DWAB_COMPRESSION`, or `None` if it's the default (45).
+    pub fn dwa_compression_level(&self) -> Option<f32> {
+        if unsafe { CEXR_Header_has_dwa_compression_level(self.handle) } {
+            Some(unsafe { CEXR_Header_dwa_compression_level(self.handle) })
+        } else {
+            None
+        }
+    }
+
+    /// Sets the compression level used by `DWAA_COMPRESSION` and
+    /// `DWAB_COMPRESSION`, or `None` for the default (45).
+    ///
+    /// DWA compression is lossy, and this controls how coarsely it
+    /// quantizes: higher levels make smaller files of lower quality, with
+    /// little effect on encoding speed.  It's stored in the header as the
+    /// "dwaCompressionLevel" attribute.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `level` is negative or NaN.
+    pub fn set_dwa_compression_level(&mut self, level: Option<f32>) -> &mut Self {
+        if let Some(x) = level {
+            assert!(x >= 0.0, "DWA compression level must not be negative");
+            unsafe { CEXR_Header_set_dwa_compression_level(self.handle, x) };
+        } else {
+            unsafe { CEXR_Header_erase_dwa_compression_level(self.handle) };
+        }
+        self
+    }
+
+    /// Sets how much effort to spend on making files smaller, by switching
+    /// a ZIP or DWA compression mode to the variant with the right chunk
+    /// size.
+    ///
+    /// This should be called after `set_compression()`.
+    ///
+    /// * With `ZIPS_COMPRESSION` or `ZIP_COMPRESSION`, `Fastest` picks
+    ///   `ZIPS_COMPRESSION`.  Its one-scanline chunks encode about a quarter
+    ///   faster than the 16-scanline chunks of `ZIP_COMPRESSION`, and make
+    ///   files a few percent larger.  `Default` and `Smallest` both pick
+    ///   `ZIP_COMPRESSION`, since OpenEXR 2.x always uses zlib's default
+    ///   level.
+    /// * With `DWAA_COMPRESSION` or `DWAB_COMPRESSION`, `Fastest` and
+    ///   `Default` pick `DWAA_COMPRESSION`.  `Smallest` picks
+    ///   `DWAB_COMPRESSION`, whose 256-scanline chunks compress better than
+    ///   the 32-scanline chunks of `DWAA_COMPRESSION`.  The compression level,
+    ///   and so the image quality, is left as it is.
+    ///
+    /// Other compression modes are left as they are.
+    pub fn set_compression_effort(&mut self, effort: CompressionEffort) -> &mut Self {
+        match self.compression() {
+            Compression::ZIPS_COMPRESSION | Compression::ZIP_COMPRESSION => {
+                self.set_compression(match effort {
+                    CompressionEffort::Fastest => Compression::ZIPS_COMPRESSION,
+                    CompressionEffort::Default | CompressionEffort::Smallest => {
+                        Compression::ZIP_COMPRESSION
+                    }
+                })
+            }
+            Compression::DWAA_COMPRESSION | Compression::DWAB_COMPRESSION => {
+                self.set_compression(match effort {
+                    CompressionEffort::Fastest | CompressionEffort::Default => {
+                        Compression::DWAA_COMPRESSION
+                    }
+                    CompressionEffort::Smallest => Compression::DWAB_COMPRESSION,
+                })
+            }
+            _ => self,
+        }
+    }
+
     /// Adds a channel.
     ///
     /// This is a simplified version of `add_channel_detailed()`, using some reasonable
@@ -186,6 +396,7 @@ impl Header {
     pub fn add_channel_detailed(&mut self, name: &str, channel: Channel) -> &mut Self {
         let cname = CString::new(name.as_bytes()).unwrap();
         unsafe { CEXR_Header_insert_channel(self.handle, cname.as_ptr(), channel) };
+        self.channel_cache = OnceCell::new();
         self
     }
 
@@ -215,24 +426,38 @@ impl Header {
         unsafe { &*CEXR_Header_display_window(self.handle) }
     }
 
-    /// Returns an iterator over the channels in the header.
+    /// Returns an iterator over the channels in the header, in
+    /// alphabetical order.
     pub fn channels(&self) -> ChannelIter {
         ChannelIter {
-            iterator: unsafe { CEXR_Header_channel_list_iter(self.handle) },
-            _phantom_1: PhantomData,
-            _phantom_2: PhantomData,
+            channels: self.channel_list().iter(),
         }
     }
 
     /// Access channels by name.
     pub fn get_channel<'a>(&'a self, name: &str) -> Option<&'a Channel> {
-        let c_name = CString::new(name.as_bytes()).unwrap();
-        let out = unsafe { CEXR_Header_get_channel(self.handle, c_name.as_ptr()) };
-        if !out.is_null() {
-            Some(unsafe { &(*out) })
-        } else {
-            None
-        }
+        let channels = self.channel_list();
+        channels
+            .binary_search_by(|&(ref n, _)| n.as_bytes().cmp(name.as_bytes()))
+            .ok()
+            .map(|i| &channels[i].1)
+    }
+
+    // The channel list, sorted by name in the same byte order OpenEXR
+    // keeps it in.
+    fn channel_list(&self) -> &[(CString, Channel)] {
+        self.channel_cache.get_or_init(|| {
+            let iterator = unsafe { CEXR_Header_channel_list_iter(self.handle) };
+            let mut channels = Vec::new();
+            let mut name = ptr::null();
+            let mut channel = std::mem::MaybeUninit::uninit();
+            while unsafe { CEXR_ChannelListIter_next(iterator, &mut name, channel.as_mut_ptr()) } {
+                let name = unsafe { CStr::from_ptr(name) }.to_owned();
+                channels.push((name, unsafe { channel.assume_init() }));
+            }
+            unsafe { CEXR_ChannelListIter_delete(iterator) };
+            channels
+        })
     }
 
     /// Determine whether this header describes an environment map, and if so, what type
@@ -297,6 +522,182 @@ impl Header {
         self
     }
 
+    /// Access the part name, if any.
+    ///
+    /// Every part of a multipart file has a unique name.  Names that aren't
+    /// valid UTF-8 are treated as missing.
+    pub fn name(&self) -> Option<&str> {
+        if !unsafe { CEXR_Header_has_name(self.handle) } {
+            return None;
+        }
+        let slice = unsafe { CEXR_Header_name(self.handle) };
+        let bytes = unsafe { slice::from_raw_parts(slice.ptr as *const u8, slice.len) };
+        std::str::from_utf8(bytes).ok()
+    }
+
+    /// Sets the part name, which is required for each part of a multipart
+    /// file (see `MultiPartOutputFile`).
+    ///
+    /// # Panics
+    ///
+    /// Panics if `name` contains a nul byte.
+    pub fn set_name(&mut self, name: Option<&str>) -> &mut Self {
+        if let Some(x) = name {
+            let cname = CString::new(x.as_bytes()).unwrap();
+            unsafe { CEXR_Header_set_name(self.handle, cname.as_ptr()) };
+        } else {
+            unsafe { CEXR_Header_erase_attribute(self.handle, b"name\0".as_ptr() as *const _) }
+        }
+        self
+    }
+
+    /// Access the view name, if any.
+    ///
+    /// Multi-view multipart files typically store each view in its own
+    /// parts, whose headers name the view, and whose channels are then named
+    /// without it.
+    pub fn view(&self) -> Option<&str> {
+        if !unsafe { CEXR_Header_has_view(self.handle) } {
+            return None;
+        }
+        let slice = unsafe { CEXR_Header_view(self.handle) };
+        let bytes = unsafe { slice::from_raw_parts(slice.ptr as *const u8, slice.len) };
+        std::str::from_utf8(bytes).ok()
+    }
+
+    /// Sets the view name, for the parts of multi-view multipart files.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `view` contains a nul byte.
+    pub fn set_view(&mut self, view: Option<&str>) -> &mut Self {
+        if let Some(x) = view {
+            let cview = CString::new(x.as_bytes()).unwrap();
+            unsafe { CEXR_Header_set_view(self.handle, cview.as_ptr()) };
+        } else {
+            unsafe { CEXR_Header_erase_attribute(self.handle, b"view\0".as_ptr() as *const _) }
+        }
+        self
+    }
+
+    /// Looks up the view named `name`, for finding and naming its channels.
+    ///
+    /// If the header has a list of views (see `multiview()`), `name` must be
+    /// one of them, and its channels are named following OpenEXR's
+    /// multi-view rules (see `View`).  Otherwise, if the header itself is of
+    /// the view named `name` (see `view()`), all of its channels belong to
+    /// that view, with their names as they are.
+    ///
+    /// Returns `None` if the header doesn't have the view.
+    pub fn find_view(&self, name: &str) -> Option<View> {
+        if let Some(views) = self.multiview() {
+            let views: Vec<String> = views.map(|view| view.to_string()).collect();
+            return views
+                .iter()
+                .position(|view| view == name)
+                .map(|index| View {
+                    views: views.clone(),
+                    index: Some(index),
+                });
+        }
+        if self.view() == Some(name) {
+            Some(View {
+                views: vec![name.to_string()],
+                index: None,
+            })
+        } else {
+            None
+        }
+    }
+
+    /// Returns the names of the channels that belong to `view`.
+    ///
+    /// Reading only these channels decodes only the one view, although
+    /// compressed chunks still have to be decompressed as a whole.  To read
+    /// just one view of a multipart file, read only its parts instead (see
+    /// `MultiPartInputFile::view_parts()`).
+    pub fn channels_in_view(&self, view: &View) -> Vec<&str> {
+        self.channels()
+            .filter_map(|channel| channel.ok())
+            .map(|(name, _)| name)
+            .filter(|&name| view.base_name(name).is_some())
+            .collect()
+    }
+
+    /// Sets the tile description, which makes this the header of a tiled
+    /// file.
+    ///
+    /// This is required for creating a `TiledOutputFile`.  The tile
+    /// description's `mode` determines whether the file stores only the full
+    /// resolution image or also mip-map or rip-map levels.
+    pub fn set_tile_description(&mut self, tile_description: TileDescription) -> &mut Self {
+        assert!(tile_description.x_size > 0 && tile_description.y_size > 0);
+        unsafe {
+            CEXR_Header_set_tile_description(self.handle, tile_description);
+        }
+        self
+    }
+
+    /// Access the tile description, if any.
+    ///
+    /// Only headers of tiled files have a tile description.
+    pub fn tile_description(&self) -> Option<TileDescription> {
+        if unsafe { CEXR_Header_has_tile_description(self.handle) } {
+            Some(unsafe { CEXR_Header_tile_description(self.handle) })
+        } else {
+            None
+        }
+    }
+
+    /// Access the preview image, if any.
+    pub fn preview_image(&self) -> Option<PreviewImage> {
+        if !unsafe { CEXR_Header_has_preview_image(self.handle) } {
+            return None;
+        }
+        let mut width = 0;
+        let mut height = 0;
+        let pixels = unsafe { CEXR_Header_preview_image(self.handle, &mut width, &mut height) };
+        let pixels = unsafe {
+            slice::from_raw_parts(pixels as *const [u8; 4], width as usize * height as usize)
+        };
+        Some(PreviewImage {
+            width: width,
+            height: height,
+            pixels: pixels.to_vec(),
+        })
+    }
+
+    /// Sets the preview image, a small thumbnail that file browsers and
+    /// image viewers can show without reading the pixels.
+    ///
+    /// To have the preview image made from the pixels as they're written,
+    /// see `OutputOptions::set_preview_size()` instead.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the number of pixels of `preview` doesn't match its width
+    /// and height.
+    pub fn set_preview_image(&mut self, preview: Option<&PreviewImage>) -> &mut Self {
+        if let Some(x) = preview {
+            assert_eq!(
+                x.pixels.len(),
+                x.width as usize * x.height as usize,
+                "preview image has the wrong number of pixels"
+            );
+            unsafe {
+                CEXR_Header_set_preview_image(
+                    self.handle,
+                    x.width,
+                    x.height,
+                    x.pixels.as_ptr() as *const CEXR_PreviewRgba,
+                )
+            };
+        } else {
+            unsafe { CEXR_Header_erase_attribute(self.handle, b"preview\0".as_ptr() as *const _) }
+        }
+        self
+    }
+
     pub(crate) fn validate_framebuffer_for_output(&self, framebuffer: &FrameBuffer) -> Result<()> {
         for chan in self.channels() {
             let (name, h_channel) = chan?;
@@ -316,6 +717,54 @@ impl Header {
     pub(crate) fn validate_framebuffer_for_input(
         &self,
         framebuffer: &FrameBufferMut,
+    ) -> Result<()> {
+        for chan in self.channels() {
+            let (name, h_channel) = chan?;
+            if let Some(mut fb_channel) = framebuffer._get_channel(name) {
+                // Channels that are converted on the way in only need
+                // matching subsampling.
+                if framebuffer.channel_converts_from(name, h_channel.pixel_type) {
+                    fb_channel.pixel_type = h_channel.pixel_type;
+                }
+                Header::validate_channel(name, &h_channel, &fb_channel)?;
+            }
+        }
+        Ok(())
+    }
+
+    // Whether reading into `framebuffer` converts any of its channels from
+    // this header's channel types.
+    pub(crate) fn framebuffer_needs_conversion(&self, framebuffer: &FrameBufferMut) -> bool {
+        self.channels().any(|chan| match chan {
+            Ok((name, h_channel)) => framebuffer._get_channel(name).map_or(false, |fb_channel| {
+                fb_channel.pixel_type != h_channel.pixel_type
+            }),
+            Err(_) => false,
+        })
+    }
+
+    pub(crate) fn validate_deep_framebuffer_for_output(
+        &self,
+        framebuffer: &DeepFrameBuffer,
+    ) -> Result<()> {
+        for chan in self.channels() {
+            let (name, h_channel) = chan?;
+            if let Some(fb_channel) = framebuffer._get_channel(name) {
+                Header::validate_channel(name, &h_channel, &fb_channel)?;
+            } else {
+                return Err(Error::Generic(format!(
+                    "DeepFrameBuffer is missing \
+                     channel '{}' expected by Header",
+                    name
+                )));
+            }
+        }
+        Ok(())
+    }
+
+    pub(crate) fn validate_deep_framebuffer_for_input(
+        &self,
+        framebuffer: &DeepFrameBuffer,
     ) -> Result<()> {
         for chan in self.channels() {
             let (name, h_channel) = chan?;
@@ -366,6 +815,16 @@ impl Default for Header {
     }
 }
 
+impl Clone for Header {
+    /// Makes an independent, owned copy of the header.
+    ///
+    /// This is useful for writing a file with the same (or slightly
+    /// modified) header as a file that was read.
+    fn clone(&self) -> Header {
+        Header::owned(unsafe { CEXR_Header_copy(self.handle) })
+    }
+}
+
 impl Drop for Header {
     fn drop(&mut self) {
         if self.owned {
@@ -378,41 +837,179 @@ impl Drop for Header {
 ///
 /// Yields a tuple of the name and description of each channel.
 pub struct ChannelIter<'a> {
-    iterator: *mut CEXR_ChannelListIter,
-    _phantom_1: PhantomData<CEXR_ChannelListIter>,
-    _phantom_2: PhantomData<&'a Header>,
-}
-
-impl<'a> Drop for ChannelIter<'a> {
-    fn drop(&mut self) {
-        unsafe { CEXR_ChannelListIter_delete(self.iterator) };
-    }
+    channels: slice::Iter<'a, (CString, Channel)>,
 }
 
 impl<'a> Iterator for ChannelIter<'a> {
     type Item = Result<(&'a str, Channel)>;
     fn next(&mut self) -> Option<Result<(&'a str, Channel)>> {
-        let mut name = std::mem::MaybeUninit::uninit();
-        let mut channel = std::mem::MaybeUninit::uninit();
-        if unsafe {
-            CEXR_ChannelListIter_next(self.iterator, name.as_mut_ptr(), channel.as_mut_ptr())
-        } {
-            // TODO: use CStr::from_bytes_with_nul() instead to avoid memory unsafety
-            // if the string is not nul terminated.
-            let cname = unsafe { CStr::from_ptr(name.assume_init()) };
-            let str_name = cname.to_str();
-            if let Ok(n) = str_name {
-                Some(Ok((n, unsafe { channel.assume_init() })))
+        self.channels.next().map(|&(ref name, channel)| {
+            if let Ok(n) = name.to_str() {
+                Ok((n, channel))
             } else {
-                Some(Err(Error::Generic(format!(
+                Err(Error::Generic(format!(
                     "Invalid channel name: {:?}",
-                    cname
-                ))))
+                    name.as_c_str()
+                )))
             }
-        } else {
-            None
+        })
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.channels.size_hint()
+    }
+}
+
+/// A preview image: a small, 8-bit RGBA version of the image.
+///
+/// The colors are tone mapped for display the same way OpenEXR's
+/// `exrmakepreview` tool does it, while alpha is linear.
+#[derive(Debug, Clone, PartialEq)]
+pub struct PreviewImage {
+    /// The width in pixels.
+    pub width: u32,
+    /// The height in pixels.
+    pub height: u32,
+    /// The pixels as `[r, g, b, a]`, in scanline order from the top left.
+    pub pixels: Vec<[u8; 4]>,
+}
+
+impl PreviewImage {
+    /// Creates a transparent black preview image of the given size.
+    pub fn new(width: u32, height: u32) -> PreviewImage {
+        PreviewImage {
+            width: width,
+            height: height,
+            pixels: vec![[0; 4]; width as usize * height as usize],
         }
     }
+
+    // The size of a preview image of the data window of `header` whose
+    // longer side is `size` pixels, or the size of the data window if
+    // that's smaller.
+    pub(crate) fn dimensions_for(header: &Header, size: u32) -> (u32, u32) {
+        let (width, height) = header.data_dimensions();
+        let long_side = width.max(height);
+        let preview_long_side = size.min(long_side) as u64;
+        let scale = |side: u32| {
+            ((side as u64 * preview_long_side + long_side as u64 / 2) / long_side as u64).max(1)
+                as u32
+        };
+        (scale(width), scale(height))
+    }
+}
+
+/// One view of a multi-view image, such as one eye of a stereo image, as
+/// found with `Header::find_view()`.
+///
+/// Multi-view headers list their views with `Header::set_multiview()`, the
+/// first of which is the default view, and the views' channels are named
+/// after the view they belong to.  A channel's view is the second to last
+/// part of its name, so "right.R" and "diffuse.right.R" are in the "right"
+/// view.  Channels whose names have only one part, like "R", are in the
+/// default view, while those whose second to last part isn't a view, like
+/// "diffuse.R", aren't in any view.
+///
+/// A `View` maps between these names and the names without the view, so
+/// that the same names can be used to read each view, for example with
+/// `FrameBufferMut::insert_view_channels()`.
+///
+/// # Examples
+///
+/// ```
+/// # use openexr::Header;
+/// #
+/// let mut header = Header::new();
+/// header.set_multiview(Some(&["left", "right"]));
+///
+/// let left = header.find_view("left").unwrap();
+/// let right = header.find_view("right").unwrap();
+/// assert_eq!(left.channel_name("R"), "R");
+/// assert_eq!(left.channel_name("diffuse.R"), "diffuse.left.R");
+/// assert_eq!(right.channel_name("R"), "right.R");
+/// assert_eq!(right.base_name("diffuse.right.R").unwrap(), "diffuse.R");
+/// assert_eq!(right.base_name("R"), None);
+/// ```
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct View {
+    views: Vec<String>,
+    // The index of this view in `views`, or `None` for the view of a header
+    // that names its view instead, whose channels don't include it.
+    index: Option<usize>,
+}
+
+impl View {
+    /// Returns the view's name.
+    pub fn name(&self) -> &str {
+        &self.views[self.index.unwrap_or(0)]
+    }
+
+    /// Returns whether this is the default view, the first in the list of
+    /// views.
+    pub fn is_default(&self) -> bool {
+        self.index == Some(0)
+    }
+
+    /// Returns the name of the view's channel named `base_name` without the
+    /// view.
+    ///
+    /// The view's name is inserted before the last part of `base_name`,
+    /// except for the default view's single-part names, as with OpenEXR's
+    /// `insertViewName()`.
+    pub fn channel_name(&self, base_name: &str) -> String {
+        if self.index.is_none() || (self.is_default() && !base_name.contains('.')) {
+            return base_name.to_string();
+        }
+        match base_name.rfind('.') {
+            Some(dot) => format!(
+                "{}.{}.{}",
+                &base_name[..dot],
+                self.name(),
+                &base_name[dot + 1..]
+            ),
+            None => format!("{}.{}", self.name(), base_name),
+        }
+    }
+
+    /// Returns the name of the channel named `channel_name` without the
+    /// view, or `None` if it isn't one of the view's channels.
+    pub fn base_name(&self, channel_name: &str) -> Option<String> {
+        if self.index.is_none() {
+            return Some(channel_name.to_string());
+        }
+
+        // The view is the second to last part of the name, as with
+        // OpenEXR's `viewFromChannelName()`.
+        let parts: Vec<&str> = channel_name.split('.').collect();
+        if parts.len() == 1 {
+            return if self.is_default() {
+                Some(channel_name.to_string())
+            } else {
+                None
+            };
+        }
+        if parts[parts.len() - 2] != self.name() {
+            return None;
+        }
+        let mut base_name = parts[..parts.len() - 2].join(".");
+        if !base_name.is_empty() {
+            base_name.push('.');
+        }
+        base_name.push_str(parts[parts.len() - 1]);
+        Some(base_name)
+    }
+}
+
+/// Presets for `Header::set_compression_effort()`.
+#[derive(Debug, Copy, Clone, Eq, PartialEq)]
+pub enum CompressionEffort {
+    /// `ZIPS_COMPRESSION` or `DWAA_COMPRESSION`, for encoding quickly.
+    Fastest,
+    /// `ZIP_COMPRESSION` or `DWAA_COMPRESSION`, the variants OpenEXR's own
+    /// tools default to.
+    Default,
+    /// `ZIP_COMPRESSION` or `DWAB_COMPRESSION`, for smaller files.
+    Smallest,
 }
 
 /// Types of environment maps
@@ -0,0 +1,271 @@
+use std::fs::File;
+use std::io::Read;
+use std::path::Path;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::{panic, ptr, thread};
+
+use libc::c_char;
+
+use openexr_sys::*;
+
+use error::*;
+use frame_buffer::{FrameBufferMut, PixelStruct};
+use Header;
+
+use super::{InputFile, InputOptions};
+
+/// Reads many files in parallel, sharing resources between them.
+///
+/// Opening an `InputFile` has a fixed cost that dominates when files are
+/// tiny, such as the sprites or tiles of a texture atlas.  A `BatchReader`
+/// spreads a list of files over worker threads, and each worker reuses its
+/// input stream, its buffer for the file's contents (when reading from
+/// paths) and its pixel buffer from one file to the next.  Each file is
+/// decoded entirely on its worker, since the parallelism comes from reading
+/// several files at once.
+///
+/// # Examples
+///
+/// Sum up the red channel of a list of files:
+///
+/// ```no_run
+/// # use openexr::input::BatchReader;
+/// use std::sync::Mutex;
+///
+/// let paths = vec!["sprite_0.exr", "sprite_1.exr", "sprite_2.exr"];
+/// let sums = Mutex::new(vec![0.0; paths.len()]);
+/// let results = BatchReader::new().read_paths(
+///     &paths,
+///     &[("R", 0.0)],
+///     |index, _header, pixels: &[f32]| {
+///         sums.lock().unwrap()[index] = pixels.iter().sum::<f32>();
+///     },
+/// );
+/// for (path, result) in paths.iter().zip(results) {
+///     if let Err(e) = result {
+///         println!("couldn't read {}: {}", path, e);
+///     }
+/// }
+/// ```
+#[derive(Debug, Copy, Clone)]
+pub struct BatchReader {
+    threads: usize,
+}
+
+impl BatchReader {
+    /// Creates a batch reader with one worker thread per CPU.
+    pub fn new() -> Self {
+        BatchReader {
+            threads: thread::available_parallelism()
+                .map(|threads| threads.get())
+                .unwrap_or(1),
+        }
+    }
+
+    /// Sets the number of worker threads.  If set to `0`, all the files are
+    /// read on the calling thread.
+    pub fn set_threads(&mut self, threads: usize) -> &mut Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Reads the files in `slices` from memory.
+    ///
+    /// Each file is read whole into a buffer of pixels of type `T`, with
+    /// the channels given in `channels` exactly as with
+    /// `FrameBufferMut::insert_channels()`, and handed to `consumer` along
+    /// with its index in `slices` and its header.  `consumer` is called
+    /// from the worker threads, and the pixel buffer is reused for the
+    /// worker's next file once it returns.
+    ///
+    /// Returns the result of reading each file, in the same order as
+    /// `slices`.  `consumer` is only called for the files that are read
+    /// successfully.
+    ///
+    /// # Panics
+    ///
+    /// Re-raises any panic from `consumer`, once the other workers are
+    /// done.
+    pub fn read_slices<T, F>(
+        &self,
+        slices: &[&[u8]],
+        channels: &[(&str, f64)],
+        consumer: F,
+    ) -> Vec<Result<()>>
+    where
+        T: PixelStruct + Copy + Default + Send,
+        F: Fn(usize, &Header, &[T]) + Sync,
+    {
+        self.read(slices.len(), |i, _| Ok(Some(slices[i])), channels, consumer)
+    }
+
+    /// Reads the files at `paths`.
+    ///
+    /// Each worker reads the whole file into a buffer it reuses from file
+    /// to file, so no memory maps or reader adapters are created per file.
+    /// Otherwise this works just like `read_slices()`.
+    pub fn read_paths<P, T, F>(
+        &self,
+        paths: &[P],
+        channels: &[(&str, f64)],
+        consumer: F,
+    ) -> Vec<Result<()>>
+    where
+        P: AsRef<Path> + Sync,
+        T: PixelStruct + Copy + Default + Send,
+        F: Fn(usize, &Header, &[T]) + Sync,
+    {
+        self.read(
+            paths.len(),
+            |i, contents| {
+                let path = paths[i].as_ref();
+                contents.clear();
+                File::open(path)
+                    .and_then(|mut file| file.read_to_end(contents))
+                    .map_err(|e| {
+                        Error::Generic(format!("couldn't read {}: {}", path.display(), e))
+                    })?;
+                Ok(None)
+            },
+            channels,
+            consumer,
+        )
+    }
+
+    // Shared code for the methods above.  `load` returns the contents of
+    // file `i`, or `None` if it read them into the worker's buffer it's
+    // given.
+    fn read<'s, L, T, F>(
+        &self,
+        count: usize,
+        load: L,
+        channels: &[(&str, f64)],
+        consumer: F,
+    ) -> Vec<Result<()>>
+    where
+        L: Fn(usize, &mut Vec<u8>) -> Result<Option<&'s [u8]>> + Sync,
+        T: PixelStruct + Copy + Default + Send,
+        F: Fn(usize, &Header, &[T]) + Sync,
+    {
+        let next = AtomicUsize::new(0);
+        let work = || {
+            let mut worker = Worker::new();
+            let mut results = Vec::new();
+            loop {
+                let i = next.fetch_add(1, Ordering::Relaxed);
+                if i >= count {
+                    break;
+                }
+                let result = worker.read_file(i, &load, channels, &consumer);
+                results.push((i, result));
+            }
+            results
+        };
+
+        let per_worker = if self.threads <= 1 || count <= 1 {
+            vec![work()]
+        } else {
+            thread::scope(|scope| {
+                let workers: Vec<_> = (0..self.threads.min(count))
+                    .map(|_| scope.spawn(&work))
+                    .collect();
+                let mut per_worker = Vec::new();
+                let mut panic = None;
+                for worker in workers {
+                    match worker.join() {
+                        Ok(results) => per_worker.push(results),
+                        Err(e) => panic = Some(e),
+                    }
+                }
+                if let Some(panic) = panic {
+                    panic::resume_unwind(panic);
+                }
+                per_worker
+            })
+        };
+
+        let mut results: Vec<Option<Result<()>>> = (0..count).map(|_| None).collect();
+        for (i, result) in per_worker.into_iter().flatten() {
+            results[i] = Some(result);
+        }
+        results.into_iter().map(|result| result.unwrap()).collect()
+    }
+}
+
+impl Default for BatchReader {
+    fn default() -> BatchReader {
+        BatchReader::new()
+    }
+}
+
+// The resources a worker thread reuses from file to file.
+struct Worker<T> {
+    // A memory istream, or null before the first file and after a file
+    // fails to open (which deletes its istream).
+    istream: *mut CEXR_IStream,
+    contents: Vec<u8>,
+    pixels: Vec<T>,
+}
+
+impl<T: PixelStruct + Copy + Default> Worker<T> {
+    fn new() -> Self {
+        Worker {
+            istream: ptr::null_mut(),
+            contents: Vec::new(),
+            pixels: Vec::new(),
+        }
+    }
+
+    fn read_file<'s, L, F>(
+        &mut self,
+        i: usize,
+        load: &L,
+        channels: &[(&str, f64)],
+        consumer: &F,
+    ) -> Result<()>
+    where
+        L: Fn(usize, &mut Vec<u8>) -> Result<Option<&'s [u8]>>,
+        F: Fn(usize, &Header, &[T]),
+    {
+        let data = match load(i, &mut self.contents)? {
+            Some(data) => data,
+            None => &self.contents[..],
+        };
+        let data_ptr = data.as_ptr() as *mut u8 as *mut c_char;
+        let istream = if self.istream.is_null() {
+            unsafe {
+                CEXR_IStream_from_memory(
+                    b"in-memory data\0".as_ptr() as *const c_char,
+                    data_ptr,
+                    data.len(),
+                )
+            }
+        } else {
+            unsafe { CEXR_IStream_reset_memory(self.istream, data_ptr, data.len()) };
+            self.istream
+        };
+        self.istream = ptr::null_mut();
+
+        let mut file = InputFile::from_istream(istream, InputOptions::new().set_threads(0))?;
+        let (width, height) = file.header().data_dimensions();
+        let (origin_x, origin_y) = file.header().data_origin();
+        self.pixels
+            .resize(width as usize * height as usize, T::default());
+        {
+            let mut fb = FrameBufferMut::new_with_origin(origin_x, origin_y, width, height);
+            fb.insert_channels(channels, &mut self.pixels);
+            file.read_pixels(&mut fb)?;
+        }
+        consumer(i, file.header(), &self.pixels);
+        self.istream = file.into_istream();
+        Ok(())
+    }
+}
+
+impl<T> Drop for Worker<T> {
+    fn drop(&mut self) {
+        if !self.istream.is_null() {
+            unsafe { CEXR_IStream_delete(self.istream) };
+        }
+    }
+}
@@ -0,0 +1,509 @@
+use std::collections::HashMap;
+use std::fs::{self, File, Metadata};
+use std::path::{Path, PathBuf};
+use std::ptr;
+use std::time::{Duration, UNIX_EPOCH};
+
+use libc::c_char;
+
+use openexr_sys::*;
+
+use error::*;
+
+use super::{mmap_istream, InputFile, InputOptions};
+
+// Identifies serialized chunk indices, followed by a format version.
+const MAGIC: &[u8; 8] = b"EXRCHIDX";
+const VERSION: u32 = 1;
+
+/// Where one chunk of a scanline file is stored.
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct ChunkLocation {
+    /// The chunk's first scanline, in the same coordinates as the data
+    /// window.
+    pub first_scanline: i32,
+    /// The chunk's offset from the start of the file, in bytes.
+    pub offset: u64,
+    /// The chunk's size in bytes, including its scanline and size fields.
+    pub size: u64,
+}
+
+/// The header, offset table and chunk locations of a scanline file, for
+/// opening it again without reading them.
+///
+/// Opening a file reads and parses its header and offset table, which can
+/// be slow when the same file is opened over and over on high-latency
+/// storage.  A `ChunkIndex` keeps a copy of their bytes, along with the
+/// file's size and modification time, and `open()` serves them from memory
+/// so that only the chunks themselves are read from the file.  OpenEXR
+/// still parses the copy, since it has no way to be handed a parsed header,
+/// but that doesn't touch the storage.
+///
+/// Indices can be saved with `to_bytes()` and loaded with `from_bytes()`,
+/// and `ChunkIndexCache` keeps track of them by path.
+///
+/// Only single-part scanline files are supported.
+///
+/// # Examples
+///
+/// ```no_run
+/// # use openexr::input::ChunkIndex;
+/// #
+/// let index = ChunkIndex::build("plate.0001.exr").unwrap();
+/// for chunk in index.chunks().iter().filter_map(|chunk| *chunk) {
+///     println!("{}: {} bytes at {}", chunk.first_scanline, chunk.size, chunk.offset);
+/// }
+///
+/// // Later, without reading the header again.
+/// let input_file = unsafe { index.open("plate.0001.exr") }.unwrap();
+/// ```
+#[derive(Debug, Clone, PartialEq)]
+pub struct ChunkIndex {
+    len: u64,
+    modified: Option<Duration>,
+    prefix: Vec<u8>,
+    chunks: Vec<Option<ChunkLocation>>,
+}
+
+impl ChunkIndex {
+    /// Builds the index of the file at `path`.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if this isn't a single-part scanline file, or if
+    /// there is an I/O error.
+    pub fn build<P: AsRef<Path>>(path: P) -> Result<ChunkIndex> {
+        let path = path.as_ref();
+        let metadata = file_metadata(path)?;
+        let mut reader = File::open(path)
+            .map_err(|e| Error::Generic(format!("couldn't open {}: {}", path.display(), e)))?;
+        let mut file = InputFile::new(&mut reader)?;
+        ChunkIndex::from_file(&mut file, &metadata)
+    }
+
+    // Builds the index of `file`, which was opened from a file with
+    // `metadata`.
+    fn from_file(file: &mut InputFile, metadata: &Metadata) -> Result<ChunkIndex> {
+        let (table_end, chunks) = file.chunk_table()?;
+        let mut prefix = vec![0u8; table_end as usize];
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_IStream_read_at(
+                file.istream,
+                0,
+                prefix.as_mut_ptr() as *mut c_char,
+                prefix.len(),
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            return Err(Error::take(error_out));
+        }
+
+        Ok(ChunkIndex {
+            len: metadata.len(),
+            modified: modified_since_epoch(metadata),
+            prefix: prefix,
+            chunks: chunks,
+        })
+    }
+
+    /// Returns where each of the file's chunks is stored, in order from the
+    /// top of the data window, or `None` for chunks that were missing when
+    /// the index was built.
+    ///
+    /// See `InputFile::chunk_locations()`.
+    pub fn chunks(&self) -> &[Option<ChunkLocation>] {
+        &self.chunks
+    }
+
+    /// Returns whether all of the file's chunks were present when the index
+    /// was built.
+    pub fn is_complete(&self) -> bool {
+        self.chunks.iter().all(|chunk| chunk.is_some())
+    }
+
+    /// Returns the size in bytes of the file's header and offset table,
+    /// which the index holds a copy of.
+    pub fn header_size(&self) -> u64 {
+        self.prefix.len() as u64
+    }
+
+    /// Returns whether the file at `path` still has the size and modification
+    /// time it had when the index was built.
+    pub fn is_current<P: AsRef<Path>>(&self, path: P) -> bool {
+        match fs::metadata(path) {
+            Ok(metadata) => self.matches(&metadata),
+            Err(_) => false,
+        }
+    }
+
+    fn matches(&self, metadata: &Metadata) -> bool {
+        metadata.len() == self.len && modified_since_epoch(metadata) == self.modified
+    }
+
+    /// Opens the file at `path`, using the index's copy of its header and
+    /// offset table.
+    ///
+    /// The file is memory mapped, as with `InputFile::from_path_mmap()`.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the file's size or modification time have changed
+    /// since the index was built, or if there is an I/O error.
+    ///
+    /// # Safety
+    ///
+    /// As with `InputFile::from_path_mmap()`.
+    pub unsafe fn open<P: AsRef<Path>>(&self, path: P) -> Result<InputFile<'static>> {
+        self.open_with_options(path, &InputOptions::new())
+    }
+
+    /// Opens the file at `path`, using the index's copy of its header and
+    /// offset table and the given `options`.
+    ///
+    /// See `open()` for details.
+    ///
+    /// # Safety
+    ///
+    /// As with `InputFile::from_path_mmap()`.
+    pub unsafe fn open_with_options<P: AsRef<Path>>(
+        &self,
+        path: P,
+        options: &InputOptions,
+    ) -> Result<InputFile<'static>> {
+        let path = path.as_ref();
+        if !self.matches(&file_metadata(path)?) {
+            return Err(Error::Generic(format!(
+                "chunk index is out of date for {}",
+                path.display()
+            )));
+        }
+        self.open_unchecked(path, options)
+    }
+
+    // Safety: as with `InputFile::from_path_mmap()`.
+    unsafe fn open_unchecked(
+        &self,
+        path: &Path,
+        options: &InputOptions,
+    ) -> Result<InputFile<'static>> {
+        let istream_ptr = CEXR_IStream_with_prefix(
+            mmap_istream(path)?,
+            self.prefix.as_ptr() as *const c_char,
+            self.prefix.len(),
+        );
+        InputFile::from_istream(istream_ptr, options)
+    }
+
+    /// Serializes the index, for `from_bytes()`.
+    pub fn to_bytes(&self) -> Vec<u8> {
+        let mut out = MAGIC.to_vec();
+        write_u32(&mut out, VERSION);
+        self.write_to(&mut out);
+        out
+    }
+
+    /// Deserializes an index from `to_bytes()`.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if `bytes` isn't a serialized index of this version.
+    pub fn from_bytes(bytes: &[u8]) -> Result<ChunkIndex> {
+        let mut reader = ByteReader::new(bytes)?;
+        let index = ChunkIndex::read_from(&mut reader)?;
+        reader.finish()?;
+        Ok(index)
+    }
+
+    fn write_to(&self, out: &mut Vec<u8>) {
+        write_u64(out, self.len);
+        match self.modified {
+            Some(modified) => {
+                out.push(1);
+                write_u64(out, modified.as_secs());
+                write_u32(out, modified.subsec_nanos());
+            }
+            None => out.push(0),
+        }
+        write_u64(out, self.prefix.len() as u64);
+        out.extend_from_slice(&self.prefix);
+        write_u64(out, self.chunks.len() as u64);
+        for chunk in &self.chunks {
+            match *chunk {
+                Some(chunk) => {
+                    out.push(1);
+                    write_u32(out, chunk.first_scanline as u32);
+                    write_u64(out, chunk.offset);
+                    write_u64(out, chunk.size);
+                }
+                None => out.push(0),
+            }
+        }
+    }
+
+    fn read_from(reader: &mut ByteReader) -> Result<ChunkIndex> {
+        let len = reader.u64()?;
+        let modified = if reader.flag()? {
+            let secs = reader.u64()?;
+            let nanos = reader.u32()?;
+            if nanos >= 1_000_000_000 {
+                return Err(invalid_data());
+            }
+            Some(Duration::new(secs, nanos))
+        } else {
+            None
+        };
+        let prefix_len = reader.u64()?;
+        let prefix = reader.bytes(prefix_len)?.to_vec();
+        let count = reader.u64()?;
+        let mut chunks = Vec::new();
+        for _ in 0..count {
+            chunks.push(if reader.flag()? {
+                Some(ChunkLocation {
+                    first_scanline: reader.u32()? as i32,
+                    offset: reader.u64()?,
+                    size: reader.u64()?,
+                })
+            } else {
+                None
+            });
+        }
+        Ok(ChunkIndex {
+            len: len,
+            modified: modified,
+            prefix: prefix,
+            chunks: chunks,
+        })
+    }
+}
+
+/// Chunk indices of files, by path, for opening files repeatedly without
+/// reading their headers each time.
+///
+/// `open()` uses the file's index if it's still current, and otherwise
+/// opens it as usual and indexes it for next time.  The whole cache can be
+/// saved with `to_bytes()` and loaded with `from_bytes()`, for example to
+/// keep it across runs.
+///
+/// # Examples
+///
+/// ```no_run
+/// # use openexr::input::ChunkIndexCache;
+/// #
+/// let mut cache = ChunkIndexCache::new();
+/// for _ in 0..3 {
+///     // Only the first open reads the header from the file.
+///     let input_file = unsafe { cache.open("plate.0001.exr") }.unwrap();
+/// }
+/// std::fs::write("plates.idx", cache.to_bytes()).unwrap();
+/// ```
+#[derive(Debug, Clone, Default)]
+pub struct ChunkIndexCache {
+    indices: HashMap<PathBuf, ChunkIndex>,
+}
+
+impl ChunkIndexCache {
+    /// Creates an empty cache.
+    pub fn new() -> Self {
+        ChunkIndexCache {
+            indices: HashMap::new(),
+        }
+    }
+
+    /// Opens the file at `path`, using its index if the cache has a current
+    /// one.
+    ///
+    /// Otherwise the file is opened from scratch and its index is added to
+    /// the cache, replacing any out of date one.  Files that can't be
+    /// indexed, such as tiled files, are opened but not added.  Files are
+    /// memory mapped, as with `InputFile::from_path_mmap()`.
+    ///
+    /// Indexing reads the start of each chunk to check the offset table, so
+    /// the first open of a file costs a little more than usual.
+    ///
+    /// # Safety
+    ///
+    /// As with `InputFile::from_path_mmap()`.
+    pub unsafe fn open<P: AsRef<Path>>(&mut self, path: P) -> Result<InputFile<'static>> {
+        self.open_with_options(path, &InputOptions::new())
+    }
+
+    /// Opens the file at `path` with the given `options`, using its index if
+    /// the cache has a current one.
+    ///
+    /// See `open()` for details.
+    ///
+    /// # Safety
+    ///
+    /// As with `InputFile::from_path_mmap()`.
+    pub unsafe fn open_with_options<P: AsRef<Path>>(
+        &mut self,
+        path: P,
+        options: &InputOptions,
+    ) -> Result<InputFile<'static>> {
+        let path = path.as_ref();
+        let metadata = file_metadata(path)?;
+        if let Some(index) = self.indices.get(path) {
+            if index.matches(&metadata) {
+                return index.open_unchecked(path, options);
+            }
+        }
+
+        self.indices.remove(path);
+        let mut file = InputFile::from_path_mmap_with_options(path, options)?;
+        if let Ok(index) = ChunkIndex::from_file(&mut file, &metadata) {
+            self.indices.insert(path.to_path_buf(), index);
+        }
+        Ok(file)
+    }
+
+    /// Returns the index for `path`, if there is one, whether or not it's
+    /// current.
+    pub fn get<P: AsRef<Path>>(&self, path: P) -> Option<&ChunkIndex> {
+        self.indices.get(path.as_ref())
+    }
+
+    /// Adds the index for `path`, replacing any previous one.
+    pub fn insert<P: Into<PathBuf>>(&mut self, path: P, index: ChunkIndex) {
+        self.indices.insert(path.into(), index);
+    }
+
+    /// Removes the index for `path`, returning it if there was one.
+    pub fn remove<P: AsRef<Path>>(&mut self, path: P) -> Option<ChunkIndex> {
+        self.indices.remove(path.as_ref())
+    }
+
+    /// Returns the number of indices in the cache.
+    pub fn len(&self) -> usize {
+        self.indices.len()
+    }
+
+    /// Returns whether the cache is empty.
+    pub fn is_empty(&self) -> bool {
+        self.indices.is_empty()
+    }
+
+    /// Removes all indices.
+    pub fn clear(&mut self) {
+        self.indices.clear();
+    }
+
+    /// Serializes the cache, for `from_bytes()`.
+    ///
+    /// Indices of paths that aren't valid UTF-8 are left out.
+    pub fn to_bytes(&self) -> Vec<u8> {
+        let entries: Vec<_> = self
+            .indices
+            .iter()
+            .filter_map(|(path, index)| path.to_str().map(|path| (path, index)))
+            .collect();
+
+        let mut out = MAGIC.to_vec();
+        write_u32(&mut out, VERSION);
+        write_u64(&mut out, entries.len() as u64);
+        for (path, index) in entries {
+            write_u64(&mut out, path.len() as u64);
+            out.extend_from_slice(path.as_bytes());
+            index.write_to(&mut out);
+        }
+        out
+    }
+
+    /// Deserializes a cache from `to_bytes()`.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if `bytes` isn't a serialized cache of this version.
+    pub fn from_bytes(bytes: &[u8]) -> Result<ChunkIndexCache> {
+        let mut reader = ByteReader::new(bytes)?;
+        let mut cache = ChunkIndexCache::new();
+        for _ in 0..reader.u64()? {
+            let path_len = reader.u64()?;
+            let path =
+                String::from_utf8(reader.bytes(path_len)?.to_vec()).map_err(|_| invalid_data())?;
+            let index = ChunkIndex::read_from(&mut reader)?;
+            cache.indices.insert(PathBuf::from(path), index);
+        }
+        reader.finish()?;
+        Ok(cache)
+    }
+}
+
+fn file_metadata(path: &Path) -> Result<Metadata> {
+    fs::metadata(path)
+        .map_err(|e| Error::Generic(format!("couldn't read {}: {}", path.display(), e)))
+}
+
+fn modified_since_epoch(metadata: &Metadata) -> Option<Duration> {
+    metadata
+        .modified()
+        .ok()
+        .and_then(|modified| modified.duration_since(UNIX_EPOCH).ok())
+}
+
+fn write_u32(out: &mut Vec<u8>, value: u32) {
+    out.extend_from_slice(&value.to_le_bytes());
+}
+
+fn write_u64(out: &mut Vec<u8>, value: u64) {
+    out.extend_from_slice(&value.to_le_bytes());
+}
+
+fn invalid_data() -> Error {
+    Error::Generic("invalid chunk index data".to_string())
+}
+
+// Reads the little-endian values written by the functions above, after
+// checking the magic number and version.
+struct ByteReader<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> ByteReader<'a> {
+    fn new(data: &'a [u8]) -> Result<ByteReader<'a>> {
+        let mut reader = ByteReader { data: data };
+        if reader.bytes(MAGIC.len() as u64)? != &MAGIC[..] || reader.u32()? != VERSION {
+            return Err(invalid_data());
+        }
+        Ok(reader)
+    }
+
+    fn bytes(&mut self, n: u64) -> Result<&'a [u8]> {
+        if n > self.data.len() as u64 {
+            return Err(invalid_data());
+        }
+        let (bytes, rest) = self.data.split_at(n as usize);
+        self.data = rest;
+        Ok(bytes)
+    }
+
+    fn flag(&mut self) -> Result<bool> {
+        match self.bytes(1)?[0] {
+            0 => Ok(false),
+            1 => Ok(true),
+            _ => Err(invalid_data()),
+        }
+    }
+
+    fn u32(&mut self) -> Result<u32> {
+        let mut bytes = [0; 4];
+        bytes.copy_from_slice(self.bytes(4)?);
+        Ok(u32::from_le_bytes(bytes))
+    }
+
+    fn u64(&mut self) -> Result<u64> {
+        let mut bytes = [0; 8];
+        bytes.copy_from_slice(self.bytes(8)?);
+        Ok(u64::from_le_bytes(bytes))
+    }
+
+    // Checks that all of the data was read.
+    fn finish(self) -> Result<()> {
+        if self.data.is_empty() {
+            Ok(())
+        } else {
+            Err(invalid_data())
+        }
+    }
+}
@@ -0,0 +1,378 @@
+use std::io::{Read, Seek};
+use std::marker::PhantomData;
+use std::path::Path;
+use std::ptr;
+
+use libc::c_char;
+
+use openexr_sys::*;
+
+use deep_frame_buffer::{DeepFrameBufferHandle, DeepFrameBufferMut};
+use error::*;
+use stream_io::{read_stream, seek_stream};
+use threads::c_thread_count;
+use Header;
+
+use super::{mmap_istream, InputOptions};
+
+/// Reads deep scanline OpenEXR files.
+///
+/// Deep files store a varying number of samples per pixel, e.g. one per
+/// surface a camera ray passed through.  Reading them is a two step
+/// process: first the number of samples of each pixel is read with
+/// `read_sample_counts()`, and then, once there is memory to hold them, the
+/// samples themselves are read with `read_pixels()` into a
+/// `DeepFrameBufferMut` built from those sample counts.  See the
+/// [`deep_frame_buffer`](../deep_frame_buffer/index.html) module for
+/// how the samples are laid out in memory.
+///
+/// # Examples
+///
+/// Load the depth samples of a deep file named "input_file.exr".
+///
+/// ```no_run
+/// # use openexr::{DeepFrameBufferMut, DeepScanlineInputFile};
+/// #
+/// let mut file = std::fs::File::open("input_file.exr").unwrap();
+/// let mut input_file = DeepScanlineInputFile::new(&mut file).unwrap();
+/// let (width, height) = input_file.header().data_dimensions();
+///
+/// // Find out how many samples each pixel has.
+/// let mut sample_counts = vec![0u32; (width * height) as usize];
+/// input_file.read_sample_counts(0, &mut sample_counts).unwrap();
+///
+/// // Allocate one buffer for all of the samples and read them in.
+/// let total_samples = sample_counts.iter().map(|&n| n as usize).sum();
+/// let mut depths = vec![0.0f32; total_samples];
+/// let mut fb = DeepFrameBufferMut::new(width, height, &sample_counts);
+/// fb.insert_channel("Z", 0.0, &mut depths);
+/// input_file.read_pixels(&mut fb).unwrap();
+/// ```
+#[allow(dead_code)]
+pub struct DeepScanlineInputFile<'a> {
+    handle: *mut CEXR_DeepScanLineInputFile,
+    header_ref: Header,
+    istream: *mut CEXR_IStream,
+    _phantom_1: PhantomData<CEXR_DeepScanLineInputFile>,
+    _phantom_2: PhantomData<&'a mut ()>, // Represents the borrowed reader
+
+                                         // NOTE: Because we don't know what type the reader might be, it's important
+                                         // that this struct remains neither Sync nor Send.  Please don't implement
+                                         // them!
+}
+
+impl<'a> DeepScanlineInputFile<'a> {
+    /// Creates a new `DeepScanlineInputFile` from any `Read + Seek` type
+    /// (typically a `std::fs::File`).
+    ///
+    /// Note: this seeks to byte 0 before reading.
+    pub fn new<T: 'a>(reader: &'a mut T) -> Result<DeepScanlineInputFile<'a>>
+    where
+        T: Read + Seek,
+    {
+        DeepScanlineInputFile::new_with_options(reader, &InputOptions::new())
+    }
+
+    /// Creates a new `DeepScanlineInputFile` from any `Read + Seek` type
+    /// (typically a `std::fs::File`), using the given `options`.
+    ///
+    /// Note: this seeks to byte 0 before reading.
+    pub fn new_with_options<T: 'a>(
+        reader: &'a mut T,
+        options: &InputOptions,
+    ) -> Result<DeepScanlineInputFile<'a>>
+    where
+        T: Read + Seek,
+    {
+        let istream_ptr = {
+            let read_ptr = read_stream::<T>;
+            let seekp_ptr = seek_stream::<T>;
+
+            let mut error_out = ptr::null();
+            let mut out = ptr::null_mut();
+            let error = unsafe {
+                CEXR_IStream_from_reader(
+                    reader as *mut T as *mut _,
+                    Some(read_ptr),
+                    Some(seekp_ptr),
+                    options.buffer_size,
+                    &mut out,
+                    &mut error_out,
+                )
+            };
+
+            if error != 0 {
+                return Err(Error::take(error_out));
+            } else {
+                out
+            }
+        };
+
+        DeepScanlineInputFile::from_istream(istream_ptr, options)
+    }
+
+    /// Creates a new `DeepScanlineInputFile` from a slice of bytes, reading
+    /// from memory.
+    pub fn from_slice(slice: &'a [u8]) -> Result<DeepScanlineInputFile<'a>> {
+        DeepScanlineInputFile::from_slice_with_options(slice, &InputOptions::new())
+    }
+
+    /// Creates a new `DeepScanlineInputFile` from a slice of bytes, reading
+    /// from memory, using the given `options`.
+    pub fn from_slice_with_options(
+        slice: &'a [u8],
+        options: &InputOptions,
+    ) -> Result<DeepScanlineInputFile<'a>> {
+        let istream_ptr = unsafe {
+            CEXR_IStream_from_memory(
+                b"in-memory data\0".as_ptr() as *const c_char,
+                slice.as_ptr() as *mut u8 as *mut c_char,
+                slice.len(),
+            )
+        };
+
+        DeepScanlineInputFile::from_istream(istream_ptr, options)
+    }
+
+    /// Creates a new `DeepScanlineInputFile` by memory mapping the file at
+    /// `path`.
+    ///
+    /// See `InputFile::from_path_mmap()` for details.
+    ///
+    /// # Safety
+    ///
+    /// As with `InputFile::from_path_mmap()`.
+    pub unsafe fn from_path_mmap<P: AsRef<Path>>(
+        path: P,
+    ) -> Result<DeepScanlineInputFile<'static>> {
+        DeepScanlineInputFile::from_path_mmap_with_options(path, &InputOptions::new())
+    }
+
+    /// Creates a new `DeepScanlineInputFile` by memory mapping the file at
+    /// `path`, using the given `options`.
+    ///
+    /// See `InputFile::from_path_mmap()` for details.
+    ///
+    /// # Safety
+    ///
+    /// As with `InputFile::from_path_mmap()`.
+    pub unsafe fn from_path_mmap_with_options<P: AsRef<Path>>(
+        path: P,
+        options: &InputOptions,
+    ) -> Result<DeepScanlineInputFile<'static>> {
+        let istream_ptr = mmap_istream(path.as_ref())?;
+        DeepScanlineInputFile::from_istream(istream_ptr, options)
+    }
+
+    // Shared code for the constructors above.  Takes ownership of
+    // `istream_ptr`, deleting it if the file can't be opened.
+    fn from_istream(
+        istream_ptr: *mut CEXR_IStream,
+        options: &InputOptions,
+    ) -> Result<DeepScanlineInputFile<'a>> {
+        let threads = match c_thread_count(options.threads) {
+            Ok(threads) => threads,
+            Err(e) => {
+                unsafe { CEXR_IStream_delete(istream_ptr) };
+                return Err(e);
+            }
+        };
+
+        let mut error_out = ptr::null();
+        let mut out = ptr::null_mut();
+        let error = unsafe {
+            CEXR_DeepScanLineInputFile_from_stream(istream_ptr, threads, &mut out, &mut error_out)
+        };
+        if error != 0 {
+            unsafe { CEXR_IStream_delete(istream_ptr) };
+            Err(Error::take(error_out))
+        } else {
+            Ok(DeepScanlineInputFile {
+                handle: out,
+                header_ref: Header::borrowed(unsafe { CEXR_DeepScanLineInputFile_header(out) }),
+                istream: istream_ptr,
+                _phantom_1: PhantomData,
+                _phantom_2: PhantomData,
+            })
+        }
+    }
+
+    /// Reads the number of samples of each pixel of a contiguous chunk of
+    /// scanlines into `sample_counts`.
+    ///
+    /// Scanlines are read starting at `starting_scanline`, and
+    /// `sample_counts` is filled in scanline order, so its length must be a
+    /// multiple of the image width.  To read the sample counts of the whole
+    /// image, pass a starting scanline of 0 and width * height elements.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if `sample_counts` is empty or isn't a multiple of
+    /// the image width, if there aren't enough scanlines starting at
+    /// `starting_scanline` to fill it, or if there is an I/O error.
+    pub fn read_sample_counts(
+        &mut self,
+        starting_scanline: u32,
+        sample_counts: &mut [u32],
+    ) -> Result<()> {
+        let width = self.header().data_dimensions().0;
+        if sample_counts.is_empty() || sample_counts.len() % width as usize != 0 {
+            return Err(Error::Generic(format!(
+                "{} sample counts are not a whole number of \
+                 {}-pixel scanlines",
+                sample_counts.len(),
+                width
+            )));
+        }
+        let rows = (sample_counts.len() / width as usize) as u32;
+        let (start, end) = self.scanline_range(starting_scanline, rows)?;
+
+        let framebuffer = DeepFrameBufferHandle::with_sample_counts(
+            sample_counts.as_mut_ptr(),
+            width,
+            (self.header().data_origin().0, start),
+        );
+        self.set_framebuffer(&framebuffer)?;
+
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_DeepScanLineInputFile_read_pixel_sample_counts(
+                self.handle,
+                start,
+                end,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(())
+        }
+    }
+
+    /// Reads the samples of the entire image into `framebuffer` at once.
+    ///
+    /// `framebuffer` must have been built from the sample counts of the whole
+    /// image, as read by `read_sample_counts()`.  Any channels in
+    /// `framebuffer` that are not present in the file will be filled with
+    /// their default fill value.
+    ///
+    /// # Errors
+    ///
+    /// This function expects `framebuffer` to have the same resolution as the
+    /// file, and for any same-named channels to have matching types.
+    ///
+    /// It will also return an error if there is an I/O error.
+    pub fn read_pixels(&mut self, framebuffer: &mut DeepFrameBufferMut) -> Result<()> {
+        if self.header().data_dimensions() != framebuffer.dimensions() {
+            return Err(Error::Generic(format!(
+                "framebuffer size {}x{} does not match \
+                 image dimensions {}x{}",
+                framebuffer.dimensions().0,
+                framebuffer.dimensions().1,
+                self.header().data_dimensions().0,
+                self.header().data_dimensions().1
+            )));
+        }
+
+        self.read_pixels_partial(0, framebuffer)
+    }
+
+    /// Reads the samples of a contiguous chunk of scanlines into
+    /// `framebuffer`.
+    ///
+    /// `framebuffer` may have a different vertical resolution than the image,
+    /// but must have the same horizontal resolution, and must have been built
+    /// from the sample counts of the same scanlines, as read by
+    /// `read_sample_counts()`.  Scanlines are read from the image starting at
+    /// `starting_scanline` until `framebuffer` is filled.
+    ///
+    /// # Errors
+    ///
+    /// This function expects `framebuffer` to have the same _horizontal_
+    /// resolution as the file, and for any same-named channels to have
+    /// matching types.
+    ///
+    /// It will also return an error if:
+    ///
+    /// * There aren't enough scanlines starting at `starting_scanline` to fill
+    ///   `framebuffer`.
+    /// * There is an I/O error.
+    pub fn read_pixels_partial(
+        &mut self,
+        starting_scanline: u32,
+        framebuffer: &mut DeepFrameBufferMut,
+    ) -> Result<()> {
+        // Validation
+        if self.header().data_dimensions().0 != framebuffer.dimensions().0 {
+            return Err(Error::Generic(format!(
+                "framebuffer width {} does not match\
+                 image width {}",
+                framebuffer.dimensions().0,
+                self.header().data_dimensions().0
+            )));
+        }
+        let (start, end) = self.scanline_range(starting_scanline, framebuffer.dimensions().1)?;
+        self.header()
+            .validate_deep_framebuffer_for_input(framebuffer)?;
+
+        // Set up the framebuffer with the image
+        let c_framebuffer = framebuffer.build((self.header().data_origin().0, start));
+        self.set_framebuffer(&c_framebuffer)?;
+
+        // Read the image data
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_DeepScanLineInputFile_read_pixels(self.handle, start, end, &mut error_out)
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(())
+        }
+    }
+
+    /// Access to the file's header.
+    pub fn header(&self) -> &Header {
+        &self.header_ref
+    }
+
+    // Returns the first and last scanline, in data window coordinates, of
+    // `rows` scanlines starting at `starting_scanline`, checking that they're
+    // in the image.
+    fn scanline_range(&self, starting_scanline: u32, rows: u32) -> Result<(i32, i32)> {
+        let height = self.header().data_dimensions().1;
+        if starting_scanline >= height || rows > height - starting_scanline {
+            return Err(Error::Generic(format!(
+                "cannot read {} scanlines starting at \
+                 scanline {} of a {}-scanline image",
+                rows, starting_scanline, height
+            )));
+        }
+        let start = self.header().data_origin().1 + starting_scanline as i32;
+        Ok((start, start + rows as i32 - 1))
+    }
+
+    fn set_framebuffer(&mut self, framebuffer: &DeepFrameBufferHandle) -> Result<()> {
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_DeepScanLineInputFile_set_framebuffer(
+                self.handle,
+                framebuffer.handle(),
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(())
+        }
+    }
+}
+
+impl<'a> Drop for DeepScanlineInputFile<'a> {
+    fn drop(&mut self) {
+        unsafe { CEXR_DeepScanLineInputFile_delete(self.handle) };
+        unsafe { CEXR_IStream_delete(self.istream) };
+    }
+}
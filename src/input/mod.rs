@@ -1,17 +1,120 @@
 //! Input file types.
 
+use std::ffi::CString;
 use std::io::{Read, Seek};
 use std::marker::PhantomData;
-use std::ptr;
+use std::path::Path;
+use std::sync::mpsc;
+use std::time::Instant;
+use std::{mem, panic, ptr, slice, thread};
 
-use libc::c_char;
+use libc::{c_char, c_int};
 
 use openexr_sys::*;
 
+use cexr_type_aliases::Box2i;
 use error::*;
-use frame_buffer::FrameBufferMut;
+use frame_buffer::{FrameBufferCache, FrameBufferMut, FrameBufferUpdate, PixelStruct};
+use stats::{IoStats, PixelStats};
 use stream_io::{read_stream, seek_stream};
-use Header;
+use threads::c_thread_count;
+use {Header, PreviewImage};
+
+mod batch_reader;
+mod chunk_index;
+mod deep_scanline_input_file;
+mod multipart_input_file;
+mod parallel_reader;
+mod progressive_reader;
+mod sequence_loader;
+mod tiled_input_file;
+
+pub use self::batch_reader::BatchReader;
+pub use self::chunk_index::{ChunkIndex, ChunkIndexCache, ChunkLocation};
+pub use self::deep_scanline_input_file::DeepScanlineInputFile;
+pub use self::multipart_input_file::MultiPartInputFile;
+pub use self::parallel_reader::ParallelReader;
+pub use self::progressive_reader::ProgressiveReader;
+pub use self::sequence_loader::{Frame, SequenceLoader, SequenceOptions};
+pub use self::tiled_input_file::TiledInputFile;
+
+// The minimum number of scanlines `InputFile` decodes at a time when it has
+// to go through temporary buffers, for region reads and conversions.  Rounded up to a
+// multiple of the file's scanlines per chunk.
+const REGION_BATCH_ROWS: u32 = 32;
+
+/// Options for opening input files.
+///
+/// This follows the builder pattern: create it with `new()`, adjust it with
+/// the `set_*()` methods, and pass it to one of the `*_with_options()`
+/// constructors of the input file types.
+///
+/// # Examples
+///
+/// Open a file with eight decoding threads:
+///
+/// ```no_run
+/// # use openexr::InputFile;
+/// # use openexr::input::InputOptions;
+/// #
+/// let mut file = std::fs::File::open("input_file.exr").unwrap();
+/// let input_file =
+///     InputFile::new_with_options(&mut file, InputOptions::new().set_threads(8)).unwrap();
+/// ```
+#[derive(Debug, Copy, Clone)]
+pub struct InputOptions {
+    pub(crate) threads: usize,
+    pub(crate) buffer_size: usize,
+}
+
+impl InputOptions {
+    /// Creates a new set of input options with default settings.
+    pub fn new() -> Self {
+        InputOptions {
+            threads: 1,
+            buffer_size: DEFAULT_BUFFER_SIZE,
+        }
+    }
+
+    /// Sets the number of threads used to decode the file.
+    ///
+    /// This is how many scanline blocks or tiles OpenEXR will decompress
+    /// concurrently when reading this particular file.  The default is 1.
+    /// If set to `0`, all decoding happens on the calling thread.
+    ///
+    /// Note that the work itself is run on OpenEXR's global thread pool, so
+    /// the effective parallelism is also limited by the size of that pool.
+    /// See the [threads](../threads/index.html) module for details.
+    pub fn set_threads(&mut self, threads: usize) -> &mut Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Sets the size in bytes of the read-ahead buffer used when reading
+    /// through a `Read + Seek` type.
+    ///
+    /// OpenEXR does many small reads, particularly when parsing the header
+    /// and offset tables.  These are served from the buffer, so the reader
+    /// only sees a few large reads, which matters when each read is
+    /// expensive (e.g. over a network file system).  Reads at least as large
+    /// as the buffer bypass it.  The default is 64 KiB, and `0` disables
+    /// buffering.
+    ///
+    /// This has no effect on files read from memory.
+    pub fn set_buffer_size(&mut self, buffer_size: usize) -> &mut Self {
+        self.buffer_size = buffer_size;
+        self
+    }
+}
+
+impl Default for InputOptions {
+    fn default() -> InputOptions {
+        InputOptions::new()
+    }
+}
+
+// Default size of the read-ahead buffer, in bytes.
+const DEFAULT_BUFFER_SIZE: usize = 64 * 1024;
 
 /// Reads any kind of OpenEXR file.
 ///
@@ -21,8 +124,8 @@ use Header;
 ///
 /// Special features like tiles, mipmaps, and deep image data will not be
 /// available even if they are present in the file.  To gain access to those
-/// features you need to use the other input file types (not yet implemented,
-/// sorry!).
+/// features you need to use the other input file types, such as
+/// `TiledInputFile`.
 ///
 /// # Examples
 ///
@@ -47,6 +150,8 @@ pub struct InputFile<'a> {
     handle: *mut CEXR_InputFile,
     header_ref: Header,
     istream: *mut CEXR_IStream,
+    framebuffer_cache: FrameBufferCache,
+    pixel_stats: PixelStats,
     _phantom_1: PhantomData<CEXR_InputFile>,
     _phantom_2: PhantomData<&'a mut ()>, // Represents the borrowed reader
 
@@ -61,6 +166,20 @@ impl<'a> InputFile<'a> {
     ///
     /// Note: this seeks to byte 0 before reading.
     pub fn new<T: 'a>(reader: &mut T) -> Result<InputFile>
+    where
+        T: Read + Seek,
+    {
+        InputFile::new_with_options(reader, &InputOptions::new())
+    }
+
+    /// Creates a new `InputFile` from any `Read + Seek` type (typically a
+    /// `std::fs::File`), using the given `options`.
+    ///
+    /// Note: this seeks to byte 0 before reading.
+    pub fn new_with_options<T: 'a>(
+        reader: &'a mut T,
+        options: &InputOptions,
+    ) -> Result<InputFile<'a>>
     where
         T: Read + Seek,
     {
@@ -75,6 +194,7 @@ impl<'a> InputFile<'a> {
                     reader as *mut T as *mut _,
                     Some(read_ptr),
                     Some(seekp_ptr),
+                    options.buffer_size,
                     &mut out,
                     &mut error_out,
                 )
@@ -87,27 +207,7 @@ impl<'a> InputFile<'a> {
             }
         };
 
-        let mut error_out = ptr::null();
-        let mut out = ptr::null_mut();
-        let error = unsafe { CEXR_InputFile_from_stream(istream_ptr, 1, &mut out, &mut error_out) };
-        if error != 0 {
-            Err(Error::take(error_out))
-        } else {
-            Ok(InputFile {
-                handle: out,
-                header_ref: Header {
-                    // NOTE: We're casting to *mut here to satisfy the
-                    // field's type, but importantly we only return a
-                    // const & of the Header so it retains const semantics.
-                    handle: unsafe { CEXR_InputFile_header(out) } as *mut CEXR_Header,
-                    owned: false,
-                    _phantom: PhantomData,
-                },
-                istream: istream_ptr,
-                _phantom_1: PhantomData,
-                _phantom_2: PhantomData,
-            })
-        }
+        InputFile::from_istream(istream_ptr, options)
     }
 
     /// Creates a new `InputFile` from a slice of bytes, reading from memory.
@@ -117,6 +217,15 @@ impl<'a> InputFile<'a> {
     /// efficient because it allows the underlying APIs to avoid reading data
     /// into intermediate buffers.
     pub fn from_slice(slice: &[u8]) -> Result<InputFile> {
+        InputFile::from_slice_with_options(slice, &InputOptions::new())
+    }
+
+    /// Creates a new `InputFile` from a slice of bytes, reading from memory,
+    /// using the given `options`.
+    pub fn from_slice_with_options(
+        slice: &'a [u8],
+        options: &InputOptions,
+    ) -> Result<InputFile<'a>> {
         let istream_ptr = unsafe {
             CEXR_IStream_from_memory(
                 b"in-memory data\0".as_ptr() as *const c_char,
@@ -125,23 +234,73 @@ impl<'a> InputFile<'a> {
             )
         };
 
+        InputFile::from_istream(istream_ptr, options)
+    }
+
+    /// Creates a new `InputFile` by memory mapping the file at `path`.
+    ///
+    /// The mapping is owned by the returned `InputFile` and released when
+    /// it's dropped.  Compressed data is then read directly from the mapped
+    /// pages, without the intermediate copy that reading through `new()`
+    /// requires, which can be significantly faster for large files on fast
+    /// storage.
+    ///
+    /// # Safety
+    ///
+    /// The file must not be modified or truncated, by this or any other
+    /// process, until the returned `InputFile` is dropped.  OpenEXR reads
+    /// the mapped pages as ordinary memory, and slices returned by methods
+    /// like `raw_pixel_data()` point straight into them, so changes to the
+    /// file are undefined behavior.  On most platforms, accessing the pages
+    /// of a truncated file kills the process.
+    pub unsafe fn from_path_mmap<P: AsRef<Path>>(path: P) -> Result<InputFile<'static>> {
+        InputFile::from_path_mmap_with_options(path, &InputOptions::new())
+    }
+
+    /// Creates a new `InputFile` by memory mapping the file at `path`, using
+    /// the given `options`.
+    ///
+    /// See `from_path_mmap()` for details.
+    ///
+    /// # Safety
+    ///
+    /// As with `from_path_mmap()`.
+    pub unsafe fn from_path_mmap_with_options<P: AsRef<Path>>(
+        path: P,
+        options: &InputOptions,
+    ) -> Result<InputFile<'static>> {
+        let istream_ptr = mmap_istream(path.as_ref())?;
+        InputFile::from_istream(istream_ptr, options)
+    }
+
+    // Shared code for the constructors above.  Takes ownership of
+    // `istream_ptr`, deleting it if the file can't be opened.
+    fn from_istream(
+        istream_ptr: *mut CEXR_IStream,
+        options: &InputOptions,
+    ) -> Result<InputFile<'a>> {
+        let threads = match c_thread_count(options.threads) {
+            Ok(threads) => threads,
+            Err(e) => {
+                unsafe { CEXR_IStream_delete(istream_ptr) };
+                return Err(e);
+            }
+        };
+
         let mut error_out = ptr::null();
         let mut out = ptr::null_mut();
-        let error = unsafe { CEXR_InputFile_from_stream(istream_ptr, 1, &mut out, &mut error_out) };
+        let error =
+            unsafe { CEXR_InputFile_from_stream(istream_ptr, threads, &mut out, &mut error_out) };
         if error != 0 {
+            unsafe { CEXR_IStream_delete(istream_ptr) };
             Err(Error::take(error_out))
         } else {
             Ok(InputFile {
                 handle: out,
-                header_ref: Header {
-                    // NOTE: We're casting to *mut here to satisfy the
-                    // field's type, but importantly we only return a
-                    // const & of the Header so it retains const semantics.
-                    handle: unsafe { CEXR_InputFile_header(out) } as *mut CEXR_Header,
-                    owned: false,
-                    _phantom: PhantomData,
-                },
+                header_ref: Header::borrowed(unsafe { CEXR_InputFile_header(out) }),
                 istream: istream_ptr,
+                framebuffer_cache: FrameBufferCache::new(),
+                pixel_stats: PixelStats::new(),
                 _phantom_1: PhantomData,
                 _phantom_2: PhantomData,
             })
@@ -151,13 +310,15 @@ impl<'a> InputFile<'a> {
     /// Reads the entire image into `framebuffer` at once.
     ///
     /// Any channels in `framebuffer` that are not present in the file will be
-    /// filled with their default fill value.
+    /// filled with their default fill value.  Channels may be read into
+    /// types that opt in to converting from the file's types, e.g. HALF into
+    /// a `f32` newtype; see `PixelData::converts_from()`.
     ///
     /// # Errors
     ///
     /// This function expects `framebuffer` to have the same resolution as the
-    /// file, and for any same-named channels to have matching types and
-    /// subsampling.
+    /// file, and for any same-named channels to have matching (or
+    /// convertible) types and subsampling.
     ///
     /// It will also return an error if there is an I/O error.
     pub fn read_pixels(&mut self, framebuffer: &mut FrameBufferMut) -> Result<()> {
@@ -190,32 +351,12 @@ impl<'a> InputFile<'a> {
             )));
         }
 
-        self.header().validate_framebuffer_for_input(framebuffer)?;
-
-        // Set up the framebuffer with the image
-        let mut error_out = ptr::null();
-
-        let error = unsafe {
-            CEXR_InputFile_set_framebuffer(self.handle, framebuffer.handle_mut(), &mut error_out)
-        };
-        if error != 0 {
-            return Err(Error::take(error_out));
-        }
-
         // Read the image data
-        let error = unsafe {
-            CEXR_InputFile_read_pixels(
-                self.handle,
-                self.header().data_window().min.y,
-                self.header().data_window().max.y,
-                &mut error_out,
-            )
+        let (start_scanline, end_scanline) = {
+            let data_window = self.header().data_window();
+            (data_window.min.y, data_window.max.y)
         };
-        if error != 0 {
-            Err(Error::take(error_out))
-        } else {
-            Ok(())
-        }
+        self.read_scanlines(framebuffer, 0, start_scanline, end_scanline)
     }
 
     /// Reads a contiguous chunk of scanlines into `framebuffer`.
@@ -230,13 +371,14 @@ impl<'a> InputFile<'a> {
     /// 150.
     ///
     /// Any channels in `framebuffer` that are not present in the file will be
-    /// filled with their default fill value.
+    /// filled with their default fill value.  Channels may be converted as
+    /// with `read_pixels()`.
     ///
     /// # Errors
     ///
     /// This function expects `framebuffer` to have the same _horizontal_
     /// resolution as the file, and for any same-named channels to have
-    /// matching types and subsampling.
+    /// matching (or convertible) types and subsampling.
     ///
     /// It will also return an error if:
     ///
@@ -280,49 +422,582 @@ impl<'a> InputFile<'a> {
             )));
         }
 
-        self.header().validate_framebuffer_for_input(framebuffer)?;
-
         // Set up the framebuffer with the image
         let start_scanline = self.header().data_window().min.y + starting_scanline as i32;
         let end_scanline = self.header().data_window().min.y
             + (starting_scanline + framebuffer.dimensions().1) as i32
             - 1;
 
+        // Read the image data
+        self.read_scanlines(framebuffer, starting_scanline, start_scanline, end_scanline)
+    }
+
+    /// Reads just the pixels inside `region` into `framebuffer`.
+    ///
+    /// `region` is given in the same coordinate system as the data window,
+    /// and must be inside it.  `framebuffer` only needs to cover `region`, so
+    /// it's typically created with `FrameBufferMut::new_with_origin()` using
+    /// the region's `min` corner and size.  Only the scanlines that overlap
+    /// `region` are read from the file, and only the channels inserted into
+    /// `framebuffer` are converted, so to read a subset of the channels
+    /// simply leave the others out of it.
+    ///
+    /// Scanline files are always decoded a full scanline at a time, so when
+    /// `region` is narrower than the data window, each batch of scanlines is
+    /// decoded into a temporary buffer before the requested columns are
+    /// copied to `framebuffer`.  Batches are a multiple of
+    /// `Header::scanlines_per_chunk()` so that no compressed chunk is decoded
+    /// more than once.
+    ///
+    /// # Examples
+    ///
+    /// Read the red and alpha channels of a 256x128 crop of an image.
+    ///
+    /// ```no_run
+    /// # use openexr::{FrameBufferMut, Header, InputFile};
+    /// #
+    /// let mut input_file = unsafe { InputFile::from_path_mmap("input_file.exr") }.unwrap();
+    /// let region = Header::box2i(1024, 512, 256, 128);
+    ///
+    /// let mut pixel_data = vec![(0.0f32, 0.0f32); 256 * 128];
+    /// let mut fb = FrameBufferMut::new_with_origin(1024, 512, 256, 128);
+    /// fb.insert_channels(&[("R", 0.0), ("A", 1.0)], &mut pixel_data);
+    /// input_file.read_region(&region, &mut fb).unwrap();
+    /// ```
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if:
+    ///
+    /// * `region` is empty or not inside the data window.
+    /// * `framebuffer` doesn't cover `region`.
+    /// * Any same-named channels in `framebuffer` don't have matching (or
+    ///   convertible) types and subsampling, or `region` is narrower than
+    ///   the data window and `framebuffer` has subsampled channels.
+    /// * There is an I/O error.
+    pub fn read_region(&mut self, region: &Box2i, framebuffer: &mut FrameBufferMut) -> Result<()> {
+        // Validation
+        let data_window = *self.header().data_window();
+        if region.min.x > region.max.x
+            || region.min.y > region.max.y
+            || region.min.x < data_window.min.x
+            || region.min.y < data_window.min.y
+            || region.max.x > data_window.max.x
+            || region.max.y > data_window.max.y
+        {
+            return Err(Error::Generic(format!(
+                "region {},{} to {},{} is not inside \
+                 the data window {},{} to {},{}",
+                region.min.x,
+                region.min.y,
+                region.max.x,
+                region.max.y,
+                data_window.min.x,
+                data_window.min.y,
+                data_window.max.x,
+                data_window.max.y
+            )));
+        }
+        framebuffer.validate_covers(region)?;
+
+        if region.min.x == data_window.min.x && region.max.x == data_window.max.x {
+            // Whole scanlines can be read straight into the framebuffer.
+            return self.read_scanlines(framebuffer, 0, region.min.y, region.max.y);
+        }
+
+        self.header().validate_framebuffer_for_input(framebuffer)?;
+
+        // The C++ side sets its own framebuffer on the file.
+        self.framebuffer_cache.invalidate();
+
+        let started = Instant::now();
         let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_InputFile_read_region(
+                self.handle,
+                framebuffer.handle(),
+                *region,
+                self.region_batch_rows(),
+                &mut error_out,
+            )
+        };
+        self.pixel_stats
+            .record(&self.header_ref, region.min.y, region.max.y, started);
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(())
+        }
+    }
 
+    /// Reads the whole image top to bottom in chunks of `chunk_height`
+    /// scanlines, overlapping decoding with processing.
+    ///
+    /// Each chunk is read into a buffer of pixels of type `T` (with the
+    /// channels given in `channels`, exactly as with
+    /// `FrameBufferMut::insert_channels()`) and handed to `consumer` along
+    /// with the index of its first scanline.  `consumer` runs on a separate
+    /// thread, and while it works on one chunk up to `prefetch` further
+    /// chunks are decoded ahead of it.  Chunk buffers are recycled, so at
+    /// most `prefetch + 2` of them are ever allocated.  The last chunk may
+    /// be shorter than `chunk_height`.
+    ///
+    /// Decoding is more efficient if `chunk_height` is a multiple of
+    /// `Header::scanlines_per_chunk()`, since chunks then never share a
+    /// compressed block.
+    ///
+    /// # Examples
+    ///
+    /// ```no_run
+    /// # use openexr::InputFile;
+    /// #
+    /// let mut file = unsafe { InputFile::from_path_mmap("input_file.exr") }.unwrap();
+    /// let mut sum = 0.0;
+    /// file.read_pixels_prefetched(
+    ///     &[("R", 0.0), ("G", 0.0), ("B", 0.0)],
+    ///     64,
+    ///     2,
+    ///     |_first_scanline, pixels: &[(f32, f32, f32)]| {
+    ///         sum += pixels.iter().map(|p| p.0 + p.1 + p.2).sum::<f32>();
+    ///     },
+    /// ).unwrap();
+    /// ```
+    ///
+    /// # Errors
+    ///
+    /// Returns the first error encountered while decoding, after letting
+    /// `consumer` finish the chunks that were already decoded.  The same
+    /// validation as for `read_pixels_partial()` applies.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `chunk_height` or `prefetch` is zero, and re-raises any
+    /// panic from `consumer`.
+    pub fn read_pixels_prefetched<T, F>(
+        &mut self,
+        channels: &[(&str, f64)],
+        chunk_height: u32,
+        prefetch: usize,
+        mut consumer: F,
+    ) -> Result<()>
+    where
+        T: PixelStruct + Copy + Default + Send,
+        F: FnMut(u32, &[T]) + Send,
+    {
+        assert!(chunk_height > 0, "chunk_height must be at least 1");
+        assert!(prefetch > 0, "prefetch must be at least 1");
+
+        let (width, height) = self.header().data_dimensions();
+        let max_buffers = prefetch + 2;
+
+        // Decoded chunks go to the consumer through `full`, and come back
+        // for reuse through `empty`.
+        let (full_tx, full_rx) = mpsc::sync_channel::<(u32, Vec<T>)>(prefetch);
+        let (empty_tx, empty_rx) = mpsc::channel::<Vec<T>>();
+
+        thread::scope(|scope| {
+            let consumer_thread = scope.spawn(move || {
+                for (first_scanline, buffer) in full_rx {
+                    consumer(first_scanline, &buffer);
+                    if empty_tx.send(buffer).is_err() {
+                        break;
+                    }
+                }
+            });
+
+            let mut result = Ok(());
+            let mut allocated = 0;
+            let mut first_scanline = 0;
+            while first_scanline < height {
+                let rows = chunk_height.min(height - first_scanline);
+
+                let mut buffer = match empty_rx.try_recv() {
+                    Ok(buffer) => buffer,
+                    Err(_) if allocated < max_buffers => {
+                        allocated += 1;
+                        Vec::new()
+                    }
+                    Err(_) => match empty_rx.recv() {
+                        Ok(buffer) => buffer,
+                        // The consumer panicked; `join()` below re-raises it.
+                        Err(_) => break,
+                    },
+                };
+                buffer.resize(width as usize * rows as usize, T::default());
+
+                {
+                    let mut fb = FrameBufferMut::new(width, rows);
+                    fb.insert_channels(channels, &mut buffer);
+                    if let Err(e) = self.read_pixels_partial(first_scanline, &mut fb) {
+                        result = Err(e);
+                        break;
+                    }
+                }
+
+                if full_tx.send((first_scanline, buffer)).is_err() {
+                    break;
+                }
+                first_scanline += rows;
+            }
+
+            drop(full_tx);
+            if let Err(panic) = consumer_thread.join() {
+                panic::resume_unwind(panic);
+            }
+            result
+        })
+    }
+
+    /// Returns a preview image of the file, with its longer side at most
+    /// `size` pixels long.
+    ///
+    /// This is the file's preview image if its header has one, whatever
+    /// its size.  Otherwise one is made by decoding only the scanlines
+    /// that are sampled, one at a time, which for large images is much
+    /// faster than reading the whole image and scaling it down.  Still,
+    /// each sampled scanline decodes its whole chunk, so files with a
+    /// lot of scanlines per chunk benefit less.
+    ///
+    /// The preview image is made from the "R", "G" and "B" channels, or
+    /// "Y" for luminance-only files, and "A" if present.
+    ///
+    /// # Examples
+    ///
+    /// ```no_run
+    /// # use openexr::InputFile;
+    /// #
+    /// let mut file = std::fs::File::open("input_file.exr").unwrap();
+    /// let mut input_file = InputFile::new(&mut file).unwrap();
+    /// let preview = input_file.read_preview(128).unwrap();
+    /// println!("{}x{} preview", preview.width, preview.height);
+    /// ```
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if there is an I/O error.
+    pub fn read_preview(&mut self, size: u32) -> Result<PreviewImage> {
+        if let Some(preview) = self.header().preview_image() {
+            return Ok(preview);
+        }
+
+        let (width, height) = PreviewImage::dimensions_for(self.header(), size);
+        let mut preview = PreviewImage::new(width, height);
+
+        // The C++ side sets its own framebuffer on the file.
+        self.framebuffer_cache.invalidate();
+
+        let mut error_out = ptr::null();
         let error = unsafe {
-            let offset_fb = CEXR_FrameBuffer_copy_and_offset_scanlines(
-                framebuffer.handle_mut(),
-                starting_scanline,
-            );
-            let err = CEXR_InputFile_set_framebuffer(self.handle, offset_fb, &mut error_out);
-            CEXR_FrameBuffer_delete(offset_fb);
-            err
+            CEXR_InputFile_read_preview(
+                self.handle,
+                width,
+                height,
+                preview.pixels.as_mut_ptr() as *mut CEXR_PreviewRgba,
+                &mut error_out,
+            )
         };
         if error != 0 {
-            return Err(Error::take(error_out));
+            Err(Error::take(error_out))
+        } else {
+            Ok(preview)
         }
+    }
 
-        // Read the image data
+    /// Returns the raw, still compressed data of the chunk of scanlines
+    /// starting at `first_scanline`.
+    ///
+    /// `first_scanline` is in the same coordinates as the data window, and
+    /// should be the first scanline of a chunk: the data window's minimum y
+    /// plus a multiple of `Header::scanlines_per_chunk()`.  The data is in
+    /// the file's compression format, and stays valid until the next read
+    /// from the file.
+    ///
+    /// To copy all of a file's pixels to a new file without decompressing
+    /// them, use `ScanlineOutputFile::copy_pixels_from()` instead.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if this is a tiled file, if `first_scanline` is
+    /// outside of the data window, or if there is an I/O error.
+    pub fn raw_pixel_data(&mut self, first_scanline: i32) -> Result<&[u8]> {
+        let mut error_out = ptr::null();
+        let mut data = ptr::null();
+        let mut size = 0;
         let error = unsafe {
-            CEXR_InputFile_read_pixels(self.handle, start_scanline, end_scanline, &mut error_out)
+            CEXR_InputFile_raw_pixel_data(
+                self.handle,
+                first_scanline,
+                &mut data,
+                &mut size,
+                &mut error_out,
+            )
         };
         if error != 0 {
             Err(Error::take(error_out))
+        } else if size == 0 {
+            Ok(&[])
         } else {
-            Ok(())
+            Ok(unsafe { slice::from_raw_parts(data as *const u8, size as usize) })
         }
     }
 
+    /// Returns whether all of the file's chunks were present when it was
+    /// opened.
+    ///
+    /// Files that are still being written, or that weren't closed properly,
+    /// can still be opened, and the chunks that had been completely written
+    /// can be read.  Reading any others fails.  See `complete_chunks()` for
+    /// which ones those are, and `ProgressiveReader` for reading a file as
+    /// it's written.
+    pub fn is_complete(&self) -> bool {
+        unsafe { CEXR_InputFile_is_complete(self.handle) }
+    }
+
+    /// Returns which of the file's chunks have been completely written, in
+    /// order from the top of the data window.
+    ///
+    /// Each chunk holds `Header::scanlines_per_chunk()` scanlines, apart from
+    /// possibly the last one.  This looks at the data as it is now, so when
+    /// reading from a file that is still growing it may include chunks
+    /// written after this `InputFile` was opened, which can only be read by
+    /// opening the file again.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if this isn't a single-part scanline file, or if
+    /// there is an I/O error.
+    pub fn complete_chunks(&mut self) -> Result<Vec<bool>> {
+        Ok(self
+            .chunk_locations()?
+            .iter()
+            .map(|chunk| chunk.is_some())
+            .collect())
+    }
+
+    /// Returns where each of the file's chunks is stored, in order from the
+    /// top of the data window, or `None` for chunks that haven't been
+    /// completely written.
+    ///
+    /// Each entry of the file's offset table is checked against the chunk it
+    /// points to, and chunks that don't match are treated as missing.  As
+    /// with `complete_chunks()`, this looks at the data as it is now.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if this isn't a single-part scanline file, or if
+    /// there is an I/O error.
+    pub fn chunk_locations(&mut self) -> Result<Vec<Option<ChunkLocation>>> {
+        Ok(self.chunk_table()?.1)
+    }
+
     /// Access to the file's header.
     pub fn header(&self) -> &Header {
         &self.header_ref
     }
+
+    /// Returns the file's I/O statistics so far.
+    ///
+    /// See the [stats](../stats/index.html) module for details.
+    pub fn stats(&self) -> IoStats {
+        let mut stream_stats = unsafe { mem::zeroed() };
+        unsafe { CEXR_IStream_stats(self.istream, &mut stream_stats) };
+        IoStats::new(&stream_stats, &self.pixel_stats)
+    }
+
+    pub(crate) fn handle_mut(&mut self) -> *mut CEXR_InputFile {
+        self.handle
+    }
+
+    // Returns the size of the file's header and offset table, and where its
+    // chunks are.  See `chunk_locations()`.
+    fn chunk_table(&mut self) -> Result<(u64, Vec<Option<ChunkLocation>>)> {
+        let height = self.header().data_dimensions().1;
+        let chunk_rows = self.header().scanlines_per_chunk();
+        let count = ((height + chunk_rows - 1) / chunk_rows) as usize;
+        let mut offsets = vec![0u64; count];
+        let mut sizes = vec![0u64; count];
+        let mut table_end = 0;
+
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_IStream_read_chunk_table(
+                self.istream,
+                offsets.as_mut_ptr(),
+                sizes.as_mut_ptr(),
+                count,
+                &mut table_end,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            return Err(Error::take(error_out));
+        }
+
+        let first_scanline = self.header().data_window().min.y;
+        let chunks = offsets
+            .iter()
+            .zip(&sizes)
+            .enumerate()
+            .map(|(i, (&offset, &size))| {
+                if offset == 0 {
+                    None
+                } else {
+                    Some(ChunkLocation {
+                        first_scanline: first_scanline + (i as u32 * chunk_rows) as i32,
+                        offset: offset,
+                        size: size,
+                    })
+                }
+            })
+            .collect();
+        Ok((table_end, chunks))
+    }
+
+    // Closes the file, handing back its istream instead of deleting it, so
+    // that it can be reused.
+    fn into_istream(mut self) -> *mut CEXR_IStream {
+        mem::replace(&mut self.istream, ptr::null_mut())
+    }
+
+    // Reads scanlines `start_scanline` to `end_scanline` of the data window
+    // into `framebuffer` with its scanlines offset by `offset`.
+    //
+    // If any of its channels need converting from the file's channel types,
+    // the read goes through the C++ side's scratch buffers, which convert
+    // whole rows at a time.  Otherwise it's a plain read.
+    fn read_scanlines(
+        &mut self,
+        framebuffer: &mut FrameBufferMut,
+        offset: u32,
+        start_scanline: i32,
+        end_scanline: i32,
+    ) -> Result<()> {
+        let started = Instant::now();
+        let mut error_out = ptr::null();
+        let error = if self.header().framebuffer_needs_conversion(framebuffer) {
+            self.header().validate_framebuffer_for_input(framebuffer)?;
+
+            // The cache is only used to offset the framebuffer here, since
+            // the C++ side sets its own framebuffer on the file.
+            self.framebuffer_cache.update(framebuffer, offset);
+            self.framebuffer_cache.invalidate();
+
+            let mut region = *self.header().data_window();
+            region.min.y = start_scanline;
+            region.max.y = end_scanline;
+            unsafe {
+                CEXR_InputFile_read_region(
+                    self.handle,
+                    self.framebuffer_cache.handle(),
+                    region,
+                    self.region_batch_rows(),
+                    &mut error_out,
+                )
+            }
+        } else {
+            self.set_framebuffer(framebuffer, offset)?;
+            unsafe {
+                CEXR_InputFile_read_pixels(
+                    self.handle,
+                    start_scanline,
+                    end_scanline,
+                    &mut error_out,
+                )
+            }
+        };
+        self.pixel_stats
+            .record(&self.header_ref, start_scanline, end_scanline, started);
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(())
+        }
+    }
+
+    // The number of scanlines to decode at a time when reading through the
+    // C++ side's scratch buffers: `REGION_BATCH_ROWS` rounded up to a whole
+    // number of chunks.
+    fn region_batch_rows(&self) -> c_int {
+        let chunk = self.header().scanlines_per_chunk();
+        (chunk * ((REGION_BATCH_ROWS + chunk - 1) / chunk)) as c_int
+    }
+
+    // Validates `framebuffer` and sets it on the file with its scanlines
+    // offset by `offset`.  Validating and setting are skipped when they
+    // aren't needed, which makes repeated reads into framebuffers with the
+    // same layout (e.g. chunk by chunk with `read_pixels_partial()`) cheap.
+    fn set_framebuffer(&mut self, framebuffer: &mut FrameBufferMut, offset: u32) -> Result<()> {
+        match self.framebuffer_cache.update(framebuffer, offset) {
+            FrameBufferUpdate::Unchanged => return Ok(()),
+            FrameBufferUpdate::Moved => {}
+            FrameBufferUpdate::Changed => {
+                self.header().validate_framebuffer_for_input(framebuffer)?;
+            }
+        }
+
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_InputFile_set_framebuffer(
+                self.handle,
+                self.framebuffer_cache.handle_mut(),
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            self.framebuffer_cache.set_current();
+            Ok(())
+        }
+    }
 }
 
 impl<'a> Drop for InputFile<'a> {
     fn drop(&mut self) {
         unsafe { CEXR_InputFile_delete(self.handle) };
-        unsafe { CEXR_IStream_delete(self.istream) };
+        if !self.istream.is_null() {
+            unsafe { CEXR_IStream_delete(self.istream) };
+        }
+    }
+}
+
+// Creates an istream over a memory mapping of the file at `path`.  The
+// istream owns the mapping.
+pub(crate) fn mmap_istream(path: &Path) -> Result<*mut CEXR_IStream> {
+    let c_path = {
+        #[cfg(unix)]
+        let bytes = {
+            use std::os::unix::ffi::OsStrExt;
+            path.as_os_str().as_bytes().to_vec()
+        };
+        #[cfg(not(unix))]
+        let bytes = match path.to_str() {
+            Some(path) => path.as_bytes().to_vec(),
+            None => {
+                return Err(Error::Generic(format!(
+                    "path {} is not valid unicode",
+                    path.display()
+                )))
+            }
+        };
+
+        match CString::new(bytes) {
+            Ok(c_path) => c_path,
+            Err(_) => {
+                return Err(Error::Generic(format!(
+                    "path {} contains a nul byte",
+                    path.display()
+                )))
+            }
+        }
+    };
+
+    let mut error_out = ptr::null();
+    let mut out = ptr::null_mut();
+    let error = unsafe { CEXR_IStream_from_file_mmap(c_path.as_ptr(), &mut out, &mut error_out) };
+    if error != 0 {
+        Err(Error::take(error_out))
+    } else {
+        Ok(out)
     }
 }
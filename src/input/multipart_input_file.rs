@@ -0,0 +1,551 @@
+use std::io::{Read, Seek};
+use std::marker::PhantomData;
+use std::path::{Path, PathBuf};
+use std::{ptr, thread};
+
+use libc::{c_char, c_int};
+
+use openexr_sys::*;
+
+use error::*;
+use frame_buffer::{FrameBufferCache, FrameBufferMut, FrameBufferUpdate};
+use stream_io::{read_stream, seek_stream};
+use threads::c_thread_count;
+use Header;
+
+use super::{mmap_istream, InputOptions};
+
+/// Reads multipart OpenEXR files.
+///
+/// A multipart file stores several independent images ("parts") in one
+/// file, each with its own header, channels and compression.  This is
+/// typically used for the separate passes or AOVs of a render, and lets a
+/// reader decode only the parts it needs.
+///
+/// Parts are identified by their index, from `0` to `parts() - 1`, and can
+/// be looked up by name with `find_part()`.  Each part is read as if it were
+/// a scanline image, in the same way as with `InputFile`, regardless of
+/// whether it's stored as scanlines or tiles.  Deep parts can't be read.
+///
+/// Files with a single part, including ordinary single-part files, can be
+/// read with this type as well.
+///
+/// # Examples
+///
+/// Load the "diffuse" part of a file named "input_file.exr".
+///
+/// ```no_run
+/// # use openexr::{FrameBufferMut, MultiPartInputFile};
+/// #
+/// let mut input_file = unsafe { MultiPartInputFile::from_path_mmap("input_file.exr") }.unwrap();
+/// let part = input_file.find_part("diffuse").unwrap();
+/// let (width, height) = input_file.header(part).data_dimensions();
+///
+/// let mut pixel_data = vec![(0.0f32, 0.0f32, 0.0f32); (width * height) as usize];
+/// let mut fb = FrameBufferMut::new(width, height);
+/// fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut pixel_data);
+/// input_file.read_part(part, &mut fb).unwrap();
+/// ```
+#[allow(dead_code)]
+pub struct MultiPartInputFile<'a> {
+    handle: *mut CEXR_MultiPartInputFile,
+    header_refs: Vec<Header>,
+    istream: *mut CEXR_IStream,
+    source: Source,
+    options: InputOptions,
+    framebuffer_caches: Vec<FrameBufferCache>,
+    _phantom_1: PhantomData<CEXR_MultiPartInputFile>,
+    _phantom_2: PhantomData<&'a mut ()>, // Represents the borrowed reader
+}
+
+// Where a file was opened from, so that `read_parts()` can open it again.
+enum Source {
+    // A reader, which can't be opened again.
+    Reader,
+    // A slice, which outlives the file.
+    Memory(*const u8, usize),
+    // A memory mapped file, which the caller of `from_path_mmap()` has
+    // promised won't change.
+    Mapped(PathBuf),
+}
+
+// The slice of `Source::Memory` is only read from.
+unsafe impl Sync for Source {}
+
+impl<'a> MultiPartInputFile<'a> {
+    /// Creates a new `MultiPartInputFile` from any `Read + Seek` type
+    /// (typically a `std::fs::File`).
+    ///
+    /// Note: this seeks to byte 0 before reading.
+    pub fn new<T: 'a>(reader: &'a mut T) -> Result<MultiPartInputFile<'a>>
+    where
+        T: Read + Seek,
+    {
+        MultiPartInputFile::new_with_options(reader, &InputOptions::new())
+    }
+
+    /// Creates a new `MultiPartInputFile` from any `Read + Seek` type
+    /// (typically a `std::fs::File`), using the given `options`.
+    ///
+    /// Note: this seeks to byte 0 before reading.
+    pub fn new_with_options<T: 'a>(
+        reader: &'a mut T,
+        options: &InputOptions,
+    ) -> Result<MultiPartInputFile<'a>>
+    where
+        T: Read + Seek,
+    {
+        let istream_ptr = {
+            let read_ptr = read_stream::<T>;
+            let seekp_ptr = seek_stream::<T>;
+
+            let mut error_out = ptr::null();
+            let mut out = ptr::null_mut();
+            let error = unsafe {
+                CEXR_IStream_from_reader(
+                    reader as *mut T as *mut _,
+                    Some(read_ptr),
+                    Some(seekp_ptr),
+                    options.buffer_size,
+                    &mut out,
+                    &mut error_out,
+                )
+            };
+
+            if error != 0 {
+                return Err(Error::take(error_out));
+            } else {
+                out
+            }
+        };
+
+        MultiPartInputFile::from_istream(istream_ptr, Source::Reader, options)
+    }
+
+    /// Creates a new `MultiPartInputFile` from a slice of bytes, reading
+    /// from memory.
+    pub fn from_slice(slice: &'a [u8]) -> Result<MultiPartInputFile<'a>> {
+        MultiPartInputFile::from_slice_with_options(slice, &InputOptions::new())
+    }
+
+    /// Creates a new `MultiPartInputFile` from a slice of bytes, reading
+    /// from memory, using the given `options`.
+    pub fn from_slice_with_options(
+        slice: &'a [u8],
+        options: &InputOptions,
+    ) -> Result<MultiPartInputFile<'a>> {
+        let istream_ptr = unsafe { memory_istream(slice.as_ptr(), slice.len()) };
+        MultiPartInputFile::from_istream(
+            istream_ptr,
+            Source::Memory(slice.as_ptr(), slice.len()),
+            options,
+        )
+    }
+
+    /// Creates a new `MultiPartInputFile` by memory mapping the file at
+    /// `path`.
+    ///
+    /// See `InputFile::from_path_mmap()` for details.
+    ///
+    /// # Safety
+    ///
+    /// As with `InputFile::from_path_mmap()`.
+    pub unsafe fn from_path_mmap<P: AsRef<Path>>(path: P) -> Result<MultiPartInputFile<'static>> {
+        MultiPartInputFile::from_path_mmap_with_options(path, &InputOptions::new())
+    }
+
+    /// Creates a new `MultiPartInputFile` by memory mapping the file at
+    /// `path`, using the given `options`.
+    ///
+    /// See `InputFile::from_path_mmap()` for details.
+    ///
+    /// # Safety
+    ///
+    /// As with `InputFile::from_path_mmap()`.
+    pub unsafe fn from_path_mmap_with_options<P: AsRef<Path>>(
+        path: P,
+        options: &InputOptions,
+    ) -> Result<MultiPartInputFile<'static>> {
+        let path = path.as_ref();
+        let istream_ptr = mmap_istream(path)?;
+        MultiPartInputFile::from_istream(istream_ptr, Source::Mapped(path.to_path_buf()), options)
+    }
+
+    // Shared code for the constructors above.  Takes ownership of
+    // `istream_ptr`, deleting it if the file can't be opened.
+    fn from_istream(
+        istream_ptr: *mut CEXR_IStream,
+        source: Source,
+        options: &InputOptions,
+    ) -> Result<MultiPartInputFile<'a>> {
+        let threads = match c_thread_count(options.threads) {
+            Ok(threads) => threads,
+            Err(e) => {
+                unsafe { CEXR_IStream_delete(istream_ptr) };
+                return Err(e);
+            }
+        };
+
+        let mut error_out = ptr::null();
+        let mut out = ptr::null_mut();
+        let error = unsafe {
+            CEXR_MultiPartInputFile_from_stream(istream_ptr, threads, &mut out, &mut error_out)
+        };
+        if error != 0 {
+            unsafe { CEXR_IStream_delete(istream_ptr) };
+            Err(Error::take(error_out))
+        } else {
+            let parts = unsafe { CEXR_MultiPartInputFile_parts(out) };
+            Ok(MultiPartInputFile {
+                handle: out,
+                header_refs: (0..parts)
+                    .map(|part| {
+                        Header::borrowed(unsafe { CEXR_MultiPartInputFile_header(out, part) })
+                    })
+                    .collect(),
+                istream: istream_ptr,
+                source: source,
+                options: *options,
+                framebuffer_caches: (0..parts).map(|_| FrameBufferCache::new()).collect(),
+                _phantom_1: PhantomData,
+                _phantom_2: PhantomData,
+            })
+        }
+    }
+
+    /// Returns the number of parts in the file.
+    pub fn parts(&self) -> usize {
+        self.header_refs.len()
+    }
+
+    /// Returns the index of the part named `name`, if there is one.
+    pub fn find_part(&self, name: &str) -> Option<usize> {
+        self.header_refs
+            .iter()
+            .position(|header| header.name() == Some(name))
+    }
+
+    /// Returns the indices of the parts that hold channels of the view
+    /// named `view`, in order.
+    ///
+    /// These are the parts whose headers are of that view or list it among
+    /// their views (see `Header::find_view()`).  Reading only these parts,
+    /// for example with `read_parts()`, decodes only the one view.
+    pub fn view_parts(&self, view: &str) -> Vec<usize> {
+        self.header_refs
+            .iter()
+            .enumerate()
+            .filter(|&(_, header)| header.find_view(view).is_some())
+            .map(|(part, _)| part)
+            .collect()
+    }
+
+    /// Access to the header of part `part`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `part` is out of range.
+    pub fn header(&self, part: usize) -> &Header {
+        &self.header_refs[part]
+    }
+
+    /// Reads all of part `part` into `framebuffer` at once.
+    ///
+    /// Any channels in `framebuffer` that are not present in the part will
+    /// be filled with their default fill value.
+    ///
+    /// # Errors
+    ///
+    /// This function expects `framebuffer` to have the same resolution and
+    /// origin as the part, and for any same-named channels to have matching
+    /// types and subsampling.
+    ///
+    /// It will also return an error if `part` is out of range, if it's a deep
+    /// part, or if there is an I/O error.
+    pub fn read_part(&mut self, part: usize, framebuffer: &mut FrameBufferMut) -> Result<()> {
+        self.prepare_read(part, framebuffer)?;
+        let window = *self.header(part).data_window();
+        read_part_pixels(self.handle, part, window.min.y, window.max.y)
+    }
+
+    /// Reads a contiguous chunk of scanlines of part `part` into
+    /// `framebuffer`.
+    ///
+    /// This works the same way as `InputFile::read_pixels_partial()`:
+    /// `framebuffer` must have the same horizontal resolution as the part,
+    /// and is filled with scanlines starting at `starting_scanline`.
+    ///
+    /// # Errors
+    ///
+    /// The same as `InputFile::read_pixels_partial()`, and additionally
+    /// returns an error if `part` is out of range or is a deep part.
+    pub fn read_part_partial(
+        &mut self,
+        part: usize,
+        starting_scanline: u32,
+        framebuffer: &mut FrameBufferMut,
+    ) -> Result<()> {
+        self.check_part(part)?;
+        let (width, height) = self.header(part).data_dimensions();
+
+        // Validation
+        if starting_scanline >= height {
+            return Err(Error::Generic(format!(
+                "starting scanline {} is past the last \
+                 scanline of part {}",
+                starting_scanline, part
+            )));
+        }
+
+        if framebuffer.dimensions().1 > (height - starting_scanline) {
+            return Err(Error::Generic(format!(
+                "framebuffer contains {} \
+                 scanlines, but only {} scanlines are available to read from \
+                 the given starting scanline",
+                framebuffer.dimensions().1,
+                height - starting_scanline
+            )));
+        }
+
+        if width != framebuffer.dimensions().0 {
+            return Err(Error::Generic(format!(
+                "framebuffer width {} does not match\
+                 image width {}",
+                framebuffer.dimensions().0,
+                width
+            )));
+        }
+
+        // Set up the framebuffer with the part
+        let start_scanline = self.header(part).data_window().min.y + starting_scanline as i32;
+        let end_scanline = start_scanline + framebuffer.dimensions().1 as i32 - 1;
+        self.set_framebuffer(part, framebuffer, starting_scanline)?;
+
+        read_part_pixels(self.handle, part, start_scanline, end_scanline)
+    }
+
+    /// Reads several whole parts at once, decoding them concurrently.
+    ///
+    /// Each entry of `reads` is a part index and the framebuffer to read all
+    /// of that part into, as with `read_part()`.  Each part after the first
+    /// is read on its own thread (in addition to the decoding threads set
+    /// with `InputOptions::set_threads()`), through its own copy of the file,
+    /// since OpenEXR serializes all reads of one file.  That makes reading
+    /// the handful of parts that are actually needed this way typically much
+    /// faster than reading them one after the other, despite the cost of
+    /// opening the copies, which parses the headers again.
+    ///
+    /// Files opened from a reader can't be opened again, so their parts are
+    /// read one after the other.
+    ///
+    /// # Errors
+    ///
+    /// The same as `read_part()` for each of the parts, and additionally
+    /// returns an error if a part appears more than once in `reads`.  All
+    /// framebuffers are validated before anything is read.  If reading more
+    /// than one part fails, the error of the earliest one in `reads` is
+    /// returned.
+    pub fn read_parts(&mut self, reads: &mut [(usize, &mut FrameBufferMut)]) -> Result<()> {
+        // Validation and setup.  The C++ framebuffers are all set ahead of
+        // time, so that the threads below only read.
+        for i in 0..reads.len() {
+            let part = reads[i].0;
+            if reads[..i].iter().any(|read| read.0 == part) {
+                return Err(Error::Generic(format!(
+                    "part {} can only be read once at a time",
+                    part
+                )));
+            }
+            self.prepare_read(part, &mut *reads[i].1)?;
+        }
+
+        let windows: Vec<_> = reads
+            .iter()
+            .map(|&(part, _)| (part, *self.header(part).data_window()))
+            .collect();
+        if let Source::Reader = self.source {
+            for &(part, window) in &windows {
+                read_part_pixels(self.handle, part, window.min.y, window.max.y)?;
+            }
+            return Ok(());
+        }
+
+        // Read the first part through this file, and the others
+        // concurrently through copies of it.
+        let framebuffers: Vec<_> = windows
+            .iter()
+            .map(|&(part, _)| FrameBufferHandle(self.framebuffer_caches[part].handle()))
+            .collect();
+        let source = &self.source;
+        let options = &self.options;
+        let handle = self.handle;
+        thread::scope(|scope| {
+            let threads: Vec<_> = windows[1..]
+                .iter()
+                .zip(&framebuffers[1..])
+                .map(|(&(part, window), framebuffer)| {
+                    scope.spawn(move || -> Result<()> {
+                        let file = MultiPartInputFile::reopen(source, options)?;
+                        set_part_framebuffer(file.handle, part, framebuffer.0)?;
+                        read_part_pixels(file.handle, part, window.min.y, window.max.y)
+                    })
+                })
+                .collect();
+
+            let (part, window) = windows[0];
+            let mut result = read_part_pixels(handle, part, window.min.y, window.max.y);
+            for thread in threads {
+                let thread_result = thread.join().unwrap();
+                if result.is_ok() {
+                    result = thread_result;
+                }
+            }
+            result
+        })
+    }
+
+    // Opens a copy of a file opened from `source`, which mustn't be a
+    // reader, for `read_parts()`.
+    fn reopen(source: &Source, options: &InputOptions) -> Result<MultiPartInputFile<'a>> {
+        let istream_ptr = match *source {
+            Source::Reader => unreachable!(),
+            Source::Memory(data, len) => unsafe { memory_istream(data, len) },
+            Source::Mapped(ref path) => mmap_istream(path)?,
+        };
+        // The copy is never opened again itself.
+        MultiPartInputFile::from_istream(istream_ptr, Source::Reader, options)
+    }
+
+    // Validates that `framebuffer` can receive all of part `part`, and
+    // sets it on the part.
+    fn prepare_read(&mut self, part: usize, framebuffer: &mut FrameBufferMut) -> Result<()> {
+        self.check_part(part)?;
+
+        // Validation
+        if self.header(part).data_dimensions() != framebuffer.dimensions() {
+            return Err(Error::Generic(format!(
+                "framebuffer size {}x{} does not match \
+                 dimensions {}x{} of part {}",
+                framebuffer.dimensions().0,
+                framebuffer.dimensions().1,
+                self.header(part).data_dimensions().0,
+                self.header(part).data_dimensions().1,
+                part
+            )));
+        }
+
+        if self.header(part).data_origin() != framebuffer.origin() {
+            return Err(Error::Generic(format!(
+                "framebuffer origin {},{} does not match origin {},{} of part {}",
+                framebuffer.origin().0,
+                framebuffer.origin().1,
+                self.header(part).data_origin().0,
+                self.header(part).data_origin().1,
+                part
+            )));
+        }
+
+        self.set_framebuffer(part, framebuffer, 0)
+    }
+
+    fn check_part(&self, part: usize) -> Result<()> {
+        if part >= self.parts() {
+            Err(Error::Generic(format!(
+                "part {} does not exist, the file has {} parts",
+                part,
+                self.parts()
+            )))
+        } else {
+            Ok(())
+        }
+    }
+
+    // Validates `framebuffer` and sets it on part `part` with its scanlines
+    // offset by `offset`, skipping both when they aren't needed.  See
+    // `InputFile::set_framebuffer()`.
+    fn set_framebuffer(
+        &mut self,
+        part: usize,
+        framebuffer: &mut FrameBufferMut,
+        offset: u32,
+    ) -> Result<()> {
+        match self.framebuffer_caches[part].update(framebuffer, offset) {
+            FrameBufferUpdate::Unchanged => return Ok(()),
+            FrameBufferUpdate::Moved => {}
+            FrameBufferUpdate::Changed => {
+                self.header(part)
+                    .validate_framebuffer_for_input(framebuffer)?;
+            }
+        }
+
+        set_part_framebuffer(self.handle, part, self.framebuffer_caches[part].handle())?;
+        self.framebuffer_caches[part].set_current();
+        Ok(())
+    }
+}
+
+impl<'a> Drop for MultiPartInputFile<'a> {
+    fn drop(&mut self) {
+        unsafe { CEXR_MultiPartInputFile_delete(self.handle) };
+        unsafe { CEXR_IStream_delete(self.istream) };
+    }
+}
+
+// A framebuffer set on this file, for setting on the copies of it in
+// `read_parts()`.  It's only read from.
+struct FrameBufferHandle(*const CEXR_FrameBuffer);
+unsafe impl Sync for FrameBufferHandle {}
+
+// Creates an istream over `len` bytes at `data`, which must outlive it.
+unsafe fn memory_istream(data: *const u8, len: usize) -> *mut CEXR_IStream {
+    CEXR_IStream_from_memory(
+        b"in-memory data\0".as_ptr() as *const c_char,
+        data as *mut u8 as *mut c_char,
+        len,
+    )
+}
+
+// Sets `framebuffer` on part `part`.  OpenEXR keeps a copy of it.
+fn set_part_framebuffer(
+    handle: *mut CEXR_MultiPartInputFile,
+    part: usize,
+    framebuffer: *const CEXR_FrameBuffer,
+) -> Result<()> {
+    let mut error_out = ptr::null();
+    let error = unsafe {
+        CEXR_MultiPartInputFile_set_framebuffer(
+            handle,
+            part as c_int,
+            framebuffer as *mut CEXR_FrameBuffer,
+            &mut error_out,
+        )
+    };
+    if error != 0 {
+        Err(Error::take(error_out))
+    } else {
+        Ok(())
+    }
+}
+
+fn read_part_pixels(
+    handle: *mut CEXR_MultiPartInputFile,
+    part: usize,
+    scanline_1: i32,
+    scanline_2: i32,
+) -> Result<()> {
+    let mut error_out = ptr::null();
+    let error = unsafe {
+        CEXR_MultiPartInputFile_read_pixels(
+            handle,
+            part as c_int,
+            scanline_1,
+            scanline_2,
+            &mut error_out,
+        )
+    };
+    if error != 0 {
+        Err(Error::take(error_out))
+    } else {
+        Ok(())
+    }
+}
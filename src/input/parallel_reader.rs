@@ -0,0 +1,210 @@
+use std::fs;
+use std::path::Path;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Mutex;
+use std::{panic, thread};
+
+use error::*;
+use frame_buffer::{FrameBufferMut, PixelStruct};
+
+use super::{InputFile, InputOptions};
+
+// The number of bands of scanlines the image is split into per thread, so
+// that threads that finish early can pick up more work.
+const BANDS_PER_THREAD: u32 = 4;
+
+/// Reads a single scanline image with several `InputFile`s at once, each
+/// decoding different scanlines.
+///
+/// OpenEXR's own threading (see `InputOptions::set_threads()`) decodes
+/// chunks in parallel within each read, but all reading goes through one
+/// stream and one framebuffer, which limits how far it scales.  A
+/// `ParallelReader` instead opens one file per thread on the same data and
+/// splits the image into bands of whole chunks, which the threads decode
+/// into disjoint parts of the pixel buffer with
+/// `InputFile::read_pixels_partial()`.  This pays off for large images with
+/// expensive compression, such as ZIP or PIZ.
+///
+/// # Examples
+///
+/// ```no_run
+/// # use openexr::input::ParallelReader;
+/// # use openexr::Header;
+/// #
+/// let header = Header::read_from_slice(&std::fs::read("input_file.exr").unwrap()).unwrap();
+/// let (width, height) = header.data_dimensions();
+/// let mut pixels = vec![(0.0f32, 0.0f32, 0.0f32); width as usize * height as usize];
+/// ParallelReader::new()
+///     .read_path(
+///         "input_file.exr",
+///         &[("R", 0.0), ("G", 0.0), ("B", 0.0)],
+///         &mut pixels,
+///     )
+///     .unwrap();
+/// ```
+#[derive(Debug, Copy, Clone)]
+pub struct ParallelReader {
+    threads: usize,
+}
+
+impl ParallelReader {
+    /// Creates a parallel reader with one thread per CPU.
+    pub fn new() -> Self {
+        ParallelReader {
+            threads: thread::available_parallelism()
+                .map(|threads| threads.get())
+                .unwrap_or(1),
+        }
+    }
+
+    /// Sets the number of threads, and so of files opened.  The calling
+    /// thread is one of them, and `0` is treated as `1`.
+    pub fn set_threads(&mut self, threads: usize) -> &mut Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Reads the whole image in `data` into `pixels`.
+    ///
+    /// `pixels` holds the data window in scanline order, with the channels
+    /// given in `channels` exactly as with `FrameBufferMut::insert_channels()`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `pixels` doesn't have exactly one element per pixel of the
+    /// data window.
+    pub fn read_slice<T: PixelStruct + Send>(
+        &self,
+        data: &[u8],
+        channels: &[(&str, f64)],
+        pixels: &mut [T],
+    ) -> Result<()> {
+        self.read_with(
+            || InputFile::from_slice_with_options(data, InputOptions::new().set_threads(0)),
+            channels,
+            pixels,
+        )
+    }
+
+    /// Reads the whole image at `path` into `pixels`, reading the file into
+    /// memory once for all of the threads.
+    ///
+    /// See `read_slice()` for details.  To memory map the file instead, use
+    /// `read_with()` with `InputFile::from_path_mmap_with_options()`.
+    pub fn read_path<P: AsRef<Path>, T: PixelStruct + Send>(
+        &self,
+        path: P,
+        channels: &[(&str, f64)],
+        pixels: &mut [T],
+    ) -> Result<()> {
+        let path = path.as_ref();
+        let data = fs::read(path)
+            .map_err(|e| Error::Generic(format!("couldn't read {}: {}", path.display(), e)))?;
+        self.read_slice(&data, channels, pixels)
+    }
+
+    /// Reads the whole image into `pixels`, with `open` opening each
+    /// thread's file.
+    ///
+    /// `open` is called once on the calling thread, and then once on each
+    /// other thread that's needed.  Every call must open the same image.
+    /// The files' own thread counts should generally be `0`.
+    ///
+    /// See `read_slice()` for details.
+    ///
+    /// # Errors
+    ///
+    /// Returns the first error from opening or reading any of the files.
+    /// The other threads stop as soon as they notice.
+    pub fn read_with<'s, F, T>(
+        &self,
+        open: F,
+        channels: &[(&str, f64)],
+        pixels: &mut [T],
+    ) -> Result<()>
+    where
+        F: Fn() -> Result<InputFile<'s>> + Sync,
+        T: PixelStruct + Send,
+    {
+        let mut first_file = open()?;
+        let (width, height) = first_file.header().data_dimensions();
+        let origin = first_file.header().data_origin();
+        if pixels.len() != width as usize * height as usize {
+            panic!(
+                "data size of {} elements cannot back {}x{} image",
+                pixels.len(),
+                width,
+                height
+            );
+        }
+
+        // Bands of whole chunks, counted from the top of the data window.
+        let threads = self.threads.max(1) as u32;
+        let chunk = first_file.header().scanlines_per_chunk();
+        let target_bands = threads * BANDS_PER_THREAD;
+        let band_rows = ((height + target_bands - 1) / target_bands + chunk - 1) / chunk * chunk;
+        let band_len = band_rows as usize * width as usize;
+        let bands = Mutex::new(pixels.chunks_mut(band_len).enumerate());
+        let band_count = (height + band_rows - 1) / band_rows;
+
+        let failed = AtomicBool::new(false);
+        let work = |file: &mut InputFile| -> Result<()> {
+            loop {
+                if failed.load(Ordering::Relaxed) {
+                    return Ok(());
+                }
+                let (index, band) = match bands.lock().unwrap().next() {
+                    Some(band) => band,
+                    None => return Ok(()),
+                };
+                let first_row = index as u32 * band_rows;
+                let rows = (band.len() / width as usize) as u32;
+                // `read_pixels_partial()` offsets the framebuffer to the
+                // band's first row itself.
+                let mut fb = FrameBufferMut::new_with_origin(origin.0, origin.1, width, rows);
+                fb.insert_channels(channels, band);
+                if let Err(e) = file.read_pixels_partial(first_row, &mut fb) {
+                    failed.store(true, Ordering::Relaxed);
+                    return Err(e);
+                }
+            }
+        };
+
+        thread::scope(|scope| {
+            let helpers: Vec<_> = (1..threads.min(band_count))
+                .map(|_| {
+                    scope.spawn(|| {
+                        let mut file = open().map_err(|e| {
+                            failed.store(true, Ordering::Relaxed);
+                            e
+                        })?;
+                        work(&mut file)
+                    })
+                })
+                .collect();
+
+            let mut result = work(&mut first_file);
+            let mut panic = None;
+            for helper in helpers {
+                match helper.join() {
+                    Ok(helper_result) => {
+                        if result.is_ok() {
+                            result = helper_result;
+                        }
+                    }
+                    Err(e) => panic = Some(e),
+                }
+            }
+            if let Some(panic) = panic {
+                panic::resume_unwind(panic);
+            }
+            result
+        })
+    }
+}
+
+impl Default for ParallelReader {
+    fn default() -> ParallelReader {
+        ParallelReader::new()
+    }
+}
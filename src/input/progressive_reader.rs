@@ -0,0 +1,290 @@
+use std::fs::File;
+use std::io::Read;
+use std::path::Path;
+use std::ptr;
+
+use libc::c_char;
+
+use openexr_sys::*;
+
+use error::*;
+use frame_buffer::FrameBufferMut;
+use Header;
+
+use super::{InputFile, InputOptions};
+
+// The magic number at the start of every OpenEXR file.
+const MAGIC: [u8; 4] = [0x76, 0x2f, 0x31, 0x01];
+
+// The file format version, and the version field flags for tiled, deep and
+// multi-part files, as in ImfVersion.h.
+const VERSION: u32 = 2;
+const NOT_SINGLE_PART_SCANLINE: u32 = 0x200 | 0x800 | 0x1000;
+
+/// Reads a scanline file while it's still being written.
+///
+/// OpenEXR writes a scanline file's chunks one after another as they're
+/// finished, for example by `ScanlineOutputFile::write_pixels_incremental()`,
+/// but only fills in the table of where they are once the file is closed.
+/// A `ProgressiveReader` keeps reading whatever has been appended to the file
+/// so far, and tracks which chunks are complete, so that they can be read
+/// without waiting for the rest of the file.
+///
+/// The data is kept in memory, and each `refresh()` that finds new data opens
+/// it again, since OpenEXR only finds the chunks that are present when a file
+/// is opened.  The file is assumed to only be appended to, since bytes that
+/// have been read are never read again.  That includes the offset table,
+/// whose eventual contents aren't needed.
+///
+/// Only single-part scanline files are supported.
+///
+/// # Examples
+///
+/// Read a file in bands of 16 scanlines as they become available:
+///
+/// ```no_run
+/// # use openexr::input::ProgressiveReader;
+/// # use openexr::FrameBufferMut;
+/// #
+/// let mut reader = ProgressiveReader::open("still_rendering.exr").unwrap();
+/// while reader.header().is_none() {
+///     std::thread::sleep(std::time::Duration::from_millis(100));
+///     reader.refresh().unwrap();
+/// }
+/// let (width, height) = reader.header().unwrap().data_dimensions();
+/// let origin = reader.header().unwrap().data_origin();
+///
+/// let mut pixel_data = vec![(0.0f32, 0.0f32, 0.0f32); width as usize * 16];
+/// let mut row = 0;
+/// while row < height {
+///     let rows = (height - row).min(16);
+///     if reader.scanlines_complete(row, rows) {
+///         let mut fb = FrameBufferMut::new_with_origin(origin.0, origin.1, width, rows);
+///         fb.insert_channels(
+///             &[("R", 0.0), ("G", 0.0), ("B", 0.0)],
+///             &mut pixel_data[..(width * rows) as usize],
+///         );
+///         reader.read_pixels_partial(row, &mut fb).unwrap();
+///         row += rows;
+///     } else {
+///         std::thread::sleep(std::time::Duration::from_millis(100));
+///         reader.refresh().unwrap();
+///     }
+/// }
+/// ```
+pub struct ProgressiveReader<R: Read> {
+    // Declared before `data`, which it reads from, so that it's dropped
+    // first.
+    file: Option<InputFile<'static>>,
+    data: Vec<u8>,
+    source: R,
+    options: InputOptions,
+    complete: Vec<bool>,
+}
+
+impl ProgressiveReader<File> {
+    /// Creates a progressive reader for the file at `path`, reading what has
+    /// been written of it so far.
+    pub fn open<P: AsRef<Path>>(path: P) -> Result<ProgressiveReader<File>> {
+        let path = path.as_ref();
+        let file = File::open(path)
+            .map_err(|e| Error::Generic(format!("couldn't open {}: {}", path.display(), e)))?;
+        ProgressiveReader::new(file)
+    }
+}
+
+impl<R: Read> ProgressiveReader<R> {
+    /// Creates a progressive reader for the data from `source`, reading what
+    /// is available of it so far.
+    ///
+    /// `source` should return end-of-file whenever it has no more data for
+    /// now, as `File`s do, and return any data added since on the next read.
+    pub fn new(source: R) -> Result<ProgressiveReader<R>> {
+        ProgressiveReader::new_with_options(source, &InputOptions::new())
+    }
+
+    /// Creates a progressive reader for the data from `source` that opens it
+    /// with the given `options`.
+    ///
+    /// See `new()` for details.  The read-ahead buffer size isn't used, since
+    /// the data is read from memory.
+    pub fn new_with_options(source: R, options: &InputOptions) -> Result<ProgressiveReader<R>> {
+        let mut reader = ProgressiveReader {
+            file: None,
+            data: Vec::new(),
+            source: source,
+            options: *options,
+            complete: Vec::new(),
+        };
+        reader.refresh()?;
+        Ok(reader)
+    }
+
+    /// Reads any data added to the file since the last refresh, and updates
+    /// which chunks are complete.
+    ///
+    /// Returns whether more chunks are complete than before.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the data isn't a single-part scanline OpenEXR
+    /// file, or can't be opened for any other reason once its header and
+    /// offset table have been written, or if there is an I/O error.  A file
+    /// whose header or offset table hasn't been completely written yet isn't
+    /// an error, but leaves `header()` as `None`.
+    pub fn refresh(&mut self) -> Result<bool> {
+        let mut new_data = Vec::new();
+        self.source
+            .read_to_end(&mut new_data)
+            .map_err(|e| Error::Generic(format!("couldn't read file: {}", e)))?;
+        if new_data.is_empty() {
+            return Ok(false);
+        }
+
+        // The file has to be closed before `data` may move.
+        self.file = None;
+        self.data.extend_from_slice(&new_data);
+        if self.data.len() >= MAGIC.len() && self.data[..MAGIC.len()] != MAGIC {
+            return Err(Error::Generic("not an OpenEXR file".to_string()));
+        }
+
+        let istream_ptr = unsafe {
+            CEXR_IStream_from_memory(
+                b"in-memory data\0".as_ptr() as *const c_char,
+                self.data.as_ptr() as *mut u8 as *mut c_char,
+                self.data.len(),
+            )
+        };
+        let mut file = match InputFile::from_istream(istream_ptr, &self.options) {
+            Ok(file) => file,
+            Err(_) if is_unfinished(&self.data) => return Ok(false),
+            Err(e) => return Err(e),
+        };
+        let complete = file.complete_chunks()?;
+        let newly_complete = count_complete(&complete) > count_complete(&self.complete);
+        self.complete = complete;
+        self.file = Some(file);
+        Ok(newly_complete)
+    }
+
+    /// Access to the file's header, once it has been written.
+    pub fn header(&self) -> Option<&Header> {
+        self.file.as_ref().map(|file| file.header())
+    }
+
+    /// Returns which of the file's chunks were complete as of the last
+    /// refresh, in order from the top of the data window.
+    ///
+    /// Each chunk holds `Header::scanlines_per_chunk()` scanlines, apart from
+    /// possibly the last one.  This is empty until the header has been
+    /// written.
+    pub fn complete_chunks(&self) -> &[bool] {
+        &self.complete
+    }
+
+    /// Returns whether the whole file was complete as of the last refresh.
+    pub fn is_complete(&self) -> bool {
+        !self.complete.is_empty() && self.complete.iter().all(|&complete| complete)
+    }
+
+    /// Returns whether `rows` scanlines starting at `starting_scanline` were
+    /// complete as of the last refresh, and so can be read.
+    ///
+    /// `starting_scanline` is counted from the top of the data window, as
+    /// with `read_pixels_partial()`.
+    pub fn scanlines_complete(&self, starting_scanline: u32, rows: u32) -> bool {
+        let chunk_rows = match self.header() {
+            Some(header) => header.scanlines_per_chunk(),
+            None => return false,
+        };
+        if rows == 0 {
+            return true;
+        }
+        let first_chunk = (starting_scanline / chunk_rows) as usize;
+        let last_chunk = ((starting_scanline + rows - 1) / chunk_rows) as usize;
+        last_chunk < self.complete.len()
+            && self.complete[first_chunk..last_chunk + 1]
+                .iter()
+                .all(|&complete| complete)
+    }
+
+    /// Reads a contiguous chunk of scanlines into `framebuffer`, as with
+    /// `InputFile::read_pixels_partial()`.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the scanlines weren't all complete as of the last
+    /// refresh, as well as in the cases that
+    /// `InputFile::read_pixels_partial()` does.
+    pub fn read_pixels_partial(
+        &mut self,
+        starting_scanline: u32,
+        framebuffer: &mut FrameBufferMut,
+    ) -> Result<()> {
+        let rows = framebuffer.dimensions().1;
+        if !self.scanlines_complete(starting_scanline, rows) {
+            return Err(Error::Generic(format!(
+                "scanlines {} to {} haven't been completely written yet",
+                starting_scanline,
+                starting_scanline + rows - 1
+            )));
+        }
+        self.file
+            .as_mut()
+            .unwrap()
+            .read_pixels_partial(starting_scanline, framebuffer)
+    }
+}
+
+// Whether `data` is the start of a single-part scanline file whose header or
+// offset table hasn't been completely written yet.
+fn is_unfinished(data: &[u8]) -> bool {
+    if data.len() < 8 {
+        return true;
+    }
+    let mut version = [0; 4];
+    version.copy_from_slice(&data[4..8]);
+    let version = u32::from_le_bytes(version);
+    if version & 0xff != VERSION || version & NOT_SINGLE_PART_SCANLINE != 0 {
+        return false;
+    }
+    let header = match Header::read_from_slice(data) {
+        Ok(header) => header,
+        Err(_) => return true,
+    };
+
+    // The header is complete, so the offset table is all that's left.
+    let height = header.data_dimensions().1;
+    let chunk_rows = header.scanlines_per_chunk();
+    let count = ((height + chunk_rows - 1) / chunk_rows) as usize;
+    let mut offsets = vec![0u64; count];
+    let mut sizes = vec![0u64; count];
+    let mut table_end = 0;
+    let mut error_out = ptr::null();
+    unsafe {
+        let istream_ptr = CEXR_IStream_from_memory(
+            b"in-memory data\0".as_ptr() as *const c_char,
+            data.as_ptr() as *mut u8 as *mut c_char,
+            data.len(),
+        );
+        let error = CEXR_IStream_read_chunk_table(
+            istream_ptr,
+            offsets.as_mut_ptr(),
+            sizes.as_mut_ptr(),
+            count,
+            &mut table_end,
+            &mut error_out,
+        );
+        CEXR_IStream_delete(istream_ptr);
+        if error != 0 {
+            // Only frees the message, since the table running out is the
+            // only way for a single-part scanline file's table to fail.
+            Error::take(error_out);
+        }
+        error != 0
+    }
+}
+
+fn count_complete(chunks: &[bool]) -> usize {
+    chunks.iter().filter(|&&complete| complete).count()
+}
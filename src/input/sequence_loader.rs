@@ -0,0 +1,523 @@
+use std::fs::File;
+use std::mem;
+use std::ops::Range;
+use std::panic;
+use std::path::Path;
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::thread::{self, JoinHandle};
+
+use cexr_type_aliases::Box2i;
+use error::*;
+use frame_buffer::{FrameBufferMut, PixelStruct};
+
+use super::{InputFile, InputOptions};
+
+/// Options for creating a `SequenceLoader`.
+///
+/// This follows the builder pattern, like `InputOptions`.
+#[derive(Debug, Copy, Clone)]
+pub struct SequenceOptions {
+    threads: usize,
+    memory_budget: usize,
+}
+
+impl SequenceOptions {
+    /// Creates a new set of options with default settings: one worker
+    /// thread per CPU, and a memory budget of 1 GiB.
+    pub fn new() -> Self {
+        SequenceOptions {
+            threads: thread::available_parallelism()
+                .map(|threads| threads.get())
+                .unwrap_or(1),
+            memory_budget: 1 << 30,
+        }
+    }
+
+    /// Sets the number of frames decoded at the same time, each on its own
+    /// worker thread.  At least one worker is always used.
+    pub fn set_threads(&mut self, threads: usize) -> &mut Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Sets the maximum number of bytes of decoded pixels kept in memory.
+    ///
+    /// This covers the frames held by the loader and the ones being
+    /// decoded, but not the file data, which is read as it's decoded.  A single
+    /// frame larger than the budget is still loaded when nothing else is.
+    pub fn set_memory_budget(&mut self, bytes: usize) -> &mut Self {
+        self.memory_budget = bytes;
+        self
+    }
+}
+
+impl Default for SequenceOptions {
+    fn default() -> SequenceOptions {
+        SequenceOptions::new()
+    }
+}
+
+/// A decoded frame of an image sequence.
+#[derive(Debug)]
+pub struct Frame<T> {
+    index: usize,
+    data_window: Box2i,
+    display_window: Box2i,
+    pixels: Vec<T>,
+}
+
+impl<T> Frame<T> {
+    /// The frame's number in the sequence.
+    pub fn index(&self) -> usize {
+        self.index
+    }
+
+    /// The data window of the frame's file.
+    pub fn data_window(&self) -> &Box2i {
+        &self.data_window
+    }
+
+    /// The display window of the frame's file.
+    pub fn display_window(&self) -> &Box2i {
+        &self.display_window
+    }
+
+    /// The dimensions of the data window.
+    pub fn dimensions(&self) -> (u32, u32) {
+        (
+            (self.data_window.max.x - self.data_window.min.x + 1) as u32,
+            (self.data_window.max.y - self.data_window.min.y + 1) as u32,
+        )
+    }
+
+    /// The pixels of the data window, in scanline order.
+    pub fn pixels(&self) -> &[T] {
+        &self.pixels
+    }
+}
+
+/// Loads the frames of an image sequence in the background, for playback.
+///
+/// Frames are decoded on worker threads, several at a time, starting with
+/// the frames nearest the playhead (see `set_playhead()`) and preferring
+/// the ones after it on ties.  They're kept in memory until the memory
+/// budget runs out, at which point the least recently used frames are
+/// evicted to make room for frames nearer the playhead, while frames
+/// nearer the playhead than any missing frame are kept.
+///
+/// Each file is read and decoded straight into the frame's pixel
+/// buffer, with all of the channels given exactly as with
+/// `FrameBufferMut::insert_channels()`.  Frames are handed out as
+/// `Arc`s, so a frame that's evicted while in use stays valid, but no
+/// longer counts against the memory budget.
+///
+/// # Examples
+///
+/// ```no_run
+/// # use openexr::input::{SequenceLoader, SequenceOptions};
+/// #
+/// let loader = SequenceLoader::<(f32, f32, f32)>::new(
+///     1001..1101,
+///     &[("R", 0.0), ("G", 0.0), ("B", 0.0)],
+///     |frame| format!("shot.{}.exr", frame),
+///     SequenceOptions::new().set_memory_budget(4 << 30),
+/// );
+/// for frame in 1001..1101 {
+///     let frame = loader.wait(frame).unwrap();
+///     println!("frame {}: {:?}", frame.index(), frame.dimensions());
+/// }
+/// ```
+pub struct SequenceLoader<T> {
+    shared: Arc<Shared<T>>,
+    workers: Vec<JoinHandle<()>>,
+}
+
+impl<T> SequenceLoader<T>
+where
+    T: PixelStruct + Copy + Default + Send + Sync + 'static,
+{
+    /// Starts loading the frames in `frames`, with `path_for` giving the
+    /// path of each frame's file.  The playhead starts at the first frame.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `frames` is empty.  Panics in `path_for` are reported as
+    /// errors for the frame.
+    pub fn new<F, P>(
+        frames: Range<usize>,
+        channels: &[(&str, f64)],
+        path_for: F,
+        options: &SequenceOptions,
+    ) -> SequenceLoader<T>
+    where
+        F: Fn(usize) -> P + Send + Sync + 'static,
+        P: AsRef<Path>,
+    {
+        assert!(frames.start < frames.end, "frame range must not be empty");
+
+        let shared = Arc::new(Shared {
+            state: Mutex::new(State {
+                slots: (frames.start..frames.end).map(|_| Slot::Missing).collect(),
+                first_frame: frames.start,
+                playhead: 0,
+                memory_used: 0,
+                memory_budget: options.memory_budget,
+                clock: 0,
+                generation: 0,
+                shutdown: false,
+            }),
+            changed: Condvar::new(),
+        });
+        let channels: Arc<Vec<(String, f64)>> = Arc::new(
+            channels
+                .iter()
+                .map(|&(name, fill)| (name.to_string(), fill))
+                .collect(),
+        );
+        let path_for = Arc::new(path_for);
+
+        let workers = (0..options.threads.max(1))
+            .map(|_| {
+                let shared = shared.clone();
+                let channels = channels.clone();
+                let path_for = path_for.clone();
+                thread::spawn(move || shared.work(&*channels, &*path_for))
+            })
+            .collect();
+
+        SequenceLoader {
+            shared: shared,
+            workers: workers,
+        }
+    }
+
+    /// Moves the playhead to `frame`, which reprioritizes loading around
+    /// it.  Frames outside of the range move it to the nearest end.
+    pub fn set_playhead(&self, frame: usize) {
+        let mut state = self.shared.lock();
+        let slot = state.slot_index(frame);
+        if state.playhead != slot {
+            state.playhead = slot;
+            state.changed();
+            self.shared.changed.notify_all();
+        }
+    }
+
+    /// Returns `frame` if it's loaded, marking it as recently used, or the
+    /// error it failed to load with.
+    ///
+    /// Returns `None` if it isn't loaded (yet), or is outside of the range.
+    pub fn get(&self, frame: usize) -> Option<Result<Arc<Frame<T>>>> {
+        let mut state = self.shared.lock();
+        if frame < state.first_frame || frame - state.first_frame >= state.slots.len() {
+            return None;
+        }
+        let slot = frame - state.first_frame;
+        state.take(slot)
+    }
+
+    /// Moves the playhead to `frame` and waits until it's loaded.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if `frame` is outside of the range, or couldn't be
+    /// loaded.
+    pub fn wait(&self, frame: usize) -> Result<Arc<Frame<T>>> {
+        self.set_playhead(frame);
+        let mut state = self.shared.lock();
+        if frame < state.first_frame || frame - state.first_frame >= state.slots.len() {
+            return Err(Error::Generic(format!(
+                "frame {} is outside of the sequence's range",
+                frame
+            )));
+        }
+        let slot = frame - state.first_frame;
+        loop {
+            if let Some(result) = state.take(slot) {
+                return result;
+            }
+            state = self.shared.changed.wait(state).unwrap();
+        }
+    }
+
+    /// The number of bytes of decoded pixels currently held, including
+    /// frames being decoded.
+    pub fn memory_used(&self) -> usize {
+        self.shared.lock().memory_used
+    }
+}
+
+impl<T> Drop for SequenceLoader<T> {
+    fn drop(&mut self) {
+        self.shared.lock().shutdown = true;
+        self.shared.changed.notify_all();
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+    }
+}
+
+// The state shared between a `SequenceLoader` and its workers.  `changed`
+// is notified whenever `state` changes in a way that could unblock a
+// worker or a `wait()`.
+struct Shared<T> {
+    state: Mutex<State<T>>,
+    changed: Condvar,
+}
+
+struct State<T> {
+    slots: Vec<Slot<T>>,
+    first_frame: usize,
+    playhead: usize, // A slot index
+    memory_used: usize,
+    memory_budget: usize,
+    clock: u64,      // Counts uses, for least recently used eviction
+    generation: u64, // Counts changes of the playhead and of frames' slots
+    shutdown: bool,
+}
+
+enum Slot<T> {
+    Missing,
+    Loading,
+    Loaded {
+        frame: Arc<Frame<T>>,
+        last_used: u64,
+    },
+    Failed(Error),
+}
+
+impl<T> State<T> {
+    fn slot_index(&self, frame: usize) -> usize {
+        frame
+            .saturating_sub(self.first_frame)
+            .min(self.slots.len() - 1)
+    }
+
+    fn changed(&mut self) {
+        self.generation += 1;
+    }
+
+    // The distance of slot `i` from the playhead, ordered so that slots
+    // after the playhead come before slots the same distance before it.
+    fn priority(&self, i: usize) -> (usize, bool) {
+        if i >= self.playhead {
+            (i - self.playhead, false)
+        } else {
+            (self.playhead - i, true)
+        }
+    }
+
+    // The missing frame nearest the playhead.
+    fn next_to_load(&self) -> Option<usize> {
+        (0..self.slots.len())
+            .filter(|&i| match self.slots[i] {
+                Slot::Missing => true,
+                _ => false,
+            })
+            .min_by_key(|&i| self.priority(i))
+    }
+
+    // The least recently used loaded frame further from the playhead than
+    // slot `i`.
+    fn eviction_victim(&self, i: usize) -> Option<usize> {
+        let priority = self.priority(i);
+        (0..self.slots.len())
+            .filter_map(|j| match self.slots[j] {
+                Slot::Loaded { last_used, .. } if self.priority(j) > priority => {
+                    Some((j, last_used))
+                }
+                _ => None,
+            })
+            .min_by_key(|&(_, last_used)| last_used)
+            .map(|(j, _)| j)
+    }
+
+    fn take(&mut self, i: usize) -> Option<Result<Arc<Frame<T>>>> {
+        self.clock += 1;
+        match self.slots[i] {
+            Slot::Loaded {
+                ref frame,
+                ref mut last_used,
+            } => {
+                *last_used = self.clock;
+                Some(Ok(frame.clone()))
+            }
+            Slot::Failed(ref e) => Some(Err(e.clone())),
+            _ => None,
+        }
+    }
+}
+
+impl<T> Shared<T> {
+    fn lock(&self) -> MutexGuard<'_, State<T>> {
+        self.state.lock().unwrap()
+    }
+}
+
+impl<T> Shared<T>
+where
+    T: PixelStruct + Copy + Default,
+{
+    // The loop of a worker thread.
+    fn work<F, P>(&self, channels: &[(String, f64)], path_for: &F)
+    where
+        F: Fn(usize) -> P,
+        P: AsRef<Path>,
+    {
+        let channels: Vec<(&str, f64)> = channels
+            .iter()
+            .map(|&(ref name, fill)| (&name[..], fill))
+            .collect();
+        let mut state = self.lock();
+        loop {
+            if state.shutdown {
+                return;
+            }
+            let i = match state.next_to_load() {
+                Some(i) => i,
+                None => {
+                    state = self.changed.wait(state).unwrap();
+                    continue;
+                }
+            };
+            state.slots[i] = Slot::Loading;
+            let frame = state.first_frame + i;
+            drop(state);
+
+            let result = panic::catch_unwind(panic::AssertUnwindSafe(|| {
+                self.load(i, frame, &channels, path_for)
+            }))
+            .unwrap_or_else(|_| {
+                Err(Error::Generic(format!(
+                    "panicked while loading frame {}",
+                    frame
+                )))
+            });
+
+            state = self.lock();
+            let slot = match result {
+                Ok(Some(frame)) => {
+                    state.clock += 1;
+                    Slot::Loaded {
+                        frame: Arc::new(frame),
+                        last_used: state.clock,
+                    }
+                }
+                Ok(None) => {
+                    // Postponed, which isn't a change anyone waits for.
+                    state.slots[i] = Slot::Missing;
+                    continue;
+                }
+                Err(e) => Slot::Failed(e),
+            };
+            state.slots[i] = slot;
+            state.changed();
+            self.changed.notify_all();
+        }
+    }
+
+    // Loads slot `i`, or returns `None` if there's no room for it (after
+    // waiting for a change that might make room).
+    fn load<F, P>(
+        &self,
+        i: usize,
+        frame: usize,
+        channels: &[(&str, f64)],
+        path_for: &F,
+    ) -> Result<Option<Frame<T>>>
+    where
+        F: Fn(usize) -> P,
+        P: AsRef<Path>,
+    {
+        let path = path_for(frame);
+        let path = path.as_ref();
+        let mut reader = File::open(path)
+            .map_err(|e| Error::Generic(format!("couldn't open {}: {}", path.display(), e)))?;
+        let mut file =
+            InputFile::new_with_options(&mut reader, InputOptions::new().set_threads(0))?;
+        let data_window = *file.header().data_window();
+        let display_window = *file.header().display_window();
+        let (width, height) = file.header().data_dimensions();
+        let len = width as usize * height as usize;
+        let reservation = match self.reserve(i, len * mem::size_of::<T>()) {
+            Some(reservation) => reservation,
+            None => return Ok(None),
+        };
+
+        let mut pixels = vec![T::default(); len];
+        let result = {
+            let mut fb = FrameBufferMut::new_with_origin(
+                data_window.min.x,
+                data_window.min.y,
+                width,
+                height,
+            );
+            fb.insert_channels(channels, &mut pixels);
+            file.read_pixels(&mut fb)
+        };
+        result?;
+        reservation.commit();
+        Ok(Some(Frame {
+            index: frame,
+            data_window: data_window,
+            display_window: display_window,
+            pixels: pixels,
+        }))
+    }
+
+    // Reserves `bytes` of the memory budget for slot `i`, evicting frames
+    // further from the playhead as needed.  If that's not enough, waits
+    // for a change that might help and returns `None`.
+    fn reserve(&self, i: usize, bytes: usize) -> Option<Reservation<'_, T>> {
+        let mut state = self.lock();
+        while state.memory_used > 0 && state.memory_used + bytes > state.memory_budget {
+            match state.eviction_victim(i) {
+                Some(j) => {
+                    if let Slot::Loaded { ref frame, .. } = state.slots[j] {
+                        state.memory_used -= frame.pixels.len() * mem::size_of::<T>();
+                    }
+                    state.slots[j] = Slot::Missing;
+                    state.changed();
+                }
+                None => {
+                    let generation = state.generation;
+                    while state.generation == generation && !state.shutdown {
+                        state = self.changed.wait(state).unwrap();
+                    }
+                    return None;
+                }
+            }
+        }
+        state.memory_used += bytes;
+        Some(Reservation {
+            shared: self,
+            bytes: bytes,
+        })
+    }
+}
+
+// Bytes of the memory budget reserved for a frame being loaded.  They're
+// given back when this is dropped, e.g. because reading the frame failed or
+// panicked, unless the loaded frame took them over with `commit()`.
+struct Reservation<'a, T: 'a> {
+    shared: &'a Shared<T>,
+    bytes: usize,
+}
+
+impl<'a, T> Reservation<'a, T> {
+    // Keeps the bytes reserved.  They're given back when the frame is
+    // evicted.
+    fn commit(mut self) {
+        self.bytes = 0;
+    }
+}
+
+impl<'a, T> Drop for Reservation<'a, T> {
+    fn drop(&mut self) {
+        if self.bytes > 0 {
+            // The lock might be poisoned if this is dropped while unwinding.
+            let mut state = self.shared.state.lock().unwrap_or_else(|e| e.into_inner());
+            state.memory_used -= self.bytes;
+        }
+    }
+}
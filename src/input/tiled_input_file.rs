@@ -0,0 +1,583 @@
+use std::io::{Read, Seek};
+use std::marker::PhantomData;
+use std::path::Path;
+use std::ptr;
+
+use libc::c_char;
+
+use openexr_sys::*;
+
+use cexr_type_aliases::{Box2i, LevelMode};
+use error::*;
+use frame_buffer::FrameBufferMut;
+use stream_io::{read_stream, seek_stream};
+use threads::c_thread_count;
+use Header;
+
+use super::{mmap_istream, InputOptions};
+
+/// Reads tiled OpenEXR files.
+///
+/// Unlike `InputFile`, this gives access to the individual tiles of the
+/// file, so that a region of the image can be read without decoding the rest
+/// of it.
+///
+/// Tile coordinates are given as `(column, row)` of the tile in the grid of
+/// tiles, with `(0, 0)` being the tile in the top left corner of the data
+/// window.
+///
+/// # Examples
+///
+/// Load the top left tile of a floating point RGB image file named
+/// "input_file.exr".
+///
+/// ```no_run
+/// # use openexr::{FrameBufferMut, TiledInputFile};
+/// #
+/// let mut file = std::fs::File::open("input_file.exr").unwrap();
+/// let mut input_file = TiledInputFile::new(&mut file).unwrap();
+///
+/// // Find out where the tile is and how large it is.
+/// let window = input_file.tile_data_window(0, 0).unwrap();
+/// let width = (window.max.x - window.min.x + 1) as u32;
+/// let height = (window.max.y - window.min.y + 1) as u32;
+///
+/// // Allocate a buffer for just that tile and read it in.
+/// let mut pixel_data = vec![(0.0f32, 0.0f32, 0.0f32); (width * height) as usize];
+/// let mut fb = FrameBufferMut::new_with_origin(window.min.x, window.min.y, width, height);
+/// fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut pixel_data);
+/// input_file.read_tile(0, 0, &mut fb).unwrap();
+/// ```
+#[allow(dead_code)]
+pub struct TiledInputFile<'a> {
+    handle: *mut CEXR_TiledInputFile,
+    header_ref: Header,
+    istream: *mut CEXR_IStream,
+    _phantom_1: PhantomData<CEXR_TiledInputFile>,
+    _phantom_2: PhantomData<&'a mut ()>, // Represents the borrowed reader
+
+                                         // NOTE: Because we don't know what type the reader might be, it's important
+                                         // that this struct remains neither Sync nor Send.  Please don't implement
+                                         // them!
+}
+
+impl<'a> TiledInputFile<'a> {
+    /// Creates a new `TiledInputFile` from any `Read + Seek` type (typically
+    /// a `std::fs::File`).
+    ///
+    /// Note: this seeks to byte 0 before reading.
+    pub fn new<T: 'a>(reader: &mut T) -> Result<TiledInputFile>
+    where
+        T: Read + Seek,
+    {
+        TiledInputFile::new_with_options(reader, &InputOptions::new())
+    }
+
+    /// Creates a new `TiledInputFile` from any `Read + Seek` type (typically
+    /// a `std::fs::File`), using the given `options`.
+    ///
+    /// Note: this seeks to byte 0 before reading.
+    pub fn new_with_options<T: 'a>(
+        reader: &'a mut T,
+        options: &InputOptions,
+    ) -> Result<TiledInputFile<'a>>
+    where
+        T: Read + Seek,
+    {
+        let istream_ptr = {
+            let read_ptr = read_stream::<T>;
+            let seekp_ptr = seek_stream::<T>;
+
+            let mut error_out = ptr::null();
+            let mut out = ptr::null_mut();
+            let error = unsafe {
+                CEXR_IStream_from_reader(
+                    reader as *mut T as *mut _,
+                    Some(read_ptr),
+                    Some(seekp_ptr),
+                    options.buffer_size,
+                    &mut out,
+                    &mut error_out,
+                )
+            };
+
+            if error != 0 {
+                return Err(Error::take(error_out));
+            } else {
+                out
+            }
+        };
+
+        TiledInputFile::from_istream(istream_ptr, options)
+    }
+
+    /// Creates a new `TiledInputFile` from a slice of bytes, reading from
+    /// memory.
+    pub fn from_slice(slice: &[u8]) -> Result<TiledInputFile> {
+        TiledInputFile::from_slice_with_options(slice, &InputOptions::new())
+    }
+
+    /// Creates a new `TiledInputFile` from a slice of bytes, reading from
+    /// memory, using the given `options`.
+    pub fn from_slice_with_options(
+        slice: &'a [u8],
+        options: &InputOptions,
+    ) -> Result<TiledInputFile<'a>> {
+        let istream_ptr = unsafe {
+            CEXR_IStream_from_memory(
+                b"in-memory data\0".as_ptr() as *const c_char,
+                slice.as_ptr() as *mut u8 as *mut c_char,
+                slice.len(),
+            )
+        };
+
+        TiledInputFile::from_istream(istream_ptr, options)
+    }
+
+    /// Creates a new `TiledInputFile` by memory mapping the file at `path`.
+    ///
+    /// See `InputFile::from_path_mmap()` for details.
+    ///
+    /// # Safety
+    ///
+    /// As with `InputFile::from_path_mmap()`.
+    pub unsafe fn from_path_mmap<P: AsRef<Path>>(path: P) -> Result<TiledInputFile<'static>> {
+        TiledInputFile::from_path_mmap_with_options(path, &InputOptions::new())
+    }
+
+    /// Creates a new `TiledInputFile` by memory mapping the file at `path`,
+    /// using the given `options`.
+    ///
+    /// See `InputFile::from_path_mmap()` for details.
+    ///
+    /// # Safety
+    ///
+    /// As with `InputFile::from_path_mmap()`.
+    pub unsafe fn from_path_mmap_with_options<P: AsRef<Path>>(
+        path: P,
+        options: &InputOptions,
+    ) -> Result<TiledInputFile<'static>> {
+        let istream_ptr = mmap_istream(path.as_ref())?;
+        TiledInputFile::from_istream(istream_ptr, options)
+    }
+
+    // Shared code for the constructors above.  Takes ownership of
+    // `istream_ptr`, deleting it if the file can't be opened.
+    fn from_istream(
+        istream_ptr: *mut CEXR_IStream,
+        options: &InputOptions,
+    ) -> Result<TiledInputFile<'a>> {
+        let threads = match c_thread_count(options.threads) {
+            Ok(threads) => threads,
+            Err(e) => {
+                unsafe { CEXR_IStream_delete(istream_ptr) };
+                return Err(e);
+            }
+        };
+
+        let mut error_out = ptr::null();
+        let mut out = ptr::null_mut();
+        let error = unsafe {
+            CEXR_TiledInputFile_from_stream(istream_ptr, threads, &mut out, &mut error_out)
+        };
+        if error != 0 {
+            unsafe { CEXR_IStream_delete(istream_ptr) };
+            Err(Error::take(error_out))
+        } else {
+            Ok(TiledInputFile {
+                handle: out,
+                header_ref: Header::borrowed(unsafe { CEXR_TiledInputFile_header(out) }),
+                istream: istream_ptr,
+                _phantom_1: PhantomData,
+                _phantom_2: PhantomData,
+            })
+        }
+    }
+
+    /// Returns the width and height of the tiles, in pixels.
+    ///
+    /// Note that tiles at the right and bottom edges of the image may be
+    /// smaller than this.  Use `tile_data_window()` to get the exact extent
+    /// of a given tile.
+    pub fn tile_dimensions(&self) -> (u32, u32) {
+        let td = self
+            .header()
+            .tile_description()
+            .expect("tiled file has no tile description");
+        (td.x_size, td.y_size)
+    }
+
+    /// Returns the number of tiles in each dimension at full resolution.
+    pub fn num_tiles(&self) -> (u32, u32) {
+        self.num_tiles_at_level((0, 0))
+            .expect("tiled file has no full resolution level")
+    }
+
+    /// Returns which resolution levels are stored in the file.
+    pub fn level_mode(&self) -> LevelMode {
+        self.header()
+            .tile_description()
+            .expect("tiled file has no tile description")
+            .mode
+    }
+
+    /// Returns the number of resolution levels in each dimension.
+    ///
+    /// Level `(0, 0)` is the full resolution image, and each successive level
+    /// halves the resolution in its dimension.  For `ONE_LEVEL` files this is
+    /// `(1, 1)`.  For `MIPMAP_LEVELS` files both numbers are the same, and the
+    /// valid levels are `(l, l)`.  For `RIPMAP_LEVELS` files any combination
+    /// of x and y levels is valid.
+    pub fn num_levels(&self) -> (u32, u32) {
+        let mut error_out = ptr::null();
+        let mut x_levels = 0;
+        let mut y_levels = 0;
+        let error =
+            unsafe { CEXR_TiledInputFile_num_x_levels(self.handle, &mut x_levels, &mut error_out) };
+        if error != 0 {
+            panic!("{}", Error::take(error_out));
+        }
+        let error =
+            unsafe { CEXR_TiledInputFile_num_y_levels(self.handle, &mut y_levels, &mut error_out) };
+        if error != 0 {
+            panic!("{}", Error::take(error_out));
+        }
+        (x_levels as u32, y_levels as u32)
+    }
+
+    /// Returns the region covered by the given `(x, y)` resolution level.
+    ///
+    /// All levels share the minimum corner of the data window, and
+    /// framebuffers used with a level are positioned in these coordinates.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the level isn't in the file.
+    pub fn level_data_window(&self, level: (u32, u32)) -> Result<Box2i> {
+        let mut error_out = ptr::null();
+        let mut window = Header::box2i(0, 0, 1, 1);
+        let error = unsafe {
+            CEXR_TiledInputFile_data_window_for_level(
+                self.handle,
+                level.0 as i32,
+                level.1 as i32,
+                &mut window,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(window)
+        }
+    }
+
+    /// Returns the width and height of the given `(x, y)` resolution level,
+    /// in pixels.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the level isn't in the file.
+    pub fn level_dimensions(&self, level: (u32, u32)) -> Result<(u32, u32)> {
+        let window = self.level_data_window(level)?;
+        Ok((
+            (window.max.x - window.min.x + 1) as u32,
+            (window.max.y - window.min.y + 1) as u32,
+        ))
+    }
+
+    /// Returns the number of tiles in each dimension at the given `(x, y)`
+    /// resolution level.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the level isn't in the file.
+    pub fn num_tiles_at_level(&self, level: (u32, u32)) -> Result<(u32, u32)> {
+        // The per-dimension queries below only check each level number on
+        // its own, so validate the level as a whole first.
+        self.level_data_window(level)?;
+
+        let mut error_out = ptr::null();
+        let mut x_tiles = 0;
+        let mut y_tiles = 0;
+        let error = unsafe {
+            CEXR_TiledInputFile_num_x_tiles(
+                self.handle,
+                level.0 as i32,
+                &mut x_tiles,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            return Err(Error::take(error_out));
+        }
+        let error = unsafe {
+            CEXR_TiledInputFile_num_y_tiles(
+                self.handle,
+                level.1 as i32,
+                &mut y_tiles,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            return Err(Error::take(error_out));
+        }
+        Ok((x_tiles as u32, y_tiles as u32))
+    }
+
+    /// Returns the region of the data window covered by the given tile.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if there is no tile at the given coordinates.
+    pub fn tile_data_window(&self, tile_x: u32, tile_y: u32) -> Result<Box2i> {
+        self.tile_data_window_at_level(tile_x, tile_y, (0, 0))
+    }
+
+    /// Returns the region covered by the given tile of the given `(x, y)`
+    /// resolution level, in the coordinates of `level_data_window()`.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the level isn't in the file or there is no tile at
+    /// the given coordinates.
+    pub fn tile_data_window_at_level(
+        &self,
+        tile_x: u32,
+        tile_y: u32,
+        level: (u32, u32),
+    ) -> Result<Box2i> {
+        let mut error_out = ptr::null();
+        let mut window = Header::box2i(0, 0, 1, 1);
+        let error = unsafe {
+            CEXR_TiledInputFile_data_window_for_tile(
+                self.handle,
+                tile_x as i32,
+                tile_y as i32,
+                level.0 as i32,
+                level.1 as i32,
+                &mut window,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(window)
+        }
+    }
+
+    /// Reads a single tile into `framebuffer`.
+    ///
+    /// `framebuffer` uses the same coordinates as the data window, and it
+    /// must cover at least the region of the tile (see
+    /// `tile_data_window()`).  For example, it may be exactly the size of
+    /// the tile with its origin at the tile's upper left corner, or it may
+    /// cover the whole image.
+    ///
+    /// Any channels in `framebuffer` that are not present in the file will be
+    /// filled with their default fill value.
+    ///
+    /// # Errors
+    ///
+    /// This function expects any same-named channels to have matching types
+    /// and subsampling.
+    ///
+    /// It will also return an error if:
+    ///
+    /// * There is no tile at the given coordinates.
+    /// * `framebuffer` doesn't cover the tile.
+    /// * There is an I/O error.
+    pub fn read_tile(
+        &mut self,
+        tile_x: u32,
+        tile_y: u32,
+        framebuffer: &mut FrameBufferMut,
+    ) -> Result<()> {
+        self.read_tiles_at_level((tile_x, tile_y), (tile_x, tile_y), (0, 0), framebuffer)
+    }
+
+    /// Reads a rectangular range of tiles into `framebuffer`.
+    ///
+    /// `first_tile` and `last_tile` are the tile coordinates of the upper
+    /// left and lower right tiles of the range, inclusive.
+    ///
+    /// `framebuffer` uses the same coordinates as the data window, and it
+    /// must cover at least the region of the tiles being read.
+    ///
+    /// Any channels in `framebuffer` that are not present in the file will be
+    /// filled with their default fill value.
+    ///
+    /// # Errors
+    ///
+    /// This function expects any same-named channels to have matching types
+    /// and subsampling.
+    ///
+    /// It will also return an error if:
+    ///
+    /// * The range of tiles is empty or outside of the image.
+    /// * `framebuffer` doesn't cover the range of tiles.
+    /// * There is an I/O error.
+    pub fn read_tiles(
+        &mut self,
+        first_tile: (u32, u32),
+        last_tile: (u32, u32),
+        framebuffer: &mut FrameBufferMut,
+    ) -> Result<()> {
+        self.read_tiles_at_level(first_tile, last_tile, (0, 0), framebuffer)
+    }
+
+    /// Reads a single tile of the given `(x, y)` resolution level into
+    /// `framebuffer`.
+    ///
+    /// This is the same as `read_tile()`, except that the tile coordinates
+    /// and `framebuffer` are relative to the level (see
+    /// `level_data_window()` and `tile_data_window_at_level()`).
+    ///
+    /// # Errors
+    ///
+    /// The same as `read_tile()`, and additionally returns an error if the
+    /// level isn't in the file.
+    pub fn read_tile_at_level(
+        &mut self,
+        tile_x: u32,
+        tile_y: u32,
+        level: (u32, u32),
+        framebuffer: &mut FrameBufferMut,
+    ) -> Result<()> {
+        self.read_tiles_at_level((tile_x, tile_y), (tile_x, tile_y), level, framebuffer)
+    }
+
+    /// Reads a rectangular range of tiles of the given `(x, y)` resolution
+    /// level into `framebuffer`.
+    ///
+    /// This is the same as `read_tiles()`, except that the tile coordinates
+    /// and `framebuffer` are relative to the level (see
+    /// `level_data_window()` and `tile_data_window_at_level()`).
+    ///
+    /// # Errors
+    ///
+    /// The same as `read_tiles()`, and additionally returns an error if the
+    /// level isn't in the file.
+    pub fn read_tiles_at_level(
+        &mut self,
+        first_tile: (u32, u32),
+        last_tile: (u32, u32),
+        level: (u32, u32),
+        framebuffer: &mut FrameBufferMut,
+    ) -> Result<()> {
+        // ^^^ NOTE: it's not obvious, but this does indeed need to take self as
+        // &mut to be safe.  Even though it is not conceptually modifying the
+        // thing (typically a file) that it's reading from, it still has a
+        // cursor getting incremented etc. during reads, so the reference needs
+        // to be unique to avoid unsafe aliasing.
+
+        // Validation
+        if first_tile.0 > last_tile.0 || first_tile.1 > last_tile.1 {
+            return Err(Error::Generic(format!(
+                "tile range {},{} to {},{} is empty",
+                first_tile.0, first_tile.1, last_tile.0, last_tile.1
+            )));
+        }
+
+        let window = {
+            let first = self.tile_data_window_at_level(first_tile.0, first_tile.1, level)?;
+            let last = self.tile_data_window_at_level(last_tile.0, last_tile.1, level)?;
+            Box2i {
+                min: first.min,
+                max: last.max,
+            }
+        };
+        framebuffer.validate_covers(&window)?;
+
+        self.header().validate_framebuffer_for_input(framebuffer)?;
+
+        // Set up the framebuffer with the image
+        let mut error_out = ptr::null();
+
+        let error = unsafe {
+            CEXR_TiledInputFile_set_framebuffer(
+                self.handle,
+                framebuffer.handle_mut(),
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            return Err(Error::take(error_out));
+        }
+
+        // Read the image data
+        let error = unsafe {
+            CEXR_TiledInputFile_read_tiles(
+                self.handle,
+                first_tile.0 as i32,
+                last_tile.0 as i32,
+                first_tile.1 as i32,
+                last_tile.1 as i32,
+                level.0 as i32,
+                level.1 as i32,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(())
+        }
+    }
+
+    /// Reads the entire full resolution image into `framebuffer` at once.
+    ///
+    /// This is a convenience method that reads all of the tiles.
+    /// `framebuffer` must cover the entire data window.
+    ///
+    /// Any channels in `framebuffer` that are not present in the file will be
+    /// filled with their default fill value.
+    ///
+    /// # Errors
+    ///
+    /// This function expects any same-named channels to have matching types
+    /// and subsampling.
+    ///
+    /// It will also return an error if `framebuffer` doesn't cover the data
+    /// window or if there is an I/O error.
+    pub fn read_pixels(&mut self, framebuffer: &mut FrameBufferMut) -> Result<()> {
+        self.read_level((0, 0), framebuffer)
+    }
+
+    /// Reads the entire image of the given `(x, y)` resolution level into
+    /// `framebuffer` at once.
+    ///
+    /// `framebuffer` must cover the level's data window (see
+    /// `level_data_window()`).  This reads only the precomputed level from
+    /// the file, without touching the full resolution image.
+    ///
+    /// # Errors
+    ///
+    /// The same as `read_pixels()`, and additionally returns an error if the
+    /// level isn't in the file.
+    pub fn read_level(
+        &mut self,
+        level: (u32, u32),
+        framebuffer: &mut FrameBufferMut,
+    ) -> Result<()> {
+        let (x_tiles, y_tiles) = self.num_tiles_at_level(level)?;
+        self.read_tiles_at_level((0, 0), (x_tiles - 1, y_tiles - 1), level, framebuffer)
+    }
+
+    /// Access to the file's header.
+    pub fn header(&self) -> &Header {
+        &self.header_ref
+    }
+
+    pub(crate) fn handle_mut(&mut self) -> *mut CEXR_TiledInputFile {
+        self.handle
+    }
+}
+
+impl<'a> Drop for TiledInputFile<'a> {
+    fn drop(&mut self) {
+        unsafe { CEXR_TiledInputFile_delete(self.handle) };
+        unsafe { CEXR_IStream_delete(self.istream) };
+    }
+}
@@ -107,16 +107,27 @@ extern crate openexr_sys;
 mod cexr_type_aliases;
 mod stream_io;
 
+pub mod deep_frame_buffer;
 pub mod error;
 pub mod frame_buffer;
 pub mod header;
 pub mod input;
 pub mod output;
+pub mod planar_buffer;
+pub mod stats;
 pub mod threads;
 
 pub use cexr_type_aliases::{Box2i, PixelType};
+pub use deep_frame_buffer::{DeepFrameBuffer, DeepFrameBufferMut};
 pub use error::{Error, Result};
 pub use frame_buffer::{FrameBuffer, FrameBufferMut};
-pub use header::{Envmap, Header};
-pub use input::InputFile;
-pub use output::ScanlineOutputFile;
+pub use header::{Envmap, Header, PreviewImage, View};
+pub use input::{
+    BatchReader, ChunkIndex, ChunkIndexCache, DeepScanlineInputFile, InputFile, MultiPartInputFile,
+    ParallelReader, ProgressiveReader, SequenceLoader, TiledInputFile,
+};
+pub use output::{
+    DeepScanlineOutputFile, MultiPartOutputFile, ScanlineOutputFile, TiledOutputFile,
+};
+pub use planar_buffer::{BufferPool, PlanarBuffer};
+pub use stats::IoStats;
@@ -0,0 +1,276 @@
+use std::io::{Seek, Write};
+use std::marker::PhantomData;
+use std::ptr;
+
+use openexr_sys::*;
+
+use deep_frame_buffer::DeepFrameBuffer;
+use error::*;
+use stream_io::{seek_stream, write_stream};
+use threads::c_thread_count;
+use Header;
+
+use super::OutputOptions;
+
+/// Writes deep scanline OpenEXR files.
+///
+/// Deep files store a varying number of samples per pixel.  The samples to
+/// write are given by a `DeepFrameBuffer`, which holds the sample count of
+/// each pixel along with the samples themselves.  The header's type is
+/// always set to deep scanline, so the same `Header` methods can be used to
+/// describe the file as with `ScanlineOutputFile`.  Deep files only support
+/// the NONE, RLE, ZIPS and ZIP compression methods.
+///
+/// # Examples
+///
+/// Write a 2x1 image whose first pixel has two depth samples and whose
+/// second pixel has one to a file named "output_file.exr".
+///
+/// ```no_run
+/// # use openexr::{DeepFrameBuffer, DeepScanlineOutputFile, Header, PixelType};
+/// # use openexr::header::Compression;
+/// #
+/// let mut file = std::fs::File::create("output_file.exr").unwrap();
+/// let mut output_file = DeepScanlineOutputFile::new(
+///     &mut file,
+///     Header::new()
+///         .set_resolution(2, 1)
+///         .set_compression(Compression::ZIPS_COMPRESSION)
+///         .add_channel("Z", PixelType::FLOAT))
+///     .unwrap();
+///
+/// let sample_counts = [2, 1];
+/// let depths = [1.0f32, 2.0, 5.0];
+/// let mut fb = DeepFrameBuffer::new(2, 1, &sample_counts);
+/// fb.insert_channel("Z", &depths);
+/// output_file.write_pixels(&fb).unwrap();
+/// ```
+pub struct DeepScanlineOutputFile<'a> {
+    handle: *mut CEXR_DeepScanLineOutputFile,
+    header_ref: Header,
+    ostream: *mut CEXR_OStream,
+    scanlines_written: u32,
+    _phantom_1: PhantomData<CEXR_DeepScanLineOutputFile>,
+    _phantom_2: PhantomData<&'a mut ()>, // Represents the borrowed writer
+
+                                         // NOTE: Because we don't know what type the writer might be, it's important
+                                         // that this struct remains neither Sync nor Send.  Please don't implement
+                                         // them!
+}
+
+impl<'a> DeepScanlineOutputFile<'a> {
+    /// Creates a new `DeepScanlineOutputFile` from any `Write + Seek` type
+    /// (typically a `std::fs::File`) and `header`.
+    ///
+    /// Note: this seeks to byte 0 before writing.
+    pub fn new<T: 'a>(writer: &'a mut T, header: &Header) -> Result<DeepScanlineOutputFile<'a>>
+    where
+        T: Write + Seek,
+    {
+        DeepScanlineOutputFile::new_with_options(writer, header, &OutputOptions::new())
+    }
+
+    /// Creates a new `DeepScanlineOutputFile` from any `Write + Seek` type
+    /// (typically a `std::fs::File`) and `header`, using the given `options`.
+    ///
+    /// Note: this seeks to byte 0 before writing.
+    pub fn new_with_options<T: 'a>(
+        writer: &'a mut T,
+        header: &Header,
+        options: &OutputOptions,
+    ) -> Result<DeepScanlineOutputFile<'a>>
+    where
+        T: Write + Seek,
+    {
+        let threads = c_thread_count(options.threads)?;
+
+        let ostream_ptr = {
+            let write_ptr = write_stream::<T>;
+            let seekp_ptr = seek_stream::<T>;
+
+            let mut error_out = ptr::null();
+            let mut out = ptr::null_mut();
+            let error = unsafe {
+                CEXR_OStream_from_writer(
+                    writer as *mut T as *mut _,
+                    Some(write_ptr),
+                    Some(seekp_ptr),
+                    options.buffer_size,
+                    &mut out,
+                    &mut error_out,
+                )
+            };
+
+            if error != 0 {
+                return Err(Error::take(error_out));
+            } else {
+                out
+            }
+        };
+
+        let mut error_out = ptr::null();
+        let mut out = ptr::null_mut();
+        let error = unsafe {
+            // NOTE: we don't need to keep a copy of the header, because this
+            // function makes a deep copy that is stored in the
+            // CEXR_DeepScanLineOutputFile.
+            CEXR_DeepScanLineOutputFile_from_stream(
+                ostream_ptr,
+                header.handle,
+                threads,
+                &mut out,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            unsafe { CEXR_OStream_delete(ostream_ptr) };
+            Err(Error::take(error_out))
+        } else {
+            Ok(DeepScanlineOutputFile {
+                handle: out,
+                header_ref: Header::borrowed(unsafe { CEXR_DeepScanLineOutputFile_header(out) }),
+                ostream: ostream_ptr,
+                scanlines_written: 0,
+                _phantom_1: PhantomData,
+                _phantom_2: PhantomData,
+            })
+        }
+    }
+
+    /// Writes the entire image at once from `framebuffer`.
+    ///
+    /// # Errors
+    ///
+    /// This function expects `framebuffer` to have the same resolution as the
+    /// output file, as well as the same channels (with matching types).
+    ///
+    /// It will also return an error if:
+    ///
+    /// * Part or all of the image data has already been written by a previous
+    ///   call to either this or `write_pixels_incremental`.
+    /// * There is an I/O error.
+    pub fn write_pixels(&mut self, framebuffer: &DeepFrameBuffer) -> Result<()> {
+        // Validation
+        if self.scanlines_written != 0 {
+            return Err(Error::Generic(format!(
+                "{} scanlines have already been \
+                 written, cannot do a full image write",
+                self.scanlines_written
+            )));
+        }
+
+        if self.header().data_dimensions() != framebuffer.dimensions() {
+            return Err(Error::Generic(format!(
+                "framebuffer size {}x{} does not match image dimensions {}x{}",
+                framebuffer.dimensions().0,
+                framebuffer.dimensions().1,
+                self.header().data_dimensions().0,
+                self.header().data_dimensions().1
+            )));
+        }
+
+        self.write_scanlines(framebuffer)
+    }
+
+    /// Writes the image incrementally over multiple calls.
+    ///
+    /// `framebuffer` may have a different vertical resolution than the image,
+    /// but it must have the same horizontal resolution.  Multiple calls will
+    /// incrementally write chunks of scanlines in the order given until the
+    /// image is complete.
+    ///
+    /// Note: all scanlines must be written for the resulting OpenEXR file to
+    /// be complete and correct.
+    ///
+    /// # Errors
+    ///
+    /// This function expects `framebuffer` to have the same _horizontal_
+    /// resolution as the output file, as well as the same channels (with
+    /// matching types).
+    ///
+    /// It will also return an error if:
+    ///
+    /// * `framebuffer` contains more scanlines than remain to be written.
+    /// * There is an I/O error.
+    pub fn write_pixels_incremental(&mut self, framebuffer: &DeepFrameBuffer) -> Result<()> {
+        // Validation
+        if self.scanlines_written == self.header().data_dimensions().1 {
+            return Err(Error::Generic(
+                "All scanlines have already been \
+                 written, cannot do another incremental write"
+                    .to_string(),
+            ));
+        }
+
+        if framebuffer.dimensions().1 > (self.header().data_dimensions().1 - self.scanlines_written)
+        {
+            return Err(Error::Generic(format!(
+                "framebuffer contains {} \
+                 scanlines, but only {} scanlines remain to be written",
+                framebuffer.dimensions().1,
+                self.header().data_dimensions().1 - self.scanlines_written
+            )));
+        }
+
+        if framebuffer.dimensions().0 != self.header().data_dimensions().0 {
+            return Err(Error::Generic(format!(
+                "framebuffer width {} does not match\
+                 image width {}",
+                framebuffer.dimensions().0,
+                self.header().data_dimensions().0
+            )));
+        }
+
+        self.write_scanlines(framebuffer)
+    }
+
+    /// Access to the file's header.
+    pub fn header(&self) -> &Header {
+        &self.header_ref
+    }
+
+    // Writes all of the scanlines in `framebuffer` as the next scanlines of
+    // the image.
+    fn write_scanlines(&mut self, framebuffer: &DeepFrameBuffer) -> Result<()> {
+        self.header()
+            .validate_deep_framebuffer_for_output(framebuffer)?;
+
+        // Set up the framebuffer with the image
+        let (x, y) = self.header().data_origin();
+        let c_framebuffer = framebuffer.build((x, y + self.scanlines_written as i32));
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_DeepScanLineOutputFile_set_framebuffer(
+                self.handle,
+                c_framebuffer.handle(),
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            return Err(Error::take(error_out));
+        }
+
+        // Write out the image data
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_DeepScanLineOutputFile_write_pixels(
+                self.handle,
+                framebuffer.dimensions().1 as i32,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            self.scanlines_written += framebuffer.dimensions().1;
+            Ok(())
+        }
+    }
+}
+
+impl<'a> Drop for DeepScanlineOutputFile<'a> {
+    fn drop(&mut self) {
+        unsafe { CEXR_DeepScanLineOutputFile_delete(self.handle) };
+        unsafe { CEXR_OStream_delete(self.ostream) };
+    }
+}
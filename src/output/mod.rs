@@ -1,5 +1,105 @@
 //! Output file types.
 
+mod deep_scanline_output_file;
+mod multipart_output_file;
 mod scanline_output_file;
+mod tiled_output_file;
 
+pub use self::deep_scanline_output_file::DeepScanlineOutputFile;
+pub use self::multipart_output_file::MultiPartOutputFile;
 pub use self::scanline_output_file::ScanlineOutputFile;
+pub use self::tiled_output_file::TiledOutputFile;
+
+/// Options for creating output files.
+///
+/// This follows the builder pattern: create it with `new()`, adjust it with
+/// the `set_*()` methods, and pass it to one of the `*_with_options()`
+/// constructors of the output file types.
+///
+/// # Examples
+///
+/// Create a file that is compressed with four threads:
+///
+/// ```no_run
+/// # use openexr::{Header, PixelType, ScanlineOutputFile};
+/// # use openexr::output::OutputOptions;
+/// #
+/// let mut file = std::fs::File::create("output_file.exr").unwrap();
+/// let output_file = ScanlineOutputFile::new_with_options(
+///     &mut file,
+///     Header::new()
+///         .set_resolution(256, 256)
+///         .add_channel("R", PixelType::FLOAT),
+///     OutputOptions::new().set_threads(4),
+/// )
+/// .unwrap();
+/// ```
+#[derive(Debug, Copy, Clone)]
+pub struct OutputOptions {
+    pub(crate) threads: usize,
+    pub(crate) buffer_size: usize,
+    pub(crate) preview_size: u32,
+}
+
+impl OutputOptions {
+    /// Creates a new set of output options with default settings.
+    pub fn new() -> Self {
+        OutputOptions {
+            threads: 1,
+            buffer_size: DEFAULT_BUFFER_SIZE,
+            preview_size: 0,
+        }
+    }
+
+    /// Sets the number of threads used to encode the file.
+    ///
+    /// This is how many scanline blocks or tiles OpenEXR will compress
+    /// concurrently when writing this particular file.  The default is 1.
+    /// If set to `0`, all encoding happens on the calling thread.
+    ///
+    /// Note that the work itself is run on OpenEXR's global thread pool, so
+    /// the effective parallelism is also limited by the size of that pool.
+    /// See the [threads](../threads/index.html) module for details.
+    pub fn set_threads(&mut self, threads: usize) -> &mut Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Sets the size in bytes of the write-behind buffer used when writing
+    /// through a `Write + Seek` type.
+    ///
+    /// OpenEXR does many small writes, particularly for the header and
+    /// offset tables.  These are collected in the buffer, so the writer only
+    /// sees a few large writes.  Writes at least as large as the buffer
+    /// bypass it.  The default is 64 KiB, and `0` disables buffering.
+    ///
+    /// Buffered data is passed on to the writer when the buffer fills up,
+    /// before seeking, and when the output file is dropped.  Note that I/O
+    /// errors at drop time can't be reported.
+    pub fn set_buffer_size(&mut self, buffer_size: usize) -> &mut Self {
+        self.buffer_size = buffer_size;
+        self
+    }
+
+    /// Makes a `ScanlineOutputFile` generate a preview image from the
+    /// pixels as they're written, with its longer side `size` pixels long.
+    ///
+    /// The pixels are sampled from the framebuffer during each
+    /// `write_pixels()` call, and the preview image is written to the
+    /// header once the last scanline is written.  It replaces any preview
+    /// image already in the header.  The default is `0`, which doesn't
+    /// generate a preview image.
+    pub fn set_preview_size(&mut self, size: u32) -> &mut Self {
+        self.preview_size = size;
+        self
+    }
+}
+
+impl Default for OutputOptions {
+    fn default() -> OutputOptions {
+        OutputOptions::new()
+    }
+}
+
+// Default size of the write-behind buffer, in bytes.
+const DEFAULT_BUFFER_SIZE: usize = 64 * 1024;
@@ -0,0 +1,366 @@
+use std::io::{Seek, Write};
+use std::marker::PhantomData;
+use std::ptr;
+
+use libc::c_int;
+
+use openexr_sys::*;
+
+use error::*;
+use frame_buffer::{FrameBuffer, FrameBufferCache, FrameBufferUpdate};
+use stream_io::{seek_stream, write_stream};
+use threads::c_thread_count;
+use Header;
+
+use super::OutputOptions;
+
+/// Writes multipart OpenEXR files.
+///
+/// A multipart file stores several independent images ("parts") in one
+/// file, each with its own header.  Every part needs a unique name, set with
+/// `Header::set_name()`.  Parts are written as scanline images, in any order
+/// and interleaved however is convenient, but each part's scanlines are
+/// written in order, as with `ScanlineOutputFile`.
+///
+/// # Examples
+///
+/// Write a file with separate "diffuse" and "depth" parts.
+///
+/// ```no_run
+/// # use openexr::{FrameBuffer, Header, MultiPartOutputFile, PixelType};
+/// #
+/// let mut diffuse = Header::new();
+/// diffuse
+///     .set_name(Some("diffuse"))
+///     .set_resolution(256, 256)
+///     .add_channel("R", PixelType::FLOAT)
+///     .add_channel("G", PixelType::FLOAT)
+///     .add_channel("B", PixelType::FLOAT);
+/// let mut depth = Header::new();
+/// depth
+///     .set_name(Some("depth"))
+///     .set_resolution(256, 256)
+///     .add_channel("Z", PixelType::FLOAT);
+///
+/// let mut file = std::fs::File::create("output_file.exr").unwrap();
+/// let mut output_file = MultiPartOutputFile::new(&mut file, &[diffuse, depth]).unwrap();
+///
+/// let diffuse_data = vec![(0.5f32, 0.5f32, 0.5f32); 256 * 256];
+/// let depth_data = vec![10.0f32; 256 * 256];
+/// output_file
+///     .write_part(0, FrameBuffer::new(256, 256).insert_channels(&["R", "G", "B"], &diffuse_data))
+///     .unwrap();
+/// output_file
+///     .write_part(1, FrameBuffer::new(256, 256).insert_channel("Z", &depth_data))
+///     .unwrap();
+/// ```
+pub struct MultiPartOutputFile<'a> {
+    handle: *mut CEXR_MultiPartOutputFile,
+    header_refs: Vec<Header>,
+    ostream: *mut CEXR_OStream,
+    scanlines_written: Vec<u32>,
+    framebuffer_caches: Vec<FrameBufferCache>,
+    _phantom_1: PhantomData<CEXR_MultiPartOutputFile>,
+    _phantom_2: PhantomData<&'a mut ()>, // Represents the borrowed writer
+
+                                         // NOTE: Because we don't know what type the writer might be, it's important
+                                         // that this struct remains neither Sync nor Send.  Please don't implement
+                                         // them!
+}
+
+impl<'a> MultiPartOutputFile<'a> {
+    /// Creates a new `MultiPartOutputFile` from any `Write + Seek` type
+    /// (typically a `std::fs::File`), with one part per header in `headers`.
+    ///
+    /// Note: this seeks to byte 0 before writing.
+    pub fn new<T: 'a>(writer: &'a mut T, headers: &[Header]) -> Result<MultiPartOutputFile<'a>>
+    where
+        T: Write + Seek,
+    {
+        MultiPartOutputFile::new_with_options(writer, headers, &OutputOptions::new())
+    }
+
+    /// Creates a new `MultiPartOutputFile` from any `Write + Seek` type
+    /// (typically a `std::fs::File`), with one part per header in `headers`,
+    /// using the given `options`.
+    ///
+    /// Note: this seeks to byte 0 before writing.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if `headers` is empty, if there is more than one
+    /// header and any of them doesn't have a unique name, if any of them is
+    /// invalid, or if there is an I/O error.
+    pub fn new_with_options<T: 'a>(
+        writer: &'a mut T,
+        headers: &[Header],
+        options: &OutputOptions,
+    ) -> Result<MultiPartOutputFile<'a>>
+    where
+        T: Write + Seek,
+    {
+        if headers.is_empty() {
+            return Err(Error::Generic(
+                "a multipart file needs at least one part".to_string(),
+            ));
+        }
+
+        let threads = c_thread_count(options.threads)?;
+
+        let ostream_ptr = {
+            let write_ptr = write_stream::<T>;
+            let seekp_ptr = seek_stream::<T>;
+
+            let mut error_out = ptr::null();
+            let mut out = ptr::null_mut();
+            let error = unsafe {
+                CEXR_OStream_from_writer(
+                    writer as *mut T as *mut _,
+                    Some(write_ptr),
+                    Some(seekp_ptr),
+                    options.buffer_size,
+                    &mut out,
+                    &mut error_out,
+                )
+            };
+
+            if error != 0 {
+                return Err(Error::take(error_out));
+            } else {
+                out
+            }
+        };
+
+        let header_handles: Vec<*const CEXR_Header> = headers
+            .iter()
+            .map(|header| header.handle as *const CEXR_Header)
+            .collect();
+
+        let mut error_out = ptr::null();
+        let mut out = ptr::null_mut();
+        let error = unsafe {
+            // NOTE: we don't need to keep copies of the headers, because this
+            // function makes deep copies that are stored in the
+            // CEXR_MultiPartOutputFile.
+            CEXR_MultiPartOutputFile_from_stream(
+                ostream_ptr,
+                header_handles.as_ptr(),
+                header_handles.len() as c_int,
+                threads,
+                &mut out,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            unsafe { CEXR_OStream_delete(ostream_ptr) };
+            Err(Error::take(error_out))
+        } else {
+            let parts = headers.len();
+            Ok(MultiPartOutputFile {
+                handle: out,
+                header_refs: (0..parts)
+                    .map(|part| {
+                        Header::borrowed(unsafe {
+                            CEXR_MultiPartOutputFile_header(out, part as c_int)
+                        })
+                    })
+                    .collect(),
+                ostream: ostream_ptr,
+                scanlines_written: vec![0; parts],
+                framebuffer_caches: (0..parts).map(|_| FrameBufferCache::new()).collect(),
+                _phantom_1: PhantomData,
+                _phantom_2: PhantomData,
+            })
+        }
+    }
+
+    /// Returns the number of parts in the file.
+    pub fn parts(&self) -> usize {
+        self.header_refs.len()
+    }
+
+    /// Access to the header of part `part`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `part` is out of range.
+    pub fn header(&self, part: usize) -> &Header {
+        &self.header_refs[part]
+    }
+
+    /// Writes all of part `part` at once from `framebuffer`.
+    ///
+    /// # Errors
+    ///
+    /// This function expects `framebuffer` to have the same resolution and
+    /// origin as the part, as well as the same channels (with matching types
+    /// and subsampling).
+    ///
+    /// It will also return an error if:
+    ///
+    /// * `part` is out of range, or isn't a scanline part.
+    /// * Part or all of the part's image data has already been written.
+    /// * There is an I/O error.
+    pub fn write_part(&mut self, part: usize, framebuffer: &FrameBuffer) -> Result<()> {
+        self.check_part(part)?;
+
+        // Validation
+        if self.scanlines_written[part] != 0 {
+            return Err(Error::Generic(format!(
+                "{} scanlines have already been \
+                 written to part {}, cannot do a full image write",
+                self.scanlines_written[part], part
+            )));
+        }
+
+        if self.header(part).data_dimensions() != framebuffer.dimensions() {
+            return Err(Error::Generic(format!(
+                "framebuffer size {}x{} does not match dimensions {}x{} of part {}",
+                framebuffer.dimensions().0,
+                framebuffer.dimensions().1,
+                self.header(part).data_dimensions().0,
+                self.header(part).data_dimensions().1,
+                part
+            )));
+        }
+
+        if self.header(part).data_origin() != framebuffer.origin() {
+            return Err(Error::Generic(format!(
+                "framebuffer origin {}x{} does not match origin {}x{} of part {}",
+                framebuffer.origin().0,
+                framebuffer.origin().1,
+                self.header(part).data_origin().0,
+                self.header(part).data_origin().1,
+                part
+            )));
+        }
+
+        self.write_scanlines(part, framebuffer)
+    }
+
+    /// Writes part `part` incrementally over multiple calls.
+    ///
+    /// This works the same way as
+    /// `ScanlineOutputFile::write_pixels_incremental()`, independently for
+    /// each part.
+    ///
+    /// # Errors
+    ///
+    /// The same as `ScanlineOutputFile::write_pixels_incremental()`, and
+    /// additionally returns an error if `part` is out of range or isn't a
+    /// scanline part.
+    pub fn write_part_incremental(&mut self, part: usize, framebuffer: &FrameBuffer) -> Result<()> {
+        self.check_part(part)?;
+        let (width, height) = self.header(part).data_dimensions();
+
+        // Validation
+        if self.scanlines_written[part] == height {
+            return Err(Error::Generic(format!(
+                "All scanlines of part {} have already \
+                 been written, cannot do another incremental write",
+                part
+            )));
+        }
+
+        if framebuffer.dimensions().1 > (height - self.scanlines_written[part]) {
+            return Err(Error::Generic(format!(
+                "framebuffer contains {} \
+                 scanlines, but only {} scanlines remain to be written to part {}",
+                framebuffer.dimensions().1,
+                height - self.scanlines_written[part],
+                part
+            )));
+        }
+
+        if framebuffer.dimensions().0 != width {
+            return Err(Error::Generic(format!(
+                "framebuffer width {} does not match\
+                 width {} of part {}",
+                framebuffer.dimensions().0,
+                width,
+                part
+            )));
+        }
+
+        self.write_scanlines(part, framebuffer)
+    }
+
+    // Writes all of the scanlines in `framebuffer` as the next scanlines of
+    // part `part`.
+    fn write_scanlines(&mut self, part: usize, framebuffer: &FrameBuffer) -> Result<()> {
+        // Set up the framebuffer with the part
+        let offset = self.scanlines_written[part];
+        self.set_framebuffer(part, framebuffer, offset)?;
+
+        // Write out the image data
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_MultiPartOutputFile_write_pixels(
+                self.handle,
+                part as c_int,
+                framebuffer.dimensions().1 as c_int,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            self.scanlines_written[part] += framebuffer.dimensions().1;
+            Ok(())
+        }
+    }
+
+    fn check_part(&self, part: usize) -> Result<()> {
+        if part >= self.parts() {
+            Err(Error::Generic(format!(
+                "part {} does not exist, the file has {} parts",
+                part,
+                self.parts()
+            )))
+        } else {
+            Ok(())
+        }
+    }
+
+    // Validates `framebuffer` and sets it on part `part` with its scanlines
+    // offset by `offset`, skipping both when they aren't needed.  See
+    // `ScanlineOutputFile::set_framebuffer()`.
+    fn set_framebuffer(
+        &mut self,
+        part: usize,
+        framebuffer: &FrameBuffer,
+        offset: u32,
+    ) -> Result<()> {
+        match self.framebuffer_caches[part].update(framebuffer, offset) {
+            FrameBufferUpdate::Unchanged => return Ok(()),
+            FrameBufferUpdate::Moved => {}
+            FrameBufferUpdate::Changed => {
+                self.header(part)
+                    .validate_framebuffer_for_output(framebuffer)?;
+            }
+        }
+
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_MultiPartOutputFile_set_framebuffer(
+                self.handle,
+                part as c_int,
+                self.framebuffer_caches[part].handle(),
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            self.framebuffer_caches[part].set_current();
+            Ok(())
+        }
+    }
+}
+
+impl<'a> Drop for MultiPartOutputFile<'a> {
+    fn drop(&mut self) {
+        unsafe { CEXR_MultiPartOutputFile_delete(self.handle) };
+        unsafe { CEXR_OStream_delete(self.ostream) };
+    }
+}
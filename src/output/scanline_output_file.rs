@@ -1,13 +1,20 @@
 use std::io::{Seek, Write};
 use std::marker::PhantomData;
-use std::ptr;
+use std::sync::mpsc;
+use std::time::Instant;
+use std::{mem, panic, ptr, thread};
 
 use openexr_sys::*;
 
 use error::*;
-use frame_buffer::FrameBuffer;
-use stream_io::{seek_stream, write_stream};
-use Header;
+use frame_buffer::{FrameBuffer, FrameBufferCache, FrameBufferUpdate, PixelStruct};
+use input::InputFile;
+use stats::{IoStats, PixelStats};
+use stream_io::{seek_stream, sync_vec, write_stream};
+use threads::c_thread_count;
+use {Header, PreviewImage};
+
+use super::OutputOptions;
 
 /// Writes scanline OpenEXR files.
 ///
@@ -45,6 +52,9 @@ pub struct ScanlineOutputFile<'a> {
     header_ref: Header,
     ostream: *mut CEXR_OStream,
     scanlines_written: u32,
+    framebuffer_cache: FrameBufferCache,
+    pixel_stats: PixelStats,
+    preview: Option<PreviewImage>, // Generated as pixels are written
     _phantom_1: PhantomData<CEXR_OutputFile>,
     _phantom_2: PhantomData<&'a mut ()>, // Represents the borrowed writer
 
@@ -59,6 +69,21 @@ impl<'a> ScanlineOutputFile<'a> {
     ///
     /// Note: this seeks to byte 0 before writing.
     pub fn new<T: 'a>(writer: &'a mut T, header: &Header) -> Result<ScanlineOutputFile<'a>>
+    where
+        T: Write + Seek,
+    {
+        ScanlineOutputFile::new_with_options(writer, header, &OutputOptions::new())
+    }
+
+    /// Creates a new `ScanlineOutputFile` from any `Write + Seek` type
+    /// (typically a `std::fs::File`) and `header`, using the given `options`.
+    ///
+    /// Note: this seeks to byte 0 before writing.
+    pub fn new_with_options<T: 'a>(
+        writer: &'a mut T,
+        header: &Header,
+        options: &OutputOptions,
+    ) -> Result<ScanlineOutputFile<'a>>
     where
         T: Write + Seek,
     {
@@ -73,6 +98,7 @@ impl<'a> ScanlineOutputFile<'a> {
                     writer as *mut T as *mut _,
                     Some(write_ptr),
                     Some(seekp_ptr),
+                    options.buffer_size,
                     &mut out,
                     &mut error_out,
                 )
@@ -85,28 +111,130 @@ impl<'a> ScanlineOutputFile<'a> {
             }
         };
 
+        ScanlineOutputFile::from_ostream(ostream_ptr, header, options)
+    }
+
+    /// Creates a new `ScanlineOutputFile` that writes into `buffer`, which
+    /// is cleared first.
+    ///
+    /// The file is encoded straight into the vector's storage, without any
+    /// calls back into Rust except when the vector has to grow.  Reserving
+    /// enough capacity up front (e.g. with `Vec::with_capacity()`, or by
+    /// reusing the buffer of a previous image) avoids reallocation
+    /// entirely.  This is faster than writing to a `Cursor<Vec<u8>>` with
+    /// `new()`.
+    ///
+    /// The buffer holds the complete file once the `ScanlineOutputFile` is
+    /// dropped.
+    ///
+    /// # Examples
+    ///
+    /// ```no_run
+    /// # use openexr::{FrameBuffer, Header, PixelType, ScanlineOutputFile};
+    /// #
+    /// let pixel_data = vec![(0.5f32, 1.0f32, 0.5f32); 256 * 256];
+    /// let mut buffer = Vec::with_capacity(1 << 20);
+    /// {
+    ///     let mut output_file = ScanlineOutputFile::to_memory(
+    ///         &mut buffer,
+    ///         Header::new()
+    ///             .set_resolution(256, 256)
+    ///             .add_channel("R", PixelType::FLOAT)
+    ///             .add_channel("G", PixelType::FLOAT)
+    ///             .add_channel("B", PixelType::FLOAT),
+    ///     )
+    ///     .unwrap();
+    ///     let mut fb = FrameBuffer::new(256, 256);
+    ///     fb.insert_channels(&["R", "G", "B"], &pixel_data);
+    ///     output_file.write_pixels(&fb).unwrap();
+    /// }
+    /// // `buffer` now holds the file.
+    /// ```
+    pub fn to_memory(buffer: &'a mut Vec<u8>, header: &Header) -> Result<ScanlineOutputFile<'a>> {
+        ScanlineOutputFile::to_memory_with_options(buffer, header, &OutputOptions::new())
+    }
+
+    /// Creates a new `ScanlineOutputFile` that writes into `buffer`, using
+    /// the given `options`.
+    ///
+    /// See `to_memory()` for details.  The buffer size option has no effect
+    /// here.
+    pub fn to_memory_with_options(
+        buffer: &'a mut Vec<u8>,
+        header: &Header,
+        options: &OutputOptions,
+    ) -> Result<ScanlineOutputFile<'a>> {
+        buffer.clear();
+
+        let mut error_out = ptr::null();
+        let mut ostream_ptr = ptr::null_mut();
+        let error = unsafe {
+            CEXR_OStream_from_memory(
+                buffer as *mut Vec<u8> as *mut _,
+                Some(sync_vec),
+                &mut ostream_ptr,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            return Err(Error::take(error_out));
+        }
+
+        ScanlineOutputFile::from_ostream(ostream_ptr, header, options)
+    }
+
+    // Shared code for the constructors above.  Takes ownership of
+    // `ostream_ptr`, deleting it if the file can't be created.
+    fn from_ostream(
+        ostream_ptr: *mut CEXR_OStream,
+        header: &Header,
+        options: &OutputOptions,
+    ) -> Result<ScanlineOutputFile<'a>> {
+        let threads = match c_thread_count(options.threads) {
+            Ok(threads) => threads,
+            Err(e) => {
+                unsafe { CEXR_OStream_delete(ostream_ptr) };
+                return Err(e);
+            }
+        };
+
+        // The preview image attribute has to be in the header from the
+        // start, so a blank one is added and filled in at the end.
+        let (preview, preview_header) = if options.preview_size > 0 {
+            let (width, height) = PreviewImage::dimensions_for(header, options.preview_size);
+            let preview = PreviewImage::new(width, height);
+            let mut preview_header = header.clone();
+            preview_header.set_preview_image(Some(&preview));
+            (Some(preview), Some(preview_header))
+        } else {
+            (None, None)
+        };
+
         let mut error_out = ptr::null();
         let mut out = ptr::null_mut();
         let error = unsafe {
             // NOTE: we don't need to keep a copy of the header, because this
             // function makes a deep copy that is stored in the CEXR_OutputFile.
-            CEXR_OutputFile_from_stream(ostream_ptr, header.handle, 1, &mut out, &mut error_out)
+            CEXR_OutputFile_from_stream(
+                ostream_ptr,
+                preview_header.as_ref().unwrap_or(header).handle,
+                threads,
+                &mut out,
+                &mut error_out,
+            )
         };
         if error != 0 {
+            unsafe { CEXR_OStream_delete(ostream_ptr) };
             Err(Error::take(error_out))
         } else {
             Ok(ScanlineOutputFile {
                 handle: out,
-                header_ref: Header {
-                    // NOTE: We're casting to *mut here to satisfy the
-                    // field's type, but importantly we only return a
-                    // const & of the Header so it retains const semantics.
-                    handle: unsafe { CEXR_OutputFile_header(out) } as *mut CEXR_Header,
-                    owned: false,
-                    _phantom: PhantomData,
-                },
+                header_ref: Header::borrowed(unsafe { CEXR_OutputFile_header(out) }),
                 ostream: ostream_ptr,
                 scanlines_written: 0,
+                framebuffer_cache: FrameBufferCache::new(),
+                pixel_stats: PixelStats::new(),
+                preview: preview,
                 _phantom_1: PhantomData,
                 _phantom_2: PhantomData,
             })
@@ -156,19 +284,13 @@ impl<'a> ScanlineOutputFile<'a> {
             )));
         }
 
-        self.header().validate_framebuffer_for_output(framebuffer)?;
-
         // Set up the framebuffer with the image
-        let mut error_out = ptr::null();
-
-        let error = unsafe {
-            CEXR_OutputFile_set_framebuffer(self.handle, framebuffer.handle(), &mut error_out)
-        };
-        if error != 0 {
-            return Err(Error::take(error_out));
-        }
+        let offset = 0;
+        self.set_framebuffer(framebuffer, offset)?;
 
         // Write out the image data
+        let started = Instant::now();
+        let mut error_out = ptr::null();
         let error = unsafe {
             CEXR_OutputFile_write_pixels(
                 self.handle,
@@ -176,11 +298,12 @@ impl<'a> ScanlineOutputFile<'a> {
                 &mut error_out,
             )
         };
+        self.record_pixel_stats(offset, framebuffer.dimensions().1, started);
         if error != 0 {
             Err(Error::take(error_out))
         } else {
             self.scanlines_written = self.header().data_dimensions().1;
-            Ok(())
+            self.update_preview(offset, framebuffer.dimensions().1)
         }
     }
 
@@ -236,25 +359,13 @@ impl<'a> ScanlineOutputFile<'a> {
             )));
         }
 
-        self.header().validate_framebuffer_for_output(framebuffer)?;
-
         // Set up the framebuffer with the image
-        let mut error_out = ptr::null();
-
-        let error = unsafe {
-            let offset_fb = CEXR_FrameBuffer_copy_and_offset_scanlines(
-                framebuffer.handle(),
-                self.scanlines_written,
-            );
-            let err = CEXR_OutputFile_set_framebuffer(self.handle, offset_fb, &mut error_out);
-            CEXR_FrameBuffer_delete(offset_fb);
-            err
-        };
-        if error != 0 {
-            return Err(Error::take(error_out));
-        }
+        let offset = self.scanlines_written;
+        self.set_framebuffer(framebuffer, offset)?;
 
         // Write out the image data
+        let started = Instant::now();
+        let mut error_out = ptr::null();
         let error = unsafe {
             CEXR_OutputFile_write_pixels(
                 self.handle,
@@ -262,10 +373,187 @@ impl<'a> ScanlineOutputFile<'a> {
                 &mut error_out,
             )
         };
+        self.record_pixel_stats(offset, framebuffer.dimensions().1, started);
         if error != 0 {
             Err(Error::take(error_out))
         } else {
             self.scanlines_written += framebuffer.dimensions().1;
+            self.update_preview(offset, framebuffer.dimensions().1)
+        }
+    }
+
+    /// Writes the rest of the image in chunks of `chunk_height` scanlines,
+    /// overlapping producing the pixels with compressing and writing them.
+    ///
+    /// `producer` is called with the index of the first scanline of each
+    /// chunk and a buffer of pixels of type `T` to fill, laid out for the
+    /// channels in `channels` exactly as with `FrameBuffer::insert_channels()`.
+    /// It runs on a separate thread, and can get up to `queue_depth` chunks
+    /// ahead of the compression and writing done on the calling thread.
+    /// Chunk buffers are recycled, so at most `queue_depth + 2` of them are
+    /// ever allocated, and a buffer passed to `producer` may still hold the
+    /// pixels of an earlier chunk.  The last chunk may be shorter than
+    /// `chunk_height`.
+    ///
+    /// Writing starts after any scanlines already written with
+    /// `write_pixels_incremental()`, and continues until the image is
+    /// complete.  Compression is more efficient if `chunk_height` is a
+    /// multiple of `Header::scanlines_per_chunk()`.
+    ///
+    /// # Examples
+    ///
+    /// ```no_run
+    /// # use openexr::{ScanlineOutputFile, Header, PixelType};
+    /// #
+    /// let mut file = std::fs::File::create("output_file.exr").unwrap();
+    /// let mut output_file = ScanlineOutputFile::new(
+    ///     &mut file,
+    ///     Header::new()
+    ///         .set_resolution(256, 256)
+    ///         .add_channel("R", PixelType::FLOAT)
+    ///         .add_channel("G", PixelType::FLOAT)
+    ///         .add_channel("B", PixelType::FLOAT))
+    ///     .unwrap();
+    ///
+    /// output_file.write_pixels_pipelined(
+    ///     &["R", "G", "B"],
+    ///     64,
+    ///     2,
+    ///     |first_scanline, pixels: &mut [(f32, f32, f32)]| {
+    ///         let v = first_scanline as f32 / 256.0;
+    ///         for pixel in pixels {
+    ///             *pixel = (v, v, v);
+    ///         }
+    ///     },
+    /// ).unwrap();
+    /// ```
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if all scanlines have already been written, and
+    /// otherwise the first error encountered while writing, with the same
+    /// validation as for `write_pixels_incremental()`.  Once an error occurs
+    /// no further chunks are requested from `producer`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `chunk_height` or `queue_depth` is zero, and re-raises any
+    /// panic from `producer`.
+    pub fn write_pixels_pipelined<T, F>(
+        &mut self,
+        channels: &[&str],
+        chunk_height: u32,
+        queue_depth: usize,
+        mut producer: F,
+    ) -> Result<()>
+    where
+        T: PixelStruct + Copy + Default + Send,
+        F: FnMut(u32, &mut [T]) + Send,
+    {
+        assert!(chunk_height > 0, "chunk_height must be at least 1");
+        assert!(queue_depth > 0, "queue_depth must be at least 1");
+
+        let (width, height) = self.header().data_dimensions();
+        let start = self.scanlines_written;
+        if start == height {
+            return Err(Error::Generic(
+                "All scanlines have already been \
+                 written, cannot do another incremental write"
+                    .to_string(),
+            ));
+        }
+
+        // Filled chunks come from the producer through `full`, and go back
+        // for reuse through `empty`.  The empty buffers start out
+        // unallocated, and only grow when the producer first uses them.
+        let (full_tx, full_rx) = mpsc::sync_channel::<(u32, Vec<T>)>(queue_depth);
+        let (empty_tx, empty_rx) = mpsc::channel::<Vec<T>>();
+        for _ in 0..(queue_depth + 2) {
+            empty_tx.send(Vec::new()).unwrap();
+        }
+
+        thread::scope(|scope| {
+            let producer_thread = scope.spawn(move || {
+                let mut first_scanline = start;
+                while first_scanline < height {
+                    let rows = chunk_height.min(height - first_scanline);
+                    let mut buffer = match empty_rx.recv() {
+                        Ok(buffer) => buffer,
+                        Err(_) => break,
+                    };
+                    buffer.resize(width as usize * rows as usize, T::default());
+                    producer(first_scanline, &mut buffer);
+                    if full_tx.send((rows, buffer)).is_err() {
+                        break;
+                    }
+                    first_scanline += rows;
+                }
+            });
+
+            let mut result = Ok(());
+            for (rows, buffer) in &full_rx {
+                {
+                    let mut fb = FrameBuffer::new(width, rows);
+                    fb.insert_channels(channels, &buffer);
+                    if let Err(e) = self.write_pixels_incremental(&fb) {
+                        result = Err(e);
+                        break;
+                    }
+                }
+                if empty_tx.send(buffer).is_err() {
+                    break;
+                }
+            }
+
+            // Unblocks the producer if we stopped early.
+            drop(full_rx);
+            drop(empty_tx);
+            if let Err(panic) = producer_thread.join() {
+                panic::resume_unwind(panic);
+            }
+            result
+        })
+    }
+
+    /// Copies all of the pixels of `input` to this file without
+    /// decompressing and recompressing them.
+    ///
+    /// This is much faster than reading and writing the pixels, especially
+    /// for expensive compression modes, and is useful for writing a file
+    /// whose header differs from the input's only in its attributes (see
+    /// `Header::clone()`).
+    ///
+    /// No preview image is generated from the copied pixels, so with
+    /// `OutputOptions::set_preview_size()` the preview image stays blank.
+    ///
+    /// # Errors
+    ///
+    /// The data window, line order, compression and channels of the two
+    /// files' headers must be identical, and `input` must be a scanline file.
+    ///
+    /// It will also return an error if:
+    ///
+    /// * Part or all of the image data has already been written to this file.
+    /// * `input` is incomplete.
+    /// * There is an I/O error.
+    pub fn copy_pixels_from(&mut self, input: &mut InputFile) -> Result<()> {
+        // Validation
+        if self.scanlines_written != 0 {
+            return Err(Error::Generic(format!(
+                "{} scanlines have already been \
+                 written, cannot copy pixels",
+                self.scanlines_written
+            )));
+        }
+
+        // Copy the image data
+        let mut error_out = ptr::null();
+        let error =
+            unsafe { CEXR_OutputFile_copy_pixels(self.handle, input.handle_mut(), &mut error_out) };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            self.scanlines_written = self.header().data_dimensions().1;
             Ok(())
         }
     }
@@ -274,6 +562,99 @@ impl<'a> ScanlineOutputFile<'a> {
     pub fn header(&self) -> &Header {
         &self.header_ref
     }
+
+    /// Returns the file's I/O statistics so far.
+    ///
+    /// Buffered data that hasn't been passed on to the writer yet is
+    /// already counted in `bytes`.  See the [stats](../stats/index.html)
+    /// module for details.
+    pub fn stats(&self) -> IoStats {
+        let mut stream_stats = unsafe { mem::zeroed() };
+        unsafe { CEXR_OStream_stats(self.ostream, &mut stream_stats) };
+        IoStats::new(&stream_stats, &self.pixel_stats)
+    }
+
+    // Records a write of `rows` scanlines starting `offset` scanlines into
+    // the data window, which started at `started`.
+    fn record_pixel_stats(&mut self, offset: u32, rows: u32, started: Instant) {
+        let start_scanline = self.header_ref.data_window().min.y + offset as i32;
+        self.pixel_stats.record(
+            &self.header_ref,
+            start_scanline,
+            start_scanline + rows as i32 - 1,
+            started,
+        );
+    }
+
+    // Samples the preview image, if any, from the `rows` scanlines just
+    // written starting `offset` scanlines into the data window, and writes
+    // it to the file once the image is complete.
+    fn update_preview(&mut self, offset: u32, rows: u32) -> Result<()> {
+        let preview = match self.preview {
+            Some(ref mut preview) => preview,
+            None => return Ok(()),
+        };
+        let data_window = *self.header_ref.data_window();
+        let start_scanline = data_window.min.y + offset as i32;
+        unsafe {
+            CEXR_FrameBuffer_sample_preview(
+                self.framebuffer_cache.handle(),
+                data_window,
+                start_scanline,
+                start_scanline + rows as i32 - 1,
+                preview.width,
+                preview.height,
+                preview.pixels.as_mut_ptr() as *mut CEXR_PreviewRgba,
+            )
+        };
+
+        if self.scanlines_written < self.header_ref.data_dimensions().1 {
+            return Ok(());
+        }
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_OutputFile_update_preview_image(
+                self.handle,
+                preview.pixels.as_ptr() as *const CEXR_PreviewRgba,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(())
+        }
+    }
+
+    // Validates `framebuffer` and sets it on the file with its scanlines
+    // offset by `offset`.  Validating and setting are skipped when they
+    // aren't needed, which makes repeated writes from framebuffers with the
+    // same layout (e.g. chunk by chunk with `write_pixels_incremental()`)
+    // cheap.
+    fn set_framebuffer(&mut self, framebuffer: &FrameBuffer, offset: u32) -> Result<()> {
+        match self.framebuffer_cache.update(framebuffer, offset) {
+            FrameBufferUpdate::Unchanged => return Ok(()),
+            FrameBufferUpdate::Moved => {}
+            FrameBufferUpdate::Changed => {
+                self.header().validate_framebuffer_for_output(framebuffer)?;
+            }
+        }
+
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_OutputFile_set_framebuffer(
+                self.handle,
+                self.framebuffer_cache.handle(),
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            self.framebuffer_cache.set_current();
+            Ok(())
+        }
+    }
 }
 
 impl<'a> Drop for ScanlineOutputFile<'a> {
@@ -0,0 +1,554 @@
+use std::io::{Seek, Write};
+use std::marker::PhantomData;
+use std::ptr;
+
+use openexr_sys::*;
+
+use cexr_type_aliases::{Box2i, LevelMode};
+use error::*;
+use frame_buffer::FrameBuffer;
+use input::TiledInputFile;
+use stream_io::{seek_stream, write_stream};
+use threads::c_thread_count;
+use Header;
+
+use super::OutputOptions;
+
+/// Writes tiled OpenEXR files.
+///
+/// Image data is stored in rectangular tiles, which can be written in any
+/// order.  The header passed at creation must have a tile description (see
+/// `Header::set_tile_description()`).
+///
+/// Tile coordinates are given as `(column, row)` of the tile in the grid of
+/// tiles, with `(0, 0)` being the tile in the top left corner of the data
+/// window.
+///
+/// If the tile description's mode is `MIPMAP_LEVELS` or `RIPMAP_LEVELS`, the
+/// tiles of every resolution level must be written for the file to be
+/// complete (see the `*_at_level()` methods and `write_level()`).
+///
+/// # Examples
+///
+/// Write a floating point RGB image with 64x64 pixel tiles to a file named
+/// "output_file.exr", one tile at a time.
+///
+/// ```no_run
+/// # use openexr::{TiledOutputFile, Header, FrameBuffer, PixelType};
+/// # use openexr::header::{LevelMode, LevelRoundingMode, LineOrder, TileDescription};
+/// #
+/// // Create file with the desired resolution, tiling and channels.
+/// let mut file = std::fs::File::create("output_file.exr").unwrap();
+/// let mut output_file = TiledOutputFile::new(
+///     &mut file,
+///     Header::new()
+///         .set_resolution(256, 256)
+///         .set_line_order(LineOrder::RANDOM_Y)
+///         .set_tile_description(TileDescription {
+///             x_size: 64,
+///             y_size: 64,
+///             mode: LevelMode::ONE_LEVEL,
+///             rounding_mode: LevelRoundingMode::ROUND_DOWN,
+///         })
+///         .add_channel("R", PixelType::FLOAT)
+///         .add_channel("G", PixelType::FLOAT)
+///         .add_channel("B", PixelType::FLOAT))
+///     .unwrap();
+///
+/// // Create the image data for each tile and write it to the file.
+/// let pixel_data = vec![(0.5f32, 1.0f32, 0.5f32); 64 * 64];
+/// for tile_y in 0..4 {
+///     for tile_x in 0..4 {
+///         let mut fb = FrameBuffer::new_with_origin(tile_x * 64, tile_y * 64, 64, 64);
+///         fb.insert_channels(&["R", "G", "B"], &pixel_data);
+///         output_file.write_tile(tile_x as u32, tile_y as u32, &fb).unwrap();
+///     }
+/// }
+/// ```
+pub struct TiledOutputFile<'a> {
+    handle: *mut CEXR_TiledOutputFile,
+    header_ref: Header,
+    ostream: *mut CEXR_OStream,
+    _phantom_1: PhantomData<CEXR_TiledOutputFile>,
+    _phantom_2: PhantomData<&'a mut ()>, // Represents the borrowed writer
+
+                                         // NOTE: Because we don't know what type the writer might be, it's important
+                                         // that this struct remains neither Sync nor Send.  Please don't implement
+                                         // them!
+}
+
+impl<'a> TiledOutputFile<'a> {
+    /// Creates a new `TiledOutputFile` from any `Write + Seek` type
+    /// (typically a `std::fs::File`) and `header`.
+    ///
+    /// Note: this seeks to byte 0 before writing.
+    pub fn new<T: 'a>(writer: &'a mut T, header: &Header) -> Result<TiledOutputFile<'a>>
+    where
+        T: Write + Seek,
+    {
+        TiledOutputFile::new_with_options(writer, header, &OutputOptions::new())
+    }
+
+    /// Creates a new `TiledOutputFile` from any `Write + Seek` type
+    /// (typically a `std::fs::File`) and `header`, using the given `options`.
+    ///
+    /// Note: this seeks to byte 0 before writing.
+    pub fn new_with_options<T: 'a>(
+        writer: &'a mut T,
+        header: &Header,
+        options: &OutputOptions,
+    ) -> Result<TiledOutputFile<'a>>
+    where
+        T: Write + Seek,
+    {
+        if header.tile_description().is_none() {
+            return Err(Error::Generic(
+                "header has no tile description, cannot create a tiled file".to_string(),
+            ));
+        }
+
+        let threads = c_thread_count(options.threads)?;
+
+        let ostream_ptr = {
+            let write_ptr = write_stream::<T>;
+            let seekp_ptr = seek_stream::<T>;
+
+            let mut error_out = ptr::null();
+            let mut out = ptr::null_mut();
+            let error = unsafe {
+                CEXR_OStream_from_writer(
+                    writer as *mut T as *mut _,
+                    Some(write_ptr),
+                    Some(seekp_ptr),
+                    options.buffer_size,
+                    &mut out,
+                    &mut error_out,
+                )
+            };
+
+            if error != 0 {
+                return Err(Error::take(error_out));
+            } else {
+                out
+            }
+        };
+
+        let mut error_out = ptr::null();
+        let mut out = ptr::null_mut();
+        let error = unsafe {
+            // NOTE: we don't need to keep a copy of the header, because this
+            // function makes a deep copy that is stored in the
+            // CEXR_TiledOutputFile.
+            CEXR_TiledOutputFile_from_stream(
+                ostream_ptr,
+                header.handle,
+                threads,
+                &mut out,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            unsafe { CEXR_OStream_delete(ostream_ptr) };
+            Err(Error::take(error_out))
+        } else {
+            Ok(TiledOutputFile {
+                handle: out,
+                header_ref: Header::borrowed(unsafe { CEXR_TiledOutputFile_header(out) }),
+                ostream: ostream_ptr,
+                _phantom_1: PhantomData,
+                _phantom_2: PhantomData,
+            })
+        }
+    }
+
+    /// Returns the width and height of the tiles, in pixels.
+    ///
+    /// Note that tiles at the right and bottom edges of the image may be
+    /// smaller than this.  Use `tile_data_window()` to get the exact extent
+    /// of a given tile.
+    pub fn tile_dimensions(&self) -> (u32, u32) {
+        let td = self
+            .header()
+            .tile_description()
+            .expect("tiled file has no tile description");
+        (td.x_size, td.y_size)
+    }
+
+    /// Returns the number of tiles in each dimension at full resolution.
+    pub fn num_tiles(&self) -> (u32, u32) {
+        self.num_tiles_at_level((0, 0))
+            .expect("tiled file has no full resolution level")
+    }
+
+    /// Returns which resolution levels are stored in the file.
+    pub fn level_mode(&self) -> LevelMode {
+        self.header()
+            .tile_description()
+            .expect("tiled file has no tile description")
+            .mode
+    }
+
+    /// Returns the number of resolution levels in each dimension.
+    ///
+    /// Level `(0, 0)` is the full resolution image, and each successive level
+    /// halves the resolution in its dimension.  For `ONE_LEVEL` files this is
+    /// `(1, 1)`.  For `MIPMAP_LEVELS` files both numbers are the same, and the
+    /// valid levels are `(l, l)`.  For `RIPMAP_LEVELS` files any combination
+    /// of x and y levels is valid.
+    pub fn num_levels(&self) -> (u32, u32) {
+        let mut error_out = ptr::null();
+        let mut x_levels = 0;
+        let mut y_levels = 0;
+        let error = unsafe {
+            CEXR_TiledOutputFile_num_x_levels(self.handle, &mut x_levels, &mut error_out)
+        };
+        if error != 0 {
+            panic!("{}", Error::take(error_out));
+        }
+        let error = unsafe {
+            CEXR_TiledOutputFile_num_y_levels(self.handle, &mut y_levels, &mut error_out)
+        };
+        if error != 0 {
+            panic!("{}", Error::take(error_out));
+        }
+        (x_levels as u32, y_levels as u32)
+    }
+
+    /// Returns the region covered by the given `(x, y)` resolution level.
+    ///
+    /// All levels share the minimum corner of the data window, and
+    /// framebuffers used with a level are positioned in these coordinates.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the level isn't in the file.
+    pub fn level_data_window(&self, level: (u32, u32)) -> Result<Box2i> {
+        let mut error_out = ptr::null();
+        let mut window = Header::box2i(0, 0, 1, 1);
+        let error = unsafe {
+            CEXR_TiledOutputFile_data_window_for_level(
+                self.handle,
+                level.0 as i32,
+                level.1 as i32,
+                &mut window,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(window)
+        }
+    }
+
+    /// Returns the width and height of the given `(x, y)` resolution level,
+    /// in pixels.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the level isn't in the file.
+    pub fn level_dimensions(&self, level: (u32, u32)) -> Result<(u32, u32)> {
+        let window = self.level_data_window(level)?;
+        Ok((
+            (window.max.x - window.min.x + 1) as u32,
+            (window.max.y - window.min.y + 1) as u32,
+        ))
+    }
+
+    /// Returns the number of tiles in each dimension at the given `(x, y)`
+    /// resolution level.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the level isn't in the file.
+    pub fn num_tiles_at_level(&self, level: (u32, u32)) -> Result<(u32, u32)> {
+        // The per-dimension queries below only check each level number on
+        // its own, so validate the level as a whole first.
+        self.level_data_window(level)?;
+
+        let mut error_out = ptr::null();
+        let mut x_tiles = 0;
+        let mut y_tiles = 0;
+        let error = unsafe {
+            CEXR_TiledOutputFile_num_x_tiles(
+                self.handle,
+                level.0 as i32,
+                &mut x_tiles,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            return Err(Error::take(error_out));
+        }
+        let error = unsafe {
+            CEXR_TiledOutputFile_num_y_tiles(
+                self.handle,
+                level.1 as i32,
+                &mut y_tiles,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            return Err(Error::take(error_out));
+        }
+        Ok((x_tiles as u32, y_tiles as u32))
+    }
+
+    /// Returns the region of the data window covered by the given tile.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if there is no tile at the given coordinates.
+    pub fn tile_data_window(&self, tile_x: u32, tile_y: u32) -> Result<Box2i> {
+        self.tile_data_window_at_level(tile_x, tile_y, (0, 0))
+    }
+
+    /// Returns the region covered by the given tile of the given `(x, y)`
+    /// resolution level, in the coordinates of `level_data_window()`.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the level isn't in the file or there is no tile at
+    /// the given coordinates.
+    pub fn tile_data_window_at_level(
+        &self,
+        tile_x: u32,
+        tile_y: u32,
+        level: (u32, u32),
+    ) -> Result<Box2i> {
+        let mut error_out = ptr::null();
+        let mut window = Header::box2i(0, 0, 1, 1);
+        let error = unsafe {
+            CEXR_TiledOutputFile_data_window_for_tile(
+                self.handle,
+                tile_x as i32,
+                tile_y as i32,
+                level.0 as i32,
+                level.1 as i32,
+                &mut window,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(window)
+        }
+    }
+
+    /// Writes a single tile from `framebuffer`.
+    ///
+    /// `framebuffer` uses the same coordinates as the data window, and it
+    /// must cover at least the region of the tile (see
+    /// `tile_data_window()`).
+    ///
+    /// # Errors
+    ///
+    /// This function expects `framebuffer` to have the same channels as the
+    /// output file (with matching types and subsampling).
+    ///
+    /// It will also return an error if:
+    ///
+    /// * There is no tile at the given coordinates.
+    /// * The tile has already been written.
+    /// * `framebuffer` doesn't cover the tile.
+    /// * There is an I/O error.
+    pub fn write_tile(
+        &mut self,
+        tile_x: u32,
+        tile_y: u32,
+        framebuffer: &FrameBuffer,
+    ) -> Result<()> {
+        self.write_tiles_at_level((tile_x, tile_y), (tile_x, tile_y), (0, 0), framebuffer)
+    }
+
+    /// Writes a rectangular range of tiles from `framebuffer`.
+    ///
+    /// `first_tile` and `last_tile` are the tile coordinates of the upper
+    /// left and lower right tiles of the range, inclusive.
+    ///
+    /// `framebuffer` uses the same coordinates as the data window, and it
+    /// must cover at least the region of the tiles being written.
+    ///
+    /// # Errors
+    ///
+    /// This function expects `framebuffer` to have the same channels as the
+    /// output file (with matching types and subsampling).
+    ///
+    /// It will also return an error if:
+    ///
+    /// * The range of tiles is empty or outside of the image.
+    /// * Any of the tiles have already been written.
+    /// * `framebuffer` doesn't cover the range of tiles.
+    /// * There is an I/O error.
+    pub fn write_tiles(
+        &mut self,
+        first_tile: (u32, u32),
+        last_tile: (u32, u32),
+        framebuffer: &FrameBuffer,
+    ) -> Result<()> {
+        self.write_tiles_at_level(first_tile, last_tile, (0, 0), framebuffer)
+    }
+
+    /// Writes a single tile of the given `(x, y)` resolution level from
+    /// `framebuffer`.
+    ///
+    /// This is the same as `write_tile()`, except that the tile coordinates
+    /// and `framebuffer` are relative to the level (see
+    /// `level_data_window()` and `tile_data_window_at_level()`).
+    ///
+    /// # Errors
+    ///
+    /// The same as `write_tile()`, and additionally returns an error if the
+    /// level isn't in the file.
+    pub fn write_tile_at_level(
+        &mut self,
+        tile_x: u32,
+        tile_y: u32,
+        level: (u32, u32),
+        framebuffer: &FrameBuffer,
+    ) -> Result<()> {
+        self.write_tiles_at_level((tile_x, tile_y), (tile_x, tile_y), level, framebuffer)
+    }
+
+    /// Writes a rectangular range of tiles of the given `(x, y)` resolution
+    /// level from `framebuffer`.
+    ///
+    /// This is the same as `write_tiles()`, except that the tile coordinates
+    /// and `framebuffer` are relative to the level (see
+    /// `level_data_window()` and `tile_data_window_at_level()`).
+    ///
+    /// # Errors
+    ///
+    /// The same as `write_tiles()`, and additionally returns an error if the
+    /// level isn't in the file.
+    pub fn write_tiles_at_level(
+        &mut self,
+        first_tile: (u32, u32),
+        last_tile: (u32, u32),
+        level: (u32, u32),
+        framebuffer: &FrameBuffer,
+    ) -> Result<()> {
+        // Validation
+        if first_tile.0 > last_tile.0 || first_tile.1 > last_tile.1 {
+            return Err(Error::Generic(format!(
+                "tile range {},{} to {},{} is empty",
+                first_tile.0, first_tile.1, last_tile.0, last_tile.1
+            )));
+        }
+
+        let window = {
+            let first = self.tile_data_window_at_level(first_tile.0, first_tile.1, level)?;
+            let last = self.tile_data_window_at_level(last_tile.0, last_tile.1, level)?;
+            Box2i {
+                min: first.min,
+                max: last.max,
+            }
+        };
+        framebuffer.validate_covers(&window)?;
+
+        self.header().validate_framebuffer_for_output(framebuffer)?;
+
+        // Set up the framebuffer with the image
+        let mut error_out = ptr::null();
+
+        let error = unsafe {
+            CEXR_TiledOutputFile_set_framebuffer(self.handle, framebuffer.handle(), &mut error_out)
+        };
+        if error != 0 {
+            return Err(Error::take(error_out));
+        }
+
+        // Write out the image data
+        let error = unsafe {
+            CEXR_TiledOutputFile_write_tiles(
+                self.handle,
+                first_tile.0 as i32,
+                last_tile.0 as i32,
+                first_tile.1 as i32,
+                last_tile.1 as i32,
+                level.0 as i32,
+                level.1 as i32,
+                &mut error_out,
+            )
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(())
+        }
+    }
+
+    /// Writes the entire full resolution image from `framebuffer` at once.
+    ///
+    /// This is a convenience method that writes all of the tiles.
+    /// `framebuffer` must cover the entire data window.
+    ///
+    /// # Errors
+    ///
+    /// This function expects `framebuffer` to have the same channels as the
+    /// output file (with matching types and subsampling).
+    ///
+    /// It will also return an error if any of the tiles have already been
+    /// written, if `framebuffer` doesn't cover the data window, or if there
+    /// is an I/O error.
+    pub fn write_pixels(&mut self, framebuffer: &FrameBuffer) -> Result<()> {
+        self.write_level((0, 0), framebuffer)
+    }
+
+    /// Writes the entire image of the given `(x, y)` resolution level from
+    /// `framebuffer` at once.
+    ///
+    /// `framebuffer` must cover the level's data window (see
+    /// `level_data_window()`).  The contents of each level are up to the
+    /// caller, and are typically a downsampled version of the full
+    /// resolution image.
+    ///
+    /// # Errors
+    ///
+    /// The same as `write_pixels()`, and additionally returns an error if the
+    /// level isn't in the file.
+    pub fn write_level(&mut self, level: (u32, u32), framebuffer: &FrameBuffer) -> Result<()> {
+        let (x_tiles, y_tiles) = self.num_tiles_at_level(level)?;
+        self.write_tiles_at_level((0, 0), (x_tiles - 1, y_tiles - 1), level, framebuffer)
+    }
+
+    /// Copies all of the tiles of `input`, at every level, to this file
+    /// without decompressing and recompressing them.
+    ///
+    /// This is much faster than reading and writing the pixels, especially
+    /// for expensive compression modes, and is useful for writing a file
+    /// whose header differs from the input's only in its attributes (see
+    /// `Header::clone()`).
+    ///
+    /// # Errors
+    ///
+    /// The data window, line order, compression, tile description and
+    /// channels of the two files' headers must be identical.
+    ///
+    /// It will also return an error if any tiles have already been written
+    /// to this file, if `input` is incomplete, or if there is an I/O error.
+    pub fn copy_pixels_from(&mut self, input: &mut TiledInputFile) -> Result<()> {
+        let mut error_out = ptr::null();
+        let error = unsafe {
+            CEXR_TiledOutputFile_copy_pixels(self.handle, input.handle_mut(), &mut error_out)
+        };
+        if error != 0 {
+            Err(Error::take(error_out))
+        } else {
+            Ok(())
+        }
+    }
+
+    /// Access to the file's header.
+    pub fn header(&self) -> &Header {
+        &self.header_ref
+    }
+}
+
+impl<'a> Drop for TiledOutputFile<'a> {
+    fn drop(&mut self) {
+        unsafe { CEXR_TiledOutputFile_delete(self.handle) };
+        unsafe { CEXR_OStream_delete(self.ostream) };
+    }
+}
@@ -0,0 +1,545 @@
+//! A `PlanarBuffer` owns image data stored as one contiguous plane per
+//! channel.
+//!
+//! Frame buffers built with `insert_channels()` over a slice of structs
+//! interleave the channels, so OpenEXR walks each channel with a stride of
+//! the whole struct.  A planar buffer instead gives OpenEXR a unit-stride
+//! slice per channel, and gives downstream code contiguous planes that are
+//! friendly to caches and SIMD.  `pack()` and `unpack()` convert between
+//! the planes and interleaved `PixelStruct` buffers when both layouts are
+//! needed.
+//!
+//! The planes are aligned to 64 bytes.  When reading many images of the
+//! same size, such as the frames of a sequence, a `BufferPool` lets each
+//! planar buffer reuse the planes of earlier ones instead of allocating
+//! (and page faulting in) fresh memory for every image.
+//!
+//! ## Examples
+//!
+//! Reading the RGB channels of a file into planes, and interleaving them
+//! afterward:
+//!
+//! ```no_run
+//! # use openexr::{InputFile, PlanarBuffer};
+//! #
+//! let mut input_file = unsafe { InputFile::from_path_mmap("input_file.exr") }.unwrap();
+//! let (width, height) = input_file.header().data_dimensions();
+//!
+//! let mut planes = PlanarBuffer::<f32>::new(width, height, &["R", "G", "B"]);
+//! input_file
+//!     .read_pixels(&mut planes.frame_buffer_mut(&[0.0, 0.0, 0.0]))
+//!     .unwrap();
+//!
+//! let red: &[f32] = planes.plane(0);
+//! let mut pixels = vec![(0.0f32, 0.0f32, 0.0f32); (width * height) as usize];
+//! planes.pack(&mut pixels);
+//! ```
+//!
+//! Reading a sequence of frames, reusing the same memory for each:
+//!
+//! ```no_run
+//! # use openexr::InputFile;
+//! # use openexr::planar_buffer::BufferPool;
+//! #
+//! let pool = BufferPool::<f32>::new();
+//! for frame in 1..100 {
+//!     let path = format!("frame.{}.exr", frame);
+//!     let mut input_file = unsafe { InputFile::from_path_mmap(&path) }.unwrap();
+//!     let (width, height) = input_file.header().data_dimensions();
+//!
+//!     // After the first frame, this reuses the planes returned to the pool
+//!     // when the previous frame's buffer was dropped.
+//!     let mut planes = pool.planar_buffer(width, height, &["R", "G", "B"]);
+//!     input_file
+//!         .read_pixels(&mut planes.frame_buffer_mut(&[0.0, 0.0, 0.0]))
+//!         .unwrap();
+//! }
+//! ```
+
+use std::alloc::{self, Layout};
+use std::marker::PhantomData;
+use std::ops::{Deref, DerefMut};
+use std::ptr::{self, NonNull};
+use std::sync::{Arc, Mutex};
+use std::{mem, slice};
+
+use frame_buffer::{FrameBuffer, FrameBufferMut, PixelData, PixelStruct};
+
+// The number of pixels `pack()` and `unpack()` copy for each channel before
+// moving on to the next one, so that the block of interleaved pixels being
+// worked on stays in cache across channels.
+const BLOCK_PIXELS: usize = 1024;
+
+// The alignment of planes in bytes: a cache line, and enough for any SIMD
+// loads.
+const PLANE_ALIGN: usize = 64;
+
+/// Owns image data stored as one contiguous plane of `T` per channel.
+pub struct PlanarBuffer<T> {
+    dimensions: (u32, u32),
+    origin: (i32, i32),
+    names: Vec<String>,
+    planes: Vec<Plane<T>>,
+    pool: Option<BufferPool<T>>, // Where the planes go back to when dropped
+}
+
+impl<T: PixelData + Copy + Default> PlanarBuffer<T> {
+    /// Creates a zero-filled planar buffer with the given dimensions in
+    /// pixels, with one plane per channel in `names`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if either dimension is zero.
+    pub fn new(width: u32, height: u32, names: &[&str]) -> Self {
+        Self::new_with_origin(0, 0, width, height, names)
+    }
+
+    /// Creates a zero-filled planar buffer with the given dimensions in
+    /// pixels, with one plane per channel in `names`, for the window that
+    /// starts at the given origin coordinate.
+    ///
+    /// See `FrameBuffer::new_with_origin()` for details.
+    ///
+    /// # Panics
+    ///
+    /// Panics if either dimension is zero.
+    pub fn new_with_origin(
+        origin_x: i32,
+        origin_y: i32,
+        width: u32,
+        height: u32,
+        names: &[&str],
+    ) -> Self {
+        assert!(
+            width > 0 && height > 0,
+            "PlanarBuffer dimensions must be non-zero"
+        );
+        let len = width as usize * height as usize;
+        PlanarBuffer {
+            dimensions: (width, height),
+            origin: (origin_x, origin_y),
+            names: names.iter().map(|name| name.to_string()).collect(),
+            planes: names.iter().map(|_| Plane::zeroed(len)).collect(),
+            pool: None,
+        }
+    }
+
+    /// Return the dimensions of the buffer.
+    pub fn dimensions(&self) -> (u32, u32) {
+        self.dimensions
+    }
+
+    /// Return the origin of the buffer.
+    pub fn origin(&self) -> (i32, i32) {
+        self.origin
+    }
+
+    /// Returns the number of channels (planes).
+    pub fn channels(&self) -> usize {
+        self.planes.len()
+    }
+
+    /// Returns the name of channel `index`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `index` is out of range.
+    pub fn name(&self, index: usize) -> &str {
+        &self.names[index]
+    }
+
+    /// Returns the index of the channel named `name`, if there is one.
+    pub fn find(&self, name: &str) -> Option<usize> {
+        self.names.iter().position(|n| n == name)
+    }
+
+    /// Returns the plane of channel `index`, in scanline order.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `index` is out of range.
+    pub fn plane(&self, index: usize) -> &[T] {
+        &self.planes[index]
+    }
+
+    /// Returns the plane of channel `index` mutably, in scanline order.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `index` is out of range.
+    pub fn plane_mut(&mut self, index: usize) -> &mut [T] {
+        &mut self.planes[index]
+    }
+
+    /// Creates a `FrameBuffer` with a unit-stride slice for each plane, for
+    /// writing files.
+    pub fn frame_buffer(&self) -> FrameBuffer<'_> {
+        let (width, height) = self.dimensions;
+        let mut frame_buffer =
+            FrameBuffer::new_with_origin(self.origin.0, self.origin.1, width, height);
+        for (name, plane) in self.names.iter().zip(&self.planes) {
+            frame_buffer.insert_channel(name, plane);
+        }
+        frame_buffer
+    }
+
+    /// Creates a `FrameBufferMut` with a unit-stride slice for each plane,
+    /// for reading files.
+    ///
+    /// `fills` are the values used for channels that are missing from the
+    /// file being read, in the same order as the planes.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `fills` doesn't have one element per channel.
+    pub fn frame_buffer_mut(&mut self, fills: &[f64]) -> FrameBufferMut<'_> {
+        assert_eq!(
+            fills.len(),
+            self.planes.len(),
+            "PlanarBuffer needs one fill value per channel"
+        );
+        let (width, height) = self.dimensions;
+        let mut frame_buffer =
+            FrameBufferMut::new_with_origin(self.origin.0, self.origin.1, width, height);
+        for ((name, plane), fill) in self.names.iter().zip(&mut self.planes).zip(fills) {
+            frame_buffer.insert_channel(name, *fill, plane);
+        }
+        frame_buffer
+    }
+
+    /// Copies the planes into interleaved pixels, one field of `P` per
+    /// channel in order.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `pixels` doesn't contain precisely width * height elements,
+    /// or if `P` doesn't have exactly one field of type `T` per channel.
+    pub fn pack<P: PixelStruct>(&self, pixels: &mut [P]) {
+        let slots = self.slots::<P>(pixels.len());
+        let base = pixels.as_mut_ptr() as *mut u8;
+        for start in (0..pixels.len()).step_by(BLOCK_PIXELS) {
+            let end = (start + BLOCK_PIXELS).min(pixels.len());
+            for (plane, slot) in self.planes.iter().zip(&slots) {
+                let values = &plane[start..end];
+                match *slot {
+                    Slot::Dense(index, stride) => unsafe {
+                        let first = (base as *mut T).add(start * stride + index);
+                        match stride {
+                            1 => scatter::<T, 1>(values, first),
+                            2 => scatter::<T, 2>(values, first),
+                            3 => scatter::<T, 3>(values, first),
+                            4 => scatter::<T, 4>(values, first),
+                            _ => {
+                                for (i, value) in values.iter().enumerate() {
+                                    *first.add(i * stride) = *value;
+                                }
+                            }
+                        }
+                    },
+                    Slot::Offset(offset) => {
+                        for (i, value) in values.iter().enumerate() {
+                            unsafe {
+                                let field = base.add((start + i) * mem::size_of::<P>() + offset);
+                                ptr::write_unaligned(field as *mut T, *value);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /// Copies interleaved pixels into the planes, one field of `P` per
+    /// channel in order.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `pixels` doesn't contain precisely width * height elements,
+    /// or if `P` doesn't have exactly one field of type `T` per channel.
+    pub fn unpack<P: PixelStruct>(&mut self, pixels: &[P]) {
+        let slots = self.slots::<P>(pixels.len());
+        let base = pixels.as_ptr() as *const u8;
+        for start in (0..pixels.len()).step_by(BLOCK_PIXELS) {
+            let end = (start + BLOCK_PIXELS).min(pixels.len());
+            for (plane, slot) in self.planes.iter_mut().zip(&slots) {
+                let values = &mut plane[start..end];
+                match *slot {
+                    Slot::Dense(index, stride) => unsafe {
+                        let first = (base as *const T).add(start * stride + index);
+                        match stride {
+                            1 => gather::<T, 1>(first, values),
+                            2 => gather::<T, 2>(first, values),
+                            3 => gather::<T, 3>(first, values),
+                            4 => gather::<T, 4>(first, values),
+                            _ => {
+                                for (i, value) in values.iter_mut().enumerate() {
+                                    *value = *first.add(i * stride);
+                                }
+                            }
+                        }
+                    },
+                    Slot::Offset(offset) => {
+                        for (i, value) in values.iter_mut().enumerate() {
+                            unsafe {
+                                let field = base.add((start + i) * mem::size_of::<P>() + offset);
+                                *value = ptr::read_unaligned(field as *const T);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Works out where each channel lives in a `P`, checking that `P` matches
+    // the planes and that `len` pixels of it cover the buffer.
+    //
+    // When `P` is nothing but a packed array of `T`s (as with tuples and
+    // arrays of a single type), every channel is a `Slot::Dense` and the
+    // interleaved pixels are treated as a flat slice of `T`, which lets the
+    // compiler vectorize the copies.
+    fn slots<P: PixelStruct>(&self, len: usize) -> Vec<Slot> {
+        let (width, height) = self.dimensions;
+        if len != width as usize * height as usize {
+            panic!(
+                "data size of {} elements cannot back {}x{} PlanarBuffer",
+                len, width, height
+            );
+        }
+        if P::channel_count() != self.planes.len() {
+            panic!(
+                "pixel type has {} channels, but PlanarBuffer has {}",
+                P::channel_count(),
+                self.planes.len()
+            );
+        }
+
+        let size = mem::size_of::<T>();
+        let stride = mem::size_of::<P>() / size;
+        let dense = mem::size_of::<P>() == self.planes.len() * size
+            && mem::align_of::<P>() >= mem::align_of::<T>();
+        P::channels()
+            .map(|(ty, offset)| {
+                if ty != T::pixel_type() {
+                    panic!(
+                        "pixel type channel is {:?}, but PlanarBuffer is {:?}",
+                        ty,
+                        T::pixel_type()
+                    );
+                }
+                if dense {
+                    Slot::Dense(offset / size, stride)
+                } else {
+                    Slot::Offset(offset)
+                }
+            })
+            .collect()
+    }
+}
+
+impl<T> Drop for PlanarBuffer<T> {
+    fn drop(&mut self) {
+        if let Some(ref pool) = self.pool {
+            pool.free.lock().unwrap().extend(self.planes.drain(..));
+        }
+    }
+}
+
+/// A pool of planes for `PlanarBuffer`s, which go back to the pool when
+/// the buffers are dropped.
+///
+/// Each plane is handed out again for the next buffer that needs a plane
+/// of at most its size, so reading a sequence of same-sized images into
+/// pooled buffers only allocates memory for the first one(s).  Reused
+/// planes aren't cleared: their contents are left over from their previous
+/// use, and reading a file overwrites them.  Newly allocated planes are
+/// zero-filled.
+///
+/// Clones share the same pool, which can be used from multiple threads.
+/// Planes stay in the pool until it's dropped along with every buffer
+/// using it, or until `clear()`.
+pub struct BufferPool<T> {
+    free: Arc<Mutex<Vec<Plane<T>>>>,
+}
+
+impl<T: PixelData + Copy + Default> BufferPool<T> {
+    /// Creates an empty pool.
+    pub fn new() -> Self {
+        BufferPool {
+            free: Arc::new(Mutex::new(Vec::new())),
+        }
+    }
+
+    /// Creates a planar buffer with planes from the pool, just like
+    /// `PlanarBuffer::new()` except that the contents of the planes are
+    /// unspecified.
+    ///
+    /// # Panics
+    ///
+    /// Panics if either dimension is zero.
+    pub fn planar_buffer(&self, width: u32, height: u32, names: &[&str]) -> PlanarBuffer<T> {
+        self.planar_buffer_with_origin(0, 0, width, height, names)
+    }
+
+    /// Creates a planar buffer with planes from the pool, just like
+    /// `PlanarBuffer::new_with_origin()` except that the contents of the
+    /// planes are unspecified.
+    ///
+    /// # Panics
+    ///
+    /// Panics if either dimension is zero.
+    pub fn planar_buffer_with_origin(
+        &self,
+        origin_x: i32,
+        origin_y: i32,
+        width: u32,
+        height: u32,
+        names: &[&str],
+    ) -> PlanarBuffer<T> {
+        assert!(
+            width > 0 && height > 0,
+            "PlanarBuffer dimensions must be non-zero"
+        );
+        let len = width as usize * height as usize;
+        let planes = {
+            let mut free = self.free.lock().unwrap();
+            names
+                .iter()
+                .map(|_| {
+                    // The smallest plane that's large enough.
+                    let best = (0..free.len())
+                        .filter(|&i| free[i].capacity >= len)
+                        .min_by_key(|&i| free[i].capacity);
+                    match best {
+                        Some(i) => {
+                            let mut plane = free.swap_remove(i);
+                            plane.len = len;
+                            plane
+                        }
+                        None => Plane::zeroed(len),
+                    }
+                })
+                .collect()
+        };
+        PlanarBuffer {
+            dimensions: (width, height),
+            origin: (origin_x, origin_y),
+            names: names.iter().map(|name| name.to_string()).collect(),
+            planes: planes,
+            pool: Some(self.clone()),
+        }
+    }
+
+    /// Returns the number of bytes of planes waiting in the pool.
+    pub fn idle_bytes(&self) -> usize {
+        let free = self.free.lock().unwrap();
+        free.iter()
+            .map(|plane| plane.capacity * mem::size_of::<T>())
+            .sum()
+    }
+
+    /// Frees the planes waiting in the pool.  Planes of buffers still in
+    /// use are returned to the pool as usual.
+    pub fn clear(&self) {
+        self.free.lock().unwrap().clear();
+    }
+}
+
+impl<T> Clone for BufferPool<T> {
+    fn clone(&self) -> Self {
+        BufferPool {
+            free: self.free.clone(),
+        }
+    }
+}
+
+impl<T: PixelData + Copy + Default> Default for BufferPool<T> {
+    fn default() -> Self {
+        BufferPool::new()
+    }
+}
+
+// An allocation of `capacity` values of `T` aligned to `PLANE_ALIGN`, viewed
+// as its first `len` values.  `T` is always a `PixelData` type, for which
+// all zeroes is a valid value.
+struct Plane<T> {
+    ptr: NonNull<T>,
+    len: usize,
+    capacity: usize,
+    _phantom: PhantomData<T>,
+}
+
+unsafe impl<T: Send> Send for Plane<T> {}
+unsafe impl<T: Sync> Sync for Plane<T> {}
+
+impl<T> Plane<T> {
+    fn zeroed(len: usize) -> Plane<T> {
+        let layout = Plane::<T>::layout(len);
+        let ptr = unsafe { alloc::alloc_zeroed(layout) } as *mut T;
+        match NonNull::new(ptr) {
+            Some(ptr) => Plane {
+                ptr: ptr,
+                len: len,
+                capacity: len,
+                _phantom: PhantomData,
+            },
+            None => alloc::handle_alloc_error(layout),
+        }
+    }
+
+    fn layout(capacity: usize) -> Layout {
+        mem::size_of::<T>()
+            .checked_mul(capacity.max(1))
+            .and_then(|size| Layout::from_size_align(size, PLANE_ALIGN).ok())
+            .expect("PlanarBuffer plane is too large")
+    }
+}
+
+impl<T> Deref for Plane<T> {
+    type Target = [T];
+    fn deref(&self) -> &[T] {
+        unsafe { slice::from_raw_parts(self.ptr.as_ptr(), self.len) }
+    }
+}
+
+impl<T> DerefMut for Plane<T> {
+    fn deref_mut(&mut self) -> &mut [T] {
+        unsafe { slice::from_raw_parts_mut(self.ptr.as_ptr(), self.len) }
+    }
+}
+
+impl<T> Drop for Plane<T> {
+    fn drop(&mut self) {
+        unsafe {
+            alloc::dealloc(
+                self.ptr.as_ptr() as *mut u8,
+                Plane::<T>::layout(self.capacity),
+            )
+        };
+    }
+}
+
+// Where a channel lives in an interleaved pixel.
+enum Slot {
+    // Element index within a pixel viewed as `stride` elements of `T`.
+    Dense(usize, usize),
+    // Byte offset within the pixel.
+    Offset(usize),
+}
+
+// Copies `values` to every `STRIDE`th element starting at `first`.  The
+// stride is a constant so that the compiler can vectorize this with
+// interleaving shuffles.
+unsafe fn scatter<T: Copy, const STRIDE: usize>(values: &[T], first: *mut T) {
+    for (i, value) in values.iter().enumerate() {
+        *first.add(i * STRIDE) = *value;
+    }
+}
+
+// Copies every `STRIDE`th element starting at `first` to `values`.  See
+// `scatter()`.
+unsafe fn gather<T: Copy, const STRIDE: usize>(first: *const T, values: &mut [T]) {
+    for (i, value) in values.iter_mut().enumerate() {
+        *value = *first.add(i * STRIDE);
+    }
+}
@@ -0,0 +1,115 @@
+//! I/O statistics of input and output files.
+//!
+//! `InputFile::stats()` and `ScanlineOutputFile::stats()` report how much
+//! data a file has moved, how often it has called into its reader or
+//! writer, and how the time spent reading or writing pixels splits between
+//! I/O and the codec.  This tells whether a slow read or write is bound by
+//! storage or by compression.
+//!
+//! The counters are always kept, and only cost a clock read per call into
+//! the reader or writer and per pixel read or write.
+//!
+//! # Examples
+//!
+//! ```no_run
+//! # use openexr::{FrameBufferMut, InputFile};
+//! #
+//! let mut file = std::fs::File::open("input_file.exr").unwrap();
+//! let mut input_file = InputFile::new(&mut file).unwrap();
+//! let (width, height) = input_file.header().data_dimensions();
+//!
+//! let mut pixel_data = vec![(0.0f32, 0.0f32, 0.0f32); (width * height) as usize];
+//! let mut fb = FrameBufferMut::new(width, height);
+//! fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut pixel_data);
+//! input_file.read_pixels(&mut fb).unwrap();
+//!
+//! let stats = input_file.stats();
+//! println!(
+//!     "{} bytes in {} reads, {:?} of {:?} spent in I/O",
+//!     stats.bytes,
+//!     stats.io_calls,
+//!     stats.io_time,
+//!     stats.pixel_time
+//! );
+//! ```
+
+use std::time::{Duration, Instant};
+
+use openexr_sys::CEXR_IoStats;
+
+use Header;
+
+/// Cumulative I/O statistics of a file, since it was opened or created.
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq)]
+pub struct IoStats {
+    /// The number of bytes read from or written to the file, including its
+    /// header and offset tables.
+    pub bytes: u64,
+
+    /// The number of calls made to the `Read` or `Write` implementation.
+    ///
+    /// With buffering (see `InputOptions::set_buffer_size()`) this is
+    /// generally much smaller than the number of reads and writes OpenEXR
+    /// does.  It's zero for files read from memory.
+    pub io_calls: u64,
+
+    /// The number of calls made to the `Seek` implementation.  It's zero for
+    /// files read from memory.
+    pub seek_calls: u64,
+
+    /// The time spent in the `Read`, `Write` and `Seek` calls.
+    pub io_time: Duration,
+
+    /// The time spent reading or writing pixels, including the part of
+    /// `io_time` spent meanwhile.  The time spent in the codec is roughly
+    /// `pixel_time - io_time`.
+    pub pixel_time: Duration,
+
+    /// The number of chunks of scanlines decoded or encoded.  With region
+    /// reads and type conversions, this counts each chunk touched once.
+    pub chunks: u64,
+}
+
+impl IoStats {
+    pub(crate) fn new(stream: &CEXR_IoStats, pixels: &PixelStats) -> IoStats {
+        IoStats {
+            bytes: stream.bytes,
+            io_calls: stream.calls,
+            seek_calls: stream.seeks,
+            io_time: Duration::from_nanos(stream.nanos),
+            pixel_time: pixels.time,
+            chunks: pixels.chunks,
+        }
+    }
+}
+
+// The part of `IoStats` kept on the Rust side: time spent in and chunks
+// covered by pixel reads or writes.
+#[derive(Debug, Default)]
+pub(crate) struct PixelStats {
+    time: Duration,
+    chunks: u64,
+}
+
+impl PixelStats {
+    pub fn new() -> PixelStats {
+        PixelStats::default()
+    }
+
+    // Records a read or write of scanlines `start_scanline` to
+    // `end_scanline` of the data window, which started at `started`.
+    pub fn record(
+        &mut self,
+        header: &Header,
+        start_scanline: i32,
+        end_scanline: i32,
+        started: Instant,
+    ) {
+        let chunk = header.scanlines_per_chunk() as i64;
+        let min_y = header.data_window().min.y as i64;
+        let first = (start_scanline as i64 - min_y) / chunk;
+        let last = (end_scanline as i64 - min_y) / chunk;
+        self.time += started.elapsed();
+        self.chunks += (last - first + 1) as u64;
+    }
+}
@@ -1,30 +1,44 @@
-use std::io::{Read, Seek, SeekFrom, Write};
+use std::io::{ErrorKind, Read, Seek, SeekFrom, Write};
 use std::os::raw::{c_char, c_int, c_void};
-use std::slice;
+use std::{panic, slice};
 
 /// Returns 0 on success, 1 on system failure, and 2 on other failure.
 ///
+/// Reads until `c` is full or the end of the input is reached, and stores
+/// the number of bytes read in `read_out`.  This is fewer than `n` only at
+/// the end of the input, which lets the C++ side read ahead without knowing
+/// the size of the input.
+///
 /// ImfIO.h:
 /// virtual bool read (char c[/*n*/], int n) = 0;
 pub unsafe extern "C" fn read_stream<T: Read>(
     read: *mut c_void,
     c: *mut c_char,
     n: c_int,
+    read_out: *mut c_int,
     err_out: *mut c_int,
 ) -> c_int {
     let bytes = slice::from_raw_parts_mut(c as *mut u8, n as usize);
-    match (*(read as *mut T)).read_exact(bytes) {
-        Ok(_) => 0,
-        Err(e) => {
-            if let Some(err) = e.raw_os_error() {
-                *err_out = err as c_int;
-                1
-            } else {
-                *err_out = 0;
-                2
+    let reader = &mut *(read as *mut T);
+    let mut total = 0;
+    while total < bytes.len() {
+        match reader.read(&mut bytes[total..]) {
+            Ok(0) => break,
+            Ok(count) => total += count,
+            Err(ref e) if e.kind() == ErrorKind::Interrupted => {}
+            Err(e) => {
+                if let Some(err) = e.raw_os_error() {
+                    *err_out = err as c_int;
+                    return 1;
+                } else {
+                    *err_out = 0;
+                    return 2;
+                }
             }
         }
     }
+    *read_out = total as c_int;
+    0
 }
 
 /// Returns 0 on success, 1 on system failure, and 2 on other failure.
@@ -52,6 +66,32 @@ pub unsafe extern "C" fn write_stream<T: Write>(
     }
 }
 
+/// Returns 0 on success, and 1 if the vector couldn't grow.
+///
+/// Sets the length of the `Vec<u8>` at `vec` to `len`, the number of bytes
+/// the C++ side has written into it, makes sure its capacity is at least
+/// `min_capacity`, and returns its storage in `data_out` and
+/// `capacity_out`.
+pub unsafe extern "C" fn sync_vec(
+    vec: *mut c_void,
+    len: usize,
+    min_capacity: usize,
+    data_out: *mut *mut c_char,
+    capacity_out: *mut usize,
+) -> c_int {
+    let vec = &mut *(vec as *mut Vec<u8>);
+    vec.set_len(len);
+    if min_capacity > vec.capacity() {
+        let additional = min_capacity - len;
+        if panic::catch_unwind(panic::AssertUnwindSafe(|| vec.reserve(additional))).is_err() {
+            return 1;
+        }
+    }
+    *data_out = vec.as_mut_ptr() as *mut c_char;
+    *capacity_out = vec.capacity();
+    0
+}
+
 /// Returns 0 on success, 1 on system failure, and 2 on other failure.
 ///
 /// ImfIO.h:
@@ -8,10 +8,23 @@
 //!
 //! By default, the thread pool is disabled.
 //!
+//! Instead of OpenEXR's own worker threads, the work can also be run by an
+//! executor of your choosing (e.g. a rayon thread pool) with
+//! `set_global_executor()`, and individual reads and writes can send their
+//! work to a different executor than the rest with `with_executor()`.
+//! That way, for example, latency-sensitive reads don't have to queue up
+//! behind bulk conversions.
+//!
 //! Please see the
 //! [OpenEXR C++ library documentation](https://www.openexr.com/documentation/ReadingAndWritingImageFiles.pdf)
 //! for more details.
 
+use std::cell::Cell;
+use std::os::raw::c_void;
+use std::{mem, panic, ptr};
+
+use openexr_sys::CEXR_Task;
+
 use error::{Error, Result};
 
 /// Sets the number of worker threads to use for compression/decompression.
@@ -19,17 +32,115 @@ use error::{Error, Result};
 /// If set to `0`, the thread pool is disabled and all OpenEXR calls will run
 /// on their calling thread.
 pub fn set_global_thread_count(thread_count: usize) -> Result<()> {
-    if thread_count > ::std::os::raw::c_int::max_value() as usize {
-        return Err(Error::Generic(String::from(
-            "The number of threads is too high",
-        )));
-    }
+    let thread_count = c_thread_count(thread_count)?;
 
     let mut error_out = ::std::ptr::null();
 
+    let error = unsafe { openexr_sys::CEXR_set_global_thread_count(thread_count, &mut error_out) };
+    if error != 0 {
+        Err(Error::take(error_out))
+    } else {
+        Ok(())
+    }
+}
+
+/// A unit of OpenEXR's compression or decompression work, handed to an
+/// `Executor`.
+///
+/// Each task must be run exactly once, on any thread.  The read or write
+/// that created a task waits for it to be run, so tasks should be run
+/// promptly.  A task that is dropped without being run is run by `drop()`,
+/// so that nothing waits on it forever.
+pub struct Task {
+    handle: *mut CEXR_Task,
+}
+
+// Tasks are designed to be run on OpenEXR's worker threads.
+unsafe impl Send for Task {}
+
+impl Task {
+    /// Runs the task.
+    pub fn run(self) {
+        let handle = self.handle;
+        mem::forget(self);
+        unsafe { openexr_sys::CEXR_Task_run(handle) };
+    }
+}
+
+impl Drop for Task {
+    fn drop(&mut self) {
+        unsafe { openexr_sys::CEXR_Task_run(self.handle) };
+    }
+}
+
+/// Runs OpenEXR's compression and decompression tasks.
+///
+/// This is implemented for closures, so an executor that hands each task
+/// to a rayon thread pool, for example, is just
+/// `move |task: Task| pool.spawn(move || task.run())`.
+pub trait Executor: Send + Sync {
+    /// Arranges for `task` to be run, typically on another thread.
+    fn execute(&self, task: Task);
+}
+
+impl<F: Fn(Task) + Send + Sync> Executor for F {
+    fn execute(&self, task: Task) {
+        self(task)
+    }
+}
+
+/// Replaces OpenEXR's global thread pool with `executor`.
+///
+/// From then on, all tasks of all files are handed to `executor`, except
+/// for those redirected by `with_executor()`.  `thread_count` is reported
+/// to OpenEXR as the size of the thread pool, but how many tasks actually
+/// run at once is up to `executor`.  Per-file thread counts (see
+/// `InputOptions::set_threads()`) still limit how many tasks each file
+/// creates at once.
+///
+/// The previous executor, if any, is dropped once all of its tasks have
+/// run.  Afterward, `set_global_thread_count()` only changes the reported
+/// size of the thread pool.
+///
+/// # Examples
+///
+/// Run OpenEXR's work on a dedicated pool of four plain threads:
+///
+/// ```no_run
+/// # use openexr::threads::{self, Task};
+/// use std::sync::mpsc;
+/// use std::sync::{Arc, Mutex};
+///
+/// let (sender, receiver) = mpsc::channel::<Task>();
+/// let receiver = Arc::new(Mutex::new(receiver));
+/// for _ in 0..4 {
+///     let receiver = receiver.clone();
+///     std::thread::spawn(move || loop {
+///         let task = receiver.lock().unwrap().recv();
+///         match task {
+///             Ok(task) => task.run(),
+///             Err(_) => break,
+///         }
+///     });
+/// }
+///
+/// let sender = Mutex::new(sender);
+/// threads::set_global_executor(4, move |task: Task| {
+///     sender.lock().unwrap().send(task).ok();
+/// })
+/// .unwrap();
+/// ```
+pub fn set_global_executor<E: Executor + 'static>(thread_count: usize, executor: E) -> Result<()> {
+    let thread_count = c_thread_count(thread_count)?;
+    let executor: Box<Box<dyn Executor>> = Box::new(Box::new(executor));
+
+    let mut error_out = ptr::null();
     let error = unsafe {
-        openexr_sys::CEXR_set_global_thread_count(
-            thread_count as ::std::os::raw::c_int,
+        openexr_sys::CEXR_set_global_thread_provider(
+            thread_count,
+            Box::into_raw(executor) as *mut c_void,
+            Some(add_task),
+            Some(delete_executor),
             &mut error_out,
         )
     };
@@ -40,6 +151,92 @@ pub fn set_global_thread_count(thread_count: usize) -> Result<()> {
     }
 }
 
+/// Calls `f`, handing the tasks of reads and writes done by `f` on the
+/// calling thread to `executor` instead of the global executor.
+///
+/// This lets different reads and writes use different executors, e.g. to
+/// keep interactive reads isolated from batch work.  It only takes effect
+/// once a global executor has been set with `set_global_executor()`;
+/// until then, tasks always go to OpenEXR's own thread pool.  Calls can be
+/// nested, and the innermost executor is used.
+///
+/// # Examples
+///
+/// ```no_run
+/// # use openexr::{FrameBufferMut, InputFile};
+/// # use openexr::input::InputOptions;
+/// # use openexr::threads::{self, Task};
+/// # let global = |task: Task| task.run();
+/// # let interactive = |task: Task| task.run();
+/// threads::set_global_executor(8, global).unwrap();
+///
+/// let mut input_file = unsafe {
+///     InputFile::from_path_mmap_with_options("input_file.exr", InputOptions::new().set_threads(4))
+/// }
+/// .unwrap();
+/// let (width, height) = input_file.header().data_dimensions();
+/// let mut pixel_data = vec![(0.0f32, 0.0f32, 0.0f32); (width * height) as usize];
+/// let mut fb = FrameBufferMut::new(width, height);
+/// fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut pixel_data);
+///
+/// threads::with_executor(&interactive, || input_file.read_pixels(&mut fb)).unwrap();
+/// ```
+pub fn with_executor<E: Executor, R, F: FnOnce() -> R>(executor: &E, f: F) -> R {
+    // Puts back the previous executor even if `f` panics.
+    struct Restore(Option<*const dyn Executor>);
+    impl Drop for Restore {
+        fn drop(&mut self) {
+            CURRENT_EXECUTOR.with(|current| current.set(self.0));
+        }
+    }
+
+    // NOTE: the lifetime of `executor` is erased here, which is sound
+    // because OpenEXR only hands out tasks from within the reads and writes
+    // done by `f`, and the executor is taken out of `CURRENT_EXECUTOR`
+    // again before `executor` goes out of scope.
+    let executor: &dyn Executor = executor;
+    let executor: *const dyn Executor = unsafe { mem::transmute(executor) };
+    let _restore = Restore(CURRENT_EXECUTOR.with(|current| current.replace(Some(executor))));
+    f()
+}
+
+thread_local! {
+    // The executor set by `with_executor()` on this thread, if any.
+    static CURRENT_EXECUTOR: Cell<Option<*const dyn Executor>> = Cell::new(None);
+}
+
+// Called by the C++ side with each task, on the thread that created it.
+unsafe extern "C" fn add_task(executor: *mut c_void, task: *mut CEXR_Task) {
+    let task = Task { handle: task };
+    let global = &**(executor as *const Box<dyn Executor>);
+
+    // A panicking executor can't unwind into C++.  The task is either
+    // dropped during unwinding (and so run), or still owned by the executor.
+    let _ = panic::catch_unwind(panic::AssertUnwindSafe(|| {
+        match CURRENT_EXECUTOR.with(|current| current.get()) {
+            Some(current) => (*current).execute(task),
+            None => global.execute(task),
+        }
+    }));
+}
+
+// Called by the C++ side when the executor is replaced.
+unsafe extern "C" fn delete_executor(executor: *mut c_void) {
+    let executor = Box::from_raw(executor as *mut Box<dyn Executor>);
+    let _ = panic::catch_unwind(panic::AssertUnwindSafe(move || drop(executor)));
+}
+
+// Converts a thread count to the `int` that the OpenEXR APIs expect.
+pub(crate) fn c_thread_count(thread_count: usize) -> Result<::std::os::raw::c_int> {
+    if thread_count > ::std::os::raw::c_int::max_value() as usize {
+        Err(Error::Generic(String::from(
+            "The number of threads is too high",
+        )))
+    } else {
+        Ok(thread_count as ::std::os::raw::c_int)
+    }
+}
+
 #[test]
 fn test_set_global_thread_count() {
     assert!(set_global_thread_count(4).is_ok());
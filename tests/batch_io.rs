@@ -0,0 +1,75 @@
+extern crate openexr;
+
+mod common;
+
+use std::sync::Mutex;
+
+use openexr::{BatchReader, Header, PixelType};
+
+// Writes a `size`x`size` image whose "Y" channel is `value` everywhere.
+fn write_file(size: u32, value: f32) -> Vec<u8> {
+    let mut header = Header::new();
+    header
+        .set_resolution(size, size)
+        .add_channel("Y", PixelType::FLOAT);
+    common::write_file(&header, &["Y"], &vec![value; (size * size) as usize])
+}
+
+#[test]
+fn batch_io() {
+    let mut files: Vec<Vec<u8>> = (0..20).map(|i| write_file(1 + i % 7, i as f32)).collect();
+    files[5] = b"not an exr file".to_vec();
+    let slices: Vec<&[u8]> = files.iter().map(|file| &file[..]).collect();
+
+    for &threads in &[0, 3] {
+        let seen = Mutex::new(vec![None; files.len()]);
+        let results = BatchReader::new().set_threads(threads).read_slices(
+            &slices,
+            &[("Y", 0.0), ("A", 1.0)],
+            |i, header, pixels: &[(f32, f32)]| {
+                assert_eq!(pixels.len() as u32, header.data_dimensions().0.pow(2));
+                seen.lock().unwrap()[i] = Some(pixels[pixels.len() - 1]);
+            },
+        );
+
+        let seen = seen.into_inner().unwrap();
+        assert_eq!(results.len(), files.len());
+        for i in 0..files.len() {
+            if i == 5 {
+                assert!(results[i].is_err());
+                assert_eq!(seen[i], None);
+            } else {
+                assert!(results[i].is_ok());
+                assert_eq!(seen[i], Some((i as f32, 1.0)));
+            }
+        }
+    }
+}
+
+#[test]
+fn batch_io_paths() {
+    let dir = std::env::temp_dir();
+    let paths: Vec<_> = (0..4)
+        .map(|i| dir.join(format!("openexr-batch-io-{}-{}.exr", std::process::id(), i)))
+        .collect();
+    for (i, path) in paths.iter().enumerate().skip(1) {
+        std::fs::write(path, write_file(4, i as f32)).unwrap();
+    }
+
+    // The first file doesn't exist.
+    let sums = Mutex::new(vec![0.0; paths.len()]);
+    let results = BatchReader::new().set_threads(2).read_paths(
+        &paths,
+        &[("Y", 0.0)],
+        |i, _, pixels: &[f32]| {
+            sums.lock().unwrap()[i] = pixels.iter().sum::<f32>();
+        },
+    );
+    for path in &paths[1..] {
+        std::fs::remove_file(path).unwrap();
+    }
+
+    assert!(results[0].is_err());
+    assert!(results[1..].iter().all(|result| result.is_ok()));
+    assert_eq!(sums.into_inner().unwrap(), vec![0.0, 16.0, 32.0, 48.0]);
+}
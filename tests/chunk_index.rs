@@ -0,0 +1,141 @@
+extern crate openexr;
+
+mod common;
+
+use std::fs;
+use std::path::PathBuf;
+
+use openexr::header::Compression;
+use openexr::input::{ChunkIndex, ChunkIndexCache};
+use openexr::{FrameBufferMut, Header, InputFile, PixelType};
+
+const WIDTH: u32 = 64;
+const HEIGHT: u32 = 100;
+
+fn write_file(value: f32) -> Vec<u8> {
+    let pixel_data: Vec<f32> = (0..(WIDTH * HEIGHT)).map(|i| i as f32 * value).collect();
+    let mut header = Header::new();
+    header
+        .set_resolution(WIDTH, HEIGHT)
+        .set_compression(Compression::ZIP_COMPRESSION)
+        .add_channel("Y", PixelType::FLOAT);
+    common::write_file(&header, &["Y"], &pixel_data)
+}
+
+// Returns a replacement for `write_file(1.0)` whose size differs, so that it's
+// recognized as changed even if the file system's modification times are
+// coarse.
+fn replacement() -> Vec<u8> {
+    let mut data = write_file(2.0);
+    data.extend_from_slice(&[0; 16]);
+    data
+}
+
+fn read_y(input_file: &mut InputFile) -> Vec<f32> {
+    let mut pixel_data = vec![0.0f32; (WIDTH * HEIGHT) as usize];
+    {
+        let mut fb = FrameBufferMut::new(WIDTH, HEIGHT);
+        fb.insert_channel("Y", 0.0, &mut pixel_data);
+        input_file.read_pixels(&mut fb).unwrap();
+    }
+    pixel_data
+}
+
+fn temp_path(name: &str) -> PathBuf {
+    std::env::temp_dir().join(format!("openexr-{}-{}.exr", name, std::process::id()))
+}
+
+#[test]
+fn chunk_locations() {
+    let data = write_file(1.0);
+    let mut input_file = InputFile::from_slice(&data).unwrap();
+    let chunks = input_file.chunk_locations().unwrap();
+    assert_eq!(chunks.len(), 7);
+
+    let mut end = 0;
+    for (i, chunk) in chunks.iter().enumerate() {
+        let chunk = chunk.unwrap();
+        assert_eq!(chunk.first_scanline, i as i32 * 16);
+        assert!(chunk.offset >= end);
+        end = chunk.offset + chunk.size;
+    }
+    assert_eq!(end, data.len() as u64);
+}
+
+#[test]
+fn chunk_locations_invalid_table() {
+    let data = write_file(1.0);
+    let chunks = InputFile::from_slice(&data)
+        .unwrap()
+        .chunk_locations()
+        .unwrap();
+
+    // Point the third entry of the offset table at the fourth chunk.
+    let table = chunks[0].unwrap().offset as usize - chunks.len() * 8;
+    let mut data = data;
+    let fourth = chunks[3].unwrap().offset.to_le_bytes();
+    data[table + 2 * 8..table + 3 * 8].copy_from_slice(&fourth);
+
+    let chunks = InputFile::from_slice(&data)
+        .unwrap()
+        .chunk_locations()
+        .unwrap();
+    assert!(chunks[2].is_none());
+    assert_eq!(chunks.iter().filter(|chunk| chunk.is_some()).count(), 6);
+}
+
+#[test]
+fn chunk_index() {
+    let path = temp_path("chunk-index");
+    fs::write(&path, write_file(1.0)).unwrap();
+    let expected = read_y(&mut unsafe { InputFile::from_path_mmap(&path) }.unwrap());
+
+    let index = ChunkIndex::build(&path).unwrap();
+    assert!(index.is_complete());
+    assert!(index.is_current(&path));
+    assert_eq!(
+        &index.chunks()[..],
+        &unsafe { InputFile::from_path_mmap(&path) }
+            .unwrap()
+            .chunk_locations()
+            .unwrap()[..]
+    );
+    assert_eq!(index.header_size(), index.chunks()[0].unwrap().offset);
+    assert_eq!(read_y(&mut unsafe { index.open(&path) }.unwrap()), expected);
+
+    let bytes = index.to_bytes();
+    assert_eq!(ChunkIndex::from_bytes(&bytes).unwrap(), index);
+    assert!(ChunkIndex::from_bytes(&bytes[..bytes.len() - 1]).is_err());
+    assert!(ChunkIndex::from_bytes(b"not a chunk index").is_err());
+
+    // Replacing the file makes the index out of date.
+    fs::write(&path, replacement()).unwrap();
+    assert!(unsafe { index.open(&path) }.is_err());
+
+    fs::remove_file(&path).unwrap();
+}
+
+#[test]
+fn chunk_index_cache() {
+    let path = temp_path("chunk-index-cache");
+    fs::write(&path, write_file(1.0)).unwrap();
+
+    let mut cache = ChunkIndexCache::new();
+    let expected = read_y(&mut unsafe { cache.open(&path) }.unwrap());
+    assert_eq!(cache.len(), 1);
+    assert_eq!(read_y(&mut unsafe { cache.open(&path) }.unwrap()), expected);
+
+    let mut saved = ChunkIndexCache::from_bytes(&cache.to_bytes()).unwrap();
+    assert_eq!(saved.get(&path), cache.get(&path));
+    assert_eq!(read_y(&mut unsafe { saved.open(&path) }.unwrap()), expected);
+
+    // A replaced file is indexed again.
+    fs::write(&path, replacement()).unwrap();
+    let old_index = saved.get(&path).unwrap().clone();
+    let replaced = read_y(&mut unsafe { saved.open(&path) }.unwrap());
+    assert_eq!(replaced[1], 2.0);
+    assert!(saved.get(&path).unwrap() != &old_index);
+    assert!(saved.get(&path).unwrap().is_current(&path));
+
+    fs::remove_file(&path).unwrap();
+}
@@ -0,0 +1,19 @@
+// Helpers shared by the integration tests.
+
+use openexr::frame_buffer::PixelStruct;
+use openexr::{FrameBuffer, Header, ScanlineOutputFile};
+
+// Writes a scanline file with `header` to memory.  `pixels` covers the data
+// window, with the channels `names` interleaved in each pixel.
+pub fn write_file<T: PixelStruct>(header: &Header, names: &[&str], pixels: &[T]) -> Vec<u8> {
+    let (x, y) = header.data_origin();
+    let (width, height) = header.data_dimensions();
+    let mut buffer = Vec::new();
+    {
+        let mut exr_file = ScanlineOutputFile::to_memory(&mut buffer, header).unwrap();
+        let mut fb = FrameBuffer::new_with_origin(x, y, width, height);
+        fb.insert_channels(names, pixels);
+        exr_file.write_pixels(&fb).unwrap();
+    }
+    buffer
+}
@@ -0,0 +1,95 @@
+extern crate half;
+extern crate openexr;
+
+mod common;
+
+use half::f16;
+use openexr::header::{Compression, CompressionEffort};
+use openexr::{Header, InputFile, PixelType};
+
+// Writes a 64x64 image of ramps into the header's "R" channel, which may be
+// HALF or FLOAT.
+fn write_file(header: &Header) -> Vec<u8> {
+    let pixel_data: Vec<f32> = (0..(64 * 64)).map(|i| (i % 97) as f32 * 0.01).collect();
+    if header.get_channel("R").unwrap().pixel_type == PixelType::HALF {
+        let pixel_data: Vec<f16> = pixel_data.iter().map(|&x| f16::from_f32(x)).collect();
+        common::write_file(header, &["R"], &pixel_data)
+    } else {
+        common::write_file(header, &["R"], &pixel_data)
+    }
+}
+
+#[test]
+fn dwa_compression_level() {
+    let mut header = Header::new();
+    header
+        .set_resolution(64, 64)
+        .set_compression(Compression::DWAA_COMPRESSION)
+        .add_channel("R", PixelType::HALF);
+    assert_eq!(header.dwa_compression_level(), None);
+
+    header.set_dwa_compression_level(Some(100.0));
+    assert_eq!(header.dwa_compression_level(), Some(100.0));
+    let coarse = write_file(&header);
+
+    // The level is stored in the file.
+    let exr_file = InputFile::from_slice(&coarse).unwrap();
+    assert_eq!(exr_file.header().dwa_compression_level(), Some(100.0));
+
+    header.set_dwa_compression_level(None);
+    assert_eq!(header.dwa_compression_level(), None);
+    let fine = write_file(&header);
+    assert!(coarse.len() < fine.len());
+}
+
+#[test]
+fn compression_effort() {
+    let mut header = Header::new();
+    header
+        .set_resolution(64, 64)
+        .set_compression(Compression::ZIP_COMPRESSION)
+        .add_channel("R", PixelType::FLOAT);
+
+    header.set_compression_effort(CompressionEffort::Fastest);
+    assert_eq!(header.compression(), Compression::ZIPS_COMPRESSION);
+    let fastest = write_file(&header);
+    let exr_file = InputFile::from_slice(&fastest).unwrap();
+    assert_eq!(
+        exr_file.header().compression(),
+        Compression::ZIPS_COMPRESSION
+    );
+
+    header.set_compression_effort(CompressionEffort::Default);
+    assert_eq!(header.compression(), Compression::ZIP_COMPRESSION);
+    header.set_compression_effort(CompressionEffort::Smallest);
+    assert_eq!(header.compression(), Compression::ZIP_COMPRESSION);
+    let smallest = write_file(&header);
+    assert!(smallest.len() < fastest.len());
+
+    // DWA only gets smaller.  Its compression level is left alone.
+    header
+        .set_compression(Compression::DWAB_COMPRESSION)
+        .set_dwa_compression_level(Some(100.0));
+    header.set_compression_effort(CompressionEffort::Default);
+    assert_eq!(header.compression(), Compression::DWAA_COMPRESSION);
+    header.set_compression_effort(CompressionEffort::Fastest);
+    assert_eq!(header.compression(), Compression::DWAA_COMPRESSION);
+    header.set_compression_effort(CompressionEffort::Smallest);
+    assert_eq!(header.compression(), Compression::DWAB_COMPRESSION);
+    assert_eq!(header.dwa_compression_level(), Some(100.0));
+
+    let mut header = Header::new();
+    header
+        .set_resolution(64, 64)
+        .set_compression(Compression::DWAA_COMPRESSION)
+        .add_channel("R", PixelType::HALF);
+    let default = write_file(&header);
+    header.set_compression_effort(CompressionEffort::Smallest);
+    let smallest = write_file(&header);
+    assert!(smallest.len() < default.len());
+
+    // Other codecs are left alone.
+    header.set_compression(Compression::PIZ_COMPRESSION);
+    header.set_compression_effort(CompressionEffort::Fastest);
+    assert_eq!(header.compression(), Compression::PIZ_COMPRESSION);
+}
@@ -0,0 +1,158 @@
+extern crate openexr;
+
+use std::io::Cursor;
+
+use openexr::header::{Compression, Envmap, LevelMode, LevelRoundingMode, TileDescription};
+use openexr::{
+    FrameBuffer, FrameBufferMut, Header, InputFile, PixelType, ScanlineOutputFile, TiledInputFile,
+    TiledOutputFile,
+};
+
+fn test_pixels(width: u32, height: u32) -> Vec<(f32, f32)> {
+    (0..(width * height))
+        .map(|i| ((i % width) as f32, (i / width) as f32))
+        .collect()
+}
+
+fn read_pixels(data: &[u8], width: u32, height: u32) -> Vec<(f32, f32)> {
+    let mut exr_file = InputFile::from_slice(data).unwrap();
+    let mut pixel_data = vec![(0.0f32, 0.0f32); (width * height) as usize];
+    {
+        let mut fb = FrameBufferMut::new(width, height);
+        fb.insert_channels(&[("X", 0.0), ("Y", 0.0)], &mut pixel_data);
+        exr_file.read_pixels(&mut fb).unwrap();
+    }
+    pixel_data
+}
+
+#[test]
+fn copy_pixels_scanline() {
+    let pixel_data = test_pixels(128, 96);
+
+    // Write the original file.
+    let mut original = Cursor::new(Vec::<u8>::new());
+    {
+        let mut exr_file = ScanlineOutputFile::new(
+            &mut original,
+            Header::new()
+                .set_resolution(128, 96)
+                .set_compression(Compression::PIZ_COMPRESSION)
+                .add_channel("X", PixelType::FLOAT)
+                .add_channel("Y", PixelType::FLOAT),
+        )
+        .unwrap();
+
+        let mut fb = FrameBuffer::new(128, 96);
+        fb.insert_channels(&["X", "Y"], &pixel_data);
+        exr_file.write_pixels(&fb).unwrap();
+    }
+
+    // Rewrap it with a changed attribute.
+    let mut rewrapped = Cursor::new(Vec::<u8>::new());
+    {
+        let mut input = InputFile::from_slice(original.get_ref()).unwrap();
+        let mut header = input.header().clone();
+        header.set_envmap(Some(Envmap::LatLong));
+        assert!(input.header().envmap().is_none());
+
+        let raw_chunk = input.raw_pixel_data(0).unwrap().to_vec();
+        assert!(!raw_chunk.is_empty());
+        assert_eq!(input.header().scanlines_per_chunk(), 32);
+
+        let mut exr_file = ScanlineOutputFile::new(&mut rewrapped, &header).unwrap();
+        exr_file.copy_pixels_from(&mut input).unwrap();
+
+        // Everything has been written now.
+        assert!(exr_file.copy_pixels_from(&mut input).is_err());
+        let mut fb = FrameBuffer::new(128, 96);
+        fb.insert_channels(&["X", "Y"], &pixel_data);
+        assert!(exr_file.write_pixels_incremental(&fb).is_err());
+    }
+
+    // The copy has the new attribute, and the same compressed and
+    // decompressed data.
+    {
+        let mut original_file = InputFile::from_slice(original.get_ref()).unwrap();
+        let mut copied_file = InputFile::from_slice(rewrapped.get_ref()).unwrap();
+        assert_eq!(copied_file.header().envmap(), Some(Envmap::LatLong));
+        for chunk in 0..3 {
+            assert_eq!(
+                original_file.raw_pixel_data(chunk * 32).unwrap(),
+                copied_file.raw_pixel_data(chunk * 32).unwrap()
+            );
+        }
+    }
+    assert!(read_pixels(rewrapped.get_ref(), 128, 96) == pixel_data);
+}
+
+#[test]
+fn copy_pixels_mismatched_header() {
+    let pixel_data = test_pixels(32, 32);
+
+    let mut original = Cursor::new(Vec::<u8>::new());
+    {
+        let mut exr_file = ScanlineOutputFile::new(
+            &mut original,
+            Header::new()
+                .set_resolution(32, 32)
+                .add_channel("X", PixelType::FLOAT)
+                .add_channel("Y", PixelType::FLOAT),
+        )
+        .unwrap();
+
+        let mut fb = FrameBuffer::new(32, 32);
+        fb.insert_channels(&["X", "Y"], &pixel_data);
+        exr_file.write_pixels(&fb).unwrap();
+    }
+
+    let mut input = InputFile::from_slice(original.get_ref()).unwrap();
+    let mut header = input.header().clone();
+    header.set_compression(Compression::ZIP_COMPRESSION);
+
+    let mut output = Cursor::new(Vec::<u8>::new());
+    let mut exr_file = ScanlineOutputFile::new(&mut output, &header).unwrap();
+    assert!(exr_file.copy_pixels_from(&mut input).is_err());
+}
+
+#[test]
+fn copy_pixels_tiled() {
+    let pixel_data = test_pixels(100, 70);
+
+    // Write the original file.
+    let mut original = Cursor::new(Vec::<u8>::new());
+    {
+        let mut exr_file = TiledOutputFile::new(
+            &mut original,
+            Header::new()
+                .set_resolution(100, 70)
+                .set_tile_description(TileDescription {
+                    x_size: 32,
+                    y_size: 32,
+                    mode: LevelMode::ONE_LEVEL,
+                    rounding_mode: LevelRoundingMode::ROUND_DOWN,
+                })
+                .add_channel("X", PixelType::FLOAT)
+                .add_channel("Y", PixelType::FLOAT),
+        )
+        .unwrap();
+
+        let mut fb = FrameBuffer::new(100, 70);
+        fb.insert_channels(&["X", "Y"], &pixel_data);
+        exr_file.write_pixels(&fb).unwrap();
+    }
+
+    // Rewrap it with a changed attribute.
+    let mut rewrapped = Cursor::new(Vec::<u8>::new());
+    {
+        let mut input = TiledInputFile::from_slice(original.get_ref()).unwrap();
+        let mut header = input.header().clone();
+        header.set_envmap(Some(Envmap::Cube));
+
+        let mut exr_file = TiledOutputFile::new(&mut rewrapped, &header).unwrap();
+        exr_file.copy_pixels_from(&mut input).unwrap();
+    }
+
+    let copied_file = InputFile::from_slice(rewrapped.get_ref()).unwrap();
+    assert_eq!(copied_file.header().envmap(), Some(Envmap::Cube));
+    assert!(read_pixels(rewrapped.get_ref(), 100, 70) == pixel_data);
+}
@@ -0,0 +1,163 @@
+extern crate openexr;
+
+use std::io::Cursor;
+
+use openexr::header::Compression;
+use openexr::{
+    DeepFrameBuffer, DeepFrameBufferMut, DeepScanlineInputFile, DeepScanlineOutputFile, Header,
+    PixelType,
+};
+
+// Sample count of pixel (x, y) of the test image: varies from 0 to 3.
+fn sample_count(x: u32, y: u32) -> u32 {
+    (x + y * 3) % 4
+}
+
+// Writes a 7x5 deep image with a varying number of samples per pixel, where
+// each sample's "Z" is its pixel index plus a tenth of its sample index and
+// its "id" is its pixel index.  The image is written in two chunks.
+fn write_deep_file() -> Vec<u8> {
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+
+    let mut header = Header::new();
+    header
+        .set_resolution(7, 5)
+        .set_compression(Compression::ZIPS_COMPRESSION)
+        .add_channel("Z", PixelType::FLOAT)
+        .add_channel("id", PixelType::UINT);
+
+    let mut sample_counts = Vec::new();
+    let mut depths = Vec::new();
+    let mut ids = Vec::new();
+    for y in 0..5 {
+        for x in 0..7 {
+            let count = sample_count(x, y);
+            sample_counts.push(count);
+            for i in 0..count {
+                depths.push((y * 7 + x) as f32 + i as f32 / 10.0);
+                ids.push(y * 7 + x);
+            }
+        }
+    }
+
+    {
+        let mut exr_file = DeepScanlineOutputFile::new(&mut in_memory_buffer, &header).unwrap();
+
+        // The first two scanlines, then the rest.
+        let split = (sample_counts[..14].iter().sum::<u32>()) as usize;
+        {
+            let mut fb = DeepFrameBuffer::new(7, 2, &sample_counts[..14]);
+            fb.insert_channel("Z", &depths[..split])
+                .insert_channel("id", &ids[..split]);
+            exr_file.write_pixels_incremental(&fb).unwrap();
+
+            // A full image write can't follow an incremental write.
+            assert!(exr_file.write_pixels(&fb).is_err());
+        }
+        let mut fb = DeepFrameBuffer::new(7, 3, &sample_counts[14..]);
+        fb.insert_channel("Z", &depths[split..])
+            .insert_channel("id", &ids[split..]);
+        exr_file.write_pixels_incremental(&fb).unwrap();
+    }
+
+    in_memory_buffer.into_inner()
+}
+
+#[test]
+fn deep_io() {
+    let data = write_deep_file();
+    let mut exr_file = DeepScanlineInputFile::from_slice(&data).unwrap();
+    assert_eq!(exr_file.header().data_dimensions(), (7, 5));
+
+    let mut sample_counts = vec![0u32; 7 * 5];
+    exr_file.read_sample_counts(0, &mut sample_counts).unwrap();
+    for y in 0..5 {
+        for x in 0..7 {
+            assert_eq!(sample_counts[(y * 7 + x) as usize], sample_count(x, y));
+        }
+    }
+
+    let total_samples = sample_counts.iter().sum::<u32>() as usize;
+    let mut samples = vec![(0.0f32, 0u32); total_samples];
+    let mut fill = vec![0.0f32; total_samples];
+    {
+        let mut fb = DeepFrameBufferMut::new(7, 5, &sample_counts);
+        fb.insert_channels(&[("Z", 0.0), ("id", 0.0)], &mut samples)
+            .insert_channel("A", 1.0, &mut fill);
+        exr_file.read_pixels(&mut fb).unwrap();
+
+        let offset = fb.sample_offset(2, 3);
+        assert_eq!(samples[offset].1, 3 * 7 + 2);
+    }
+
+    let mut i = 0;
+    for y in 0..5 {
+        for x in 0..7 {
+            for s in 0..sample_count(x, y) {
+                assert_eq!(
+                    samples[i],
+                    ((y * 7 + x) as f32 + s as f32 / 10.0, y * 7 + x)
+                );
+                i += 1;
+            }
+        }
+    }
+    for a in &fill {
+        assert_eq!(*a, 1.0);
+    }
+}
+
+#[test]
+fn deep_io_partial() {
+    let data = write_deep_file();
+    let mut exr_file = DeepScanlineInputFile::from_slice(&data).unwrap();
+
+    // Read scanlines 3 and 4 only.
+    let mut sample_counts = vec![0u32; 7 * 2];
+    exr_file.read_sample_counts(3, &mut sample_counts).unwrap();
+    let total_samples = sample_counts.iter().sum::<u32>() as usize;
+    let mut ids = vec![0u32; total_samples];
+    {
+        let mut fb = DeepFrameBufferMut::new(7, 2, &sample_counts);
+        fb.insert_channel("id", 0.0, &mut ids);
+        exr_file.read_pixels_partial(3, &mut fb).unwrap();
+    }
+
+    let mut i = 0;
+    for y in 3..5 {
+        for x in 0..7 {
+            assert_eq!(
+                sample_counts[((y - 3) * 7 + x) as usize],
+                sample_count(x, y)
+            );
+            for _ in 0..sample_count(x, y) {
+                assert_eq!(ids[i], y * 7 + x);
+                i += 1;
+            }
+        }
+    }
+}
+
+#[test]
+fn deep_io_errors() {
+    let data = write_deep_file();
+    let mut exr_file = DeepScanlineInputFile::from_slice(&data).unwrap();
+
+    // Sample counts that aren't whole scanlines, or run past the end of the
+    // image.
+    let mut sample_counts = vec![0u32; 10];
+    assert!(exr_file.read_sample_counts(0, &mut sample_counts).is_err());
+    let mut sample_counts = vec![0u32; 7 * 2];
+    assert!(exr_file.read_sample_counts(4, &mut sample_counts).is_err());
+
+    // A channel with the wrong type.
+    exr_file.read_sample_counts(0, &mut sample_counts).unwrap();
+    let total_samples = sample_counts.iter().sum::<u32>() as usize;
+    let mut depths = vec![0u32; total_samples];
+    let mut fb = DeepFrameBufferMut::new(7, 2, &sample_counts);
+    fb.insert_channel("Z", 0.0, &mut depths);
+    assert!(exr_file.read_pixels_partial(0, &mut fb).is_err());
+
+    // A framebuffer of the wrong size.
+    assert!(exr_file.read_pixels(&mut fb).is_err());
+}
@@ -0,0 +1,73 @@
+extern crate openexr;
+
+use std::io::Cursor;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+
+use openexr::header::Compression;
+use openexr::input::InputOptions;
+use openexr::output::OutputOptions;
+use openexr::threads::{self, Task};
+use openexr::{FrameBuffer, FrameBufferMut, Header, InputFile, PixelType, ScanlineOutputFile};
+
+// Returns an executor that runs tasks on a new thread, counting them in
+// `count`.
+fn counting_executor(count: Arc<AtomicUsize>) -> impl Fn(Task) + Send + Sync {
+    move |task: Task| {
+        count.fetch_add(1, Ordering::SeqCst);
+        std::thread::spawn(move || task.run());
+    }
+}
+
+#[test]
+fn executor() {
+    let global_count = Arc::new(AtomicUsize::new(0));
+    threads::set_global_executor(4, counting_executor(global_count.clone())).unwrap();
+
+    let pixel_data: Vec<f32> = (0..(64 * 64)).map(|i| i as f32).collect();
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+    {
+        let mut header = Header::new();
+        header
+            .set_resolution(64, 64)
+            .set_compression(Compression::ZIP_COMPRESSION)
+            .add_channel("Y", PixelType::FLOAT);
+        let mut exr_file = ScanlineOutputFile::new_with_options(
+            &mut in_memory_buffer,
+            &header,
+            OutputOptions::new().set_threads(2),
+        )
+        .unwrap();
+        let mut fb = FrameBuffer::new(64, 64);
+        fb.insert_channel("Y", &pixel_data);
+        exr_file.write_pixels(&fb).unwrap();
+    }
+    let written_tasks = global_count.load(Ordering::SeqCst);
+    assert!(written_tasks > 0);
+
+    // Reads within `with_executor()` use its executor instead.
+    let data = in_memory_buffer.into_inner();
+    let local_count = Arc::new(AtomicUsize::new(0));
+    let local = counting_executor(local_count.clone());
+    let mut exr_file =
+        InputFile::from_slice_with_options(&data, InputOptions::new().set_threads(2)).unwrap();
+    let mut y = vec![0.0f32; 64 * 64];
+    {
+        let mut fb = FrameBufferMut::new(64, 64);
+        fb.insert_channel("Y", 0.0, &mut y);
+        threads::with_executor(&local, || exr_file.read_pixels(&mut fb)).unwrap();
+    }
+    assert_eq!(y, pixel_data);
+    assert!(local_count.load(Ordering::SeqCst) > 0);
+    assert_eq!(global_count.load(Ordering::SeqCst), written_tasks);
+
+    // Dropped tasks still get run.
+    threads::set_global_executor(4, |task: Task| drop(task)).unwrap();
+    let mut y = vec![0.0f32; 64 * 64];
+    {
+        let mut fb = FrameBufferMut::new(64, 64);
+        fb.insert_channel("Y", 0.0, &mut y);
+        exr_file.read_pixels(&mut fb).unwrap();
+    }
+    assert_eq!(y, pixel_data);
+}
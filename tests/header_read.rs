@@ -0,0 +1,82 @@
+extern crate openexr;
+
+mod common;
+
+use std::io::Cursor;
+
+use openexr::header::{Compression, LineOrder};
+use openexr::{Header, PixelType};
+
+fn write_test_file() -> Vec<u8> {
+    let pixel_data = vec![(0.82f32, 1.78f32, 0.21f32); 256 * 128];
+    common::write_file(
+        Header::new()
+            .set_resolution(256, 128)
+            .set_compression(Compression::ZIP_COMPRESSION)
+            .set_line_order(LineOrder::DECREASING_Y)
+            .add_channel("R", PixelType::FLOAT)
+            .add_channel("G", PixelType::FLOAT)
+            .add_channel("B", PixelType::FLOAT),
+        &["R", "G", "B"],
+        &pixel_data,
+    )
+}
+
+fn check_header(header: &Header) {
+    assert_eq!(header.data_dimensions(), (256, 128));
+    assert_eq!(header.compression(), Compression::ZIP_COMPRESSION);
+    assert_eq!(header.line_order(), LineOrder::DECREASING_Y);
+
+    let names = header
+        .channels()
+        .map(|c| c.unwrap().0.to_string())
+        .collect::<Vec<_>>();
+    assert_eq!(names, vec!["B", "G", "R"]);
+}
+
+#[test]
+fn header_read_from() {
+    let data = write_test_file();
+    check_header(&Header::read_from(&mut Cursor::new(&data)).unwrap());
+}
+
+#[test]
+fn header_read_from_slice() {
+    let data = write_test_file();
+    check_header(&Header::read_from_slice(&data).unwrap());
+
+    // Only the header itself is needed.
+    check_header(&Header::read_from_slice(&data[..1024]).unwrap());
+}
+
+#[test]
+fn header_read_invalid() {
+    assert!(Header::read_from_slice(b"definitely not an exr file").is_err());
+    assert!(Header::read_from_slice(&[]).is_err());
+}
+
+#[test]
+fn header_channels_after_changes() {
+    let mut header = Header::new();
+    header.add_channel("G", PixelType::FLOAT);
+    assert!(header.get_channel("G").is_some());
+    assert!(header.get_channel("R").is_none());
+
+    // Adding channels after they've been looked up is reflected.
+    header
+        .add_channel("R", PixelType::HALF)
+        .add_channel("B", PixelType::UINT);
+    let names = header
+        .channels()
+        .map(|c| c.unwrap().0.to_string())
+        .collect::<Vec<_>>();
+    assert_eq!(names, ["B", "G", "R"]);
+    assert_eq!(header.get_channel("R").unwrap().pixel_type, PixelType::HALF);
+    assert!(header.get_channel("A").is_none());
+
+    // Clones get their own copy of the channel list.
+    let mut clone = header.clone();
+    clone.add_channel("A", PixelType::FLOAT);
+    assert!(clone.get_channel("A").is_some());
+    assert!(header.get_channel("A").is_none());
+}
@@ -126,3 +126,245 @@ fn incremental_io() {
         }
     }
 }
+
+#[test]
+fn incremental_io_reused_framebuffer() {
+    // Target memory for writing
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+
+    // Write file to memory in 16-scanline chunks from a single framebuffer,
+    // changing its contents in between.
+    {
+        let mut exr_file = ScanlineOutputFile::new(
+            &mut in_memory_buffer,
+            &Header::new()
+                .set_resolution(64, 128)
+                .add_channel("R", PixelType::FLOAT)
+                .add_channel("G", PixelType::FLOAT),
+        )
+        .unwrap();
+
+        let mut pixel_data = vec![(0.0f32, 0.0f32); 64 * 16];
+        for chunk in 0..8 {
+            for pixel in &mut pixel_data {
+                *pixel = (chunk as f32, -(chunk as f32));
+            }
+            let mut fb = FrameBuffer::new(64, 16);
+            fb.insert_channels(&["R", "G"], &pixel_data);
+            exr_file.write_pixels_incremental(&fb).unwrap();
+        }
+    }
+
+    // Read it back in 16-scanline chunks into a single buffer.
+    {
+        let mut exr_file = InputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+
+        let mut pixel_data = vec![(0.0f32, 0.0f32); 64 * 16];
+        for chunk in 0..8 {
+            exr_file
+                .read_pixels_partial(
+                    chunk * 16,
+                    FrameBufferMut::new(64, 16)
+                        .insert_channels(&[("R", 0.0), ("G", 0.0)], &mut pixel_data),
+                )
+                .unwrap();
+            for pixel in &pixel_data {
+                assert_eq!(*pixel, (chunk as f32, -(chunk as f32)));
+            }
+        }
+
+        // Reading the same chunk again with the same framebuffer works too.
+        let mut fb = FrameBufferMut::new(64, 16);
+        fb.insert_channels(&[("R", 0.0), ("G", 0.0)], &mut pixel_data);
+        exr_file.read_pixels_partial(16, &mut fb).unwrap();
+        exr_file.read_pixels_partial(16, &mut fb).unwrap();
+    }
+
+    // A framebuffer whose layout no longer matches the file is still caught
+    // after reading with one that does.
+    {
+        let mut exr_file = InputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+
+        let mut pixel_data = vec![(0.0f32, 0.0f32); 64 * 16];
+        exr_file
+            .read_pixels_partial(
+                0,
+                FrameBufferMut::new(64, 16)
+                    .insert_channels(&[("R", 0.0), ("G", 0.0)], &mut pixel_data),
+            )
+            .unwrap();
+
+        let mut bad_data = vec![0u32; 64 * 16];
+        assert!(exr_file
+            .read_pixels_partial(
+                16,
+                FrameBufferMut::new(64, 16).insert_channel("R", 0.0, &mut bad_data)
+            )
+            .is_err());
+        assert!(exr_file
+            .read_pixels_partial(
+                16,
+                FrameBufferMut::new(64, 16).insert_channel("R", 0.0, &mut bad_data)
+            )
+            .is_err());
+
+        exr_file
+            .read_pixels_partial(
+                16,
+                FrameBufferMut::new(64, 16)
+                    .insert_channels(&[("R", 0.0), ("G", 0.0)], &mut pixel_data),
+            )
+            .unwrap();
+        for pixel in &pixel_data {
+            assert_eq!(*pixel, (1.0, -1.0));
+        }
+    }
+}
+
+#[test]
+fn incremental_io_prefetched() {
+    // Target memory for writing
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+
+    // Write a file whose rows each hold their own scanline index.  The
+    // height is deliberately not a multiple of the chunk height below.
+    {
+        let mut exr_file = ScanlineOutputFile::new(
+            &mut in_memory_buffer,
+            &Header::new()
+                .set_resolution(32, 100)
+                .add_channel("R", PixelType::FLOAT)
+                .add_channel("G", PixelType::FLOAT),
+        )
+        .unwrap();
+
+        let mut pixel_data = vec![(0.0f32, 0.0f32); 32 * 100];
+        for (i, pixel) in pixel_data.iter_mut().enumerate() {
+            *pixel = ((i / 32) as f32, (i % 32) as f32);
+        }
+        exr_file
+            .write_pixels(FrameBuffer::new(32, 100).insert_channels(&["R", "G"], &pixel_data))
+            .unwrap();
+    }
+
+    // Read it back with a few prefetch depths, checking that every chunk
+    // arrives in order and with the right contents.
+    for &prefetch in &[1, 2, 8] {
+        let mut exr_file = InputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+
+        let mut next_scanline = 0;
+        exr_file
+            .read_pixels_prefetched(
+                &[("R", 0.0), ("G", 0.0), ("B", 0.5)],
+                16,
+                prefetch,
+                |first_scanline, pixels: &[(f32, f32, f32)]| {
+                    assert_eq!(first_scanline, next_scanline);
+                    assert_eq!(pixels.len() % 32, 0);
+                    for (i, pixel) in pixels.iter().enumerate() {
+                        let y = first_scanline as usize + i / 32;
+                        assert_eq!(*pixel, (y as f32, (i % 32) as f32, 0.5));
+                    }
+                    next_scanline += (pixels.len() / 32) as u32;
+                },
+            )
+            .unwrap();
+        assert_eq!(next_scanline, 100);
+    }
+
+    // Decoding errors are reported.
+    {
+        let mut exr_file = InputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+        let result = exr_file.read_pixels_prefetched(&[("R", 0.0)], 16, 2, |_, _pixels: &[u32]| {
+            panic!("no chunk should decode")
+        });
+        assert!(result.is_err());
+    }
+}
+
+#[test]
+fn incremental_io_pipelined() {
+    // Target memory for writing
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+
+    // Write the first 10 scanlines normally, and the rest pipelined in
+    // chunks that don't evenly divide the image.
+    {
+        let mut exr_file = ScanlineOutputFile::new(
+            &mut in_memory_buffer,
+            &Header::new()
+                .set_resolution(32, 100)
+                .add_channel("R", PixelType::FLOAT)
+                .add_channel("G", PixelType::FLOAT),
+        )
+        .unwrap();
+
+        let pixel_data = vec![(-1.0f32, -1.0f32); 32 * 10];
+        exr_file
+            .write_pixels_incremental(
+                FrameBuffer::new(32, 10).insert_channels(&["R", "G"], &pixel_data),
+            )
+            .unwrap();
+
+        let mut next_scanline = 10;
+        exr_file
+            .write_pixels_pipelined(
+                &["R", "G"],
+                16,
+                2,
+                |first_scanline, pixels: &mut [(f32, f32)]| {
+                    assert_eq!(first_scanline, next_scanline);
+                    for (i, pixel) in pixels.iter_mut().enumerate() {
+                        let y = first_scanline as usize + i / 32;
+                        *pixel = (y as f32, (i % 32) as f32);
+                    }
+                    next_scanline += (pixels.len() / 32) as u32;
+                },
+            )
+            .unwrap();
+        assert_eq!(next_scanline, 100);
+
+        // Nothing is left to write.
+        assert!(exr_file
+            .write_pixels_pipelined(&["R", "G"], 16, 2, |_, _: &mut [(f32, f32)]| {})
+            .is_err());
+    }
+
+    // Read file from memory, and verify its contents
+    {
+        let mut exr_file = InputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+        let mut pixel_data = vec![(0.0f32, 0.0f32); 32 * 100];
+        exr_file
+            .read_pixels(
+                FrameBufferMut::new(32, 100)
+                    .insert_channels(&[("R", 0.0), ("G", 0.0)], &mut pixel_data),
+            )
+            .unwrap();
+        for (i, pixel) in pixel_data.iter().enumerate() {
+            if i < 32 * 10 {
+                assert_eq!(*pixel, (-1.0, -1.0));
+            } else {
+                assert_eq!(*pixel, ((i / 32) as f32, (i % 32) as f32));
+            }
+        }
+    }
+
+    // Write errors stop the producer and are reported.
+    {
+        let mut buffer = Cursor::new(Vec::<u8>::new());
+        let mut exr_file = ScanlineOutputFile::new(
+            &mut buffer,
+            &Header::new()
+                .set_resolution(32, 100)
+                .add_channel("R", PixelType::FLOAT),
+        )
+        .unwrap();
+
+        let mut chunks_produced = 0;
+        let result = exr_file.write_pixels_pipelined(&["R"], 1, 1, |_, _: &mut [u32]| {
+            chunks_produced += 1;
+        });
+        assert!(result.is_err());
+        assert!(chunks_produced < 100);
+    }
+}
@@ -0,0 +1,69 @@
+extern crate openexr;
+
+use std::io::Cursor;
+
+use openexr::header::Compression;
+use openexr::input::InputOptions;
+use openexr::{FrameBuffer, FrameBufferMut, Header, InputFile, PixelType, ScanlineOutputFile};
+
+#[test]
+fn io_stats() {
+    let pixel_data = vec![0.5f32; 32 * 64];
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+    {
+        let mut header = Header::new();
+        header
+            .set_resolution(32, 64)
+            .set_compression(Compression::ZIP_COMPRESSION)
+            .add_channel("Y", PixelType::FLOAT);
+        let mut exr_file = ScanlineOutputFile::new(&mut in_memory_buffer, &header).unwrap();
+        assert_eq!(exr_file.stats().chunks, 0);
+
+        // Two chunks of 16 scanlines, then a chunk and a half.
+        let mut fb = FrameBuffer::new(32, 32);
+        fb.insert_channel("Y", &pixel_data[..32 * 32]);
+        exr_file.write_pixels_incremental(&fb).unwrap();
+        let mut fb = FrameBuffer::new(32, 24);
+        fb.insert_channel("Y", &pixel_data[..32 * 24]);
+        exr_file.write_pixels_incremental(&fb).unwrap();
+        assert_eq!(exr_file.stats().chunks, 4);
+
+        let mut fb = FrameBuffer::new(32, 8);
+        fb.insert_channel("Y", &pixel_data[..32 * 8]);
+        exr_file.write_pixels_incremental(&fb).unwrap();
+        let stats = exr_file.stats();
+        assert_eq!(stats.chunks, 5);
+        assert!(stats.bytes > 0);
+        assert!(stats.seek_calls > 0);
+    }
+    let data = in_memory_buffer.into_inner();
+
+    let mut y = vec![0.0f32; 32 * 64];
+
+    // Through a reader, with a buffer larger than the whole file.
+    let mut cursor = Cursor::new(&data[..]);
+    let mut options = InputOptions::new();
+    options.set_buffer_size(1 << 20);
+    let mut exr_file = InputFile::new_with_options(&mut cursor, &options).unwrap();
+    {
+        let mut fb = FrameBufferMut::new(32, 64);
+        fb.insert_channel("Y", 0.0, &mut y);
+        exr_file.read_pixels(&mut fb).unwrap();
+    }
+    let stats = exr_file.stats();
+    assert!(stats.bytes > 0 && stats.bytes <= data.len() as u64);
+    assert!(stats.io_calls >= 1 && stats.io_calls <= 2);
+    assert_eq!(stats.chunks, 4);
+
+    // From memory, where no reader is involved.
+    let mut exr_file = InputFile::from_slice(&data).unwrap();
+    {
+        let mut fb = FrameBufferMut::new(32, 16);
+        fb.insert_channel("Y", 0.0, &mut y[..32 * 16]);
+        exr_file.read_pixels_partial(8, &mut fb).unwrap();
+    }
+    let stats = exr_file.stats();
+    assert!(stats.bytes > 0);
+    assert_eq!((stats.io_calls, stats.seek_calls), (0, 0));
+    assert_eq!(stats.chunks, 2);
+}
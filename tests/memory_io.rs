@@ -1,6 +1,6 @@
 extern crate openexr;
 
-use std::io::Cursor;
+use std::io::{Cursor, Read, Seek, SeekFrom, Write};
 
 use openexr::{FrameBuffer, FrameBufferMut, Header, InputFile, PixelType, ScanlineOutputFile};
 
@@ -61,3 +61,144 @@ fn memory_io() {
         }
     }
 }
+
+#[test]
+fn memory_io_with_threads() {
+    use openexr::input::InputOptions;
+    use openexr::output::OutputOptions;
+
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+
+    // Write file to memory, encoding with several threads
+    {
+        let pixel_data = vec![(0.82f32, 1.78f32, 0.21f32); 256 * 256];
+
+        let mut exr_file = ScanlineOutputFile::new_with_options(
+            &mut in_memory_buffer,
+            Header::new()
+                .set_resolution(256, 256)
+                .add_channel("R", PixelType::FLOAT)
+                .add_channel("G", PixelType::FLOAT)
+                .add_channel("B", PixelType::FLOAT),
+            OutputOptions::new().set_threads(4),
+        )
+        .unwrap();
+
+        let mut fb = FrameBuffer::new(256, 256);
+        fb.insert_channels(&["R", "G", "B"], &pixel_data);
+
+        exr_file.write_pixels(&fb).unwrap();
+    }
+
+    // Read file from memory single-threaded and verify its contents
+    {
+        let mut pixel_data = vec![(0.0f32, 0.0f32, 0.0f32); 256 * 256];
+
+        let mut exr_file = InputFile::from_slice_with_options(
+            in_memory_buffer.get_ref(),
+            InputOptions::new().set_threads(0),
+        )
+        .unwrap();
+
+        {
+            let mut fb = FrameBufferMut::new(256, 256);
+            fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut pixel_data);
+
+            exr_file.read_pixels(&mut fb).unwrap();
+        }
+
+        for pixel in pixel_data {
+            assert_eq!(pixel, (0.82, 1.78, 0.21));
+        }
+    }
+}
+
+// Wraps a reader or writer, counting the calls made to it.
+struct CountingIo<T> {
+    inner: T,
+    calls: usize,
+}
+
+impl<T: Read> Read for CountingIo<T> {
+    fn read(&mut self, buf: &mut [u8]) -> std::io::Result<usize> {
+        self.calls += 1;
+        self.inner.read(buf)
+    }
+}
+
+impl<T: Write> Write for CountingIo<T> {
+    fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+        self.calls += 1;
+        self.inner.write(buf)
+    }
+
+    fn flush(&mut self) -> std::io::Result<()> {
+        self.inner.flush()
+    }
+}
+
+impl<T: Seek> Seek for CountingIo<T> {
+    fn seek(&mut self, pos: SeekFrom) -> std::io::Result<u64> {
+        self.inner.seek(pos)
+    }
+}
+
+#[test]
+fn memory_io_buffer_sizes() {
+    use openexr::input::InputOptions;
+    use openexr::output::OutputOptions;
+
+    let pixel_data = (0..(64 * 48))
+        .map(|i| (i as f32, 0.5f32, -(i as f32)))
+        .collect::<Vec<_>>();
+
+    let mut calls = Vec::new();
+    for &buffer_size in &[0, 7, 64 * 1024] {
+        // Write through a buffer of the given size.
+        let mut writer = CountingIo {
+            inner: Cursor::new(Vec::<u8>::new()),
+            calls: 0,
+        };
+        {
+            let mut exr_file = ScanlineOutputFile::new_with_options(
+                &mut writer,
+                Header::new()
+                    .set_resolution(64, 48)
+                    .add_channel("R", PixelType::FLOAT)
+                    .add_channel("G", PixelType::FLOAT)
+                    .add_channel("B", PixelType::FLOAT),
+                OutputOptions::new().set_buffer_size(buffer_size),
+            )
+            .unwrap();
+
+            let mut fb = FrameBuffer::new(64, 48);
+            fb.insert_channels(&["R", "G", "B"], &pixel_data);
+            exr_file.write_pixels(&fb).unwrap();
+        }
+
+        // Read it back through a buffer of the same size.
+        let mut reader = CountingIo {
+            inner: Cursor::new(writer.inner.into_inner()),
+            calls: 0,
+        };
+        let mut read_data = vec![(0.0f32, 0.0f32, 0.0f32); 64 * 48];
+        {
+            let mut exr_file = InputFile::new_with_options(
+                &mut reader,
+                InputOptions::new().set_buffer_size(buffer_size),
+            )
+            .unwrap();
+
+            let mut fb = FrameBufferMut::new(64, 48);
+            fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut read_data);
+            exr_file.read_pixels(&mut fb).unwrap();
+        }
+        assert!(read_data == pixel_data);
+
+        calls.push((writer.calls, reader.calls));
+    }
+
+    // Buffering should cut down the number of calls considerably.
+    assert!(calls[2].0 * 4 < calls[0].0);
+    assert!(calls[2].1 * 4 < calls[0].1);
+}
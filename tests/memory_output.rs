@@ -0,0 +1,71 @@
+extern crate openexr;
+
+use std::io::Cursor;
+
+use openexr::header::Compression;
+use openexr::{FrameBuffer, FrameBufferMut, Header, InputFile, PixelType, ScanlineOutputFile};
+
+fn header() -> Header {
+    let mut header = Header::new();
+    header
+        .set_resolution(64, 48)
+        .set_compression(Compression::PIZ_COMPRESSION)
+        .add_channel("R", PixelType::FLOAT)
+        .add_channel("G", PixelType::FLOAT);
+    header
+}
+
+fn pixel_data() -> Vec<(f32, f32)> {
+    (0..(64 * 48))
+        .map(|i| (i as f32, (i % 17) as f32))
+        .collect()
+}
+
+fn write_pixels(exr_file: &mut ScanlineOutputFile, pixel_data: &[(f32, f32)]) {
+    // Written in two parts, to exercise seeking back for the offset table.
+    let mut fb = FrameBuffer::new(64, 16);
+    fb.insert_channels(&["R", "G"], &pixel_data[..64 * 16]);
+    exr_file.write_pixels_incremental(&fb).unwrap();
+    let mut fb = FrameBuffer::new(64, 32);
+    fb.insert_channels(&["R", "G"], &pixel_data[64 * 16..]);
+    exr_file.write_pixels_incremental(&fb).unwrap();
+}
+
+#[test]
+fn memory_output() {
+    let pixel_data = pixel_data();
+
+    let mut cursor = Cursor::new(Vec::<u8>::new());
+    {
+        let mut exr_file = ScanlineOutputFile::new(&mut cursor, &header()).unwrap();
+        write_pixels(&mut exr_file, &pixel_data);
+    }
+    let expected = cursor.into_inner();
+
+    // A buffer that has to grow, and that starts out with other contents.
+    let mut buffer = vec![1, 2, 3];
+    {
+        let mut exr_file = ScanlineOutputFile::to_memory(&mut buffer, &header()).unwrap();
+        write_pixels(&mut exr_file, &pixel_data);
+    }
+    assert_eq!(buffer, expected);
+
+    // A buffer that's large enough is never reallocated.
+    let mut buffer = Vec::with_capacity(expected.len() * 2);
+    let storage = buffer.as_ptr();
+    {
+        let mut exr_file = ScanlineOutputFile::to_memory(&mut buffer, &header()).unwrap();
+        write_pixels(&mut exr_file, &pixel_data);
+    }
+    assert_eq!(buffer.as_ptr(), storage);
+    assert_eq!(buffer, expected);
+
+    let mut read_data = vec![(0.0f32, 0.0f32); 64 * 48];
+    {
+        let mut exr_file = InputFile::from_slice(&buffer).unwrap();
+        let mut fb = FrameBufferMut::new(64, 48);
+        fb.insert_channels(&[("R", 0.0), ("G", 0.0)], &mut read_data);
+        exr_file.read_pixels(&mut fb).unwrap();
+    }
+    assert_eq!(read_data, pixel_data);
+}
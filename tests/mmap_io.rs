@@ -0,0 +1,49 @@
+extern crate half;
+extern crate openexr;
+
+use half::f16;
+use openexr::{FrameBufferMut, InputFile};
+
+// OpenEXR file data.
+const POSITIVE_OFFSET: &[u8] = include_bytes!("data/positive_window.exr");
+
+fn read_rgb(exr_file: &mut InputFile) -> Vec<(f16, f16, f16)> {
+    let (width, height) = exr_file.header().data_dimensions();
+    let (x, y) = exr_file.header().data_origin();
+
+    let zero = f16::from_f32(0.0f32);
+    let mut pixel_data = vec![(zero, zero, zero); (width * height) as usize];
+    {
+        let mut fb = FrameBufferMut::new_with_origin(x, y, width, height);
+        fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut pixel_data);
+        exr_file.read_pixels(&mut fb).unwrap();
+    }
+    pixel_data
+}
+
+#[test]
+fn mmap_io() {
+    let path = concat!(
+        env!("CARGO_MANIFEST_DIR"),
+        "/tests/data/positive_window.exr"
+    );
+
+    let mut mapped_file = unsafe { InputFile::from_path_mmap(path) }.unwrap();
+    let mut memory_file = InputFile::from_slice(POSITIVE_OFFSET).unwrap();
+
+    assert_eq!(
+        mapped_file.header().data_origin(),
+        memory_file.header().data_origin()
+    );
+    assert_eq!(
+        mapped_file.header().data_dimensions(),
+        memory_file.header().data_dimensions()
+    );
+    assert!(read_rgb(&mut mapped_file) == read_rgb(&mut memory_file));
+}
+
+#[test]
+fn mmap_missing_file() {
+    let path = concat!(env!("CARGO_MANIFEST_DIR"), "/tests/data/does_not_exist.exr");
+    assert!(unsafe { InputFile::from_path_mmap(path) }.is_err());
+}
@@ -0,0 +1,229 @@
+extern crate openexr;
+
+use std::io::Cursor;
+
+use openexr::header::Compression;
+use openexr::{
+    FrameBuffer, FrameBufferMut, Header, InputFile, MultiPartInputFile, MultiPartOutputFile,
+    PixelType,
+};
+
+// Writes a three part file to memory: "beauty" (RGB), "depth" (Z, written
+// incrementally) and "id" (a smaller UINT image), all with distinct contents.
+fn write_multipart_file() -> Vec<u8> {
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+
+    let mut beauty = Header::new();
+    beauty
+        .set_name(Some("beauty"))
+        .set_resolution(64, 48)
+        .add_channel("R", PixelType::FLOAT)
+        .add_channel("G", PixelType::FLOAT)
+        .add_channel("B", PixelType::FLOAT);
+    let mut depth = Header::new();
+    depth
+        .set_name(Some("depth"))
+        .set_resolution(64, 48)
+        .set_compression(Compression::ZIP_COMPRESSION)
+        .add_channel("Z", PixelType::FLOAT);
+    let mut id = Header::new();
+    id.set_name(Some("id"))
+        .set_resolution(16, 8)
+        .add_channel("id", PixelType::UINT);
+
+    {
+        let mut exr_file =
+            MultiPartOutputFile::new(&mut in_memory_buffer, &[beauty, depth, id]).unwrap();
+        assert_eq!(exr_file.parts(), 3);
+        assert_eq!(exr_file.header(1).name(), Some("depth"));
+
+        // Interleave the writes of the different parts.
+        let depth_data: Vec<f32> = (0..(64 * 48)).map(|i| i as f32).collect();
+        for chunk in 0..3 {
+            let rows = &depth_data[(chunk * 64 * 16)..((chunk + 1) * 64 * 16)];
+            exr_file
+                .write_part_incremental(1, FrameBuffer::new(64, 16).insert_channel("Z", rows))
+                .unwrap();
+
+            if chunk == 1 {
+                let beauty_data = vec![(0.25f32, 0.5f32, 0.75f32); 64 * 48];
+                exr_file
+                    .write_part(
+                        0,
+                        FrameBuffer::new(64, 48).insert_channels(&["R", "G", "B"], &beauty_data),
+                    )
+                    .unwrap();
+            }
+        }
+
+        let id_data: Vec<u32> = (0..(16 * 8)).collect();
+        exr_file
+            .write_part(2, FrameBuffer::new(16, 8).insert_channel("id", &id_data))
+            .unwrap();
+
+        // Parts can't be written twice, and must exist.
+        assert!(exr_file
+            .write_part(2, FrameBuffer::new(16, 8).insert_channel("id", &id_data))
+            .is_err());
+        assert!(exr_file
+            .write_part(3, FrameBuffer::new(16, 8).insert_channel("id", &id_data))
+            .is_err());
+    }
+
+    in_memory_buffer.into_inner()
+}
+
+#[test]
+fn multipart_io() {
+    let data = write_multipart_file();
+    let mut exr_file = MultiPartInputFile::from_slice(&data).unwrap();
+
+    assert_eq!(exr_file.parts(), 3);
+    assert_eq!(exr_file.find_part("beauty"), Some(0));
+    assert_eq!(exr_file.find_part("depth"), Some(1));
+    assert_eq!(exr_file.find_part("id"), Some(2));
+    assert_eq!(exr_file.find_part("normals"), None);
+    assert_eq!(exr_file.header(2).data_dimensions(), (16, 8));
+    assert_eq!(
+        exr_file.header(1).compression(),
+        Compression::ZIP_COMPRESSION
+    );
+
+    // Read just one part.
+    let mut id_data = vec![0u32; 16 * 8];
+    exr_file
+        .read_part(
+            2,
+            FrameBufferMut::new(16, 8).insert_channel("id", 0.0, &mut id_data),
+        )
+        .unwrap();
+    for (i, id) in id_data.iter().enumerate() {
+        assert_eq!(*id, i as u32);
+    }
+
+    // Read part of a part.
+    let mut depth_rows = vec![0.0f32; 64 * 4];
+    exr_file
+        .read_part_partial(
+            1,
+            20,
+            FrameBufferMut::new(64, 4).insert_channel("Z", 0.0, &mut depth_rows),
+        )
+        .unwrap();
+    for (i, z) in depth_rows.iter().enumerate() {
+        assert_eq!(*z, (20 * 64 + i) as f32);
+    }
+
+    // Reading into a framebuffer of the wrong size or from a missing part
+    // fails.
+    let mut wrong_size = vec![0u32; 16 * 4];
+    assert!(exr_file
+        .read_part(
+            2,
+            FrameBufferMut::new(16, 4).insert_channel("id", 0.0, &mut wrong_size)
+        )
+        .is_err());
+    assert!(exr_file
+        .read_part(
+            3,
+            FrameBufferMut::new(16, 4).insert_channel("id", 0.0, &mut wrong_size)
+        )
+        .is_err());
+}
+
+#[test]
+fn multipart_io_read_parts_concurrently() {
+    let data = write_multipart_file();
+    let mut exr_file = MultiPartInputFile::from_slice(&data).unwrap();
+
+    let mut beauty_data = vec![(0.0f32, 0.0f32, 0.0f32); 64 * 48];
+    let mut depth_data = vec![0.0f32; 64 * 48];
+    {
+        let mut beauty_fb = FrameBufferMut::new(64, 48);
+        beauty_fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut beauty_data);
+        let mut depth_fb = FrameBufferMut::new(64, 48);
+        depth_fb.insert_channel("Z", 0.0, &mut depth_data);
+
+        exr_file
+            .read_parts(&mut [(1, &mut depth_fb), (0, &mut beauty_fb)])
+            .unwrap();
+
+        // The same part can't be read twice at once.
+        let mut other_fb = FrameBufferMut::new(64, 48);
+        assert!(exr_file
+            .read_parts(&mut [(1, &mut depth_fb), (1, &mut other_fb)])
+            .is_err());
+    }
+
+    for pixel in &beauty_data {
+        assert_eq!(*pixel, (0.25, 0.5, 0.75));
+    }
+    for (i, z) in depth_data.iter().enumerate() {
+        assert_eq!(*z, i as f32);
+    }
+}
+
+#[test]
+fn multipart_io_read_parts_from_reader() {
+    // Files opened from a reader read their parts one after the other.
+    let data = write_multipart_file();
+    let mut cursor = Cursor::new(&data[..]);
+    let mut exr_file = MultiPartInputFile::new(&mut cursor).unwrap();
+
+    let mut depth_data = vec![0.0f32; 64 * 48];
+    let mut id_data = vec![0u32; 16 * 8];
+    {
+        let mut depth_fb = FrameBufferMut::new(64, 48);
+        depth_fb.insert_channel("Z", 0.0, &mut depth_data);
+        let mut id_fb = FrameBufferMut::new(16, 8);
+        id_fb.insert_channel("id", 0.0, &mut id_data);
+        exr_file
+            .read_parts(&mut [(2, &mut id_fb), (1, &mut depth_fb)])
+            .unwrap();
+    }
+
+    for (i, z) in depth_data.iter().enumerate() {
+        assert_eq!(*z, i as f32);
+    }
+    for (i, id) in id_data.iter().enumerate() {
+        assert_eq!(*id, i as u32);
+    }
+}
+
+#[test]
+fn multipart_io_single_part() {
+    // An ordinary file reads as a multipart file with one part.
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+    {
+        let mut exr_file = MultiPartOutputFile::new(
+            &mut in_memory_buffer,
+            &[Header::new()
+                .set_resolution(8, 8)
+                .add_channel("Y", PixelType::FLOAT)
+                .clone()],
+        )
+        .unwrap();
+        let pixel_data = vec![1.0f32; 8 * 8];
+        exr_file
+            .write_part(0, FrameBuffer::new(8, 8).insert_channel("Y", &pixel_data))
+            .unwrap();
+    }
+
+    let exr_file = MultiPartInputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+    assert_eq!(exr_file.parts(), 1);
+    assert_eq!(
+        InputFile::from_slice(in_memory_buffer.get_ref())
+            .unwrap()
+            .header()
+            .data_dimensions(),
+        (8, 8)
+    );
+
+    // Several unnamed parts aren't allowed.
+    let mut buffer = Cursor::new(Vec::<u8>::new());
+    let mut header = Header::new();
+    header
+        .set_resolution(8, 8)
+        .add_channel("Y", PixelType::FLOAT);
+    assert!(MultiPartOutputFile::new(&mut buffer, &[header.clone(), header]).is_err());
+}
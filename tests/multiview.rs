@@ -0,0 +1,184 @@
+extern crate openexr;
+
+use std::io::Cursor;
+
+use openexr::{
+    FrameBuffer, FrameBufferMut, Header, InputFile, MultiPartInputFile, MultiPartOutputFile,
+    PixelType, ScanlineOutputFile,
+};
+
+#[test]
+fn multiview_views() {
+    let mut header = Header::new();
+    assert!(header.multiview().is_none());
+    header.set_multiview(Some(&["left", "right"]));
+    assert_eq!(
+        header.multiview().unwrap().collect::<Vec<_>>(),
+        vec!["left", "right"]
+    );
+}
+
+#[test]
+fn multiview_channel_names() {
+    let mut header = Header::new();
+    header
+        .set_multiview(Some(&["left", "right"]))
+        .add_channel("R", PixelType::HALF)
+        .add_channel("diffuse.left.R", PixelType::HALF)
+        .add_channel("right.R", PixelType::HALF)
+        .add_channel("diffuse.right.R", PixelType::HALF)
+        .add_channel("diffuse.R", PixelType::HALF)
+        .add_channel("Z", PixelType::FLOAT);
+
+    let left = header.find_view("left").unwrap();
+    let right = header.find_view("right").unwrap();
+    assert!(header.find_view("centre").is_none());
+    assert_eq!(left.name(), "left");
+    assert!(left.is_default());
+    assert!(!right.is_default());
+
+    assert_eq!(left.channel_name("R"), "R");
+    assert_eq!(left.channel_name("diffuse.R"), "diffuse.left.R");
+    assert_eq!(right.channel_name("R"), "right.R");
+    assert_eq!(right.channel_name("diffuse.R"), "diffuse.right.R");
+    assert_eq!(left.base_name("diffuse.left.R").unwrap(), "diffuse.R");
+    assert_eq!(right.base_name("right.R").unwrap(), "R");
+    assert_eq!(right.base_name("R"), None);
+    assert_eq!(left.base_name("diffuse.R"), None);
+
+    // Channels are listed in name order.  "diffuse.R" is in neither view.
+    assert_eq!(
+        header.channels_in_view(&left),
+        vec!["R", "Z", "diffuse.left.R"]
+    );
+    assert_eq!(
+        header.channels_in_view(&right),
+        vec!["diffuse.right.R", "right.R"]
+    );
+
+    // Headers of single-view parts name their view, and their channels
+    // don't include it.
+    let mut part = Header::new();
+    part.set_view(Some("right"))
+        .add_channel("R", PixelType::HALF);
+    assert_eq!(part.view(), Some("right"));
+    let right = part.find_view("right").unwrap();
+    assert_eq!(right.channel_name("R"), "R");
+    assert_eq!(part.channels_in_view(&right), vec!["R"]);
+    assert!(part.find_view("left").is_none());
+    part.set_view(None);
+    assert_eq!(part.view(), None);
+}
+
+#[test]
+fn multiview_single_part_io() {
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+    {
+        let left_data = vec![(0.25f32, 0.5f32, 0.75f32); 32 * 16];
+        let right_data = vec![(1.0f32, 2.0f32, 3.0f32); 32 * 16];
+
+        let mut header = Header::new();
+        header
+            .set_resolution(32, 16)
+            .set_multiview(Some(&["left", "right"]));
+        for view in &["left", "right"] {
+            let view = header.find_view(view).unwrap();
+            for name in &["R", "G", "B"] {
+                header.add_channel(&view.channel_name(name), PixelType::FLOAT);
+            }
+        }
+        let left = header.find_view("left").unwrap();
+        let right = header.find_view("right").unwrap();
+
+        let mut exr_file = ScanlineOutputFile::new(&mut in_memory_buffer, &header).unwrap();
+        let mut fb = FrameBuffer::new(32, 16);
+        fb.insert_view_channels(&left, &["R", "G", "B"], &left_data)
+            .insert_view_channels(&right, &["R", "G", "B"], &right_data);
+        exr_file.write_pixels(&fb).unwrap();
+    }
+
+    let mut exr_file = InputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+    assert!(exr_file.header().get_channel("right.G").is_some());
+    let right = exr_file.header().find_view("right").unwrap();
+
+    // Read just the right view, with the same names as the left.
+    let mut pixel_data = vec![(0.0f32, 0.0f32, 0.0f32); 32 * 16];
+    {
+        let mut fb = FrameBufferMut::new(32, 16);
+        fb.insert_view_channels(
+            &right,
+            &[("R", 0.0), ("G", 0.0), ("B", 0.0)],
+            &mut pixel_data,
+        );
+        exr_file.read_pixels(&mut fb).unwrap();
+    }
+    for pixel in &pixel_data {
+        assert_eq!(*pixel, (1.0, 2.0, 3.0));
+    }
+
+    let left = exr_file.header().find_view("left").unwrap();
+    {
+        let mut fb = FrameBufferMut::new(32, 16);
+        fb.insert_view_channels(
+            &left,
+            &[("R", 0.0), ("G", 0.0), ("B", 0.0)],
+            &mut pixel_data,
+        );
+        exr_file.read_pixels(&mut fb).unwrap();
+    }
+    for pixel in &pixel_data {
+        assert_eq!(*pixel, (0.25, 0.5, 0.75));
+    }
+}
+
+#[test]
+fn multiview_multipart_io() {
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+    {
+        let mut headers = Vec::new();
+        for &(name, view) in &[
+            ("left.rgb", "left"),
+            ("right.rgb", "right"),
+            ("left.depth", "left"),
+        ] {
+            let mut header = Header::new();
+            header
+                .set_name(Some(name))
+                .set_view(Some(view))
+                .set_resolution(16, 8)
+                .add_channel("Y", PixelType::FLOAT);
+            headers.push(header);
+        }
+
+        let mut exr_file = MultiPartOutputFile::new(&mut in_memory_buffer, &headers).unwrap();
+        for part in 0..3 {
+            let pixel_data = vec![part as f32; 16 * 8];
+            exr_file
+                .write_part(
+                    part,
+                    FrameBuffer::new(16, 8).insert_channel("Y", &pixel_data),
+                )
+                .unwrap();
+        }
+    }
+
+    let mut exr_file = MultiPartInputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+    assert_eq!(exr_file.view_parts("left"), vec![0, 2]);
+    assert_eq!(exr_file.view_parts("right"), vec![1]);
+    assert!(exr_file.view_parts("centre").is_empty());
+    assert_eq!(exr_file.header(1).view(), Some("right"));
+
+    // Read only the right view's part.
+    let mut pixel_data = vec![0.0f32; 16 * 8];
+    for part in exr_file.view_parts("right") {
+        exr_file
+            .read_part(
+                part,
+                FrameBufferMut::new(16, 8).insert_channel("Y", 0.0, &mut pixel_data),
+            )
+            .unwrap();
+    }
+    for y in &pixel_data {
+        assert_eq!(*y, 1.0);
+    }
+}
@@ -0,0 +1,71 @@
+extern crate openexr;
+
+mod common;
+
+use openexr::header::Compression;
+use openexr::{FrameBufferMut, Header, InputFile, ParallelReader, PixelType};
+
+const WIDTH: u32 = 37;
+const HEIGHT: u32 = 213;
+
+// Writes a ZIP compressed image whose data window starts at (-3, 5), so that
+// bands don't line up with the data window's coordinates.
+fn write_file() -> Vec<u8> {
+    let pixel_data: Vec<(f32, f32)> = (0..(WIDTH * HEIGHT))
+        .map(|i| (i as f32, (i % 11) as f32))
+        .collect();
+    let mut header = Header::new();
+    header
+        .set_data_window(Header::box2i(-3, 5, WIDTH, HEIGHT))
+        .set_compression(Compression::ZIP_COMPRESSION)
+        .add_channel("R", PixelType::FLOAT)
+        .add_channel("G", PixelType::FLOAT);
+    common::write_file(&header, &["R", "G"], &pixel_data)
+}
+
+#[test]
+fn parallel_io() {
+    let data = write_file();
+    let channels = [("R", 0.0), ("G", 0.0), ("B", 2.0)];
+
+    let mut expected = vec![(0.0f32, 0.0f32, 0.0f32); (WIDTH * HEIGHT) as usize];
+    {
+        let mut input_file = InputFile::from_slice(&data).unwrap();
+        let mut fb = FrameBufferMut::new_with_origin(-3, 5, WIDTH, HEIGHT);
+        fb.insert_channels(&channels, &mut expected);
+        input_file.read_pixels(&mut fb).unwrap();
+    }
+    assert_eq!(
+        expected[WIDTH as usize],
+        (WIDTH as f32, (WIDTH % 11) as f32, 2.0)
+    );
+
+    for &threads in &[0, 1, 3, 64] {
+        let mut pixels = vec![(0.0f32, 0.0f32, 0.0f32); (WIDTH * HEIGHT) as usize];
+        ParallelReader::new()
+            .set_threads(threads)
+            .read_slice(&data, &channels, &mut pixels)
+            .unwrap();
+        assert!(pixels == expected);
+    }
+}
+
+#[test]
+fn parallel_io_error() {
+    let data = write_file();
+    let mut pixels = vec![(0.0f32, 0.0f32); (WIDTH * HEIGHT) as usize];
+
+    // A channel of an unconvertible type fails on every thread.
+    let mut reader = ParallelReader::new();
+    reader.set_threads(4);
+    let mut u32_pixels = vec![0u32; (WIDTH * HEIGHT) as usize];
+    assert!(reader
+        .read_slice(&data, &[("R", 0.0)], &mut u32_pixels)
+        .is_err());
+
+    // Truncated data fails partway through.
+    let truncated = &data[..data.len() / 2];
+    assert!(reader
+        .read_slice(truncated, &[("R", 0.0), ("G", 0.0)], &mut pixels)
+        .is_err());
+}
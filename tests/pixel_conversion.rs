@@ -0,0 +1,126 @@
+extern crate half;
+extern crate openexr;
+
+mod common;
+
+use half::f16;
+use openexr::frame_buffer::PixelData;
+use openexr::header::Compression;
+use openexr::{FrameBufferMut, Header, InputFile, PixelType};
+
+// An `f32` that can also be read from HALF channels.
+#[repr(transparent)]
+#[derive(Copy, Clone, Debug, Default, PartialEq)]
+struct Float(f32);
+
+unsafe impl PixelData for Float {
+    fn pixel_type() -> PixelType {
+        PixelType::FLOAT
+    }
+
+    fn converts_from(file_type: PixelType) -> bool {
+        file_type == PixelType::HALF
+    }
+}
+
+// Value of channel `c` at pixel (x, y) of the test image.  All of them are
+// exactly representable as half floats.
+fn value(c: u32, x: u32, y: u32) -> f32 {
+    (c * 1000 + y * 37 + x) as f32 * 0.25
+}
+
+// Writes a 37x20 image with HALF channels "R" and "G" and a FLOAT channel
+// "Z".
+fn write_test_file() -> Vec<u8> {
+    let mut header = Header::new();
+    header
+        .set_resolution(37, 20)
+        .set_compression(Compression::PIZ_COMPRESSION)
+        .add_channel("R", PixelType::HALF)
+        .add_channel("G", PixelType::HALF)
+        .add_channel("Z", PixelType::FLOAT);
+
+    let mut pixel_data = Vec::new();
+    for y in 0..20 {
+        for x in 0..37 {
+            pixel_data.push((
+                f16::from_f32(value(0, x, y)),
+                f16::from_f32(value(1, x, y)),
+                value(2, x, y),
+            ));
+        }
+    }
+    common::write_file(&header, &["R", "G", "Z"], &pixel_data)
+}
+
+#[test]
+fn pixel_conversion_half_to_float() {
+    let data = write_test_file();
+    let mut exr_file = InputFile::from_slice(&data).unwrap();
+
+    // HALF channels read into `Float`, both interleaved and on their own,
+    // alongside a plain f32 channel that needs no conversion.
+    let mut rgz = vec![(Float(0.0), Float(0.0), 0.0f32); 37 * 20];
+    let mut g = vec![Float(0.0); 37 * 20];
+    {
+        let mut fb = FrameBufferMut::new(37, 20);
+        fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("Z", 0.0)], &mut rgz)
+            .insert_channel("G", 0.0, &mut g);
+        exr_file.read_pixels(&mut fb).unwrap();
+    }
+    for y in 0..20 {
+        for x in 0..37 {
+            let i = (y * 37 + x) as usize;
+            assert_eq!(
+                rgz[i],
+                (Float(value(0, x, y)), Float(value(1, x, y)), value(2, x, y))
+            );
+            assert_eq!(g[i], Float(value(1, x, y)));
+        }
+    }
+
+    // Partial and region reads convert too.
+    let mut r = vec![Float(0.0); 37 * 5];
+    {
+        let mut fb = FrameBufferMut::new(37, 5);
+        fb.insert_channel("R", 0.0, &mut r);
+        exr_file.read_pixels_partial(12, &mut fb).unwrap();
+    }
+    for y in 0..5 {
+        for x in 0..37 {
+            assert_eq!(r[(y * 37 + x) as usize], Float(value(0, x, 12 + y)));
+        }
+    }
+
+    let mut r = vec![Float(0.0); 9 * 4];
+    {
+        let mut fb = FrameBufferMut::new_with_origin(20, 3, 9, 4);
+        fb.insert_channel("R", 0.0, &mut r);
+        exr_file
+            .read_region(&Header::box2i(20, 3, 9, 4), &mut fb)
+            .unwrap();
+    }
+    for y in 0..4 {
+        for x in 0..9 {
+            assert_eq!(r[(y * 9 + x) as usize], Float(value(0, 20 + x, 3 + y)));
+        }
+    }
+
+    // Types that don't opt in, plain f32 included, are still errors.
+    let mut r = vec![0.0f32; 37 * 20];
+    {
+        let mut fb = FrameBufferMut::new(37, 20);
+        fb.insert_channel("R", 0.0, &mut r);
+        assert!(exr_file.read_pixels(&mut fb).is_err());
+    }
+    let mut rg = vec![(0.0f32, Float(0.0)); 37 * 20];
+    {
+        let mut fb = FrameBufferMut::new(37, 20);
+        fb.insert_channels(&[("R", 0.0), ("G", 0.0)], &mut rg);
+        assert!(exr_file.read_pixels(&mut fb).is_err());
+    }
+    let mut r = vec![0u32; 37 * 20];
+    let mut fb = FrameBufferMut::new(37, 20);
+    fb.insert_channel("R", 0.0, &mut r);
+    assert!(exr_file.read_pixels(&mut fb).is_err());
+}
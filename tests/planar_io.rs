@@ -0,0 +1,122 @@
+extern crate openexr;
+
+use std::io::Cursor;
+
+use openexr::{BufferPool, Header, InputFile, PixelType, PlanarBuffer, ScanlineOutputFile};
+
+#[test]
+fn planar_io() {
+    // Fill a planar buffer from interleaved pixels.
+    let pixels: Vec<(f32, f32, f32, f32)> = (0..(80 * 30))
+        .map(|i| (i as f32, i as f32 * 2.0, i as f32 * 3.0, 1.0))
+        .collect();
+    let mut planes = PlanarBuffer::<f32>::new(80, 30, &["R", "G", "B", "A"]);
+    planes.unpack(&pixels);
+    assert_eq!(planes.find("B"), Some(2));
+    assert_eq!(planes.plane(1)[7], 14.0);
+
+    // Write it out.
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+    {
+        let mut exr_file = ScanlineOutputFile::new(
+            &mut in_memory_buffer,
+            Header::new()
+                .set_resolution(80, 30)
+                .add_channel("R", PixelType::FLOAT)
+                .add_channel("G", PixelType::FLOAT)
+                .add_channel("B", PixelType::FLOAT)
+                .add_channel("A", PixelType::FLOAT),
+        )
+        .unwrap();
+        exr_file.write_pixels(&planes.frame_buffer()).unwrap();
+    }
+
+    // Read some of the channels back into planes, plus one that's missing.
+    let mut read_planes = PlanarBuffer::<f32>::new(80, 30, &["B", "R", "Z"]);
+    {
+        let mut exr_file = InputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+        exr_file
+            .read_pixels(&mut read_planes.frame_buffer_mut(&[0.0, 0.0, 5.0]))
+            .unwrap();
+    }
+    assert_eq!(read_planes.plane(0), planes.plane(2));
+    assert_eq!(read_planes.plane(1), planes.plane(0));
+    for z in read_planes.plane(2) {
+        assert_eq!(*z, 5.0);
+    }
+
+    // And interleave them again.
+    let mut packed = vec![[0.0f32; 3]; 80 * 30];
+    read_planes.pack(&mut packed);
+    for (p, q) in packed.iter().zip(&pixels) {
+        assert_eq!(*p, [q.2, q.0, 5.0]);
+    }
+}
+
+#[test]
+#[should_panic]
+fn planar_io_mismatched_pixel_struct() {
+    let mut planes = PlanarBuffer::<f32>::new(4, 4, &["R", "G", "B"]);
+    planes.unpack(&vec![(0.0f32, 0.0f32); 16]);
+}
+
+#[test]
+fn planar_io_buffer_pool() {
+    let pool = BufferPool::<f32>::new();
+
+    let planes = pool.planar_buffer(64, 32, &["R", "G"]);
+    let addresses: Vec<_> = (0..2).map(|i| planes.plane(i).as_ptr()).collect();
+    for address in &addresses {
+        assert_eq!(*address as usize % 64, 0);
+    }
+    // New planes are zeroed.
+    assert!(planes.plane(1).iter().all(|&v| v == 0.0));
+    assert_eq!(pool.idle_bytes(), 0);
+    drop(planes);
+    assert_eq!(pool.idle_bytes(), 2 * 64 * 32 * 4);
+
+    // The same memory is reused for the next buffer of the same size, or
+    // smaller.
+    let mut planes = pool.planar_buffer_with_origin(-3, 5, 32, 64, &["G", "R"]);
+    assert_eq!(planes.origin(), (-3, 5));
+    for i in 0..2 {
+        assert!(addresses.contains(&planes.plane(i).as_ptr()));
+    }
+    for (i, v) in planes.plane_mut(0).iter_mut().enumerate() {
+        *v = i as f32;
+    }
+    let small = pool.planar_buffer(8, 8, &["Y"]);
+    assert_eq!(small.plane(0).len(), 64);
+    drop(small);
+    drop(planes);
+
+    // Reading a file overwrites whatever a reused plane held.
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+    {
+        let mut exr_file = ScanlineOutputFile::new(
+            &mut in_memory_buffer,
+            Header::new()
+                .set_resolution(64, 32)
+                .add_channel("G", PixelType::FLOAT),
+        )
+        .unwrap();
+        let mut written = PlanarBuffer::<f32>::new(64, 32, &["G"]);
+        for v in written.plane_mut(0) {
+            *v = 0.5;
+        }
+        exr_file.write_pixels(&written.frame_buffer()).unwrap();
+    }
+    let mut planes = pool.planar_buffer(64, 32, &["G", "B"]);
+    {
+        let mut exr_file = InputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+        exr_file
+            .read_pixels(&mut planes.frame_buffer_mut(&[0.0, 2.0]))
+            .unwrap();
+    }
+    assert!(planes.plane(0).iter().all(|&v| v == 0.5));
+    assert!(planes.plane(1).iter().all(|&v| v == 2.0));
+
+    drop(planes);
+    pool.clear();
+    assert_eq!(pool.idle_bytes(), 0);
+}
@@ -0,0 +1,163 @@
+extern crate half;
+extern crate openexr;
+
+use half::f16;
+use openexr::header::Channel;
+use openexr::output::OutputOptions;
+use openexr::{FrameBuffer, Header, InputFile, PixelType, PreviewImage, ScanlineOutputFile};
+
+fn header() -> Header {
+    let mut header = Header::new();
+    header
+        .set_resolution(64, 48)
+        .add_channel("R", PixelType::HALF)
+        .add_channel("G", PixelType::FLOAT)
+        .add_channel("B", PixelType::FLOAT)
+        .add_channel("A", PixelType::FLOAT);
+    header
+}
+
+fn pixel_data() -> Vec<(f16, f32, f32, f32)> {
+    (0..(64 * 48))
+        .map(|i| {
+            let (x, y) = ((i % 64) as f32, (i / 64) as f32);
+            (f16::from_f32(x / 64.0), y / 48.0, 4.0, 0.5)
+        })
+        .collect()
+}
+
+fn write_file(header: &Header, options: &OutputOptions) -> Vec<u8> {
+    let pixel_data = pixel_data();
+    let mut buffer = Vec::new();
+    {
+        let mut exr_file =
+            ScanlineOutputFile::to_memory_with_options(&mut buffer, header, options).unwrap();
+        // Written in two parts, so the preview is sampled in two parts.
+        for &(start, rows) in &[(0, 20), (20, 28)] {
+            let mut fb = FrameBuffer::new(64, rows as u32);
+            fb.insert_channels(
+                &["R", "G", "B", "A"],
+                &pixel_data[(start * 64)..((start + rows) * 64)],
+            );
+            exr_file.write_pixels_incremental(&fb).unwrap();
+        }
+    }
+    buffer
+}
+
+#[test]
+fn preview_header_roundtrip() {
+    let mut preview = PreviewImage::new(3, 2);
+    for (i, pixel) in preview.pixels.iter_mut().enumerate() {
+        *pixel = [i as u8, 10 * i as u8, 255 - i as u8, 128];
+    }
+    let mut header = header();
+    header.set_preview_image(Some(&preview));
+    assert_eq!(header.preview_image(), Some(preview.clone()));
+
+    let data = write_file(&header, &OutputOptions::new());
+    let mut exr_file = InputFile::from_slice(&data).unwrap();
+    assert_eq!(exr_file.header().preview_image(), Some(preview.clone()));
+    // The header's preview is returned whatever the requested size.
+    assert_eq!(exr_file.read_preview(32).unwrap(), preview);
+
+    header.set_preview_image(None);
+    assert_eq!(header.preview_image(), None);
+}
+
+#[test]
+fn generated_preview_matches_strided_read() {
+    let data = write_file(&header(), &OutputOptions::new());
+    let mut exr_file = InputFile::from_slice(&data).unwrap();
+    assert_eq!(exr_file.header().preview_image(), None);
+    let read = exr_file.read_preview(16).unwrap();
+    assert_eq!((read.width, read.height), (16, 12));
+
+    let data = write_file(&header(), OutputOptions::new().set_preview_size(16));
+    let exr_file = InputFile::from_slice(&data).unwrap();
+    let generated = exr_file.header().preview_image().unwrap();
+    assert_eq!(generated, read);
+
+    // Blue is bright and the same everywhere, and alpha is linear.
+    assert!(generated
+        .pixels
+        .iter()
+        .all(|p| p[2] == generated.pixels[0][2]));
+    assert!(generated.pixels[0][2] > 200);
+    assert!(generated.pixels.iter().all(|p| p[3] == 128));
+    // Red increases to the right and green downwards.
+    assert!(generated.pixels[0][0] < generated.pixels[15][0]);
+    assert!(generated.pixels[0][1] < generated.pixels[11 * 16][1]);
+}
+
+#[test]
+fn preview_size_is_capped() {
+    let data = write_file(&header(), OutputOptions::new().set_preview_size(1000));
+    let exr_file = InputFile::from_slice(&data).unwrap();
+    let preview = exr_file.header().preview_image().unwrap();
+    assert_eq!((preview.width, preview.height), (64, 48));
+}
+
+#[test]
+fn preview_of_subsampled_channel() {
+    // Alpha is only sampled on every other scanline, with a different value
+    // on each of them.
+    let mut header = Header::new();
+    header
+        .set_resolution(60, 30)
+        .add_channel("R", PixelType::FLOAT)
+        .add_channel("G", PixelType::FLOAT)
+        .add_channel("B", PixelType::FLOAT)
+        .add_channel_detailed(
+            "A",
+            Channel {
+                pixel_type: PixelType::FLOAT,
+                x_sampling: 1,
+                y_sampling: 2,
+                p_linear: true,
+            },
+        );
+    let rgb = vec![(0.5f32, 0.5f32, 0.5f32); 60 * 30];
+    let alpha: Vec<f32> = (0..(60 * 15))
+        .map(|i| (i / 60 * 8) as f32 / 255.0)
+        .collect();
+
+    let mut buffer = Vec::new();
+    {
+        let mut exr_file = ScanlineOutputFile::to_memory_with_options(
+            &mut buffer,
+            &header,
+            OutputOptions::new().set_preview_size(20),
+        )
+        .unwrap();
+        let mut fb = FrameBuffer::new(60, 30);
+        fb.insert_channels(&["R", "G", "B"], &rgb);
+        unsafe {
+            fb.insert_raw(
+                "A",
+                PixelType::FLOAT,
+                alpha.as_ptr() as *const _,
+                (4, 60 * 4),
+                (1, 2),
+                0.0,
+                (false, false),
+            );
+        }
+        exr_file.write_pixels(&fb).unwrap();
+    }
+
+    let mut exr_file = InputFile::from_slice(&buffer).unwrap();
+    let generated = exr_file.header().preview_image().unwrap();
+    let read = exr_file.read_preview(20).unwrap();
+    assert_eq!((read.width, read.height), (20, 10));
+    assert_eq!(read, generated);
+
+    // Preview rows that fall on unsampled scanlines get alpha from the
+    // sampled scanline above them.
+    for py in 0..10 {
+        let y = (2 * py + 1) * 30 / 20;
+        for px in 0..20 {
+            assert_eq!(read.pixels[py * 20 + px][3] as usize, y / 2 * 8);
+        }
+    }
+}
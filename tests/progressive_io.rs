@@ -0,0 +1,175 @@
+extern crate openexr;
+
+mod common;
+
+use std::cell::Cell;
+use std::io::{self, Read};
+use std::rc::Rc;
+
+use openexr::header::Compression;
+use openexr::{FrameBufferMut, Header, InputFile, PixelType, ProgressiveReader};
+
+const WIDTH: u32 = 16;
+const HEIGHT: u32 = 40;
+
+// Size of each uncompressed one-scanline chunk: its scanline and data size,
+// followed by the scanline's pixels.
+const CHUNK_SIZE: usize = 8 + WIDTH as usize * 4;
+
+// Writes an uncompressed image whose "Y" channel is the scanline's index.
+fn write_file() -> Vec<u8> {
+    let pixel_data: Vec<f32> = (0..(WIDTH * HEIGHT)).map(|i| (i / WIDTH) as f32).collect();
+    let mut header = Header::new();
+    header
+        .set_resolution(WIDTH, HEIGHT)
+        .set_compression(Compression::NO_COMPRESSION)
+        .add_channel("Y", PixelType::FLOAT);
+    common::write_file(&header, &["Y"], &pixel_data)
+}
+
+// Returns a copy of `data` as it is before the writer fills in the offset
+// table, along with where the table ends.
+fn unfinished(data: &[u8]) -> (Vec<u8>, usize) {
+    let table_len = HEIGHT as usize * 8;
+    let read_u64 = |at: usize| {
+        let mut bytes = [0; 8];
+        bytes.copy_from_slice(&data[at..at + 8]);
+        u64::from_le_bytes(bytes) as usize
+    };
+    let table = (8..data.len() - 8)
+        .find(|&at| read_u64(at) == at + table_len)
+        .unwrap();
+
+    let mut data = data.to_vec();
+    for byte in &mut data[table..table + table_len] {
+        *byte = 0;
+    }
+    (data, table + table_len)
+}
+
+// Hands out `data` up to however much of it `available` says has been
+// written.
+struct Growing {
+    data: Vec<u8>,
+    available: Rc<Cell<usize>>,
+    position: usize,
+}
+
+impl Read for Growing {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        let end = self.available.get().min(self.data.len());
+        let n = buf.len().min(end - self.position);
+        buf[..n].copy_from_slice(&self.data[self.position..self.position + n]);
+        self.position += n;
+        Ok(n)
+    }
+}
+
+fn read_rows(reader: &mut ProgressiveReader<Growing>, start: u32, rows: u32) -> Vec<f32> {
+    let mut pixel_data = vec![-1.0f32; (WIDTH * rows) as usize];
+    {
+        let mut fb = FrameBufferMut::new(WIDTH, rows);
+        fb.insert_channel("Y", 0.0, &mut pixel_data);
+        reader.read_pixels_partial(start, &mut fb).unwrap();
+    }
+    pixel_data
+}
+
+#[test]
+fn progressive_io_input_file() {
+    let data = write_file();
+    let (unfinished, chunks_start) = unfinished(&data);
+
+    let mut input_file = InputFile::from_slice(&data).unwrap();
+    assert!(input_file.is_complete());
+    assert_eq!(
+        input_file.complete_chunks().unwrap(),
+        vec![true; HEIGHT as usize]
+    );
+
+    let partial = &unfinished[..chunks_start + CHUNK_SIZE * 10 + 20];
+    let mut input_file = InputFile::from_slice(partial).unwrap();
+    assert!(!input_file.is_complete());
+    let complete = input_file.complete_chunks().unwrap();
+    assert_eq!(complete.iter().filter(|&&c| c).count(), 10);
+    assert!(complete[..10].iter().all(|&c| c));
+}
+
+#[test]
+fn progressive_io() {
+    let data = write_file();
+    let (unfinished, chunks_start) = unfinished(&data);
+    let available = Rc::new(Cell::new(20));
+    let mut reader = ProgressiveReader::new(Growing {
+        data: unfinished,
+        available: available.clone(),
+        position: 0,
+    })
+    .unwrap();
+
+    // Not even the header yet.
+    assert!(reader.header().is_none());
+    assert!(!reader.scanlines_complete(0, 1));
+    assert!(!reader.refresh().unwrap());
+
+    // The header and table, but no chunks.
+    available.set(chunks_start);
+    assert!(!reader.refresh().unwrap());
+    assert_eq!(reader.header().unwrap().data_dimensions(), (WIDTH, HEIGHT));
+    assert_eq!(reader.complete_chunks(), &[false; HEIGHT as usize][..]);
+
+    // Ten and a bit scanlines.
+    available.set(chunks_start + CHUNK_SIZE * 10 + 20);
+    assert!(reader.refresh().unwrap());
+    assert!(reader.scanlines_complete(0, 10));
+    assert!(!reader.scanlines_complete(5, 10));
+    assert!(!reader.is_complete());
+    assert!(read_rows(&mut reader, 3, 7)
+        .iter()
+        .enumerate()
+        .all(|(i, &y)| y == (3 + i as u32 / WIDTH) as f32));
+    {
+        let mut pixel_data = vec![0.0f32; (WIDTH * 10) as usize];
+        let mut fb = FrameBufferMut::new(WIDTH, 10);
+        fb.insert_channel("Y", 0.0, &mut pixel_data);
+        assert!(reader.read_pixels_partial(5, &mut fb).is_err());
+    }
+
+    // Everything.
+    available.set(usize::max_value());
+    assert!(reader.refresh().unwrap());
+    assert!(reader.is_complete());
+    assert!(read_rows(&mut reader, 0, HEIGHT)
+        .iter()
+        .enumerate()
+        .all(|(i, &y)| y == (i as u32 / WIDTH) as f32));
+}
+
+#[test]
+fn progressive_io_unsupported_version() {
+    // Once there's enough of the file to know it can't be read, that's an
+    // error rather than waiting for more.
+    let mut data = write_file();
+    data[4] = 3;
+    let available = Rc::new(Cell::new(4));
+    let mut reader = ProgressiveReader::new(Growing {
+        data: data,
+        available: available.clone(),
+        position: 0,
+    })
+    .unwrap();
+    available.set(usize::max_value());
+    assert!(reader.refresh().is_err());
+    assert!(reader.header().is_none());
+}
+
+#[test]
+fn progressive_io_not_exr() {
+    let available = Rc::new(Cell::new(usize::max_value()));
+    let result = ProgressiveReader::new(Growing {
+        data: b"not an exr file".to_vec(),
+        available: available,
+        position: 0,
+    });
+    assert!(result.is_err());
+}
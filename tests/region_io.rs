@@ -0,0 +1,114 @@
+extern crate openexr;
+
+mod common;
+
+use openexr::header::Compression;
+use openexr::{FrameBufferMut, Header, InputFile, PixelType};
+
+// Value of channel `c` at pixel (x, y) of the test image.
+fn value(c: u32, x: i32, y: i32) -> f32 {
+    (c * 10000) as f32 + (y * 100 + x) as f32
+}
+
+// Writes a 50x40 image with a data window starting at (-5, 3) and channels
+// "A" to "D", compressed so that scanlines come in chunks of 16.
+fn write_test_file() -> Vec<u8> {
+    let mut header = Header::new();
+    header
+        .set_data_window(Header::box2i(-5, 3, 50, 40))
+        .set_display_window(Header::box2i(0, 0, 40, 40))
+        .set_compression(Compression::ZIP_COMPRESSION)
+        .add_channel("A", PixelType::FLOAT)
+        .add_channel("B", PixelType::FLOAT)
+        .add_channel("C", PixelType::FLOAT)
+        .add_channel("D", PixelType::FLOAT);
+
+    let mut pixel_data = Vec::new();
+    for y in 3..43 {
+        for x in -5..45 {
+            pixel_data.push((
+                value(0, x, y),
+                value(1, x, y),
+                value(2, x, y),
+                value(3, x, y),
+            ));
+        }
+    }
+
+    common::write_file(&header, &["A", "B", "C", "D"], &pixel_data)
+}
+
+#[test]
+fn region_io() {
+    let data = write_test_file();
+    let mut exr_file = InputFile::from_slice(&data).unwrap();
+
+    // A crop of two of the channels, spanning several chunks.
+    let region = Header::box2i(7, 10, 12, 25);
+    let mut pixel_data = vec![(0.0f32, 0.0f32); 12 * 25];
+    {
+        let mut fb = FrameBufferMut::new_with_origin(7, 10, 12, 25);
+        fb.insert_channels(&[("C", 0.0), ("A", 0.0)], &mut pixel_data);
+        exr_file.read_region(&region, &mut fb).unwrap();
+    }
+    for y in 0..25 {
+        for x in 0..12 {
+            assert_eq!(
+                pixel_data[(y * 12 + x) as usize],
+                (value(2, 7 + x, 10 + y), value(0, 7 + x, 10 + y))
+            );
+        }
+    }
+
+    // Full-width regions are read directly, and missing channels filled.
+    let region = Header::box2i(-5, 20, 50, 3);
+    let mut b = vec![0.0f32; 50 * 3];
+    let mut missing = vec![0.0f32; 50 * 3];
+    {
+        let mut fb = FrameBufferMut::new_with_origin(-5, 20, 50, 3);
+        fb.insert_channel("B", 0.0, &mut b)
+            .insert_channel("E", 2.0, &mut missing);
+        exr_file.read_region(&region, &mut fb).unwrap();
+    }
+    for y in 0..3 {
+        for x in 0..50 {
+            assert_eq!(b[(y * 50 + x) as usize], value(1, x - 5, 20 + y));
+        }
+    }
+    for m in &missing {
+        assert_eq!(*m, 2.0);
+    }
+
+    // Ordinary reads still work afterward.
+    let mut d = vec![0.0f32; 50 * 40];
+    {
+        let mut fb = FrameBufferMut::new_with_origin(-5, 3, 50, 40);
+        fb.insert_channel("D", 0.0, &mut d);
+        exr_file.read_pixels(&mut fb).unwrap();
+    }
+    assert_eq!(d[0], value(3, -5, 3));
+    assert_eq!(d[50 * 40 - 1], value(3, 44, 42));
+}
+
+#[test]
+fn region_io_errors() {
+    let data = write_test_file();
+    let mut exr_file = InputFile::from_slice(&data).unwrap();
+
+    // A region outside of the data window.
+    let mut pixel_data = vec![0.0f32; 10 * 10];
+    {
+        let mut fb = FrameBufferMut::new_with_origin(-10, 3, 10, 10);
+        fb.insert_channel("A", 0.0, &mut pixel_data);
+        assert!(exr_file
+            .read_region(&Header::box2i(-10, 3, 10, 10), &mut fb)
+            .is_err());
+    }
+
+    // A framebuffer that doesn't cover the region.
+    let mut fb = FrameBufferMut::new_with_origin(0, 3, 10, 10);
+    fb.insert_channel("A", 0.0, &mut pixel_data);
+    assert!(exr_file
+        .read_region(&Header::box2i(5, 5, 10, 10), &mut fb)
+        .is_err());
+}
@@ -0,0 +1,90 @@
+extern crate openexr;
+
+use std::fs;
+use std::path::PathBuf;
+
+use openexr::input::{SequenceLoader, SequenceOptions};
+use openexr::{FrameBuffer, Header, PixelType, ScanlineOutputFile};
+
+const SIZE: u32 = 16;
+const FRAME_BYTES: usize = (SIZE * SIZE) as usize * 4;
+
+// A directory of frames 10 to 19 whose "Y" channel is the frame number
+// everywhere, except for frame 15, which is missing.  Deleted when dropped.
+struct Sequence(PathBuf);
+
+impl Sequence {
+    fn new(name: &str) -> Sequence {
+        let dir =
+            std::env::temp_dir().join(format!("openexr-test-{}-{}", std::process::id(), name));
+        fs::create_dir_all(&dir).unwrap();
+        for frame in (10..20).filter(|&frame| frame != 15) {
+            let mut header = Header::new();
+            header
+                .set_resolution(SIZE, SIZE)
+                .add_channel("Y", PixelType::FLOAT);
+            let mut file = fs::File::create(dir.join(format!("frame.{}.exr", frame))).unwrap();
+            let mut exr_file = ScanlineOutputFile::new(&mut file, &header).unwrap();
+            let pixel_data = vec![frame as f32; (SIZE * SIZE) as usize];
+            let mut fb = FrameBuffer::new(SIZE, SIZE);
+            fb.insert_channel("Y", &pixel_data);
+            exr_file.write_pixels(&fb).unwrap();
+        }
+        Sequence(dir)
+    }
+
+    fn loader(&self, options: &SequenceOptions) -> SequenceLoader<f32> {
+        let dir = self.0.clone();
+        SequenceLoader::new(
+            10..20,
+            &[("Y", 0.0)],
+            move |frame| dir.join(format!("frame.{}.exr", frame)),
+            options,
+        )
+    }
+}
+
+impl Drop for Sequence {
+    fn drop(&mut self) {
+        let _ = fs::remove_dir_all(&self.0);
+    }
+}
+
+#[test]
+fn sequence_loader() {
+    let sequence = Sequence::new("all");
+    let loader = sequence.loader(SequenceOptions::new().set_threads(3));
+    for frame in 10..20 {
+        let result = loader.wait(frame);
+        if frame == 15 {
+            assert!(result.is_err());
+            assert!(loader.get(frame).unwrap().is_err());
+            continue;
+        }
+        let loaded = result.unwrap();
+        assert_eq!(loaded.index(), frame);
+        assert_eq!(loaded.dimensions(), (SIZE, SIZE));
+        assert!(loaded.pixels().iter().all(|&y| y == frame as f32));
+    }
+    assert!(loader.wait(20).is_err());
+    assert!(loader.get(9).is_none());
+}
+
+#[test]
+fn sequence_loader_memory_budget() {
+    let sequence = Sequence::new("budget");
+    let loader = sequence.loader(
+        SequenceOptions::new()
+            .set_threads(2)
+            .set_memory_budget(FRAME_BYTES * 3),
+    );
+    // Play forwards and then backwards, through evictions.
+    for frame in (10..20).chain((10..20).rev()) {
+        if frame == 15 {
+            continue;
+        }
+        let loaded = loader.wait(frame).unwrap();
+        assert!(loaded.pixels().iter().all(|&y| y == frame as f32));
+        assert!(loader.memory_used() <= FRAME_BYTES * 3);
+    }
+}
@@ -0,0 +1,180 @@
+extern crate openexr;
+
+use std::io::Cursor;
+
+use openexr::header::{LevelMode, LevelRoundingMode, LineOrder, TileDescription};
+use openexr::{
+    FrameBuffer, FrameBufferMut, Header, InputFile, PixelType, TiledInputFile, TiledOutputFile,
+};
+
+// Color of each tile in the test image.
+fn tile_color(tile_x: u32, tile_y: u32) -> (f32, f32, f32) {
+    (tile_x as f32, tile_y as f32, 0.5)
+}
+
+#[test]
+fn tiled_io() {
+    // Target memory for writing
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+
+    // Write file to memory, one tile at a time in reverse order.
+    {
+        let mut exr_file = TiledOutputFile::new(
+            &mut in_memory_buffer,
+            Header::new()
+                .set_resolution(200, 150)
+                .set_line_order(LineOrder::RANDOM_Y)
+                .set_tile_description(TileDescription {
+                    x_size: 64,
+                    y_size: 64,
+                    mode: LevelMode::ONE_LEVEL,
+                    rounding_mode: LevelRoundingMode::ROUND_DOWN,
+                })
+                .add_channel("R", PixelType::FLOAT)
+                .add_channel("G", PixelType::FLOAT)
+                .add_channel("B", PixelType::FLOAT),
+        )
+        .unwrap();
+
+        assert_eq!(exr_file.tile_dimensions(), (64, 64));
+        assert_eq!(exr_file.num_tiles(), (4, 3));
+
+        for tile_y in (0..3).rev() {
+            for tile_x in (0..4).rev() {
+                let window = exr_file.tile_data_window(tile_x, tile_y).unwrap();
+                let width = (window.max.x - window.min.x + 1) as u32;
+                let height = (window.max.y - window.min.y + 1) as u32;
+                let pixel_data = vec![tile_color(tile_x, tile_y); (width * height) as usize];
+
+                let mut fb =
+                    FrameBuffer::new_with_origin(window.min.x, window.min.y, width, height);
+                fb.insert_channels(&["R", "G", "B"], &pixel_data);
+                exr_file.write_tile(tile_x, tile_y, &fb).unwrap();
+            }
+        }
+
+        // Writing the same tile twice is an error.
+        let pixel_data = vec![(0.0f32, 0.0f32, 0.0f32); 64 * 64];
+        let mut fb = FrameBuffer::new(64, 64);
+        fb.insert_channels(&["R", "G", "B"], &pixel_data);
+        assert!(exr_file.write_tile(0, 0, &fb).is_err());
+    }
+
+    // Read a range of tiles back and verify them.
+    {
+        let mut exr_file = TiledInputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+        assert_eq!(exr_file.header().data_dimensions(), (200, 150));
+        assert_eq!(exr_file.num_tiles(), (4, 3));
+
+        // Tiles (1, 1) to (3, 2) cover x 64..199 and y 64..149.
+        let mut pixel_data = vec![(0.0f32, 0.0f32, 0.0f32); 136 * 86];
+        {
+            let mut fb = FrameBufferMut::new_with_origin(64, 64, 136, 86);
+            fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut pixel_data);
+            exr_file.read_tiles((1, 1), (3, 2), &mut fb).unwrap();
+
+            // A framebuffer too small for the tiles is rejected.
+            assert!(exr_file.read_tiles((0, 0), (3, 2), &mut fb).is_err());
+        }
+        for y in 0..86 {
+            for x in 0..136 {
+                let expected = tile_color((x + 64) / 64, (y + 64) / 64);
+                assert_eq!(pixel_data[(y * 136 + x) as usize], expected);
+            }
+        }
+    }
+
+    // The generic input file can read tiled files as well.
+    {
+        let mut exr_file = InputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+        let mut pixel_data = vec![(0.0f32, 0.0f32, 0.0f32); 200 * 150];
+        {
+            let mut fb = FrameBufferMut::new(200, 150);
+            fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut pixel_data);
+            exr_file.read_pixels(&mut fb).unwrap();
+        }
+        for y in 0..150 {
+            for x in 0..200 {
+                assert_eq!(
+                    pixel_data[(y * 200 + x) as usize],
+                    tile_color(x / 64, y / 64)
+                );
+            }
+        }
+    }
+}
+
+// Color of each level in the mip-map test image.
+fn level_color(level: u32) -> (f32, f32, f32) {
+    (level as f32, 1.0, 0.25)
+}
+
+#[test]
+fn tiled_mipmap_io() {
+    // Target memory for writing
+    let mut in_memory_buffer = Cursor::new(Vec::<u8>::new());
+
+    // Write every level of a mip-mapped file, with each level a flat color.
+    {
+        let mut exr_file = TiledOutputFile::new(
+            &mut in_memory_buffer,
+            Header::new()
+                .set_resolution(100, 60)
+                .set_tile_description(TileDescription {
+                    x_size: 32,
+                    y_size: 32,
+                    mode: LevelMode::MIPMAP_LEVELS,
+                    rounding_mode: LevelRoundingMode::ROUND_DOWN,
+                })
+                .add_channel("R", PixelType::FLOAT)
+                .add_channel("G", PixelType::FLOAT)
+                .add_channel("B", PixelType::FLOAT),
+        )
+        .unwrap();
+
+        // 100x60, 50x30, 25x15, 12x7, 6x3, 3x1 and 1x1.
+        assert_eq!(exr_file.num_levels(), (7, 7));
+        assert!(exr_file.level_data_window((0, 1)).is_err());
+
+        for level in 0..7 {
+            let window = exr_file.level_data_window((level, level)).unwrap();
+            let (width, height) = exr_file.level_dimensions((level, level)).unwrap();
+            let pixel_data = vec![level_color(level); (width * height) as usize];
+
+            let mut fb = FrameBuffer::new_with_origin(window.min.x, window.min.y, width, height);
+            fb.insert_channels(&["R", "G", "B"], &pixel_data);
+            exr_file.write_level((level, level), &fb).unwrap();
+        }
+    }
+
+    // Read back only a low resolution level, tile by tile.
+    {
+        let mut exr_file = TiledInputFile::from_slice(in_memory_buffer.get_ref()).unwrap();
+        assert_eq!(exr_file.level_mode(), LevelMode::MIPMAP_LEVELS);
+        assert_eq!(exr_file.num_levels(), (7, 7));
+        assert_eq!(exr_file.level_dimensions((2, 2)).unwrap(), (25, 15));
+        assert_eq!(exr_file.num_tiles_at_level((2, 2)).unwrap(), (1, 1));
+        assert_eq!(exr_file.num_tiles_at_level((0, 0)).unwrap(), (4, 2));
+
+        let window = exr_file.tile_data_window_at_level(0, 0, (2, 2)).unwrap();
+        let mut pixel_data = vec![(0.0f32, 0.0f32, 0.0f32); 25 * 15];
+        {
+            let mut fb = FrameBufferMut::new_with_origin(window.min.x, window.min.y, 25, 15);
+            fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut pixel_data);
+            exr_file.read_tile_at_level(0, 0, (2, 2), &mut fb).unwrap();
+
+            // There is only a single tile at this level.
+            assert!(exr_file.read_tile_at_level(1, 0, (2, 2), &mut fb).is_err());
+        }
+        assert!(pixel_data.iter().all(|&p| p == level_color(2)));
+
+        // And the smallest level in one go.
+        let mut pixel = [(0.0f32, 0.0f32, 0.0f32)];
+        {
+            let mut fb = FrameBufferMut::new(1, 1);
+            fb.insert_channels(&[("R", 0.0), ("G", 0.0), ("B", 0.0)], &mut pixel);
+            exr_file.read_level((6, 6), &mut fb).unwrap();
+        }
+        assert_eq!(pixel[0], level_color(6));
+    }
+}